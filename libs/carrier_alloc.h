@@ -0,0 +1,407 @@
+#ifndef CARRIER_ALLOC_H
+#define CARRIER_ALLOC_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+
+// Allocation tracking adds a header to every block and takes a global lock.
+// The meson build defines it from the alloc_tracking option, other builds
+// fall back to NDEBUG.
+#ifndef CMEM_TRACKING
+#ifdef NDEBUG
+#define CMEM_TRACKING 0
+#else
+#define CMEM_TRACKING 1
+#endif
+#endif
+
+// Default size of the per-frame arena
+#define CMEM_DEFAULT_FRAME_ARENA (1u << 20)
+
+// Alignment of arena and pool allocations
+#define CMEM_ALIGNMENT 16
+
+// Maximum number of leaked blocks listed at shutdown
+#define CMEM_MAX_LEAK_REPORTS 8
+
+#define CMEM_MAGIC 0x4D454D43u // "CMEM"
+
+// Allocator interface, realloc allocates when ptr is NULL and frees when size is zero
+typedef struct {
+    void* (*realloc)(void* ptr, size_t size, void* user);
+    void* user;
+} cmem_allocator;
+
+// Configuration structure for the alloc module, a zeroed allocator uses the C library
+typedef struct {
+    cmem_allocator allocator;
+    size_t frame_arena_size;
+} cmem_conf;
+
+// Linear arena, allocations are released all at once by a reset
+typedef struct {
+    char* base;
+    size_t size;
+    size_t offset;
+    size_t peak;
+} cmem_arena;
+
+// Fixed-size object pool, free objects form an intrusive list
+typedef struct {
+    char* memory;
+    size_t object_size;
+    size_t capacity;
+    size_t count;
+    size_t peak;
+    void* free_list;
+} cmem_pool;
+
+// Allocation counters, frame values are the ones of the last committed frame
+typedef struct {
+    size_t live_bytes;
+    size_t live_allocations;
+    size_t peak_bytes;
+    size_t frame_allocations;
+    size_t frame_bytes;
+    size_t peak_frame_allocations;
+    size_t arena_used;
+    size_t arena_peak;
+} cmem_stats;
+
+// Header in front of every tracked block
+typedef struct cmem_header {
+    struct cmem_header* prev;
+    struct cmem_header* next;
+    size_t size;
+    const char* file;
+    int line;
+    uint32_t magic;
+} cmem_header;
+
+#define CMEM_HEADER_SIZE ((sizeof(cmem_header) + CMEM_ALIGNMENT - 1) & ~(size_t)(CMEM_ALIGNMENT - 1))
+
+// Memory system structure for the alloc module
+typedef struct {
+    cmem_allocator allocator;
+    cmem_arena frame;
+    cmem_header blocks;
+    size_t live_bytes;
+    size_t live_allocations;
+    size_t peak_bytes;
+    size_t frame_allocations;
+    size_t frame_bytes;
+    size_t last_frame_allocations;
+    size_t last_frame_bytes;
+    size_t peak_frame_allocations;
+} cmem_system;
+
+// Allocation macros, the call site is recorded for the leak report
+#define cr_alloc(size) cr_alloc_resize(NULL, NULL, (size), __FILE__, __LINE__)
+#define cr_calloc(count, size) cr_alloc_zeroed(NULL, (count), (size), __FILE__, __LINE__)
+#define cr_realloc(ptr, size) cr_alloc_resize(NULL, (ptr), (size), __FILE__, __LINE__)
+#define cr_free(ptr) ((void)cr_alloc_resize(NULL, (ptr), 0, __FILE__, __LINE__))
+#define cr_realloc_with(allocator, ptr, size) cr_alloc_resize((allocator), (ptr), (size), __FILE__, __LINE__)
+#define cr_free_with(allocator, ptr) ((void)cr_alloc_resize((allocator), (ptr), 0, __FILE__, __LINE__))
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_alloc_setup(const cmem_conf* conf);
+CARRIER_API void cr_alloc_shutdown(void);
+CARRIER_API void* cr_alloc_resize(const cmem_allocator* allocator, void* ptr, size_t size, const char* file, int line);
+CARRIER_API void* cr_alloc_zeroed(const cmem_allocator* allocator, size_t count, size_t size, const char* file, int line);
+CARRIER_API void cr_alloc_frame_end(void);
+CARRIER_API cmem_stats cr_alloc_get_stats(void);
+CARRIER_API void* cr_frame_alloc(size_t size);
+
+CARRIER_API bool cr_arena_init(cmem_arena* arena, size_t size);
+CARRIER_API void cr_arena_shutdown(cmem_arena* arena);
+CARRIER_API void* cr_arena_alloc(cmem_arena* arena, size_t size);
+CARRIER_API void cr_arena_reset(cmem_arena* arena);
+
+CARRIER_API bool cr_pool_init(cmem_pool* pool, size_t object_size, size_t capacity);
+CARRIER_API void cr_pool_shutdown(cmem_pool* pool);
+CARRIER_API void* cr_pool_alloc(cmem_pool* pool);
+CARRIER_API void cr_pool_free(cmem_pool* pool, void* object);
+
+#endif // CARRIER_ALLOC_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_ALLOC_IMPLEMENTATION)
+#define CARRIER_ALLOC_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static void* cr_alloc_default(void* ptr, size_t size, void* user);
+#if CMEM_TRACKING
+static void cr_alloc_link(cmem_header* header);
+static void cr_alloc_unlink(cmem_header* header);
+#endif
+
+// Global variable to hold the memory system
+static cmem_system cmem = {0};
+
+// Guards the tracked block list, allocations may come from any thread
+static pthread_mutex_t cmem_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_alloc_setup(const cmem_conf* conf) {
+    cmem.allocator = conf->allocator;
+
+    const size_t frame_size = conf->frame_arena_size ? conf->frame_arena_size : CMEM_DEFAULT_FRAME_ARENA;
+    if (!cr_arena_init(&cmem.frame, frame_size)) {
+        cr_log(CR_ERROR, "Failed to initialize [carrier alloc module]");
+        return;
+    }
+    cr_log(CR_SUCCESS, "Successfully initialized [carrier alloc module]");
+}
+
+CARRIER_API void cr_alloc_shutdown(void) {
+    cr_arena_shutdown(&cmem.frame);
+
+#if CMEM_TRACKING
+    pthread_mutex_lock(&cmem_lock);
+    size_t reported = 0;
+    for (const cmem_header* header = cmem.blocks.next; header && header != &cmem.blocks && reported < CMEM_MAX_LEAK_REPORTS; header = header->next, reported++) {
+        cr_logf(CR_WARNING, "Leaked %zu bytes allocated at %s:%d", header->size, header->file, header->line);
+    }
+    if (cmem.live_allocations > 0) {
+        cr_logf(CR_WARNING, "Leaked %zu allocations (%zu bytes) at shutdown", cmem.live_allocations, cmem.live_bytes);
+    }
+    pthread_mutex_unlock(&cmem_lock);
+
+    cr_logf(CR_SUCCESS, "Successfully shutdown [carrier alloc module] (peak %zu bytes, peak %zu allocations per frame)",
+            cmem.peak_bytes, cmem.peak_frame_allocations);
+#else
+    cr_log(CR_SUCCESS, "Successfully shutdown [carrier alloc module]");
+#endif
+
+    cmem.allocator = (cmem_allocator){0};
+}
+
+CARRIER_API void* cr_alloc_resize(const cmem_allocator* allocator, void* ptr, size_t size, const char* file, int line) {
+    if (!allocator || !allocator->realloc) { allocator = &cmem.allocator; }
+    void* (*resize)(void*, size_t, void*) = allocator->realloc ? allocator->realloc : cr_alloc_default;
+
+#if CMEM_TRACKING
+    cmem_header* header = NULL;
+    if (ptr) {
+        header = (cmem_header*)((char*)ptr - CMEM_HEADER_SIZE);
+        if (header->magic != CMEM_MAGIC) {
+            cr_logf(CR_ERROR, "Failed to resize %p at %s:%d: not a tracked allocation", ptr, file, line);
+            return NULL;
+        }
+        cr_alloc_unlink(header);
+    }
+
+    if (size == 0) {
+        if (header) {
+            header->magic = 0;
+            resize(header, 0, allocator->user);
+        }
+        return NULL;
+    }
+
+    cmem_header* block = (cmem_header*)resize(header, CMEM_HEADER_SIZE + size, allocator->user);
+    if (!block) {
+        // The old block is still valid and tracked
+        if (header) { cr_alloc_link(header); }
+        return NULL;
+    }
+
+    block->size = size;
+    block->file = file;
+    block->line = line;
+    block->magic = CMEM_MAGIC;
+    cr_alloc_link(block);
+    return (char*)block + CMEM_HEADER_SIZE;
+#else
+    (void)file, (void)line;
+    return resize(ptr, size, allocator->user);
+#endif
+}
+
+CARRIER_API void* cr_alloc_zeroed(const cmem_allocator* allocator, size_t count, size_t size, const char* file, int line) {
+    if (size != 0 && count > SIZE_MAX / size) { return NULL; }
+
+    void* ptr = cr_alloc_resize(allocator, NULL, count * size, file, line);
+    if (ptr) { memset(ptr, 0, count * size); }
+    return ptr;
+}
+
+CARRIER_API void cr_alloc_frame_end(void) {
+    pthread_mutex_lock(&cmem_lock);
+    cmem.last_frame_allocations = cmem.frame_allocations;
+    cmem.last_frame_bytes = cmem.frame_bytes;
+    cmem.frame_allocations = cmem.frame_bytes = 0;
+    if (cmem.last_frame_allocations > cmem.peak_frame_allocations) {
+        cmem.peak_frame_allocations = cmem.last_frame_allocations;
+    }
+    pthread_mutex_unlock(&cmem_lock);
+
+    cr_arena_reset(&cmem.frame);
+}
+
+CARRIER_API cmem_stats cr_alloc_get_stats(void) {
+    pthread_mutex_lock(&cmem_lock);
+    const cmem_stats stats = {
+        .live_bytes = cmem.live_bytes,
+        .live_allocations = cmem.live_allocations,
+        .peak_bytes = cmem.peak_bytes,
+        .frame_allocations = cmem.last_frame_allocations,
+        .frame_bytes = cmem.last_frame_bytes,
+        .peak_frame_allocations = cmem.peak_frame_allocations,
+        .arena_used = cmem.frame.offset,
+        .arena_peak = cmem.frame.peak
+    };
+    pthread_mutex_unlock(&cmem_lock);
+    return stats;
+}
+
+CARRIER_API void* cr_frame_alloc(size_t size) {
+    // The frame arena belongs to the main thread and is reset by cg_commit
+    void* ptr = cr_arena_alloc(&cmem.frame, size);
+    if (!ptr) {
+        cr_logf(CR_WARNING, "Failed to allocate %zu bytes from the frame arena (%zu of %zu used)",
+                size, cmem.frame.offset, cmem.frame.size);
+    }
+    return ptr;
+}
+
+CARRIER_API bool cr_arena_init(cmem_arena* arena, size_t size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->base = (char*)cr_alloc(size);
+    if (!arena->base) { return false; }
+
+    arena->size = size;
+    return true;
+}
+
+CARRIER_API void cr_arena_shutdown(cmem_arena* arena) {
+    cr_free(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
+
+CARRIER_API void* cr_arena_alloc(cmem_arena* arena, size_t size) {
+    // Block starts are aligned relative to a base that is aligned itself
+    const size_t offset = (arena->offset + CMEM_ALIGNMENT - 1) & ~(size_t)(CMEM_ALIGNMENT - 1);
+    if (!arena->base || size > arena->size || offset > arena->size - size) { return NULL; }
+
+    arena->offset = offset + size;
+    return arena->base + offset;
+}
+
+CARRIER_API void cr_arena_reset(cmem_arena* arena) {
+    if (arena->offset > arena->peak) { arena->peak = arena->offset; }
+    arena->offset = 0;
+}
+
+CARRIER_API bool cr_pool_init(cmem_pool* pool, size_t object_size, size_t capacity) {
+    memset(pool, 0, sizeof(*pool));
+
+    // Every slot must hold the free list link and keep the next slot aligned
+    if (object_size < sizeof(void*)) { object_size = sizeof(void*); }
+    object_size = (object_size + CMEM_ALIGNMENT - 1) & ~(size_t)(CMEM_ALIGNMENT - 1);
+
+    pool->memory = (char*)cr_calloc(capacity, object_size);
+    if (!pool->memory) {
+        cr_logf(CR_ERROR, "Failed to allocate pool of %zu objects", capacity);
+        return false;
+    }
+
+    pool->object_size = object_size;
+    pool->capacity = capacity;
+
+    // Thread the list back to front so objects come out in address order
+    for (size_t i = capacity; i-- > 0;) {
+        void* object = pool->memory + i * object_size;
+        *(void**)object = pool->free_list;
+        pool->free_list = object;
+    }
+    return true;
+}
+
+CARRIER_API void cr_pool_shutdown(cmem_pool* pool) {
+    if (pool->count > 0) {
+        cr_logf(CR_WARNING, "Leaked %zu pool objects at shutdown", pool->count);
+    }
+    cr_free(pool->memory);
+    memset(pool, 0, sizeof(*pool));
+}
+
+CARRIER_API void* cr_pool_alloc(cmem_pool* pool) {
+    void* object = pool->free_list;
+    if (!object) { return NULL; }
+
+    pool->free_list = *(void**)object;
+    if (++pool->count > pool->peak) { pool->peak = pool->count; }
+    return object;
+}
+
+CARRIER_API void cr_pool_free(cmem_pool* pool, void* object) {
+    if (!object) { return; }
+
+    *(void**)object = pool->free_list;
+    pool->free_list = object;
+    pool->count--;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static void* cr_alloc_default(void* ptr, size_t size, void* user) {
+    (void)user;
+
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    return realloc(ptr, size);
+}
+
+#if CMEM_TRACKING
+static void cr_alloc_link(cmem_header* header) {
+    pthread_mutex_lock(&cmem_lock);
+    if (!cmem.blocks.next) { cmem.blocks.next = cmem.blocks.prev = &cmem.blocks; }
+
+    // The list is circular around a sentinel, so a block can be unlinked
+    // without knowing which list holds it
+    header->prev = &cmem.blocks;
+    header->next = cmem.blocks.next;
+    cmem.blocks.next->prev = header;
+    cmem.blocks.next = header;
+
+    cmem.live_allocations++;
+    cmem.live_bytes += header->size;
+    if (cmem.live_bytes > cmem.peak_bytes) { cmem.peak_bytes = cmem.live_bytes; }
+    cmem.frame_allocations++;
+    cmem.frame_bytes += header->size;
+    pthread_mutex_unlock(&cmem_lock);
+}
+
+static void cr_alloc_unlink(cmem_header* header) {
+    pthread_mutex_lock(&cmem_lock);
+    header->prev->next = header->next;
+    header->next->prev = header->prev;
+
+    cmem.live_allocations--;
+    cmem.live_bytes -= header->size;
+    pthread_mutex_unlock(&cmem_lock);
+}
+#endif
+
+#endif // CARRIER_ALLOC_IMPLEMENTATION
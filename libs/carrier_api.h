@@ -0,0 +1,19 @@
+#ifndef CARRIER_API_H
+#define CARRIER_API_H
+
+// The carrier headers only declare their functions. Exactly one translation
+// unit defines CARRIER_IMPLEMENTATION before including them and gets the
+// definitions and the module state, every other unit links against it.
+//
+// Defining CARRIER_STATIC instead gives the including unit a private copy of
+// every module, for tools that are a single file.
+#ifdef CARRIER_STATIC
+#ifndef CARRIER_IMPLEMENTATION
+#define CARRIER_IMPLEMENTATION
+#endif
+#define CARRIER_API static
+#else
+#define CARRIER_API extern
+#endif
+
+#endif // CARRIER_API_H
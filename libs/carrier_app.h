@@ -2,46 +2,140 @@
 #define CARRIER_APP_H
 
 #include <GL/glew.h>
+#include "../libs/carrier_api.h"
 #include "../libs/carrier_types.h"
 #include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_asset.h"
 #include <stdlib.h>
+#include <string.h>
 
 // PUBLIC API
 // These functions are intended to be used by the users of the library.
 // === === === === === ===
 // === === === === === ===
 
-static void cr_set_window_title(const char* new_title);
-static void cr_set_window_should_close(bool should_close);
-static float cr_get_time(void);
-static float cr_get_width(void);
-static float cr_get_height(void);
-static GLFWwindow* cr_get_window(void);
-static int cr_get_key(const capp_window* window, capp_keycode key);
+CARRIER_API void cr_set_window_title(const char* new_title);
+CARRIER_API void cr_set_window_should_close(bool should_close);
+CARRIER_API float cr_get_time(void);
+CARRIER_API float cr_get_width(void);
+CARRIER_API float cr_get_height(void);
+CARRIER_API GLFWwindow* cr_get_window(void);
+CARRIER_API void cr_request_redraw(void);
+CARRIER_API void cr_request_redraw_in(float seconds);
+CARRIER_API int cr_get_key(const capp_window* window, capp_keycode key);
+CARRIER_API bool cr_post_event(const capp_event* event);
+CARRIER_API bool cr_next_event(capp_event* event);
+CARRIER_API void cr_drain_events(void (*event_cb)(const capp_event* event));
+CARRIER_API size_t cr_get_dropped_events(void);
+CARRIER_API const capp_input* cr_get_input(void);
+static inline bool cr_key_held(const capp_input* input, capp_keycode key);
+static inline bool cr_key_pressed(const capp_input* input, capp_keycode key);
+static inline bool cr_key_released(const capp_input* input, capp_keycode key);
+static inline bool cr_mouse_held(const capp_input* input, capp_mousecode button);
+static inline bool cr_mouse_pressed(const capp_input* input, capp_mousecode button);
+static inline bool cr_mouse_released(const capp_input* input, capp_mousecode button);
+CARRIER_API void cr_replay_hash(const void* data, size_t size);
+CARRIER_API capp_replay_mode cr_replay_get_mode(void);
+CARRIER_API uint64_t cr_replay_get_tick(void);
+
+// The input queries are defined with the declarations so they inline into every caller
+static inline bool cr_key_held(const capp_input* input, capp_keycode key) {
+    return (input->keys[(unsigned)key >> 6] >> ((unsigned)key & 63u)) & 1u;
+}
+
+static inline bool cr_key_pressed(const capp_input* input, capp_keycode key) {
+    return (input->keys_pressed[(unsigned)key >> 6] >> ((unsigned)key & 63u)) & 1u;
+}
+
+static inline bool cr_key_released(const capp_input* input, capp_keycode key) {
+    return (input->keys_released[(unsigned)key >> 6] >> ((unsigned)key & 63u)) & 1u;
+}
+
+static inline bool cr_mouse_held(const capp_input* input, capp_mousecode button) {
+    return (input->buttons >> (unsigned)button) & 1u;
+}
+
+static inline bool cr_mouse_pressed(const capp_input* input, capp_mousecode button) {
+    return (input->buttons_pressed >> (unsigned)button) & 1u;
+}
+
+static inline bool cr_mouse_released(const capp_input* input, capp_mousecode button) {
+    return (input->buttons_released >> (unsigned)button) & 1u;
+}
+
+// Entry points of the application, called by CARRIER_MAIN_FUNC
+CARRIER_API void cr_setup(const capp_conf* conf);
+CARRIER_API void cr_run(const capp_conf* conf);
+
+// Macro to define the main function for the application
+#define CARRIER_MAIN_FUNC(argc, argv) \
+    int main(int argc, char* argv[]) { \
+        capp_conf conf = carrier_main(argc, argv); \
+        cr_setup(&conf); \
+        cr_run(&conf); \
+        return 0; \
+}
+
+#endif // CARRIER_APP_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_APP_IMPLEMENTATION)
+#define CARRIER_APP_IMPLEMENTATION
 
 // INTERNAL
 // These functions are intended for internal use within the library.
 // === === === === === ===
 // === === === === === ===
 
-static void cr_setup(const capp_conf* conf);
-static void cr_run(const capp_conf* conf);
 static void cr_setup_window(const capp_conf* conf, capp_window* cwindow);
+static void cr_event_queue_init(capp_event_queue* queue);
+static bool cr_event_queue_push(capp_event_queue* queue, const capp_event* event);
+static bool cr_event_queue_pop(capp_event_queue* queue, capp_event* event);
+static void cr_event_queue_flush(capp_event_queue* queue);
+static void cr_enqueue_event(const capp_event* event);
+static void cr_poll_events(const capp_conf* conf);
+static void cr_latch_input(void);
+static void cr_wait_events(const capp_conf* conf);
+static bool cr_is_hidden(void);
 static void error_callback(int error, const char* desc);
 static void mouse_callback(GLFWwindow* window, int button, int action, int mods);
 static void cursor_callback(GLFWwindow* window, double xpos, double ypos);
 static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+static void iconify_callback(GLFWwindow* window, int iconified);
+static void refresh_callback(GLFWwindow* window);
+static void cr_replay_open(const capp_replay_conf* conf);
+static void cr_replay_close(void);
+static bool cr_replay_tick(void);
+static void cr_replay_finish_tick(void);
+static bool cr_replay_next_event(capp_event* event);
+static void cr_replay_record_event(const capp_event* event);
+static void cr_replay_write_input(const capp_input* input);
+static bool cr_replay_read_input(capp_input* input);
+static void cr_replay_write(const void* data, size_t size);
+static bool cr_replay_read(void* data, size_t size);
+static int cr_replay_peek(void);
 
 // Global variable to hold the window context
 static capp_window* cwindow = {0};
 
+// Global variable to hold the pending application events
+static capp_event_queue cevents;
+
+// Global variables to hold the input state, updated by the window callbacks
+// and latched into the per-frame snapshot before every frame
+static capp_input cinput_live;
+static capp_input cinput;
+
+// Global variable to hold the input recording state
+static capp_replay creplay;
+
 // PUBLIC API IMPLEMENTATION
 // === === === === === ===
 // === === === === === ===
 
-static void cr_set_window_title(const char* new_title) {
+CARRIER_API void cr_set_window_title(const char* new_title) {
     if (cwindow->glfw_window) {
         glfwSetWindowTitle(cwindow->glfw_window, new_title);
         cwindow->window_title = new_title;
@@ -51,7 +145,7 @@ static void cr_set_window_title(const char* new_title) {
     }
 }
 
-static void cr_set_window_should_close(bool should_close) {
+CARRIER_API void cr_set_window_should_close(bool should_close) {
     if (cwindow->glfw_window) {
         glfwSetWindowShouldClose(cwindow->glfw_window, should_close);
     } else {
@@ -59,27 +153,107 @@ static void cr_set_window_should_close(bool should_close) {
     }
 }
 
-static float cr_get_time(void) {
+CARRIER_API float cr_get_time(void) {
+    // Recordings latch the clock once per tick so replays see the same values
+    if (creplay.mode != CAPP_REPLAY_OFF) { return (float)creplay.time; }
     return glfwGetTime();
 }
 
-static float cr_get_width(void) {
+CARRIER_API float cr_get_width(void) {
+    if (creplay.mode == CAPP_REPLAY_PLAY) { return creplay.width; }
     return cwindow->width;
 }
 
-static float cr_get_height(void) {
+CARRIER_API float cr_get_height(void) {
+    if (creplay.mode == CAPP_REPLAY_PLAY) { return creplay.height; }
     return cwindow->height;
 }
 
-static GLFWwindow* cr_get_window(void) {
+CARRIER_API GLFWwindow* cr_get_window(void) {
     return cwindow->glfw_window;
 }
 
-static int cr_get_key(const capp_window* window, capp_keycode key) {
+CARRIER_API void cr_request_redraw(void) {
+    // Safe to call from any thread, only the first request wakes the loop
+    if (!__atomic_exchange_n(&cwindow->redraw, true, __ATOMIC_ACQ_REL)) {
+        glfwPostEmptyEvent();
+    }
+}
+
+CARRIER_API void cr_request_redraw_in(float seconds) {
+    const double deadline = glfwGetTime() + seconds;
+
+    if (cwindow->redraw_deadline <= 0.0 || deadline < cwindow->redraw_deadline) {
+        cwindow->redraw_deadline = deadline;
+    }
+}
+
+CARRIER_API int cr_get_key(const capp_window* window, capp_keycode key) {
     return glfwGetKey(window->glfw_window, key);
 }
 
-static void cr_setup(const capp_conf* conf) {
+CARRIER_API bool cr_post_event(const capp_event* event) {
+    if (!cr_event_queue_push(&cevents, event)) { return false; }
+    cr_request_redraw();
+    return true;
+}
+
+CARRIER_API bool cr_next_event(capp_event* event) {
+    if (creplay.mode == CAPP_REPLAY_PLAY && cr_replay_next_event(event)) { return true; }
+
+    cr_event_queue_flush(&cevents);
+    while (cr_event_queue_pop(&cevents, event)) {
+        // While playing, window input comes from the recording and only custom events pass
+        if (creplay.mode == CAPP_REPLAY_PLAY && event->type != CAPP_EVENT_CUSTOM) { continue; }
+        if (creplay.mode == CAPP_REPLAY_RECORD) { cr_replay_record_event(event); }
+        return true;
+    }
+    return false;
+}
+
+CARRIER_API void cr_drain_events(void (*event_cb)(const capp_event* event)) {
+    capp_event event;
+
+    while (cr_next_event(&event)) {
+        if (event_cb) { event_cb(&event); }
+    }
+
+    const size_t dropped = cr_get_dropped_events();
+    if (dropped != cevents.reported) {
+        cr_logf(CR_WARNING, "Event queue overflow: %zu events dropped", dropped - cevents.reported);
+        cevents.reported = dropped;
+    }
+}
+
+CARRIER_API size_t cr_get_dropped_events(void) {
+    return __atomic_load_n(&cevents.dropped, __ATOMIC_RELAXED);
+}
+
+CARRIER_API const capp_input* cr_get_input(void) {
+    return &cinput;
+}
+
+CARRIER_API void cr_replay_hash(const void* data, size_t size) {
+    // FNV-1a over everything the frame folds in, compared per tick on replay
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        creplay.hash = (creplay.hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+CARRIER_API capp_replay_mode cr_replay_get_mode(void) {
+    return creplay.mode;
+}
+
+CARRIER_API uint64_t cr_replay_get_tick(void) {
+    return creplay.tick;
+}
+
+CARRIER_API void cr_setup(const capp_conf* conf) {
+    cr_log_setup(&conf->log);
+    cr_alloc_setup(&conf->memory);
+    cr_jobs_setup(&conf->jobs);
+
     if (!glfwInit()) {
         cr_log(CR_ERROR, "Failed to initialize [carrier app module]");
         exit(EXIT_FAILURE);
@@ -92,7 +266,7 @@ static void cr_setup(const capp_conf* conf) {
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, conf->resizable ? GLFW_TRUE : GLFW_FALSE);
 
-    cwindow = (capp_window*)malloc(sizeof(capp_window));
+    cwindow = (capp_window*)cr_alloc(sizeof(capp_window));
     if (!cwindow) {
         cr_log(CR_ERROR, "Failed to allocate memory for window");
         glfwTerminate();
@@ -100,6 +274,12 @@ static void cr_setup(const capp_conf* conf) {
     }
 
     cr_setup_window(conf, cwindow);
+    cr_event_queue_init(&cevents);
+
+    double xpos, ypos;
+    glfwGetCursorPos(cwindow->glfw_window, &xpos, &ypos);
+    cinput_live.mouse_x = cinput.mouse_x = (float)xpos;
+    cinput_live.mouse_y = cinput.mouse_y = (float)ypos;
 
     glfwMakeContextCurrent(cwindow->glfw_window);
     glfwSwapInterval(1);
@@ -109,23 +289,53 @@ static void cr_setup(const capp_conf* conf) {
     glfwSetCursorPosCallback(cwindow->glfw_window, cursor_callback);
     glfwSetScrollCallback(cwindow->glfw_window, scroll_callback);
     glfwSetFramebufferSizeCallback(cwindow->glfw_window, framebuffer_size_callback);
+    glfwSetWindowIconifyCallback(cwindow->glfw_window, iconify_callback);
+    glfwSetWindowRefreshCallback(cwindow->glfw_window, refresh_callback);
     glViewport(0, 0, cwindow->width, cwindow->height);
 
+    cr_replay_open(&conf->replay);
     if (conf->init_cb) { conf->init_cb(); }
 }
 
-static void cr_run(const capp_conf* conf) {
+CARRIER_API void cr_run(const capp_conf* conf) {
+    // A replay holds one recorded frame per tick, so it never waits for a redraw
+    const bool on_demand = conf->on_demand && creplay.mode != CAPP_REPLAY_PLAY;
+
     while (!glfwWindowShouldClose(cwindow->glfw_window)) {
+        // Minimized and zero-size windows have nothing to present, and
+        // on-demand apps sleep until a redraw is requested or a timer expires
+        if (on_demand || cr_is_hidden()) {
+            cr_wait_events(conf);
+            if (cr_is_hidden()) { continue; }
+            if (on_demand && !__atomic_exchange_n(&cwindow->redraw, false, __ATOMIC_ACQ_REL)) { continue; }
+        } else if (conf->late_input_latch) {
+            // Late latching polls right before the update step, so the frame
+            // sees input that arrived while the previous frame waited on the swap
+            cr_poll_events(conf);
+        }
+
+        cr_latch_input();
+        if (!cr_replay_tick()) {
+            glfwSetWindowShouldClose(cwindow->glfw_window, GLFW_TRUE);
+            continue;
+        }
+
         if (conf->frame_cb) { conf->frame_cb(); }
-        glfwPollEvents();
+        cr_replay_finish_tick();
+        if (!on_demand && !conf->late_input_latch) { cr_poll_events(conf); }
     }
 
+    cr_replay_close();
     if (conf->cleanup_cb) { conf->cleanup_cb(); }
 
     glfwDestroyWindow(cwindow->glfw_window);
     glfwTerminate();
-    free(cwindow);
+    cr_free(cwindow);
     cr_log(CR_SUCCESS, "Successfully shutdown [carrier app module]");
+    cr_jobs_shutdown();
+    cr_asset_unmount();
+    cr_alloc_shutdown();
+    cr_log_shutdown();
 }
 
 // INTERNAL IMPLEMENTATION
@@ -158,95 +368,578 @@ static void cr_setup_window(const capp_conf* conf, capp_window* cwindow) {
     cwindow->window_title = conf->window_title;
     cwindow->gl_major = conf->gl_major;
     cwindow->gl_minor = conf->gl_minor;
+    cwindow->iconified = false;
+    cwindow->redraw = true;
+    cwindow->redraw_deadline = 0.0;
     cr_log(CR_SUCCESS, "Successfully created window");
 }
 
 static void error_callback(int error, const char* desc) {
-    char message[256];
-    snprintf(message, sizeof(message), "Error %d: %s", error, desc);
-    cr_log(CR_ERROR, message);
+    cr_logf(CR_ERROR, "Error %d: %s", error, desc);
 }
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    const capp_conf* conf = (capp_conf*)glfwGetWindowUserPointer(window);
-
-    if (conf->event_cb) {
-        capp_event event;
+    (void)window;
+    capp_event event;
 
+    if (key >= 0 && key <= GLFW_KEY_LAST) {
+        const uint64_t bit = (uint64_t)1 << (key & 63);
         if (action == GLFW_PRESS) {
-            event.type = CAPP_EVENT_KEY_DOWN;
+            cinput_live.keys[key >> 6] |= bit;
+            cinput_live.keys_pressed[key >> 6] |= bit;
         } else if (action == GLFW_RELEASE) {
-            event.type = CAPP_EVENT_KEY_UP;
-        } else if (action == GLFW_REPEAT) {
-            event.type = CAPP_EVENT_KEY_REPEAT;
+            cinput_live.keys[key >> 6] &= ~bit;
+            cinput_live.keys_released[key >> 6] |= bit;
         }
+    }
 
-        event.input.key_code = (capp_keycode)key;
-        event.input.scancode = scancode;
-        event.input.action = action;
-        event.input.mods = mods;
-        conf->event_cb(&event);
+    if (action == GLFW_PRESS) {
+        event.type = CAPP_EVENT_KEY_DOWN;
+    } else if (action == GLFW_RELEASE) {
+        event.type = CAPP_EVENT_KEY_UP;
+    } else {
+        event.type = CAPP_EVENT_KEY_REPEAT;
     }
+
+    event.data.key.key_code = (capp_keycode)key;
+    event.data.key.scancode = scancode;
+    event.data.key.mods = mods;
+    cr_enqueue_event(&event);
 }
 
 static void mouse_callback(GLFWwindow* window, int button, int action, int mods) {
-    const capp_conf* conf = (capp_conf*)glfwGetWindowUserPointer(window);
+    capp_event event;
+    double xpos, ypos;
 
-    if (conf->event_cb) {
-        capp_event event;
-        event.type = action == GLFW_PRESS ? CAPP_EVENT_MOUSE_DOWN : CAPP_EVENT_MOUSE_UP;
-        event.input.mouse_code = (capp_mousecode)button;
-        event.input.action = action;
-        event.input.mods = mods;
-        glfwGetCursorPos(window, &event.input.mouse_x, &event.input.mouse_y);
-        conf->event_cb(&event);
+    if (button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST) {
+        const uint32_t bit = (uint32_t)1 << button;
+        if (action == GLFW_PRESS) {
+            cinput_live.buttons |= bit;
+            cinput_live.buttons_pressed |= bit;
+        } else {
+            cinput_live.buttons &= ~bit;
+            cinput_live.buttons_released |= bit;
+        }
     }
+
+    glfwGetCursorPos(window, &xpos, &ypos);
+    event.type = action == GLFW_PRESS ? CAPP_EVENT_MOUSE_DOWN : CAPP_EVENT_MOUSE_UP;
+    event.data.mouse.mouse_code = (capp_mousecode)button;
+    event.data.mouse.mods = mods;
+    event.data.mouse.x = (float)xpos;
+    event.data.mouse.y = (float)ypos;
+    cr_enqueue_event(&event);
 }
 
 static void cursor_callback(GLFWwindow* window, double xpos, double ypos) {
-    const capp_conf* conf = (capp_conf*)glfwGetWindowUserPointer(window);
+    (void)window;
+    capp_event event;
+
+    cinput_live.mouse_x = (float)xpos;
+    cinput_live.mouse_y = (float)ypos;
+
+    event.type = CAPP_EVENT_MOUSE_MOVE;
+    event.data.mouse.mouse_code = CAPP_MOUSE_LEFT;
+    event.data.mouse.mods = 0;
+    event.data.mouse.x = (float)xpos;
+    event.data.mouse.y = (float)ypos;
+    cr_enqueue_event(&event);
+}
 
-    if (conf->event_cb) {
-        capp_event event;
-        event.type = CAPP_EVENT_MOUSE_MOVE;
-        event.input.mouse_x = xpos;
-        event.input.mouse_y = ypos;
-        conf->event_cb(&event);
+static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    (void)window;
+    capp_event event;
+
+    cinput_live.scroll_x += (float)xoffset;
+    cinput_live.scroll_y += (float)yoffset;
+
+    event.type = CAPP_EVENT_MOUSE_SCROLL;
+    event.data.scroll.x = (float)xoffset;
+    event.data.scroll.y = (float)yoffset;
+    cr_enqueue_event(&event);
+}
+
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    (void)window;
+    capp_event event;
+
+    cwindow->width = width;
+    cwindow->height = height;
+
+    event.type = CAPP_EVENT_RESIZE;
+    event.data.resize.width = width;
+    event.data.resize.height = height;
+    cr_enqueue_event(&event);
+    glViewport(0, 0, width, height);
+}
+
+static void iconify_callback(GLFWwindow* window, int iconified) {
+    (void)window;
+    cwindow->iconified = iconified == GLFW_TRUE;
+    __atomic_store_n(&cwindow->redraw, true, __ATOMIC_RELEASE);
+}
+
+static void refresh_callback(GLFWwindow* window) {
+    (void)window;
+    __atomic_store_n(&cwindow->redraw, true, __ATOMIC_RELEASE);
+}
+
+static void cr_event_queue_init(capp_event_queue* queue) {
+    for (size_t i = 0; i < CAPP_EVENT_QUEUE_SIZE; i++) {
+        queue->cells[i].sequence = i;
     }
+    queue->tail = 0;
+    queue->head = 0;
+    queue->dropped = 0;
+    queue->reported = 0;
+    queue->has_pending = false;
 }
 
-static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-    const capp_conf* conf = (capp_conf*)glfwGetWindowUserPointer(window);
+static bool cr_event_queue_push(capp_event_queue* queue, const capp_event* event) {
+    const size_t mask = CAPP_EVENT_QUEUE_SIZE - 1;
+    size_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    capp_event_cell* cell;
+
+    // Claim a cell by advancing the tail, the cell is free once its sequence
+    // matches the claimed position
+    for (;;) {
+        cell = &queue->cells[pos & mask];
+        const size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        const ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&queue->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->event = *event;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool cr_event_queue_pop(capp_event_queue* queue, capp_event* event) {
+    const size_t pos = queue->head;
+    capp_event_cell* cell = &queue->cells[pos & (CAPP_EVENT_QUEUE_SIZE - 1)];
+    const size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
 
-    if (conf->event_cb) {
-        capp_event event;
-        event.type = CAPP_EVENT_MOUSE_SCROLL;
-        event.input.scroll_x = xoffset;
-        event.input.scroll_y = yoffset;
-        conf->event_cb(&event);
+    if ((ptrdiff_t)sequence - (ptrdiff_t)(pos + 1) < 0) {
+        return false;
     }
+
+    *event = cell->event;
+    queue->head = pos + 1;
+    __atomic_store_n(&cell->sequence, pos + CAPP_EVENT_QUEUE_SIZE, __ATOMIC_RELEASE);
+    return true;
 }
 
-static void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    const capp_conf* conf = (capp_conf*)glfwGetWindowUserPointer(window);
+static void cr_event_queue_flush(capp_event_queue* queue) {
+    if (queue->has_pending) {
+        queue->has_pending = false;
+        cr_event_queue_push(queue, &queue->pending);
+    }
+}
 
-    if (conf->event_cb) {
-        capp_event event;
-        event.type = CAPP_EVENT_RESIZE;
-        event.window.width = width;
-        event.window.height = height;
-        conf->event_cb(&event);
+static void cr_enqueue_event(const capp_event* event) {
+    // Window callbacks run on the main thread only, so the pending event can be
+    // coalesced without synchronization. It is published as soon as an event
+    // of another type arrives or the queue is drained.
+    __atomic_store_n(&cwindow->redraw, true, __ATOMIC_RELEASE);
+
+    const bool coalesce = event->type == CAPP_EVENT_MOUSE_MOVE ||
+                          event->type == CAPP_EVENT_MOUSE_SCROLL ||
+                          event->type == CAPP_EVENT_RESIZE;
+
+    if (cevents.has_pending && cevents.pending.type == event->type) {
+        if (event->type == CAPP_EVENT_MOUSE_SCROLL) {
+            cevents.pending.data.scroll.x += event->data.scroll.x;
+            cevents.pending.data.scroll.y += event->data.scroll.y;
+        } else {
+            cevents.pending = *event;
+        }
+        return;
+    }
+
+    cr_event_queue_flush(&cevents);
+
+    if (coalesce) {
+        cevents.pending = *event;
+        cevents.has_pending = true;
+    } else {
+        cr_event_queue_push(&cevents, event);
     }
-    glViewport(0, 0, width, height);
 }
 
-// Macro to define the main function for the application
-#define CARRIER_MAIN_FUNC(argc, argv) \
-    int main(int argc, char* argv[]) { \
-        capp_conf conf = carrier_main(argc, argv); \
-        cr_setup(&conf); \
-        cr_run(&conf); \
-        return 0; \
+static void cr_poll_events(const capp_conf* conf) {
+    glfwPollEvents();
+    if (!conf->manual_event_drain) { cr_drain_events(conf->event_cb); }
 }
 
-#endif // CARRIER_APP_H
+static void cr_wait_events(const capp_conf* conf) {
+    if (cr_is_hidden()) {
+        glfwWaitEvents();
+    } else if (__atomic_load_n(&cwindow->redraw, __ATOMIC_ACQUIRE)) {
+        glfwPollEvents();
+    } else if (cwindow->redraw_deadline > 0.0) {
+        const double timeout = cwindow->redraw_deadline - glfwGetTime();
+        if (timeout > 0.0) {
+            glfwWaitEventsTimeout(timeout);
+        } else {
+            glfwPollEvents();
+        }
+    } else {
+        glfwWaitEvents();
+    }
+
+    if (!conf->manual_event_drain) { cr_drain_events(conf->event_cb); }
+
+    if (cwindow->redraw_deadline > 0.0 && glfwGetTime() >= cwindow->redraw_deadline) {
+        cwindow->redraw_deadline = 0.0;
+        __atomic_store_n(&cwindow->redraw, true, __ATOMIC_RELEASE);
+    }
+}
+
+static bool cr_is_hidden(void) {
+    return cwindow->iconified || cwindow->width <= 0 || cwindow->height <= 0;
+}
+
+static void cr_latch_input(void) {
+    for (int i = 0; i < CAPP_KEY_WORDS; i++) {
+        cinput.keys[i] = cinput_live.keys[i];
+        cinput.keys_pressed[i] = cinput_live.keys_pressed[i];
+        cinput.keys_released[i] = cinput_live.keys_released[i];
+        cinput_live.keys_pressed[i] = 0;
+        cinput_live.keys_released[i] = 0;
+    }
+
+    cinput.buttons = cinput_live.buttons;
+    cinput.buttons_pressed = cinput_live.buttons_pressed;
+    cinput.buttons_released = cinput_live.buttons_released;
+    cinput_live.buttons_pressed = 0;
+    cinput_live.buttons_released = 0;
+
+    cinput.delta_x = cinput_live.mouse_x - cinput.mouse_x;
+    cinput.delta_y = cinput_live.mouse_y - cinput.mouse_y;
+    cinput.mouse_x = cinput_live.mouse_x;
+    cinput.mouse_y = cinput_live.mouse_y;
+
+    cinput.scroll_x = cinput_live.scroll_x;
+    cinput.scroll_y = cinput_live.scroll_y;
+    cinput_live.scroll_x = 0.0f;
+    cinput_live.scroll_y = 0.0f;
+}
+
+static void cr_replay_open(const capp_replay_conf* conf) {
+    memset(&creplay, 0, sizeof(creplay));
+    creplay.hash = 0xcbf29ce484222325ull;
+    creplay.pending_entry = -1;
+    creplay.width = cwindow->width;
+    creplay.height = cwindow->height;
+
+    const char* path = conf->replay_path ? conf->replay_path : conf->record_path;
+    if (!path) { return; }
+
+    creplay.file = fopen(path, conf->replay_path ? "rb" : "wb");
+    if (!creplay.file) {
+        cr_logf(CR_ERROR, "Failed to open input recording '%s'", path);
+        return;
+    }
+
+    // The header stores the timestep bits so replays advance the clock exactly as recorded
+    uint32_t header[5] = { CAPP_REPLAY_MAGIC, CAPP_REPLAY_VERSION, (uint32_t)cwindow->width, (uint32_t)cwindow->height, 0 };
+    if (conf->replay_path) {
+        if (!cr_replay_read(header, sizeof(header)) || header[0] != CAPP_REPLAY_MAGIC || header[1] != CAPP_REPLAY_VERSION) {
+            cr_logf(CR_ERROR, "Failed to read input recording '%s': invalid header", path);
+            fclose(creplay.file);
+            creplay.file = NULL;
+            return;
+        }
+
+        creplay.mode = CAPP_REPLAY_PLAY;
+        creplay.width = (int)header[2];
+        creplay.height = (int)header[3];
+        memcpy(&creplay.timestep, &header[4], sizeof(creplay.timestep));
+
+        // Replays run as fast as possible, the recorded clock keeps them deterministic
+        glfwSwapInterval(0);
+    } else {
+        creplay.mode = CAPP_REPLAY_RECORD;
+        creplay.timestep = conf->timestep > 0.0f ? conf->timestep : 0.0f;
+        memcpy(&header[4], &creplay.timestep, sizeof(creplay.timestep));
+        cr_replay_write(header, sizeof(header));
+    }
+
+    creplay.started = glfwGetTime();
+    cr_logf(CR_SUCCESS, "Successfully opened input recording '%s' for %s", path,
+            creplay.mode == CAPP_REPLAY_PLAY ? "replay" : "recording");
+}
+
+static void cr_replay_close(void) {
+    if (!creplay.file) { return; }
+
+    const double elapsed = glfwGetTime() - creplay.started;
+    if (creplay.mode == CAPP_REPLAY_RECORD) {
+        const uint8_t entry = CAPP_REPLAY_END;
+        cr_replay_write(&entry, sizeof(entry));
+        cr_logf(CR_SUCCESS, "Successfully recorded %llu ticks", (unsigned long long)creplay.tick);
+    } else if (creplay.failed) {
+        cr_logf(CR_ERROR, "Failed to replay input recording after %llu ticks", (unsigned long long)creplay.tick);
+    } else if (creplay.divergences > 0) {
+        cr_logf(CR_ERROR, "Replay diverged at tick %llu (%llu of %llu ticks differ)",
+                (unsigned long long)creplay.first_divergence, (unsigned long long)creplay.divergences,
+                (unsigned long long)creplay.tick);
+    } else {
+        cr_logf(CR_SUCCESS, "Successfully replayed %llu ticks in %.2f s (%.3f ms per tick)",
+                (unsigned long long)creplay.tick, elapsed, creplay.tick ? elapsed * 1000.0 / (double)creplay.tick : 0.0);
+    }
+
+    fclose(creplay.file);
+    creplay.file = NULL;
+}
+
+static bool cr_replay_tick(void) {
+    if (!creplay.file) { return true; }
+
+    if (creplay.mode == CAPP_REPLAY_RECORD) {
+        creplay.time = creplay.timestep > 0.0f ? (double)creplay.tick * creplay.timestep : glfwGetTime();
+
+        const uint8_t entry = CAPP_REPLAY_TICK;
+        cr_replay_write(&entry, sizeof(entry));
+        cr_replay_write(&creplay.time, sizeof(creplay.time));
+        cr_replay_write_input(&cinput);
+    } else {
+        // Events nobody drained during the previous tick are dropped, as they would have been
+        int entry;
+        capp_event skipped;
+        while ((entry = cr_replay_peek()) == CAPP_REPLAY_EVENT) { cr_replay_next_event(&skipped); }
+
+        creplay.pending_entry = -1;
+        if (entry != CAPP_REPLAY_TICK) { return false; }
+        if (!cr_replay_read(&creplay.time, sizeof(creplay.time)) || !cr_replay_read_input(&cinput)) {
+            return false;
+        }
+
+        // A fixed timestep recording replays on the same step whatever clock was stored
+        if (creplay.timestep > 0.0f) { creplay.time = (double)creplay.tick * creplay.timestep; }
+    }
+
+    creplay.tick++;
+    creplay.hash = 0xcbf29ce484222325ull;
+    return true;
+}
+
+static void cr_replay_finish_tick(void) {
+    if (!creplay.file) { return; }
+
+    // The hash is stored right after the frame that folded it in, so a
+    // divergence is reported at the tick that produced it
+    if (creplay.mode == CAPP_REPLAY_RECORD) {
+        const uint8_t entry = CAPP_REPLAY_HASH;
+        cr_replay_write(&entry, sizeof(entry));
+        cr_replay_write(&creplay.hash, sizeof(creplay.hash));
+        return;
+    }
+
+    int entry;
+    capp_event skipped;
+    while ((entry = cr_replay_peek()) == CAPP_REPLAY_EVENT) { cr_replay_next_event(&skipped); }
+
+    uint64_t hash = 0;
+    creplay.pending_entry = -1;
+    if (entry != CAPP_REPLAY_HASH || !cr_replay_read(&hash, sizeof(hash))) {
+        cr_logf(CR_ERROR, "Failed to read the state hash of tick %llu", (unsigned long long)creplay.tick);
+        creplay.failed = true;
+        return;
+    }
+
+    if (hash != creplay.hash && creplay.divergences++ == 0) {
+        creplay.first_divergence = creplay.tick;
+        cr_logf(CR_ERROR, "Replay diverged at tick %llu", (unsigned long long)creplay.tick);
+    }
+}
+
+static bool cr_replay_next_event(capp_event* event) {
+    if (cr_replay_peek() != CAPP_REPLAY_EVENT) { return false; }
+    creplay.pending_entry = -1;
+
+    uint8_t type;
+    if (!cr_replay_read(&type, sizeof(type))) { return false; }
+    memset(event, 0, sizeof(*event));
+    event->type = (capp_event_type)type;
+
+    switch (event->type) {
+        case CAPP_EVENT_KEY_DOWN:
+        case CAPP_EVENT_KEY_UP:
+        case CAPP_EVENT_KEY_REPEAT:
+            return cr_replay_read(&event->data.key, sizeof(event->data.key));
+        case CAPP_EVENT_MOUSE_DOWN:
+        case CAPP_EVENT_MOUSE_UP:
+        case CAPP_EVENT_MOUSE_MOVE:
+            return cr_replay_read(&event->data.mouse, sizeof(event->data.mouse));
+        case CAPP_EVENT_MOUSE_SCROLL:
+            return cr_replay_read(&event->data.scroll, sizeof(event->data.scroll));
+        case CAPP_EVENT_RESIZE:
+            if (!cr_replay_read(&event->data.resize, sizeof(event->data.resize))) { return false; }
+            creplay.width = event->data.resize.width;
+            creplay.height = event->data.resize.height;
+            return true;
+        default:
+            cr_logf(CR_ERROR, "Failed to read input recording: unknown event type %u", type);
+            creplay.failed = true;
+            return false;
+    }
+}
+
+static void cr_replay_record_event(const capp_event* event) {
+    // Custom events carry pointers and are posted again by the code that made them
+    if (event->type == CAPP_EVENT_CUSTOM) { return; }
+
+    const uint8_t header[2] = { CAPP_REPLAY_EVENT, (uint8_t)event->type };
+    cr_replay_write(header, sizeof(header));
+
+    switch (event->type) {
+        case CAPP_EVENT_KEY_DOWN:
+        case CAPP_EVENT_KEY_UP:
+        case CAPP_EVENT_KEY_REPEAT:
+            cr_replay_write(&event->data.key, sizeof(event->data.key));
+            break;
+        case CAPP_EVENT_MOUSE_DOWN:
+        case CAPP_EVENT_MOUSE_UP:
+        case CAPP_EVENT_MOUSE_MOVE:
+            cr_replay_write(&event->data.mouse, sizeof(event->data.mouse));
+            break;
+        case CAPP_EVENT_MOUSE_SCROLL:
+            cr_replay_write(&event->data.scroll, sizeof(event->data.scroll));
+            break;
+        default:
+            cr_replay_write(&event->data.resize, sizeof(event->data.resize));
+            break;
+    }
+}
+
+static void cr_replay_write_input(const capp_input* input) {
+    const capp_input* previous = &creplay.previous;
+    uint8_t flags = 0;
+
+    // Only what changed since the previous tick is stored, idle ticks take a few bytes
+    if (memcmp(input->keys, previous->keys, sizeof(input->keys)) != 0) { flags |= CAPP_REPLAY_KEYS; }
+    for (int i = 0; i < CAPP_KEY_WORDS; i++) {
+        if (input->keys_pressed[i]) { flags |= CAPP_REPLAY_KEYS_PRESSED; }
+        if (input->keys_released[i]) { flags |= CAPP_REPLAY_KEYS_RELEASED; }
+    }
+    if (input->buttons != previous->buttons || input->buttons_pressed || input->buttons_released) { flags |= CAPP_REPLAY_BUTTONS; }
+    if (input->mouse_x != previous->mouse_x || input->mouse_y != previous->mouse_y || input->delta_x != 0.0f || input->delta_y != 0.0f) {
+        flags |= CAPP_REPLAY_MOUSE;
+    }
+    if (input->scroll_x != 0.0f || input->scroll_y != 0.0f) { flags |= CAPP_REPLAY_SCROLL; }
+    if (cwindow->width != creplay.width || cwindow->height != creplay.height) { flags |= CAPP_REPLAY_SIZE; }
+
+    cr_replay_write(&flags, sizeof(flags));
+    if (flags & CAPP_REPLAY_KEYS) { cr_replay_write(input->keys, sizeof(input->keys)); }
+    if (flags & CAPP_REPLAY_KEYS_PRESSED) { cr_replay_write(input->keys_pressed, sizeof(input->keys_pressed)); }
+    if (flags & CAPP_REPLAY_KEYS_RELEASED) { cr_replay_write(input->keys_released, sizeof(input->keys_released)); }
+    if (flags & CAPP_REPLAY_BUTTONS) {
+        const uint32_t buttons[3] = { input->buttons, input->buttons_pressed, input->buttons_released };
+        cr_replay_write(buttons, sizeof(buttons));
+    }
+    if (flags & CAPP_REPLAY_MOUSE) {
+        const float mouse[4] = { input->mouse_x, input->mouse_y, input->delta_x, input->delta_y };
+        cr_replay_write(mouse, sizeof(mouse));
+    }
+    if (flags & CAPP_REPLAY_SCROLL) {
+        const float scroll[2] = { input->scroll_x, input->scroll_y };
+        cr_replay_write(scroll, sizeof(scroll));
+    }
+    if (flags & CAPP_REPLAY_SIZE) {
+        const int32_t size[2] = { cwindow->width, cwindow->height };
+        cr_replay_write(size, sizeof(size));
+        creplay.width = cwindow->width;
+        creplay.height = cwindow->height;
+    }
+
+    creplay.previous = *input;
+}
+
+static bool cr_replay_read_input(capp_input* input) {
+    const capp_input* previous = &creplay.previous;
+    uint8_t flags;
+    if (!cr_replay_read(&flags, sizeof(flags))) { return false; }
+
+    memset(input, 0, sizeof(*input));
+    memcpy(input->keys, previous->keys, sizeof(input->keys));
+    input->buttons = previous->buttons;
+    input->mouse_x = previous->mouse_x;
+    input->mouse_y = previous->mouse_y;
+
+    bool ok = true;
+    if (flags & CAPP_REPLAY_KEYS) { ok = ok && cr_replay_read(input->keys, sizeof(input->keys)); }
+    if (flags & CAPP_REPLAY_KEYS_PRESSED) { ok = ok && cr_replay_read(input->keys_pressed, sizeof(input->keys_pressed)); }
+    if (flags & CAPP_REPLAY_KEYS_RELEASED) { ok = ok && cr_replay_read(input->keys_released, sizeof(input->keys_released)); }
+    if (flags & CAPP_REPLAY_BUTTONS) {
+        uint32_t buttons[3] = {0};
+        ok = ok && cr_replay_read(buttons, sizeof(buttons));
+        input->buttons = buttons[0];
+        input->buttons_pressed = buttons[1];
+        input->buttons_released = buttons[2];
+    }
+    if (flags & CAPP_REPLAY_MOUSE) {
+        float mouse[4] = {0};
+        ok = ok && cr_replay_read(mouse, sizeof(mouse));
+        input->mouse_x = mouse[0];
+        input->mouse_y = mouse[1];
+        input->delta_x = mouse[2];
+        input->delta_y = mouse[3];
+    }
+    if (flags & CAPP_REPLAY_SCROLL) {
+        float scroll[2] = {0};
+        ok = ok && cr_replay_read(scroll, sizeof(scroll));
+        input->scroll_x = scroll[0];
+        input->scroll_y = scroll[1];
+    }
+    if (flags & CAPP_REPLAY_SIZE) {
+        int32_t size[2] = {0};
+        ok = ok && cr_replay_read(size, sizeof(size));
+        creplay.width = size[0];
+        creplay.height = size[1];
+    }
+
+    creplay.previous = *input;
+    return ok;
+}
+
+static void cr_replay_write(const void* data, size_t size) {
+    if (creplay.failed) { return; }
+
+    if (fwrite(data, 1, size, creplay.file) != size) {
+        cr_log(CR_ERROR, "Failed to write input recording");
+        creplay.failed = true;
+    }
+}
+
+static bool cr_replay_read(void* data, size_t size) {
+    if (creplay.failed) { return false; }
+
+    if (fread(data, 1, size, creplay.file) != size) {
+        cr_log(CR_ERROR, "Failed to read input recording: unexpected end of file");
+        creplay.failed = true;
+        return false;
+    }
+    return true;
+}
+
+static int cr_replay_peek(void) {
+    // The entry kind is read ahead so events stop at the next tick boundary
+    if (creplay.pending_entry < 0 && !creplay.failed) {
+        uint8_t entry;
+        creplay.pending_entry = fread(&entry, 1, 1, creplay.file) == 1 ? entry : CAPP_REPLAY_END;
+    }
+    return creplay.pending_entry;
+}
+
+#endif // CARRIER_APP_IMPLEMENTATION
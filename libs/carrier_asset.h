@@ -0,0 +1,314 @@
+#ifndef CARRIER_ASSET_H
+#define CARRIER_ASSET_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+
+#define CASSET_MAGIC 0x4B415043u // "CPAK"
+#define CASSET_VERSION 1
+#define CASSET_ALIGNMENT 16
+#define CASSET_DEFAULT_ARCHIVE "assets.pak"
+#define CASSET_PATH_SIZE 512
+
+// Archive header, followed by the index sorted by hash, the name blob and the
+// data blob. Every payload is 16-byte aligned and followed by a NUL byte.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} casset_header;
+
+// Archive index entry, offsets are relative to the start of the archive
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t name_offset;
+    uint32_t name_length;
+} casset_entry;
+
+// Zero-copy view of an asset, valid until the archive is unmounted
+typedef struct {
+    const char* data;
+    size_t size;
+} casset_view;
+
+// Mapping of a loose file used as a development override, kept by name
+// until the archive is unmounted
+typedef struct {
+    uint64_t hash;
+    char* name;
+    void* base;
+    size_t size;
+} casset_mapping;
+
+// Archive structure for the asset module
+typedef struct {
+    void* base;
+    size_t size;
+    const casset_entry* entries;
+    uint32_t count;
+    char loose_dir[CASSET_PATH_SIZE];
+    casset_mapping* loose;
+    size_t loose_count;
+    bool mounted;
+} casset_archive;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cr_asset_mount(const char* archive_path, const char* loose_dir);
+CARRIER_API void cr_asset_unmount(void);
+CARRIER_API casset_view cr_asset_get(const char* name);
+CARRIER_API uint64_t cr_asset_hash(const char* name, size_t length);
+
+#endif // CARRIER_ASSET_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_ASSET_IMPLEMENTATION)
+#define CARRIER_ASSET_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static bool cr_asset_map_file(const char* path, void** base, size_t* size);
+static bool cr_asset_default_path(char* path, size_t size);
+static casset_view cr_asset_find(const char* name);
+static casset_view cr_asset_get_loose(const char* name);
+
+// Global variable to hold the mounted archive
+static casset_archive carchive = {0};
+
+// Serializes lazy mounting and loose file mapping, lookups come from loader threads too
+static pthread_mutex_t carchive_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cr_asset_mount(const char* archive_path, const char* loose_dir) {
+    char default_path[CASSET_PATH_SIZE];
+
+    cr_asset_unmount();
+    carchive.mounted = true;
+
+    // Loose files under this directory take precedence over packed assets
+    if (!loose_dir) { loose_dir = getenv("CARRIER_ASSET_DIR"); }
+    if (loose_dir) {
+        snprintf(carchive.loose_dir, sizeof(carchive.loose_dir), "%s", loose_dir);
+    }
+
+    if (!archive_path) {
+        if (!cr_asset_default_path(default_path, sizeof(default_path))) { return false; }
+        archive_path = default_path;
+    }
+
+    if (!cr_asset_map_file(archive_path, &carchive.base, &carchive.size)) {
+        cr_log(CR_WARNING, "Failed to map asset archive, using loose files only");
+        return false;
+    }
+
+    const casset_header* header = (const casset_header*)carchive.base;
+    const bool valid = carchive.size >= sizeof(casset_header) &&
+                       header->magic == CASSET_MAGIC &&
+                       header->version == CASSET_VERSION &&
+                       sizeof(casset_header) + (uint64_t)header->count * sizeof(casset_entry) <= carchive.size;
+
+    if (!valid) {
+        cr_log(CR_ERROR, "Failed to mount asset archive: invalid header");
+        munmap(carchive.base, carchive.size);
+        carchive.base = NULL;
+        carchive.size = 0;
+        return false;
+    }
+
+    carchive.entries = (const casset_entry*)(header + 1);
+    carchive.count = header->count;
+
+    for (uint32_t i = 0; i < carchive.count; i++) {
+        const casset_entry* entry = &carchive.entries[i];
+        if (entry->offset + entry->size > carchive.size ||
+            (uint64_t)entry->name_offset + entry->name_length > carchive.size) {
+            cr_log(CR_ERROR, "Failed to mount asset archive: corrupt index");
+            munmap(carchive.base, carchive.size);
+            carchive.base = NULL;
+            carchive.size = 0;
+            carchive.entries = NULL;
+            carchive.count = 0;
+            return false;
+        }
+    }
+
+    cr_logf(CR_SUCCESS, "Successfully mounted asset archive (%u assets)", carchive.count);
+    return true;
+}
+
+CARRIER_API void cr_asset_unmount(void) {
+    if (carchive.base) {
+        munmap(carchive.base, carchive.size);
+    }
+
+    for (size_t i = 0; i < carchive.loose_count; i++) {
+        munmap(carchive.loose[i].base, carchive.loose[i].size);
+        cr_free(carchive.loose[i].name);
+    }
+    cr_free(carchive.loose);
+
+    memset(&carchive, 0, sizeof(carchive));
+}
+
+CARRIER_API casset_view cr_asset_get(const char* name) {
+    pthread_mutex_lock(&carchive_lock);
+    if (!carchive.mounted) {
+        cr_asset_mount(NULL, NULL);
+    }
+
+    if (carchive.loose_dir[0] != '\0') {
+        casset_view view = cr_asset_get_loose(name);
+        if (view.data) {
+            pthread_mutex_unlock(&carchive_lock);
+            return view;
+        }
+    }
+
+    casset_view view = cr_asset_find(name);
+    pthread_mutex_unlock(&carchive_lock);
+    if (!view.data) {
+        cr_logf(CR_ERROR, "Failed to find asset '%s'", name);
+    }
+    return view;
+}
+
+CARRIER_API uint64_t cr_asset_hash(const char* name, size_t length) {
+    // FNV-1a, shared with the archive packer
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static bool cr_asset_map_file(const char* path, void** base, size_t* size) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) { return false; }
+
+    *base = mapping;
+    *size = (size_t)info.st_size;
+    return true;
+}
+
+static bool cr_asset_default_path(char* path, size_t size) {
+    // Resolve the archive next to the executable so the working directory
+    // does not matter
+    char exe[CASSET_PATH_SIZE];
+    const ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+
+    if (length <= 0) {
+        snprintf(path, size, "%s", CASSET_DEFAULT_ARCHIVE);
+        return true;
+    }
+    exe[length] = '\0';
+
+    char* slash = strrchr(exe, '/');
+    if (slash) { *slash = '\0'; }
+
+    const int written = snprintf(path, size, "%s/%s", exe, CASSET_DEFAULT_ARCHIVE);
+    if (written < 0 || (size_t)written >= size) {
+        cr_log(CR_ERROR, "Failed to resolve asset archive path: path too long");
+        return false;
+    }
+    return true;
+}
+
+static casset_view cr_asset_find(const char* name) {
+    const size_t length = strlen(name);
+    const uint64_t hash = cr_asset_hash(name, length);
+    const char* base = (const char*)carchive.base;
+
+    // Binary search for the first entry with a matching hash, then compare
+    // names to resolve collisions
+    uint32_t low = 0, high = carchive.count;
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        if (carchive.entries[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for (uint32_t i = low; i < carchive.count && carchive.entries[i].hash == hash; i++) {
+        const casset_entry* entry = &carchive.entries[i];
+        if (entry->name_length == length && memcmp(base + entry->name_offset, name, length) == 0) {
+            return (casset_view){ base + entry->offset, (size_t)entry->size };
+        }
+    }
+    return (casset_view){ NULL, 0 };
+}
+
+static casset_view cr_asset_get_loose(const char* name) {
+    const size_t length = strlen(name);
+    const uint64_t hash = cr_asset_hash(name, length);
+
+    // Repeated loads of the same file, e.g. streamed reloads, share one mapping
+    for (size_t i = 0; i < carchive.loose_count; i++) {
+        const casset_mapping* mapping = &carchive.loose[i];
+        if (mapping->hash == hash && strcmp(mapping->name, name) == 0) {
+            return (casset_view){ (const char*)mapping->base, mapping->size };
+        }
+    }
+
+    char path[CASSET_PATH_SIZE];
+    const int written = snprintf(path, sizeof(path), "%s/%s", carchive.loose_dir, name);
+    if (written < 0 || (size_t)written >= sizeof(path)) { return (casset_view){ NULL, 0 }; }
+
+    void* base;
+    size_t size;
+    if (!cr_asset_map_file(path, &base, &size)) { return (casset_view){ NULL, 0 }; }
+
+    char* copy = (char*)cr_alloc(length + 1);
+    casset_mapping* loose = copy ? (casset_mapping*)cr_realloc(carchive.loose, (carchive.loose_count + 1) * sizeof(casset_mapping)) : NULL;
+    if (!loose) {
+        munmap(base, size);
+        cr_free(copy);
+        cr_log(CR_ERROR, "Failed to allocate memory for loose asset");
+        return (casset_view){ NULL, 0 };
+    }
+    memcpy(copy, name, length + 1);
+
+    carchive.loose = loose;
+    carchive.loose[carchive.loose_count++] = (casset_mapping){ hash, copy, base, size };
+    return (casset_view){ (const char*)base, size };
+}
+
+#endif // CARRIER_ASSET_IMPLEMENTATION
@@ -4,37 +4,112 @@
 #include <GL/glew.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
 #include "../libs/carrier_types.h"
 #include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_asset.h"
 
 // PUBLIC API
 // These functions are intended to be used by the users of the library.
 // === === === === === ===
 // === === === === === ===
 
-static void cg_setup(const cg_conf* conf);
-static void cg_shutdown(void);
-static void cg_begin_pass(const cg_pass_action* action);
-static void cg_end_pass(void);
-static void cg_commit();
-static cg_shader cg_load_shader(const char* vertex_path, const char* fragment_path);
-static cg_bindings cg_make_buffer(const cg_buffer_conf* buffer_conf);
-static cg_pipeline cg_make_pipeline(const cg_pipeline_conf* conf);
-static void cg_apply_pipeline(cg_pipeline* pipeline);
-static void cg_apply_bindings(cg_bindings* bindings);
-static void cg_render(cg_bindings* bindings, int base_element, int num_elements, int num_instances);
-static cg_uniform cg_get_location(cg_shader shader, const char* name);
-static void cg_set_uniform_mat4(cg_uniform location, const GLfloat* value);
-static void cg_set_uniform_vec4(cg_uniform location, const GLfloat* value);
-static void cg_set_wireframe(bool enable);
+CARRIER_API void cg_setup(const cg_conf* conf);
+CARRIER_API void cg_shutdown(void);
+CARRIER_API void cg_begin_pass(const cg_pass_action* action);
+CARRIER_API void cg_begin_framebuffer_pass(const cg_framebuffer* framebuffer, const cg_pass_action* action);
+CARRIER_API void cg_end_pass(void);
+CARRIER_API void cg_commit(void);
+CARRIER_API cg_shader cg_load_shader(const char* vertex_path, const char* fragment_path);
+CARRIER_API cg_shader cg_load_shader_defines(const char* vertex_path, const char* fragment_path, const char* const* defines, size_t define_count);
+CARRIER_API cg_shader cg_load_shader_spirv(const void* vertex_binary, size_t vertex_size, const void* fragment_binary, size_t fragment_size);
+CARRIER_API cg_shader cg_load_compute_shader(const char* path);
+CARRIER_API void cg_destroy_shader(cg_shader shader);
+CARRIER_API cg_shader_variants cg_make_shader_variants(const cg_shader_variants_conf* conf);
+CARRIER_API cg_shader cg_get_shader_variant(cg_shader_variants* variants, cg_variant_key key);
+CARRIER_API void cg_destroy_shader_variants(cg_shader_variants* variants);
+CARRIER_API cg_bindings cg_make_buffer(const cg_buffer_conf* buffer_conf);
+CARRIER_API void cg_destroy_buffer(cg_bindings bindings);
+CARRIER_API cg_pipeline cg_make_pipeline(const cg_pipeline_conf* conf);
+CARRIER_API void cg_apply_pipeline(cg_pipeline* pipeline);
+CARRIER_API void cg_apply_bindings(cg_bindings* bindings);
+CARRIER_API void cg_apply_storage_buffer(uint32_t slot, const cg_storage_buffer* buffer);
+CARRIER_API cg_storage_buffer cg_make_storage_buffer(const cg_storage_conf* conf);
+CARRIER_API void cg_update_storage_buffer(cg_storage_buffer* buffer, size_t offset, size_t size, const void* data);
+CARRIER_API void cg_destroy_storage_buffer(cg_storage_buffer buffer);
+CARRIER_API cg_compute_pipeline cg_make_compute_pipeline(const cg_compute_pipeline_conf* conf);
+CARRIER_API void cg_apply_compute_pipeline(cg_compute_pipeline* pipeline);
+CARRIER_API void cg_dispatch(uint32_t groups_x, uint32_t groups_y, uint32_t groups_z);
+CARRIER_API void cg_dispatch_indirect(const cg_storage_buffer* arguments, size_t offset);
+CARRIER_API void cg_barrier(int flags);
+CARRIER_API void cg_render(cg_bindings* bindings, int base_element, int num_elements, int num_instances);
+CARRIER_API void cg_draw_indirect(cg_bindings* bindings, const cg_storage_buffer* arguments, size_t offset);
+CARRIER_API void cg_multi_draw_indirect(cg_bindings* bindings, const cg_storage_buffer* arguments, size_t offset, int draw_count);
+CARRIER_API cg_uniform cg_get_location(cg_shader shader, const char* name);
+CARRIER_API void cg_set_uniform_mat4(cg_uniform location, const float* value);
+CARRIER_API void cg_set_uniform_vec4(cg_uniform location, const float* value);
+CARRIER_API void cg_set_uniform_vec2(cg_uniform location, const float* value);
+CARRIER_API void cg_set_uniform_float(cg_uniform location, float value);
+CARRIER_API void cg_set_uniform_int(cg_uniform location, int32_t value);
+CARRIER_API void cg_set_uniform_uint(cg_uniform location, uint32_t value);
+CARRIER_API void cg_set_wireframe(bool enable);
+CARRIER_API void cg_set_depth_test(bool enable);
+CARRIER_API void cg_set_blend(bool enable);
+CARRIER_API bool cg_capture_frames(int count);
+CARRIER_API cg_image cg_make_image(const cg_image_conf* conf);
+CARRIER_API void cg_update_image(cg_image* image, int level, int layer, const void* data, size_t size);
+CARRIER_API cg_image cg_load_image(const char* path);
+CARRIER_API bool cg_decode_image(casset_view view, const char* path, cg_image_conf* conf, void** allocation);
+CARRIER_API size_t cg_image_level_size(const cg_image* image, int level);
+CARRIER_API void cg_destroy_image(cg_image image);
+CARRIER_API cg_sampler cg_make_sampler(const cg_sampler_conf* conf);
+CARRIER_API void cg_destroy_sampler(cg_sampler sampler);
+CARRIER_API void cg_apply_image(int slot, const cg_image* image, const cg_sampler* sampler);
+CARRIER_API cg_framebuffer cg_make_framebuffer(const cg_framebuffer_conf* conf);
+CARRIER_API void cg_destroy_framebuffer(cg_framebuffer framebuffer);
+CARRIER_API void cg_track_memory(cg_memory_category category, size_t size, bool allocated);
+CARRIER_API cg_memory_stats cg_get_memory_stats(void);
+CARRIER_API void cg_set_memory_budget(size_t budget);
+CARRIER_API bool cg_query_driver_memory(size_t* total, size_t* available);
+
+#endif // CARRIER_GFX_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_GFX_IMPLEMENTATION)
+#define CARRIER_GFX_IMPLEMENTATION
 
 // INTERNAL
 // These functions are intended for internal use within the library.
 // === === === === === ===
 // === === === === === ===
 
-static char* read_file(const char* path);
-static GLuint compile_shader(const char* source, GLenum type);
+static GLuint compile_shader(const char* source, size_t length, GLenum type);
+static GLuint specialize_shader(const void* binary, size_t size, GLenum type);
+static char* inject_defines(casset_view source, const char* const* defines, size_t define_count, size_t* length);
+static cg_shader_variant* find_variant(cg_shader_variants* variants, cg_variant_key key);
+static void grow_variants(cg_shader_variants* variants);
+static cg_shader link_program(const GLuint* shaders, size_t count);
+static GLbitfield barrier_bits(int flags);
+static void* grow_array(void* array, size_t* capacity, size_t count, size_t size);
+static void begin_pass(const cg_framebuffer* framebuffer, const cg_pass_action* action);
+static void invalidate_attachments(const cg_framebuffer* framebuffer, bool color, bool depth, bool stencil);
+static bool capture_active(void);
+static void capture_command(cg_capture_op op, const uint64_t* fields, uint32_t field_count, const void* data, size_t size, const void* extra, size_t extra_size);
+static void capture_buffer_contents(GLuint buffer);
+static void capture_start(void);
+static void capture_close(void);
+static bool pixel_format_info(cg_pixel_format format, GLenum* internal_format, GLenum* pixel_format, GLenum* pixel_type, size_t* pixel_size, int* block);
+static void upload_image(const cg_image* image, int level, int layer, const unsigned char* data);
+static void upload_image_rows(const cg_image* image, int level, int layer, int row, int rows, const void* source);
+static size_t reserve_upload(size_t row_size, size_t rows, size_t* offset);
+static bool create_upload_buffer(void);
+static void retire_uploads(void);
+static void fence_uploads(void);
+static uint32_t read_u32(const char* data);
+static uint64_t read_u64(const char* data);
+static bool decode_ktx2(casset_view view, const char* path, cg_image_conf* conf);
+static bool decode_dds(casset_view view, const char* path, cg_image_conf* conf, void** allocation);
 
 // Global variable to hold the graphics context
 static cg_context context = {0};
@@ -43,8 +118,16 @@ static cg_context context = {0};
 // === === === === === ===
 // === === === === === ===
 
-static void cg_setup(const cg_conf *conf) {
-    if (glewInit() != GLEW_OK) {
+CARRIER_API void cg_setup(const cg_conf *conf) {
+    // GLEW built for GLX reports a missing X display after it has loaded the
+    // entry points, offscreen EGL contexts run without one
+    const GLenum status = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    const bool initialized = status == GLEW_OK || (conf->offscreen && status == GLEW_ERROR_NO_GLX_DISPLAY);
+#else
+    const bool initialized = status == GLEW_OK;
+#endif
+    if (!initialized) {
         cr_log(CR_ERROR, "Failed to initialize [carrier graphics module]");
         exit(EXIT_FAILURE);
     }
@@ -66,20 +149,38 @@ static void cg_setup(const cg_conf *conf) {
         glDisable(GL_BLEND);
     }
 
-    context.shaders = NULL;
-    context.shader_count = 0;
-    context.pipelines = NULL;
-    context.pipeline_count = 0;
-    context.bindings = NULL;
-    context.binding_count = 0;
+    // Resource arrays use the allocator of the configuration, or cr_alloc when it is zeroed
+    memset(&context, 0, sizeof(context));
+    context.allocator = conf->allocator;
+    context.depth_test = depth_test;
+    context.blend = blend;
+    context.offscreen = conf->offscreen;
+    context.primitive_type = GL_TRIANGLES;
+    context.upload_size = ((conf->upload_size > 0 ? conf->upload_size : CG_DEFAULT_UPLOAD_SIZE) + 15) & ~(size_t)15;
+    context.memory.budget = conf->memory_budget;
+
+    if (conf->capture_path) {
+        context.capture = fopen(conf->capture_path, "wb");
+        if (context.capture) {
+            const uint32_t header[2] = { CG_CAPTURE_MAGIC, CG_CAPTURE_VERSION };
+            fwrite(header, sizeof(header), 1, context.capture);
+            context.capture_path = conf->capture_path;
+            context.capture_pending = conf->capture_frames;
+            capture_command(CG_CAPTURE_SETUP, (uint64_t[]){ depth_test, blend }, 2, NULL, 0, NULL, 0);
+        } else {
+            cr_logf(CR_ERROR, "Failed to open graphics capture '%s'", conf->capture_path);
+        }
+    }
     cr_log(CR_SUCCESS, "Successfully initialized [carrier graphics module]");
 }
 
-static void cg_shutdown(void) {
+CARRIER_API void cg_shutdown(void) {
+    capture_close();
+
     for (size_t i = 0; i < context.shader_count; i++) {
         glDeleteProgram(context.shaders[i].program);
     }
-    free(context.shaders);
+    cr_free_with(&context.allocator, context.shaders);
 
     for (size_t i = 0; i < context.binding_count; i++) {
         glDeleteVertexArrays(1, &context.bindings[i].vao);
@@ -88,85 +189,234 @@ static void cg_shutdown(void) {
             glDeleteBuffers(1, &context.bindings[i].ebo);
         }
     }
-    free(context.bindings);
+    cr_free_with(&context.allocator, context.bindings);
+
+    for (size_t i = 0; i < context.storage_buffer_count; i++) {
+        glDeleteBuffers(1, &context.storage_buffers[i].buffer);
+    }
+    cr_free_with(&context.allocator, context.storage_buffers);
+
+    for (size_t i = 0; i < context.image_count; i++) {
+        glDeleteTextures(1, &context.images[i].texture);
+    }
+    cr_free_with(&context.allocator, context.images);
+
+    for (size_t i = 0; i < context.sampler_count; i++) {
+        glDeleteSamplers(1, &context.samplers[i].sampler);
+    }
+    cr_free_with(&context.allocator, context.samplers);
+
+    for (size_t i = 0; i < context.framebuffer_count; i++) {
+        glDeleteFramebuffers(1, &context.framebuffers[i].framebuffer);
+    }
+    cr_free_with(&context.allocator, context.framebuffers);
+
+    for (; context.upload_fence_head != context.upload_fence_tail; context.upload_fence_head++) {
+        glDeleteSync(context.upload_fences[context.upload_fence_head % CG_MAX_UPLOAD_FENCES].fence);
+    }
+    if (context.upload_buffer) { glDeleteBuffers(1, &context.upload_buffer); }
 
-    free(context.pipelines);
+    cr_free_with(&context.allocator, context.pipelines);
+    cr_free_with(&context.allocator, context.compute_pipelines);
     cr_log(CR_SUCCESS, "Successfully shutdown [carrier graphics module]");
 }
 
-static void cg_begin_pass(const cg_pass_action* action) {
-    glClearColor(action->clear_color.r, action->clear_color.g, action->clear_color.b, action->clear_color.a);
+CARRIER_API void cg_begin_pass(const cg_pass_action* action) {
+    // Framebuffer passes change the viewport, the window one is put back
+    if (context.viewport_saved) {
+        glViewport(context.window_viewport[0], context.window_viewport[1], context.window_viewport[2], context.window_viewport[3]);
+        context.viewport_saved = false;
+    }
 
-    GLbitfield clear_mask = GL_COLOR_BUFFER_BIT;
+    // The window framebuffer is assumed to have depth and stencil
+    begin_pass(&(cg_framebuffer){ .color_count = 1, .depth = true, .stencil = true }, action);
 
-    if (action->clear_depth >= 0.0f && action->clear_depth <= 1.0f) {
-        glClearDepth(action->clear_depth);
-        clear_mask |= GL_DEPTH_BUFFER_BIT;
-    }
+    if (capture_active()) { capture_command(CG_CAPTURE_BEGIN_PASS, NULL, 0, action, sizeof(*action), NULL, 0); }
+}
 
-    if (action->clear_stencil >= 0) {
-        glClearStencil(action->clear_stencil);
-        clear_mask |= GL_STENCIL_BUFFER_BIT;
+CARRIER_API void cg_begin_framebuffer_pass(const cg_framebuffer* framebuffer, const cg_pass_action* action) {
+    if (!context.viewport_saved) {
+        glGetIntegerv(GL_VIEWPORT, context.window_viewport);
+        context.viewport_saved = true;
     }
 
-    glClear(clear_mask);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->framebuffer);
+    glViewport(0, 0, framebuffer->width, framebuffer->height);
+    begin_pass(framebuffer, action);
 }
 
-static void cg_end_pass(void) {
+CARRIER_API void cg_end_pass(void) {
+    const cg_pass_action* action = &context.pass_action;
+    invalidate_attachments(&context.pass_framebuffer, action->color_store == CG_STORE_DONTCARE,
+                           action->depth_store == CG_STORE_DONTCARE, action->stencil_store == CG_STORE_DONTCARE);
+
     glBindVertexArray(0);
     glUseProgram(0);
+
+    // Framebuffer passes are not captured, the replay only knows the window
+    if (context.pass_framebuffer.framebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    } else if (capture_active()) {
+        capture_command(CG_CAPTURE_END_PASS, NULL, 0, NULL, 0, NULL, 0);
+    }
 }
 
-static void cg_commit() {
-    glfwSwapBuffers(glfwGetCurrentContext());
+CARRIER_API void cg_commit(void) {
+    fence_uploads();
+    if (!context.offscreen) { glfwSwapBuffers(glfwGetCurrentContext()); }
+    cr_alloc_frame_end();
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_COMMIT, NULL, 0, NULL, 0, NULL, 0);
+        if (++context.captured_frames == context.capture_frames) { capture_close(); }
+    } else if (context.capture && context.capture_pending > 0) {
+        capture_start();
+    }
 }
 
-static cg_shader cg_load_shader(const char* vertex_path, const char* fragment_path) {
-    char* vertex_source = read_file(vertex_path);
-    char* fragment_source = read_file(fragment_path);
+CARRIER_API cg_shader cg_load_shader(const char* vertex_path, const char* fragment_path) {
+    return cg_load_shader_defines(vertex_path, fragment_path, NULL, 0);
+}
 
-    if (!vertex_source || !fragment_source) {
-        free(vertex_source);
-        free(fragment_source);
+CARRIER_API cg_shader cg_load_shader_defines(const char* vertex_path, const char* fragment_path, const char* const* defines, size_t define_count) {
+    casset_view vertex_source = cr_asset_get(vertex_path);
+    casset_view fragment_source = cr_asset_get(fragment_path);
+
+    if (!vertex_source.data || !fragment_source.data) {
         cr_log(CR_ERROR, "Failed to load shaders");
         return (cg_shader){ 0 };
     }
 
-    GLuint vertex_shader = compile_shader(vertex_source, GL_VERTEX_SHADER);
-    GLuint fragment_shader = compile_shader(fragment_source, GL_FRAGMENT_SHADER);
+    // Without defines the mapped sources compile as they are
+    char* vertex_text = NULL;
+    char* fragment_text = NULL;
+    if (define_count > 0) {
+        vertex_text = inject_defines(vertex_source, defines, define_count, &vertex_source.size);
+        fragment_text = inject_defines(fragment_source, defines, define_count, &fragment_source.size);
+        if (!vertex_text || !fragment_text) {
+            cr_log(CR_ERROR, "Failed to load shaders: out of memory");
+            cr_free(vertex_text);
+            cr_free(fragment_text);
+            return (cg_shader){ 0 };
+        }
+        vertex_source.data = vertex_text;
+        fragment_source.data = fragment_text;
+    }
 
-    free(vertex_source);
-    free(fragment_source);
+    GLuint vertex_shader = compile_shader(vertex_source.data, vertex_source.size, GL_VERTEX_SHADER);
+    GLuint fragment_shader = compile_shader(fragment_source.data, fragment_source.size, GL_FRAGMENT_SHADER);
+    cr_free(vertex_text);
+    cr_free(fragment_text);
 
     if (!vertex_shader || !fragment_shader) {
+        if (vertex_shader) { glDeleteShader(vertex_shader); }
+        if (fragment_shader) { glDeleteShader(fragment_shader); }
         return (cg_shader){ 0 };
     }
 
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
-    glLinkProgram(program);
+    const GLuint shaders[] = { vertex_shader, fragment_shader };
+    return link_program(shaders, 2);
+}
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+CARRIER_API cg_shader cg_load_shader_spirv(const void* vertex_binary, size_t vertex_size, const void* fragment_binary, size_t fragment_size) {
+    if (!GLEW_VERSION_4_6 && !GLEW_ARB_gl_spirv) {
+        cr_log(CR_ERROR, "Failed to load SPIR-V shaders: GL_ARB_gl_spirv not supported");
+        return (cg_shader){ 0 };
+    }
 
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char info_log[512];
-        glGetProgramInfoLog(program, 512, NULL, info_log);
-        cr_log(CR_ERROR, info_log);
-        glDeleteProgram(program);
+    GLuint vertex_shader = specialize_shader(vertex_binary, vertex_size, GL_VERTEX_SHADER);
+    GLuint fragment_shader = specialize_shader(fragment_binary, fragment_size, GL_FRAGMENT_SHADER);
+
+    if (!vertex_shader || !fragment_shader) {
+        if (vertex_shader) { glDeleteShader(vertex_shader); }
+        if (fragment_shader) { glDeleteShader(fragment_shader); }
         return (cg_shader){ 0 };
     }
 
-    context.shaders = (cg_shader*)realloc(context.shaders, (context.shader_count + 1) * sizeof(cg_shader));
-    context.shaders[context.shader_count++] = (cg_shader){program};
-    cr_log(CR_SUCCESS, "Successfully loaded shaders");
-    return (cg_shader){program};
+    const GLuint shaders[] = { vertex_shader, fragment_shader };
+    return link_program(shaders, 2);
+}
+
+CARRIER_API cg_shader cg_load_compute_shader(const char* path) {
+    const casset_view source = cr_asset_get(path);
+
+    if (!source.data) {
+        cr_log(CR_ERROR, "Failed to load compute shader");
+        return (cg_shader){ 0 };
+    }
+
+    GLuint compute_shader = compile_shader(source.data, source.size, GL_COMPUTE_SHADER);
+    if (!compute_shader) { return (cg_shader){ 0 }; }
+
+    return link_program(&compute_shader, 1);
+}
+
+CARRIER_API void cg_destroy_shader(cg_shader shader) {
+    for (size_t i = 0; i < context.shader_count; i++) {
+        if (context.shaders[i].program == shader.program) {
+            if (context.capture) { capture_command(CG_CAPTURE_DESTROY_PROGRAM, (uint64_t[]){ shader.program }, 1, NULL, 0, NULL, 0); }
+            glDeleteProgram(shader.program);
+            context.shaders[i] = context.shaders[--context.shader_count];
+            return;
+        }
+    }
+    cr_log(CR_WARNING, "Failed to destroy shader: unknown program");
 }
 
-static cg_bindings cg_make_buffer(const cg_buffer_conf* buffer_conf) {
+CARRIER_API cg_shader_variants cg_make_shader_variants(const cg_shader_variants_conf* conf) {
+    cg_shader_variants variants = {
+        .vertex_path = conf->vertex_path,
+        .fragment_path = conf->fragment_path
+    };
+    while (variants.feature_count < CG_MAX_SHADER_FEATURES && conf->features[variants.feature_count]) {
+        variants.features[variants.feature_count] = conf->features[variants.feature_count];
+        variants.feature_count++;
+    }
+
+    for (size_t i = 0; i < conf->variant_count; i++) {
+        cg_get_shader_variant(&variants, conf->variants[i]);
+    }
+    return variants;
+}
+
+CARRIER_API cg_shader cg_get_shader_variant(cg_shader_variants* variants, cg_variant_key key) {
+    // Bits without a feature select the same program as without them
+    if (variants->feature_count < CG_MAX_SHADER_FEATURES) { key &= (1u << variants->feature_count) - 1u; }
+
+    if (variants->variant_capacity > 0) {
+        const cg_shader_variant* cached = find_variant(variants, key);
+        if (cached->used) { return cached->shader; }
+    }
+
+    const char* defines[CG_MAX_SHADER_FEATURES];
+    size_t define_count = 0;
+    for (int i = 0; i < variants->feature_count; i++) {
+        if (key & (1u << i)) { defines[define_count++] = variants->features[i]; }
+    }
+
+    const cg_shader shader = cg_load_shader_defines(variants->vertex_path, variants->fragment_path, defines, define_count);
+    if (!shader.program) {
+        cr_logf(CR_ERROR, "Failed to compile shader variant 0x%x of '%s'", (unsigned)key, variants->fragment_path);
+    }
+
+    // Failures are cached too, a broken variant is not compiled every frame
+    if ((variants->variant_count + 1) * 2 > variants->variant_capacity) { grow_variants(variants); }
+    cg_shader_variant* variant = find_variant(variants, key);
+    *variant = (cg_shader_variant){ key, shader, true };
+    variants->variant_count++;
+    return shader;
+}
+
+CARRIER_API void cg_destroy_shader_variants(cg_shader_variants* variants) {
+    for (size_t i = 0; i < variants->variant_capacity; i++) {
+        const cg_shader_variant* variant = &variants->variants[i];
+        if (variant->used && variant->shader.program) { cg_destroy_shader(variant->shader); }
+    }
+    cr_free_with(&context.allocator, variants->variants);
+    memset(variants, 0, sizeof(*variants));
+}
+
+CARRIER_API cg_bindings cg_make_buffer(const cg_buffer_conf* buffer_conf) {
     cg_bindings bindings;
 
     glGenVertexArrays(1, &bindings.vao);
@@ -180,111 +430,747 @@ static cg_bindings cg_make_buffer(const cg_buffer_conf* buffer_conf) {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    if (buffer_conf->index_buffer.data != NULL) {
+    // A size without data allocates storage that is filled later, e.g. by streaming
+    if (buffer_conf->index_buffer.data != NULL || buffer_conf->index_buffer.size > 0) {
         glGenBuffers(1, &bindings.ebo);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bindings.ebo);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer_conf->index_buffer.size, buffer_conf->index_buffer.data, GL_STATIC_DRAW);
     } else {
         bindings.ebo = 0;
     }
+    bindings.size = buffer_conf->vertex_buffer.size + (bindings.ebo ? buffer_conf->index_buffer.size : 0);
+    cg_track_memory(CG_MEMORY_GEOMETRY, bindings.size, true);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    context.bindings = (cg_bindings*)realloc(context.bindings, (context.binding_count + 1) * sizeof(cg_bindings));
+    if (context.capture) {
+        const cg_vertex_conf* vertices = &buffer_conf->vertex_buffer;
+        const cg_index_conf* indices = &buffer_conf->index_buffer;
+        const uint64_t fields[] = {
+            bindings.vao, bindings.vbo, bindings.ebo, vertices->size, indices->size,
+            vertices->data != NULL, indices->data != NULL
+        };
+        capture_command(CG_CAPTURE_BUFFER, fields, 7, vertices->data, vertices->data ? vertices->size : 0,
+                        indices->data, indices->data ? indices->size : 0);
+    }
+
+    context.bindings = (cg_bindings*)grow_array(context.bindings, &context.binding_capacity, context.binding_count, sizeof(cg_bindings));
     context.bindings[context.binding_count++] = bindings;
     return bindings;
 }
 
-static cg_pipeline cg_make_pipeline(const cg_pipeline_conf* conf) {
+CARRIER_API void cg_destroy_buffer(cg_bindings bindings) {
+    for (size_t i = 0; i < context.binding_count; i++) {
+        if (context.bindings[i].vao == bindings.vao) {
+            if (context.capture) { capture_command(CG_CAPTURE_DESTROY_BUFFER, (uint64_t[]){ bindings.vao }, 1, NULL, 0, NULL, 0); }
+            cg_track_memory(CG_MEMORY_GEOMETRY, context.bindings[i].size, false);
+            glDeleteVertexArrays(1, &bindings.vao);
+            glDeleteBuffers(1, &bindings.vbo);
+            if (bindings.ebo != 0) {
+                glDeleteBuffers(1, &bindings.ebo);
+            }
+            context.bindings[i] = context.bindings[--context.binding_count];
+            return;
+        }
+    }
+    cr_log(CR_WARNING, "Failed to destroy buffer: unknown bindings");
+}
+
+CARRIER_API cg_pipeline cg_make_pipeline(const cg_pipeline_conf* conf) {
     cg_pipeline pipeline;
 
     pipeline.shader = conf->shader;
     pipeline.primitive_type = conf->primitive_type;
 
-    context.pipelines = (cg_pipeline*)realloc(context.pipelines, (context.pipeline_count + 1) * sizeof(cg_pipeline));
+    context.pipelines = (cg_pipeline*)grow_array(context.pipelines, &context.pipeline_capacity, context.pipeline_count, sizeof(cg_pipeline));
     context.pipelines[context.pipeline_count++] = pipeline;
     return pipeline;
 }
 
-static void cg_apply_pipeline(cg_pipeline* pipeline) {
+CARRIER_API void cg_apply_pipeline(cg_pipeline* pipeline) {
     glUseProgram(pipeline->shader.program);
+    context.primitive_type = pipeline->primitive_type ? pipeline->primitive_type : GL_TRIANGLES;
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_APPLY_PIPELINE, (uint64_t[]){ pipeline->shader.program, pipeline->primitive_type }, 2, NULL, 0, NULL, 0);
+    }
 }
 
-static void cg_apply_bindings(cg_bindings* bindings) {
+CARRIER_API void cg_apply_bindings(cg_bindings* bindings) {
     glBindVertexArray(bindings->vao);
+
+    if (capture_active()) { capture_command(CG_CAPTURE_APPLY_BINDINGS, (uint64_t[]){ bindings->vao }, 1, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API void cg_apply_storage_buffer(uint32_t slot, const cg_storage_buffer* buffer) {
+    // Storage read by the draw shaders, compute pipelines bind their own
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, buffer->buffer);
+
+    if (capture_active()) { capture_command(CG_CAPTURE_APPLY_STORAGE, (uint64_t[]){ slot, buffer->buffer }, 2, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API cg_storage_buffer cg_make_storage_buffer(const cg_storage_conf* conf) {
+    cg_storage_buffer storage = { 0, conf->size, NULL };
+
+    glGenBuffers(1, &storage.buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, storage.buffer);
+
+    bool persistent = conf->persistent;
+    if (persistent && !GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage) {
+        cr_log(CR_WARNING, "Failed to map storage buffer persistently: GL_ARB_buffer_storage not supported");
+        persistent = false;
+    }
+
+    if (persistent) {
+        // Coherent mapping, CPU writes are visible to the next dispatch without a flush
+        const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)conf->size, conf->data, flags | GL_DYNAMIC_STORAGE_BIT);
+        storage.mapped = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)conf->size, flags);
+        if (!storage.mapped) {
+            cr_log(CR_ERROR, "Failed to map storage buffer");
+        }
+    } else {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)conf->size, conf->data, GL_DYNAMIC_COPY);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    cg_track_memory(CG_MEMORY_STORAGE, storage.size, true);
+
+    if (context.capture) {
+        const uint64_t fields[] = { storage.buffer, conf->size, conf->persistent, conf->data != NULL };
+        capture_command(CG_CAPTURE_STORAGE, fields, 4, conf->data, conf->data ? conf->size : 0, NULL, 0);
+    }
+
+    context.storage_buffers = (cg_storage_buffer*)grow_array(context.storage_buffers, &context.storage_buffer_capacity, context.storage_buffer_count, sizeof(cg_storage_buffer));
+    context.storage_buffers[context.storage_buffer_count++] = storage;
+    return storage;
+}
+
+CARRIER_API void cg_update_storage_buffer(cg_storage_buffer* buffer, size_t offset, size_t size, const void* data) {
+    if (offset + size > buffer->size) {
+        cr_log(CR_ERROR, "Failed to update storage buffer: range out of bounds");
+        return;
+    }
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_UPDATE_BUFFER, (uint64_t[]){ buffer->buffer, offset }, 2, data, size, NULL, 0);
+    }
+
+    if (buffer->mapped) {
+        memcpy((char*)buffer->mapped + offset, data, size);
+        return;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer->buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+CARRIER_API void cg_destroy_storage_buffer(cg_storage_buffer buffer) {
+    for (size_t i = 0; i < context.storage_buffer_count; i++) {
+        if (context.storage_buffers[i].buffer == buffer.buffer) {
+            if (context.capture) { capture_command(CG_CAPTURE_DESTROY_STORAGE, (uint64_t[]){ buffer.buffer }, 1, NULL, 0, NULL, 0); }
+
+            // Deleting a mapped buffer unmaps it
+            cg_track_memory(CG_MEMORY_STORAGE, context.storage_buffers[i].size, false);
+            glDeleteBuffers(1, &buffer.buffer);
+            context.storage_buffers[i] = context.storage_buffers[--context.storage_buffer_count];
+            return;
+        }
+    }
+    cr_log(CR_WARNING, "Failed to destroy storage buffer: unknown buffer");
+}
+
+CARRIER_API cg_compute_pipeline cg_make_compute_pipeline(const cg_compute_pipeline_conf* conf) {
+    cg_compute_pipeline pipeline;
+
+    pipeline.shader = conf->shader;
+    memcpy(pipeline.storage, conf->storage, sizeof(pipeline.storage));
+
+    context.compute_pipelines = (cg_compute_pipeline*)grow_array(context.compute_pipelines, &context.compute_pipeline_capacity, context.compute_pipeline_count, sizeof(cg_compute_pipeline));
+    context.compute_pipelines[context.compute_pipeline_count++] = pipeline;
+    return pipeline;
+}
+
+CARRIER_API void cg_apply_compute_pipeline(cg_compute_pipeline* pipeline) {
+    glUseProgram(pipeline->shader.program);
+    for (GLuint i = 0; i < CG_MAX_STORAGE_BINDINGS; i++) {
+        if (pipeline->storage[i].buffer != 0) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, pipeline->storage[i].buffer);
+        }
+    }
+
+    if (capture_active()) {
+        uint64_t fields[1 + CG_MAX_STORAGE_BINDINGS] = { pipeline->shader.program };
+        for (size_t i = 0; i < CG_MAX_STORAGE_BINDINGS; i++) { fields[1 + i] = pipeline->storage[i].buffer; }
+        capture_command(CG_CAPTURE_APPLY_COMPUTE, fields, 1 + CG_MAX_STORAGE_BINDINGS, NULL, 0, NULL, 0);
+    }
+}
+
+CARRIER_API void cg_dispatch(uint32_t groups_x, uint32_t groups_y, uint32_t groups_z) {
+    glDispatchCompute(groups_x, groups_y, groups_z);
+
+    if (capture_active()) { capture_command(CG_CAPTURE_DISPATCH, (uint64_t[]){ groups_x, groups_y, groups_z }, 3, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API void cg_dispatch_indirect(const cg_storage_buffer* arguments, size_t offset) {
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, arguments->buffer);
+    glDispatchComputeIndirect((GLintptr)offset);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_DISPATCH_INDIRECT, (uint64_t[]){ arguments->buffer, offset }, 2, NULL, 0, NULL, 0);
+    }
+}
+
+CARRIER_API void cg_barrier(int flags) {
+    glMemoryBarrier(barrier_bits(flags));
+
+    if (capture_active()) { capture_command(CG_CAPTURE_BARRIER, (uint64_t[]){ (uint64_t)flags }, 1, NULL, 0, NULL, 0); }
 }
 
-static void cg_render(cg_bindings* bindings, int base_element, int num_elements, int num_instances) {
+CARRIER_API void cg_render(cg_bindings* bindings, int base_element, int num_elements, int num_instances) {
+    // Primitives come from the applied pipeline, bindings with indices draw indexed
     if (num_instances > 1) {
         if (bindings->ebo != 0) {
-            glDrawElementsInstanced(GL_TRIANGLES, num_elements, GL_UNSIGNED_INT, (void*)(base_element * sizeof(unsigned int)), num_instances);
+            glDrawElementsInstanced(context.primitive_type, num_elements, GL_UNSIGNED_INT, (void*)(base_element * sizeof(unsigned int)), num_instances);
         } else {
-            glDrawArraysInstanced(GL_TRIANGLES, base_element, num_elements, num_instances);
+            glDrawArraysInstanced(context.primitive_type, base_element, num_elements, num_instances);
         }
     } else {
         if (bindings->ebo != 0) {
-            glDrawElements(GL_TRIANGLES, num_elements, GL_UNSIGNED_INT, (void*)(base_element * sizeof(unsigned int)));
+            glDrawElements(context.primitive_type, num_elements, GL_UNSIGNED_INT, (void*)(base_element * sizeof(unsigned int)));
         } else {
-            glDrawArrays(GL_TRIANGLES, base_element, num_elements);
+            glDrawArrays(context.primitive_type, base_element, num_elements);
         }
     }
+
+    if (capture_active()) {
+        const uint64_t fields[] = { bindings->vao, (uint64_t)base_element, (uint64_t)num_elements, (uint64_t)num_instances };
+        capture_command(CG_CAPTURE_RENDER, fields, 4, NULL, 0, NULL, 0);
+    }
 }
 
-static cg_uniform cg_get_location(cg_shader shader, const char* name) {
+CARRIER_API void cg_draw_indirect(cg_bindings* bindings, const cg_storage_buffer* arguments, size_t offset) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arguments->buffer);
+    if (bindings->ebo != 0) {
+        glDrawElementsIndirect(context.primitive_type, GL_UNSIGNED_INT, (const void*)offset);
+    } else {
+        glDrawArraysIndirect(context.primitive_type, (const void*)offset);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_DRAW_INDIRECT, (uint64_t[]){ bindings->vao, arguments->buffer, offset }, 3, NULL, 0, NULL, 0);
+    }
+}
+
+CARRIER_API void cg_multi_draw_indirect(cg_bindings* bindings, const cg_storage_buffer* arguments, size_t offset, int draw_count) {
+    // Commands are tightly packed, five words for indexed draws and four otherwise
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arguments->buffer);
+    if (bindings->ebo != 0) {
+        glMultiDrawElementsIndirect(context.primitive_type, GL_UNSIGNED_INT, (const void*)offset, draw_count, 0);
+    } else {
+        glMultiDrawArraysIndirect(context.primitive_type, (const void*)offset, draw_count, 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (capture_active()) {
+        const uint64_t fields[] = { bindings->vao, arguments->buffer, offset, (uint64_t)draw_count };
+        capture_command(CG_CAPTURE_MULTI_DRAW_INDIRECT, fields, 4, NULL, 0, NULL, 0);
+    }
+}
+
+CARRIER_API cg_uniform cg_get_location(cg_shader shader, const char* name) {
     return glGetUniformLocation(shader.program, name);
 }
 
-static void cg_set_uniform_mat4(cg_uniform location, const GLfloat* value) {
+CARRIER_API void cg_set_uniform_mat4(cg_uniform location, const float* value) {
     glUniformMatrix4fv(location, 1, GL_FALSE, value);
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_UNIFORM_MAT4, (uint64_t[]){ (uint64_t)location }, 1, value, 16 * sizeof(float), NULL, 0);
+    }
 }
 
-static void cg_set_uniform_vec4(cg_uniform location, const GLfloat* value) {
+CARRIER_API void cg_set_uniform_vec4(cg_uniform location, const float* value) {
     glUniform4fv(location, 1, value);
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_UNIFORM_VEC4, (uint64_t[]){ (uint64_t)location }, 1, value, 4 * sizeof(float), NULL, 0);
+    }
 }
 
-static void cg_set_wireframe(bool enable) {
+CARRIER_API void cg_set_uniform_vec2(cg_uniform location, const float* value) {
+    glUniform2fv(location, 1, value);
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_UNIFORM_VEC2, (uint64_t[]){ (uint64_t)location }, 1, value, 2 * sizeof(float), NULL, 0);
+    }
+}
+
+CARRIER_API void cg_set_uniform_float(cg_uniform location, float value) {
+    glUniform1f(location, value);
+
+    if (capture_active()) {
+        capture_command(CG_CAPTURE_UNIFORM_FLOAT, (uint64_t[]){ (uint64_t)location }, 1, &value, sizeof(value), NULL, 0);
+    }
+}
+
+CARRIER_API void cg_set_uniform_int(cg_uniform location, int32_t value) {
+    glUniform1i(location, value);
+
+    if (capture_active()) { capture_command(CG_CAPTURE_UNIFORM_INT, (uint64_t[]){ (uint64_t)location, (uint64_t)value }, 2, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API void cg_set_uniform_uint(cg_uniform location, uint32_t value) {
+    glUniform1ui(location, value);
+
+    if (capture_active()) { capture_command(CG_CAPTURE_UNIFORM_UINT, (uint64_t[]){ (uint64_t)location, value }, 2, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API void cg_set_wireframe(bool enable) {
     glPolygonMode(GL_FRONT_AND_BACK, enable ? GL_LINE : GL_FILL);
+
+    if (capture_active()) { capture_command(CG_CAPTURE_WIREFRAME, (uint64_t[]){ enable }, 1, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API void cg_set_depth_test(bool enable) {
+    if (enable) {
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+
+    if (capture_active()) { capture_command(CG_CAPTURE_DEPTH_TEST, (uint64_t[]){ enable }, 1, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API void cg_set_blend(bool enable) {
+    // Same alpha blending as cg_setup enables
+    if (enable) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        glDisable(GL_BLEND);
+    }
+
+    if (capture_active()) { capture_command(CG_CAPTURE_BLEND, (uint64_t[]){ enable }, 1, NULL, 0, NULL, 0); }
+}
+
+CARRIER_API bool cg_capture_frames(int count) {
+    if (!context.capture || count <= 0) {
+        cr_log(CR_ERROR, "Failed to start graphics capture: no capture path configured");
+        return false;
+    }
+
+    // Capturing starts with the next frame, so every frame in the file is whole
+    if (!capture_active()) { context.capture_pending = count; }
+    return true;
+}
+
+CARRIER_API cg_image cg_make_image(const cg_image_conf* conf) {
+    GLenum internal_format, pixel_format, pixel_type;
+    if (!pixel_format_info(conf->format, &internal_format, &pixel_format, &pixel_type, NULL, NULL)) {
+        cr_log(CR_ERROR, "Failed to make image: unsupported pixel format");
+        return (cg_image){ 0 };
+    }
+    if (conf->width <= 0 || conf->height <= 0) {
+        cr_log(CR_ERROR, "Failed to make image: invalid size");
+        return (cg_image){ 0 };
+    }
+
+    int full_chain = 1;
+    while ((conf->width > conf->height ? conf->width : conf->height) >> full_chain) { full_chain++; }
+
+    cg_image image = {
+        .width = conf->width,
+        .height = conf->height,
+        .layers = conf->layers > 1 ? conf->layers : 1,
+        .levels = conf->levels > 0 ? conf->levels : (conf->generate_mipmaps ? full_chain : 1),
+        .format = conf->format,
+        .render_target = conf->render_target
+    };
+    if (image.levels > full_chain) { image.levels = full_chain; }
+    if (image.levels > CG_MAX_MIPMAPS) { image.levels = CG_MAX_MIPMAPS; }
+    image.target = image.layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    for (int level = 0; level < image.levels; level++) {
+        image.size += cg_image_level_size(&image, level) * (size_t)image.layers;
+    }
+
+    glGenTextures(1, &image.texture);
+    glBindTexture(image.target, image.texture);
+    if (image.target == GL_TEXTURE_2D_ARRAY) {
+        glTexStorage3D(image.target, image.levels, internal_format, image.width, image.height, image.layers);
+    } else {
+        glTexStorage2D(image.target, image.levels, internal_format, image.width, image.height);
+    }
+
+    for (int level = 0; level < image.levels; level++) {
+        const cg_image_data* data = &conf->data[level];
+        if (!data->data) { continue; }
+
+        const size_t layer_size = cg_image_level_size(&image, level);
+        if (data->size < layer_size * (size_t)image.layers) {
+            cr_logf(CR_ERROR, "Failed to upload image level %d: %zu bytes given, %zu needed", level, data->size, layer_size * (size_t)image.layers);
+            continue;
+        }
+        for (int layer = 0; layer < image.layers; layer++) {
+            upload_image(&image, level, layer, (const unsigned char*)data->data + layer_size * (size_t)layer);
+        }
+    }
+
+    // Mipmaps are generated from the first level when it is given, images
+    // filled later generate theirs once the level is uploaded
+    if (conf->generate_mipmaps && image.levels > 1 && conf->data[0].data) {
+        if (pixel_type == 0) {
+            cr_log(CR_WARNING, "Failed to generate mipmaps: compressed images need their levels uploaded");
+        } else {
+            glGenerateMipmap(image.target);
+        }
+    }
+    glBindTexture(image.target, 0);
+    cg_track_memory(image.render_target ? CG_MEMORY_RENDER_TARGET : CG_MEMORY_TEXTURE, image.size, true);
+
+    context.images = (cg_image*)grow_array(context.images, &context.image_capacity, context.image_count, sizeof(cg_image));
+    context.images[context.image_count++] = image;
+    return image;
+}
+
+CARRIER_API void cg_update_image(cg_image* image, int level, int layer, const void* data, size_t size) {
+    if (level < 0 || level >= image->levels || layer < 0 || layer >= image->layers) {
+        cr_log(CR_ERROR, "Failed to update image: level or layer out of range");
+        return;
+    }
+    if (size < cg_image_level_size(image, level)) {
+        cr_logf(CR_ERROR, "Failed to update image level %d: %zu bytes given, %zu needed", level, size, cg_image_level_size(image, level));
+        return;
+    }
+
+    glBindTexture(image->target, image->texture);
+    upload_image(image, level, layer, (const unsigned char*)data);
+    glBindTexture(image->target, 0);
+}
+
+CARRIER_API cg_image cg_load_image(const char* path) {
+    const casset_view view = cr_asset_get(path);
+    if (!view.data) {
+        cr_logf(CR_ERROR, "Failed to load image '%s'", path);
+        return (cg_image){ 0 };
+    }
+
+    cg_image_conf conf;
+    void* allocation;
+    if (!cg_decode_image(view, path, &conf, &allocation)) { return (cg_image){ 0 }; }
+
+    const cg_image image = cg_make_image(&conf);
+    cr_free(allocation);
+    return image;
+}
+
+CARRIER_API bool cg_decode_image(casset_view view, const char* path, cg_image_conf* conf, void** allocation) {
+    // Only parses, so loader threads can decode ahead of the upload. The level
+    // data points into the view, or into the allocation when it was reordered.
+    memset(conf, 0, sizeof(*conf));
+    *allocation = NULL;
+
+    static const unsigned char ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    if (view.size >= sizeof(ktx2_identifier) && memcmp(view.data, ktx2_identifier, sizeof(ktx2_identifier)) == 0) {
+        return decode_ktx2(view, path, conf);
+    }
+    if (view.size >= 4 && memcmp(view.data, "DDS ", 4) == 0) {
+        return decode_dds(view, path, conf, allocation);
+    }
+
+    cr_logf(CR_ERROR, "Failed to load image '%s': not a KTX2 or DDS file", path);
+    return false;
+}
+
+CARRIER_API size_t cg_image_level_size(const cg_image* image, int level) {
+    size_t pixel_size;
+    int block;
+    GLenum internal_format, pixel_format, pixel_type;
+    if (!pixel_format_info(image->format, &internal_format, &pixel_format, &pixel_type, &pixel_size, &block)) { return 0; }
+
+    const size_t width = (size_t)((image->width >> level) > 0 ? image->width >> level : 1);
+    const size_t height = (size_t)((image->height >> level) > 0 ? image->height >> level : 1);
+    return ((width + (size_t)block - 1) / (size_t)block) * ((height + (size_t)block - 1) / (size_t)block) * pixel_size;
+}
+
+CARRIER_API void cg_destroy_image(cg_image image) {
+    for (size_t i = 0; i < context.image_count; i++) {
+        if (context.images[i].texture == image.texture) {
+            const cg_image* tracked = &context.images[i];
+            cg_track_memory(tracked->render_target ? CG_MEMORY_RENDER_TARGET : CG_MEMORY_TEXTURE, tracked->size, false);
+            glDeleteTextures(1, &image.texture);
+            context.images[i] = context.images[--context.image_count];
+            return;
+        }
+    }
+    cr_log(CR_WARNING, "Failed to destroy image: unknown texture");
+}
+
+CARRIER_API cg_framebuffer cg_make_framebuffer(const cg_framebuffer_conf* conf) {
+    cg_framebuffer framebuffer = { 0 };
+    const cg_image* first = conf->colors[0] ? conf->colors[0] : conf->depth;
+    if (!first) {
+        cr_log(CR_ERROR, "Failed to make framebuffer: no attachments");
+        return framebuffer;
+    }
+    framebuffer.width = first->width;
+    framebuffer.height = first->height;
+
+    glGenFramebuffers(1, &framebuffer.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.framebuffer);
+
+    // Array images are attached through their first layer
+    GLenum draw_buffers[CG_MAX_COLOR_ATTACHMENTS];
+    for (; framebuffer.color_count < CG_MAX_COLOR_ATTACHMENTS && conf->colors[framebuffer.color_count]; framebuffer.color_count++) {
+        const cg_image* image = conf->colors[framebuffer.color_count];
+        const GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)framebuffer.color_count;
+        if (image->target == GL_TEXTURE_2D_ARRAY) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, image->texture, 0, 0);
+        } else {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, image->texture, 0);
+        }
+        draw_buffers[framebuffer.color_count] = attachment;
+    }
+    if (framebuffer.color_count > 0) {
+        glDrawBuffers(framebuffer.color_count, draw_buffers);
+    } else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    if (conf->depth) {
+        framebuffer.depth = true;
+        framebuffer.stencil = conf->depth->format == CG_PIXELFORMAT_DEPTH24_STENCIL8;
+        const GLenum attachment = framebuffer.stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, conf->depth->texture, 0);
+    }
+
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        cr_logf(CR_ERROR, "Failed to make framebuffer: incomplete (0x%x)", status);
+        glDeleteFramebuffers(1, &framebuffer.framebuffer);
+        return (cg_framebuffer){ 0 };
+    }
+
+    context.framebuffers = (cg_framebuffer*)grow_array(context.framebuffers, &context.framebuffer_capacity, context.framebuffer_count, sizeof(cg_framebuffer));
+    context.framebuffers[context.framebuffer_count++] = framebuffer;
+    return framebuffer;
+}
+
+CARRIER_API void cg_destroy_framebuffer(cg_framebuffer framebuffer) {
+    for (size_t i = 0; i < context.framebuffer_count; i++) {
+        if (context.framebuffers[i].framebuffer == framebuffer.framebuffer) {
+            glDeleteFramebuffers(1, &framebuffer.framebuffer);
+            context.framebuffers[i] = context.framebuffers[--context.framebuffer_count];
+            return;
+        }
+    }
+    cr_log(CR_WARNING, "Failed to destroy framebuffer: unknown framebuffer");
+}
+
+CARRIER_API cg_sampler cg_make_sampler(const cg_sampler_conf* conf) {
+    static const GLenum wraps[] = { GL_REPEAT, GL_CLAMP_TO_EDGE, GL_MIRRORED_REPEAT };
+    cg_sampler sampler = { 0 };
+
+    GLenum min_filter = conf->min_filter == CG_FILTER_NEAREST ? GL_NEAREST : GL_LINEAR;
+    if (conf->mipmap_filter == CG_FILTER_NEAREST) {
+        min_filter = conf->min_filter == CG_FILTER_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_NEAREST;
+    } else if (conf->mipmap_filter == CG_FILTER_LINEAR) {
+        min_filter = conf->min_filter == CG_FILTER_NEAREST ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR_MIPMAP_LINEAR;
+    }
+
+    glGenSamplers(1, &sampler.sampler);
+    glSamplerParameteri(sampler.sampler, GL_TEXTURE_MIN_FILTER, (GLint)min_filter);
+    glSamplerParameteri(sampler.sampler, GL_TEXTURE_MAG_FILTER, conf->mag_filter == CG_FILTER_NEAREST ? GL_NEAREST : GL_LINEAR);
+    glSamplerParameteri(sampler.sampler, GL_TEXTURE_WRAP_S, (GLint)wraps[conf->wrap_u]);
+    glSamplerParameteri(sampler.sampler, GL_TEXTURE_WRAP_T, (GLint)wraps[conf->wrap_v]);
+
+    if (conf->max_anisotropy > 1.0f) {
+        if (GLEW_VERSION_4_6 || GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic) {
+            GLfloat limit = 1.0f;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &limit);
+            glSamplerParameterf(sampler.sampler, GL_TEXTURE_MAX_ANISOTROPY, conf->max_anisotropy < limit ? conf->max_anisotropy : limit);
+        } else {
+            cr_log(CR_WARNING, "Failed to enable anisotropic filtering: not supported");
+        }
+    }
+
+    context.samplers = (cg_sampler*)grow_array(context.samplers, &context.sampler_capacity, context.sampler_count, sizeof(cg_sampler));
+    context.samplers[context.sampler_count++] = sampler;
+    return sampler;
+}
+
+CARRIER_API void cg_destroy_sampler(cg_sampler sampler) {
+    for (size_t i = 0; i < context.sampler_count; i++) {
+        if (context.samplers[i].sampler == sampler.sampler) {
+            glDeleteSamplers(1, &sampler.sampler);
+            context.samplers[i] = context.samplers[--context.sampler_count];
+            return;
+        }
+    }
+    cr_log(CR_WARNING, "Failed to destroy sampler: unknown sampler");
+}
+
+CARRIER_API void cg_apply_image(int slot, const cg_image* image, const cg_sampler* sampler) {
+    glActiveTexture(GL_TEXTURE0 + (GLenum)slot);
+    glBindTexture(image->target, image->texture);
+    glBindSampler((GLuint)slot, sampler ? sampler->sampler : 0);
+}
+
+CARRIER_API void cg_track_memory(cg_memory_category category, size_t size, bool allocated) {
+    if ((unsigned)category >= CG_MEMORY_COUNT) { return; }
+
+    cg_memory_stats* memory = &context.memory;
+    if (allocated) {
+        memory->bytes[category] += size;
+        memory->objects[category]++;
+        memory->total += size;
+        if (memory->total > memory->peak) { memory->peak = memory->total; }
+        return;
+    }
+
+    // Clamped, so a release without a matching allocation cannot wrap the totals
+    size = size < memory->bytes[category] ? size : memory->bytes[category];
+    memory->bytes[category] -= size;
+    if (memory->objects[category] > 0) { memory->objects[category]--; }
+    memory->total -= size;
+}
+
+CARRIER_API cg_memory_stats cg_get_memory_stats(void) {
+    return context.memory;
+}
+
+CARRIER_API void cg_set_memory_budget(size_t budget) {
+    context.memory.budget = budget;
+}
+
+CARRIER_API bool cg_query_driver_memory(size_t* total, size_t* available) {
+    GLint values[4] = { 0 };
+
+    // Both extensions report kilobytes, ATI only knows the free memory
+    if (GLEW_NVX_gpu_memory_info) {
+        glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &values[0]);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &values[1]);
+    } else if (GLEW_ATI_meminfo) {
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, values);
+        values[1] = values[0];
+        values[0] = 0;
+    } else {
+        if (total) { *total = 0; }
+        if (available) { *available = 0; }
+        return false;
+    }
+
+    if (total) { *total = (size_t)values[0] * 1024; }
+    if (available) { *available = (size_t)values[1] * 1024; }
+    return true;
 }
 
 // INTERNAL IMPLEMENTATION
 // === === === === === ===
 // === === === === === ===
 
-static char* read_file(const char* path) {
-    FILE* file = fopen(path, "r");
-    if (!file) {
-        cr_log(CR_ERROR, "Failed to open shader file");
-        return NULL;
+static GLuint compile_shader(const char* source, size_t length, GLenum type) {
+    const GLint source_length = (GLint)length;
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, &source_length);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetShaderInfoLog(shader, 512, NULL, info_log);
+        cr_log(CR_ERROR, info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    if (context.capture) { capture_command(CG_CAPTURE_SHADER_SOURCE, (uint64_t[]){ shader, type }, 2, source, length, NULL, 0); }
+    return shader;
+}
+
+static char* inject_defines(casset_view source, const char* const* defines, size_t define_count, size_t* length) {
+    // The defines follow the #version line, which has to stay the first one.
+    // Only a directive at the start of a line counts, not one in a comment.
+    size_t split = 0;
+    for (size_t i = 0; i + 8 <= source.size; i++) {
+        if (i > 0 && source.data[i - 1] != '\n') { continue; }
+        if (memcmp(source.data + i, "#version", 8) != 0) { continue; }
+        const char* end = (const char*)memchr(source.data + i, '\n', source.size - i);
+        split = end ? (size_t)(end - source.data) + 1 : source.size;
+        break;
+    }
+
+    size_t line = 1;
+    for (size_t i = 0; i < split; i++) {
+        if (source.data[i] == '\n') { line++; }
     }
 
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    size_t size = source.size + 32;
+    for (size_t i = 0; i < define_count; i++) { size += strlen(defines[i]) + 16; }
+    char* text = (char*)cr_alloc(size);
+    if (!text) { return NULL; }
 
-    char* buffer = (char*)malloc(length + 1);
-    if (!buffer) {
-        cr_log(CR_ERROR, "Failed to allocate memory for shader file");
-        fclose(file);
-        return NULL;
+    memcpy(text, source.data, split);
+    size_t offset = split;
+    if (split > 0 && text[split - 1] != '\n') { text[offset++] = '\n'; }
+
+    // A define without a value is set to one so that #if works as well as #ifdef
+    for (size_t i = 0; i < define_count; i++) {
+        const char* format = strchr(defines[i], ' ') ? "#define %s\n" : "#define %s 1\n";
+        offset += (size_t)snprintf(text + offset, size - offset, format, defines[i]);
     }
 
-    if (fread(buffer, 1, length, file) != length) {
-        cr_log(CR_ERROR, "Failed to read shader file");
-        fclose(file);
-        free(buffer);
-        return NULL;
+    // Compile errors keep the line numbers of the file
+    offset += (size_t)snprintf(text + offset, size - offset, "#line %zu\n", line);
+    memcpy(text + offset, source.data + split, source.size - split);
+    *length = offset + source.size - split;
+    return text;
+}
+
+static cg_shader_variant* find_variant(cg_shader_variants* variants, cg_variant_key key) {
+    // Open addressing with linear probing, the table is at most half full
+    uint32_t hash = key;
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bu;
+    hash ^= hash >> 16;
+
+    const size_t mask = variants->variant_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        cg_shader_variant* variant = &variants->variants[i];
+        if (!variant->used || variant->key == key) { return variant; }
+    }
+}
+
+static void grow_variants(cg_shader_variants* variants) {
+    const size_t capacity = variants->variant_capacity ? variants->variant_capacity * 2 : 16;
+    cg_shader_variant* previous = variants->variants;
+    const size_t previous_capacity = variants->variant_capacity;
+
+    variants->variants = (cg_shader_variant*)cr_alloc_zeroed(&context.allocator, capacity, sizeof(cg_shader_variant), __FILE__, __LINE__);
+    if (!variants->variants) {
+        cr_log(CR_ERROR, "Failed to grow shader variant table");
+        exit(EXIT_FAILURE);
     }
-    buffer[length] = '\0';
+    variants->variant_capacity = capacity;
 
-    fclose(file);
-    return buffer;
+    for (size_t i = 0; i < previous_capacity; i++) {
+        if (previous[i].used) { *find_variant(variants, previous[i].key) = previous[i]; }
+    }
+    cr_free_with(&context.allocator, previous);
 }
 
-static GLuint compile_shader(const char* source, GLenum type) {
+static GLuint specialize_shader(const void* binary, size_t size, GLenum type) {
     GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, binary, (GLsizei)size);
+    glSpecializeShader(shader, "main", 0, NULL, NULL);
 
     GLint success;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -295,7 +1181,553 @@ static GLuint compile_shader(const char* source, GLenum type) {
         glDeleteShader(shader);
         return 0;
     }
+
+    if (context.capture) { capture_command(CG_CAPTURE_SHADER_BINARY, (uint64_t[]){ shader, type }, 2, binary, size, NULL, 0); }
     return shader;
 }
 
-#endif // CARRIER_GFX_H
+static cg_shader link_program(const GLuint* shaders, size_t count) {
+    GLuint program = glCreateProgram();
+    for (size_t i = 0; i < count; i++) {
+        glAttachShader(program, shaders[i]);
+    }
+    glLinkProgram(program);
+
+    for (size_t i = 0; i < count; i++) {
+        glDeleteShader(shaders[i]);
+    }
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetProgramInfoLog(program, 512, NULL, info_log);
+        cr_log(CR_ERROR, info_log);
+        glDeleteProgram(program);
+        return (cg_shader){ 0 };
+    }
+
+    if (context.capture && count < CG_CAPTURE_MAX_FIELDS) {
+        uint64_t fields[CG_CAPTURE_MAX_FIELDS] = { program };
+        for (size_t i = 0; i < count; i++) { fields[1 + i] = shaders[i]; }
+        capture_command(CG_CAPTURE_PROGRAM, fields, (uint32_t)(1 + count), NULL, 0, NULL, 0);
+    }
+
+    context.shaders = (cg_shader*)grow_array(context.shaders, &context.shader_capacity, context.shader_count, sizeof(cg_shader));
+    context.shaders[context.shader_count++] = (cg_shader){program};
+    cr_log(CR_SUCCESS, "Successfully loaded shaders");
+    return (cg_shader){program};
+}
+
+static GLbitfield barrier_bits(int flags) {
+    if ((flags & CG_BARRIER_ALL) == CG_BARRIER_ALL) { return GL_ALL_BARRIER_BITS; }
+
+    GLbitfield bits = 0;
+    if (flags & CG_BARRIER_STORAGE) { bits |= GL_SHADER_STORAGE_BARRIER_BIT; }
+    if (flags & CG_BARRIER_INDIRECT) { bits |= GL_COMMAND_BARRIER_BIT; }
+    if (flags & CG_BARRIER_VERTEX) { bits |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT; }
+    if (flags & CG_BARRIER_INDEX) { bits |= GL_ELEMENT_ARRAY_BARRIER_BIT; }
+    if (flags & CG_BARRIER_UNIFORM) { bits |= GL_UNIFORM_BARRIER_BIT; }
+    if (flags & CG_BARRIER_BUFFER_UPDATE) { bits |= GL_BUFFER_UPDATE_BARRIER_BIT; }
+    if (flags & CG_BARRIER_MAPPED) { bits |= GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT; }
+    return bits;
+}
+
+static void* grow_array(void* array, size_t* capacity, size_t count, size_t size) {
+    if (count < *capacity) { return array; }
+
+    // Geometric growth keeps resource creation from reallocating every time
+    const size_t grown = *capacity ? *capacity * 2 : 16;
+    void* resized = cr_realloc_with(&context.allocator, array, grown * size);
+    if (!resized) {
+        cr_log(CR_ERROR, "Failed to grow graphics resource array");
+        exit(EXIT_FAILURE);
+    }
+
+    *capacity = grown;
+    return resized;
+}
+
+static void begin_pass(const cg_framebuffer* framebuffer, const cg_pass_action* action) {
+    context.pass_framebuffer = *framebuffer;
+    context.pass_action = *action;
+
+    GLbitfield clear_mask = 0;
+    bool discard_color = false, discard_depth = false, discard_stencil = false;
+
+    if (framebuffer->color_count > 0) {
+        if (action->color_load == CG_LOAD_DEFAULT || action->color_load == CG_LOAD_CLEAR) {
+            glClearColor(action->clear_color.r, action->clear_color.g, action->clear_color.b, action->clear_color.a);
+            clear_mask |= GL_COLOR_BUFFER_BIT;
+        }
+        discard_color = action->color_load == CG_LOAD_DONTCARE;
+    }
+
+    if (framebuffer->depth) {
+        const bool in_range = action->clear_depth >= 0.0f && action->clear_depth <= 1.0f;
+        if ((action->depth_load == CG_LOAD_DEFAULT && in_range) || action->depth_load == CG_LOAD_CLEAR) {
+            glClearDepth(action->clear_depth);
+            clear_mask |= GL_DEPTH_BUFFER_BIT;
+        }
+        discard_depth = action->depth_load == CG_LOAD_DONTCARE;
+    }
+
+    if (framebuffer->stencil) {
+        if ((action->stencil_load == CG_LOAD_DEFAULT && action->clear_stencil >= 0) || action->stencil_load == CG_LOAD_CLEAR) {
+            glClearStencil(action->clear_stencil);
+            clear_mask |= GL_STENCIL_BUFFER_BIT;
+        }
+        discard_stencil = action->stencil_load == CG_LOAD_DONTCARE;
+    }
+
+    // Discarded contents never have to be loaded, which tilers skip entirely
+    invalidate_attachments(framebuffer, discard_color, discard_depth, discard_stencil);
+    if (clear_mask) { glClear(clear_mask); }
+}
+
+static void invalidate_attachments(const cg_framebuffer* framebuffer, bool color, bool depth, bool stencil) {
+    if (!GLEW_VERSION_4_3 && !GLEW_ARB_invalidate_subdata) { return; }
+
+    // The window framebuffer names its attachments differently
+    GLenum attachments[CG_MAX_COLOR_ATTACHMENTS + 2];
+    GLsizei count = 0;
+    if (color) {
+        if (framebuffer->framebuffer == 0) {
+            attachments[count++] = GL_COLOR;
+        } else {
+            for (int i = 0; i < framebuffer->color_count; i++) { attachments[count++] = GL_COLOR_ATTACHMENT0 + (GLenum)i; }
+        }
+    }
+    if (depth && framebuffer->depth) { attachments[count++] = framebuffer->framebuffer ? GL_DEPTH_ATTACHMENT : GL_DEPTH; }
+    if (stencil && framebuffer->stencil) { attachments[count++] = framebuffer->framebuffer ? GL_STENCIL_ATTACHMENT : GL_STENCIL; }
+
+    if (count > 0) { glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments); }
+}
+
+static bool capture_active(void) {
+    return context.capture && context.capture_frames > 0;
+}
+
+static void capture_command(cg_capture_op op, const uint64_t* fields, uint32_t field_count, const void* data, size_t size, const void* extra, size_t extra_size) {
+    const uint32_t header[2] = { (uint32_t)op, field_count };
+    const uint64_t data_size = size + extra_size;
+
+    bool ok = fwrite(header, sizeof(header), 1, context.capture) == 1 &&
+              fwrite(&data_size, sizeof(data_size), 1, context.capture) == 1;
+    if (ok && field_count > 0) { ok = fwrite(fields, sizeof(uint64_t), field_count, context.capture) == field_count; }
+    if (ok && size > 0) { ok = fwrite(data, 1, size, context.capture) == size; }
+    if (ok && extra_size > 0) { ok = fwrite(extra, 1, extra_size, context.capture) == extra_size; }
+
+    if (!ok) {
+        cr_logf(CR_ERROR, "Failed to write graphics capture '%s'", context.capture_path);
+        fclose(context.capture);
+        context.capture = NULL;
+    }
+}
+
+static void capture_buffer_contents(GLuint buffer) {
+    GLint64 size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+
+    void* contents = size > 0 ? cr_alloc((size_t)size) : NULL;
+    if (contents) {
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)size, contents);
+        capture_command(CG_CAPTURE_UPDATE_BUFFER, (uint64_t[]){ buffer, 0 }, 2, contents, (size_t)size, NULL, 0);
+        cr_free(contents);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+static void capture_start(void) {
+    // Buffers may have been written by the GPU or through raw GL since they
+    // were created, so their current contents open the captured frames
+    for (size_t i = 0; i < context.binding_count && context.capture; i++) {
+        capture_buffer_contents(context.bindings[i].vbo);
+        if (context.bindings[i].ebo) { capture_buffer_contents(context.bindings[i].ebo); }
+    }
+    for (size_t i = 0; i < context.storage_buffer_count && context.capture; i++) {
+        capture_buffer_contents(context.storage_buffers[i].buffer);
+    }
+    if (!context.capture) { return; }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    capture_command(CG_CAPTURE_FRAME_START, (uint64_t[]){ (uint64_t)viewport[2], (uint64_t)viewport[3] }, 2, NULL, 0, NULL, 0);
+
+    context.capture_frames = context.capture_pending;
+    context.capture_pending = 0;
+    context.captured_frames = 0;
+    cr_logf(CR_INFO, "Capturing %d frames to '%s'", context.capture_frames, context.capture_path);
+}
+
+static void capture_close(void) {
+    if (!context.capture) { return; }
+
+    fclose(context.capture);
+    context.capture = NULL;
+    if (context.captured_frames > 0) {
+        cr_logf(CR_SUCCESS, "Successfully captured %d frames to '%s'", context.captured_frames, context.capture_path);
+    }
+    context.capture_frames = 0;
+}
+
+static bool pixel_format_info(cg_pixel_format format, GLenum* internal_format, GLenum* pixel_format, GLenum* pixel_type, size_t* pixel_size, int* block) {
+    // Uncompressed formats report the size of a pixel, compressed ones the
+    // size of a 4x4 block and no pixel type
+    size_t size = 0;
+    int dimension = 1;
+    *pixel_format = 0;
+    *pixel_type = 0;
+
+    switch (format) {
+        case CG_PIXELFORMAT_R8: *internal_format = GL_R8; *pixel_format = GL_RED; *pixel_type = GL_UNSIGNED_BYTE; size = 1; break;
+        case CG_PIXELFORMAT_RG8: *internal_format = GL_RG8; *pixel_format = GL_RG; *pixel_type = GL_UNSIGNED_BYTE; size = 2; break;
+        case CG_PIXELFORMAT_RGBA8: *internal_format = GL_RGBA8; *pixel_format = GL_RGBA; *pixel_type = GL_UNSIGNED_BYTE; size = 4; break;
+        case CG_PIXELFORMAT_SRGB8A8: *internal_format = GL_SRGB8_ALPHA8; *pixel_format = GL_RGBA; *pixel_type = GL_UNSIGNED_BYTE; size = 4; break;
+        case CG_PIXELFORMAT_RGBA16F: *internal_format = GL_RGBA16F; *pixel_format = GL_RGBA; *pixel_type = GL_HALF_FLOAT; size = 8; break;
+        case CG_PIXELFORMAT_RGBA32F: *internal_format = GL_RGBA32F; *pixel_format = GL_RGBA; *pixel_type = GL_FLOAT; size = 16; break;
+        case CG_PIXELFORMAT_BC1: *internal_format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; size = 8; break;
+        case CG_PIXELFORMAT_BC1_SRGB: *internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; size = 8; break;
+        case CG_PIXELFORMAT_BC3: *internal_format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; size = 16; break;
+        case CG_PIXELFORMAT_BC3_SRGB: *internal_format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; size = 16; break;
+        case CG_PIXELFORMAT_BC4: *internal_format = GL_COMPRESSED_RED_RGTC1; size = 8; break;
+        case CG_PIXELFORMAT_BC5: *internal_format = GL_COMPRESSED_RG_RGTC2; size = 16; break;
+        case CG_PIXELFORMAT_BC7: *internal_format = GL_COMPRESSED_RGBA_BPTC_UNORM; size = 16; break;
+        case CG_PIXELFORMAT_BC7_SRGB: *internal_format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; size = 16; break;
+        case CG_PIXELFORMAT_DEPTH32F: *internal_format = GL_DEPTH_COMPONENT32F; *pixel_format = GL_DEPTH_COMPONENT; *pixel_type = GL_FLOAT; size = 4; break;
+        case CG_PIXELFORMAT_DEPTH24_STENCIL8: *internal_format = GL_DEPTH24_STENCIL8; *pixel_format = GL_DEPTH_STENCIL; *pixel_type = GL_UNSIGNED_INT_24_8; size = 4; break;
+        default: return false;
+    }
+    if (*pixel_type == 0) { dimension = 4; }
+
+    // BC1 to BC3 are not core, BC4, BC5 and BC7 are
+    if (format >= CG_PIXELFORMAT_BC1 && format <= CG_PIXELFORMAT_BC3_SRGB && !GLEW_EXT_texture_compression_s3tc) { return false; }
+
+    if (pixel_size) { *pixel_size = size; }
+    if (block) { *block = dimension; }
+    return true;
+}
+
+static void upload_image(const cg_image* image, int level, int layer, const unsigned char* data) {
+    size_t pixel_size;
+    int block;
+    GLenum internal_format, pixel_format, pixel_type;
+    pixel_format_info(image->format, &internal_format, &pixel_format, &pixel_type, &pixel_size, &block);
+
+    const int width = (image->width >> level) > 0 ? image->width >> level : 1;
+    const int height = (image->height >> level) > 0 ? image->height >> level : 1;
+    const size_t row_size = (size_t)((width + block - 1) / block) * pixel_size;
+    const int rows = (height + block - 1) / block;
+
+    // Rows of pixels or blocks go through the upload ring in bands. A full
+    // ring hands the rest to the driver instead of waiting for the GPU.
+    for (int row = 0; row < rows;) {
+        size_t offset = 0;
+        int band = (int)reserve_upload(row_size, (size_t)(rows - row), &offset);
+        if (band > 0) {
+            memcpy((char*)context.upload_mapped + offset, data + (size_t)row * row_size, (size_t)band * row_size);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context.upload_buffer);
+            upload_image_rows(image, level, layer, row, band, (const void*)(uintptr_t)offset);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        } else {
+            band = rows - row;
+            upload_image_rows(image, level, layer, row, band, data + (size_t)row * row_size);
+        }
+        row += band;
+    }
+}
+
+// Uploads rows of pixels, or of blocks for compressed formats, to the bound
+// texture. The source is an offset while a pixel unpack buffer is bound.
+static void upload_image_rows(const cg_image* image, int level, int layer, int row, int rows, const void* source) {
+    size_t pixel_size;
+    int block;
+    GLenum internal_format, pixel_format, pixel_type;
+    pixel_format_info(image->format, &internal_format, &pixel_format, &pixel_type, &pixel_size, &block);
+
+    const int width = (image->width >> level) > 0 ? image->width >> level : 1;
+    const int height = (image->height >> level) > 0 ? image->height >> level : 1;
+    const size_t row_size = (size_t)((width + block - 1) / block) * pixel_size;
+    const int y = row * block;
+    const int band_height = rows * block < height - y ? rows * block : height - y;
+    const GLsizei size = (GLsizei)((size_t)rows * row_size);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (image->target == GL_TEXTURE_2D_ARRAY) {
+        if (pixel_type) {
+            glTexSubImage3D(image->target, level, 0, y, layer, width, band_height, 1, pixel_format, pixel_type, source);
+        } else {
+            glCompressedTexSubImage3D(image->target, level, 0, y, layer, width, band_height, 1, internal_format, size, source);
+        }
+    } else {
+        if (pixel_type) {
+            glTexSubImage2D(image->target, level, 0, y, width, band_height, pixel_format, pixel_type, source);
+        } else {
+            glCompressedTexSubImage2D(image->target, level, 0, y, width, band_height, internal_format, size, source);
+        }
+    }
+}
+
+static size_t reserve_upload(size_t row_size, size_t rows, size_t* offset) {
+    if (!context.upload_buffer && !create_upload_buffer()) { return 0; }
+    retire_uploads();
+
+    const size_t capacity = context.upload_size;
+    size_t position = context.upload_head % capacity;
+    size_t free_space = capacity - (context.upload_head - context.upload_tail);
+
+    // A band is contiguous, so a row that does not fit before the end of the
+    // ring skips the remainder
+    if (row_size > capacity - position && free_space >= capacity - position) {
+        context.upload_head += capacity - position;
+        free_space -= capacity - position;
+        position = 0;
+    }
+
+    // Bands are padded so the head stays aligned for the pixel types of every format
+    const size_t space = (free_space < capacity - position ? free_space : capacity - position) & ~(size_t)15;
+    if (rows > space / row_size) { rows = space / row_size; }
+    while (rows > 0 && ((rows * row_size + 15) & ~(size_t)15) > space) { rows--; }
+    if (rows == 0) { return 0; }
+
+    *offset = position;
+    context.upload_head += (rows * row_size + 15) & ~(size_t)15;
+    return rows;
+}
+
+static bool create_upload_buffer(void) {
+    if (context.upload_size == 0 || (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)) { return false; }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &context.upload_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context.upload_buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)context.upload_size, NULL, flags);
+    context.upload_mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)context.upload_size, flags);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!context.upload_mapped) {
+        cr_log(CR_ERROR, "Failed to map pixel upload buffer, uploading directly");
+        glDeleteBuffers(1, &context.upload_buffer);
+        context.upload_buffer = 0;
+        context.upload_size = 0;
+        return false;
+    }
+    cg_track_memory(CG_MEMORY_STAGING, context.upload_size, true);
+    return true;
+}
+
+static void retire_uploads(void) {
+    while (context.upload_fence_head != context.upload_fence_tail) {
+        cg_upload_fence* fence = &context.upload_fences[context.upload_fence_head % CG_MAX_UPLOAD_FENCES];
+        const GLenum status = glClientWaitSync(fence->fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) { return; }
+
+        glDeleteSync(fence->fence);
+        context.upload_tail = fence->end;
+        context.upload_fence_head++;
+    }
+}
+
+static void fence_uploads(void) {
+    // With every fence in use the range waits for the next frame, a later
+    // fence covers everything before it
+    if (context.upload_head == context.upload_fenced) { return; }
+    if (context.upload_fence_tail - context.upload_fence_head == CG_MAX_UPLOAD_FENCES) { return; }
+
+    context.upload_fences[context.upload_fence_tail++ % CG_MAX_UPLOAD_FENCES] = (cg_upload_fence){
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), context.upload_head
+    };
+    context.upload_fenced = context.upload_head;
+}
+
+static uint32_t read_u32(const char* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint64_t read_u64(const char* data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static bool decode_ktx2(casset_view view, const char* path, cg_image_conf* conf) {
+    // Header, index and one 24 byte entry per level, see the KTX 2.0 specification
+    if (view.size < 80) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': truncated KTX2 header", path);
+        return false;
+    }
+
+    cg_pixel_format format;
+    switch (read_u32(view.data + 12)) {
+        case 9: format = CG_PIXELFORMAT_R8; break;
+        case 16: format = CG_PIXELFORMAT_RG8; break;
+        case 37: format = CG_PIXELFORMAT_RGBA8; break;
+        case 43: format = CG_PIXELFORMAT_SRGB8A8; break;
+        case 97: format = CG_PIXELFORMAT_RGBA16F; break;
+        case 109: format = CG_PIXELFORMAT_RGBA32F; break;
+        case 131: case 133: format = CG_PIXELFORMAT_BC1; break;
+        case 132: case 134: format = CG_PIXELFORMAT_BC1_SRGB; break;
+        case 137: format = CG_PIXELFORMAT_BC3; break;
+        case 138: format = CG_PIXELFORMAT_BC3_SRGB; break;
+        case 139: format = CG_PIXELFORMAT_BC4; break;
+        case 141: format = CG_PIXELFORMAT_BC5; break;
+        case 145: format = CG_PIXELFORMAT_BC7; break;
+        case 146: format = CG_PIXELFORMAT_BC7_SRGB; break;
+        default:
+            cr_logf(CR_ERROR, "Failed to load image '%s': unsupported KTX2 format %u", path, read_u32(view.data + 12));
+            return false;
+    }
+
+    const uint32_t depth = read_u32(view.data + 28);
+    const uint32_t faces = read_u32(view.data + 36);
+    const uint32_t levels = read_u32(view.data + 40);
+    if (depth > 1 || faces > 1 || read_u32(view.data + 44) != 0) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': 3D, cube map and supercompressed KTX2 files are not supported", path);
+        return false;
+    }
+
+    // Zero levels ask for mipmaps to be generated from the one stored level
+    *conf = (cg_image_conf){
+        .width = (int)read_u32(view.data + 20),
+        .height = (int)read_u32(view.data + 24),
+        .layers = (int)read_u32(view.data + 32),
+        .levels = levels > 0 ? (int)levels : 0,
+        .format = format,
+        .generate_mipmaps = levels == 0
+    };
+    const uint32_t stored = levels > 0 ? levels : 1;
+    if (stored > CG_MAX_MIPMAPS || view.size < 80 + (size_t)stored * 24) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': invalid KTX2 level index", path);
+        return false;
+    }
+
+    for (uint32_t level = 0; level < stored; level++) {
+        const uint64_t offset = read_u64(view.data + 80 + level * 24);
+        const uint64_t length = read_u64(view.data + 80 + level * 24 + 8);
+        if (offset > view.size || length > view.size - offset) {
+            cr_logf(CR_ERROR, "Failed to load image '%s': level %u out of bounds", path, level);
+            return false;
+        }
+        conf->data[level] = (cg_image_data){ view.data + offset, (size_t)length };
+    }
+    return true;
+}
+
+static bool decode_dds(casset_view view, const char* path, cg_image_conf* conf, void** allocation) {
+    // Magic, 124 byte header and the optional 20 byte DX10 extension
+    if (view.size < 128 || read_u32(view.data + 4) != 124) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': truncated DDS header", path);
+        return false;
+    }
+
+    const uint32_t four_cc = read_u32(view.data + 84);
+    size_t offset = 128;
+    int layers = 1;
+    cg_pixel_format format = CG_PIXELFORMAT_NONE;
+
+    if (four_cc == 0x30315844u) { // "DX10"
+        if (view.size < 148) {
+            cr_logf(CR_ERROR, "Failed to load image '%s': truncated DDS header", path);
+            return false;
+        }
+        switch (read_u32(view.data + 128)) {
+            case 2: format = CG_PIXELFORMAT_RGBA32F; break;
+            case 10: format = CG_PIXELFORMAT_RGBA16F; break;
+            case 28: format = CG_PIXELFORMAT_RGBA8; break;
+            case 29: format = CG_PIXELFORMAT_SRGB8A8; break;
+            case 49: format = CG_PIXELFORMAT_RG8; break;
+            case 61: format = CG_PIXELFORMAT_R8; break;
+            case 71: format = CG_PIXELFORMAT_BC1; break;
+            case 72: format = CG_PIXELFORMAT_BC1_SRGB; break;
+            case 77: format = CG_PIXELFORMAT_BC3; break;
+            case 78: format = CG_PIXELFORMAT_BC3_SRGB; break;
+            case 80: format = CG_PIXELFORMAT_BC4; break;
+            case 83: format = CG_PIXELFORMAT_BC5; break;
+            case 98: format = CG_PIXELFORMAT_BC7; break;
+            case 99: format = CG_PIXELFORMAT_BC7_SRGB; break;
+            default: break;
+        }
+        layers = read_u32(view.data + 140) > 1 ? (int)read_u32(view.data + 140) : 1;
+        offset = 148;
+    } else if (four_cc == 0x31545844u) { // "DXT1"
+        format = CG_PIXELFORMAT_BC1;
+    } else if (four_cc == 0x35545844u) { // "DXT5"
+        format = CG_PIXELFORMAT_BC3;
+    } else if (four_cc == 0x31495441u || four_cc == 0x55344342u) { // "ATI1", "BC4U"
+        format = CG_PIXELFORMAT_BC4;
+    } else if (four_cc == 0x32495441u || four_cc == 0x55354342u) { // "ATI2", "BC5U"
+        format = CG_PIXELFORMAT_BC5;
+    } else if (four_cc == 0 && read_u32(view.data + 88) == 32 && read_u32(view.data + 92) == 0x000000ffu &&
+               read_u32(view.data + 96) == 0x0000ff00u && read_u32(view.data + 100) == 0x00ff0000u) {
+        format = CG_PIXELFORMAT_RGBA8;
+    }
+
+    if (format == CG_PIXELFORMAT_NONE || (read_u32(view.data + 112) & 0x200u)) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': unsupported DDS format or cube map", path);
+        return false;
+    }
+
+    const uint32_t levels = read_u32(view.data + 28) > 0 ? read_u32(view.data + 28) : 1;
+    if (levels > CG_MAX_MIPMAPS) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': too many DDS levels", path);
+        return false;
+    }
+
+    *conf = (cg_image_conf){
+        .width = (int)read_u32(view.data + 16),
+        .height = (int)read_u32(view.data + 12),
+        .layers = layers,
+        .levels = (int)levels,
+        .format = format
+    };
+
+    // A zero level size is a format the driver lacks
+    const cg_image shape = { .width = conf->width, .height = conf->height, .format = format };
+    size_t level_sizes[CG_MAX_MIPMAPS];
+    size_t layer_size = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        level_sizes[level] = cg_image_level_size(&shape, (int)level);
+        if (level_sizes[level] == 0) {
+            cr_logf(CR_ERROR, "Failed to load image '%s': unsupported DDS format", path);
+            return false;
+        }
+        layer_size += level_sizes[level];
+    }
+    if (layer_size * (size_t)layers > view.size - offset) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': truncated pixel data", path);
+        return false;
+    }
+
+    // DDS stores every level of a layer before the next layer while images
+    // take the layers of a level together, so arrays are reordered into a copy
+    if (layers == 1) {
+        for (uint32_t level = 0; level < levels; level++) {
+            conf->data[level] = (cg_image_data){ view.data + offset, level_sizes[level] };
+            offset += level_sizes[level];
+        }
+        return true;
+    }
+
+    char* pixels = (char*)cr_alloc(layer_size * (size_t)layers);
+    if (!pixels) {
+        cr_logf(CR_ERROR, "Failed to load image '%s': out of memory", path);
+        return false;
+    }
+    *allocation = pixels;
+
+    char* level_data = pixels;
+    for (uint32_t level = 0; level < levels; level++) {
+        for (int layer = 0; layer < layers; layer++) {
+            memcpy(level_data + level_sizes[level] * (size_t)layer, view.data + offset + layer_size * (size_t)layer, level_sizes[level]);
+        }
+        conf->data[level] = (cg_image_data){ level_data, level_sizes[level] * (size_t)layers };
+        level_data += level_sizes[level] * (size_t)layers;
+        offset += level_sizes[level];
+    }
+    return true;
+}
+
+#endif // CARRIER_GFX_IMPLEMENTATION
@@ -0,0 +1,557 @@
+#ifndef CARRIER_GRAPH_H
+#define CARRIER_GRAPH_H
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_gfx.h"
+
+// Limits of a graph, one bit per pass and per resource in the compiler masks
+#define CGRAPH_MAX_PASSES 64
+#define CGRAPH_MAX_RESOURCES 64
+#define CGRAPH_MAX_READS 8
+
+// Resource handle of the window framebuffer, present in every graph
+#define CGRAPH_BACKBUFFER 1
+
+// Handle of a graph resource, index plus one so that zero is never valid
+typedef uint32_t cgraph_resource;
+
+// Index of a graph pass
+typedef int cgraph_pass;
+
+// Records the commands of a pass, the graph has begun the pass already
+typedef void (*cgraph_execute_func)(void* user);
+
+// Transient texture, a zero size follows the window framebuffer multiplied
+// by scale, a zero scale counts as one
+typedef struct {
+    int width, height;
+    float scale;
+    cg_pixel_format format;
+} cgraph_texture_conf;
+
+// Pass declaration. Reads are the sampled resources, colors and depth the
+// attachments written. Attachments loaded with CG_LOAD_LOAD are read as well.
+// Passes without side effects are culled when nothing uses what they write.
+typedef struct {
+    const char* name;
+    cgraph_resource reads[CGRAPH_MAX_READS];
+    cgraph_resource colors[CG_MAX_COLOR_ATTACHMENTS];
+    cgraph_resource depth;
+    cg_pass_action action;
+    bool side_effects;
+    cgraph_execute_func execute;
+    void* user;
+} cgraph_pass_conf;
+
+// Resource kinds, transient textures are owned by the graph
+typedef enum {
+    CGRAPH_TRANSIENT = 0,
+    CGRAPH_IMPORTED,
+    CGRAPH_WINDOW
+} cgraph_resource_kind;
+
+// Resource of a graph, first and last are execution positions
+typedef struct {
+    const char* name;
+    cgraph_resource_kind kind;
+    cgraph_texture_conf conf;
+    const cg_image* image;
+    int physical;
+    int first, last;
+} cgraph_resource_info;
+
+// Texture backing one or more transient resources with disjoint lifetimes
+typedef struct {
+    cg_image image;
+    int last;
+    bool used;
+} cgraph_texture;
+
+// Pass of a graph with the action and framebuffer chosen by the compiler
+typedef struct {
+    cgraph_pass_conf conf;
+    bool enabled;
+    cg_pass_action action;
+    cg_framebuffer framebuffer;
+} cgraph_pass_info;
+
+// Result of the last compilation, bytes are the transient texture memory
+// with and without aliasing
+typedef struct {
+    int passes;
+    int culled;
+    int resources;
+    int textures;
+    size_t bytes;
+    size_t unaliased_bytes;
+} cgraph_stats;
+
+// Render graph, compiled again whenever its topology or the window size changes
+typedef struct {
+    cgraph_pass_info passes[CGRAPH_MAX_PASSES];
+    int pass_count;
+    cgraph_resource_info resources[CGRAPH_MAX_RESOURCES];
+    int resource_count;
+    cgraph_texture textures[CGRAPH_MAX_RESOURCES];
+    int texture_count;
+    int order[CGRAPH_MAX_PASSES];
+    int order_count;
+    bool dirty;
+    bool failed;
+    int width, height;
+    cgraph_stats stats;
+} cgraph_graph;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cg_graph_init(cgraph_graph* graph);
+CARRIER_API void cg_graph_shutdown(cgraph_graph* graph);
+CARRIER_API cgraph_resource cg_graph_create_texture(cgraph_graph* graph, const char* name, const cgraph_texture_conf* conf);
+CARRIER_API cgraph_resource cg_graph_import_image(cgraph_graph* graph, const char* name, const cg_image* image);
+CARRIER_API cgraph_pass cg_graph_add_pass(cgraph_graph* graph, const cgraph_pass_conf* conf);
+CARRIER_API void cg_graph_set_pass_enabled(cgraph_graph* graph, cgraph_pass pass, bool enabled);
+CARRIER_API bool cg_graph_compile(cgraph_graph* graph);
+CARRIER_API void cg_graph_execute(cgraph_graph* graph);
+CARRIER_API const cg_image* cg_graph_get_image(const cgraph_graph* graph, cgraph_resource resource);
+CARRIER_API cgraph_stats cg_graph_get_stats(const cgraph_graph* graph);
+
+#endif // CARRIER_GRAPH_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_GRAPH_IMPLEMENTATION)
+#define CARRIER_GRAPH_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static uint64_t cg_graph_writes(const cgraph_pass_info* pass);
+static uint64_t cg_graph_reads(const cgraph_pass_info* pass);
+static bool cg_graph_order(cgraph_graph* graph);
+static void cg_graph_cull(cgraph_graph* graph);
+static void cg_graph_allocate(cgraph_graph* graph);
+static bool cg_graph_build_passes(cgraph_graph* graph);
+static void cg_graph_release_passes(cgraph_graph* graph);
+static void cg_graph_texture_size(const cgraph_graph* graph, const cgraph_resource_info* resource, int* width, int* height);
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cg_graph_init(cgraph_graph* graph) {
+    memset(graph, 0, sizeof(*graph));
+    graph->resources[0] = (cgraph_resource_info){ .name = "backbuffer", .kind = CGRAPH_WINDOW, .physical = -1 };
+    graph->resource_count = 1;
+    graph->dirty = true;
+}
+
+CARRIER_API void cg_graph_shutdown(cgraph_graph* graph) {
+    cg_graph_release_passes(graph);
+    for (int i = 0; i < graph->texture_count; i++) {
+        cg_destroy_image(graph->textures[i].image);
+    }
+    memset(graph, 0, sizeof(*graph));
+}
+
+CARRIER_API cgraph_resource cg_graph_create_texture(cgraph_graph* graph, const char* name, const cgraph_texture_conf* conf) {
+    if (graph->resource_count == CGRAPH_MAX_RESOURCES) {
+        cr_logf(CR_ERROR, "Failed to create graph texture '%s': too many resources", name);
+        return 0;
+    }
+
+    graph->resources[graph->resource_count] = (cgraph_resource_info){ .name = name, .kind = CGRAPH_TRANSIENT, .conf = *conf, .physical = -1 };
+    graph->dirty = true;
+    return (cgraph_resource)++graph->resource_count;
+}
+
+CARRIER_API cgraph_resource cg_graph_import_image(cgraph_graph* graph, const char* name, const cg_image* image) {
+    if (graph->resource_count == CGRAPH_MAX_RESOURCES) {
+        cr_logf(CR_ERROR, "Failed to import graph image '%s': too many resources", name);
+        return 0;
+    }
+
+    graph->resources[graph->resource_count] = (cgraph_resource_info){ .name = name, .kind = CGRAPH_IMPORTED, .image = image, .physical = -1 };
+    graph->dirty = true;
+    return (cgraph_resource)++graph->resource_count;
+}
+
+CARRIER_API cgraph_pass cg_graph_add_pass(cgraph_graph* graph, const cgraph_pass_conf* conf) {
+    if (graph->pass_count == CGRAPH_MAX_PASSES) {
+        cr_logf(CR_ERROR, "Failed to add graph pass '%s': too many passes", conf->name);
+        return -1;
+    }
+
+    graph->passes[graph->pass_count] = (cgraph_pass_info){ .conf = *conf, .enabled = true };
+    graph->dirty = true;
+    return graph->pass_count++;
+}
+
+CARRIER_API void cg_graph_set_pass_enabled(cgraph_graph* graph, cgraph_pass pass, bool enabled) {
+    if (pass < 0 || pass >= graph->pass_count || graph->passes[pass].enabled == enabled) { return; }
+    graph->passes[pass].enabled = enabled;
+    graph->dirty = true;
+}
+
+CARRIER_API bool cg_graph_compile(cgraph_graph* graph) {
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &graph->width, &graph->height);
+    graph->dirty = false;
+    graph->failed = true;
+    cg_graph_release_passes(graph);
+
+    for (int i = 0; i < graph->pass_count; i++) {
+        const cgraph_pass_conf* conf = &graph->passes[i].conf;
+        const cgraph_resource* handles[3] = { conf->reads, conf->colors, &conf->depth };
+        const int counts[3] = { CGRAPH_MAX_READS, CG_MAX_COLOR_ATTACHMENTS, 1 };
+        for (int list = 0; list < 3; list++) {
+            for (int k = 0; k < counts[list]; k++) {
+                if (handles[list][k] > (cgraph_resource)graph->resource_count) {
+                    cr_logf(CR_ERROR, "Failed to compile render graph: pass '%s' uses an unknown resource", conf->name);
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (!cg_graph_order(graph)) { return false; }
+    cg_graph_cull(graph);
+    cg_graph_allocate(graph);
+    if (!cg_graph_build_passes(graph)) { return false; }
+
+    graph->failed = false;
+    cr_logf(CR_INFO, "Compiled render graph: %d passes, %d culled, %d textures for %d resources (%zu KiB, %zu KiB without aliasing)",
+            graph->stats.passes, graph->stats.culled, graph->stats.textures, graph->stats.resources,
+            graph->stats.bytes >> 10, graph->stats.unaliased_bytes >> 10);
+    return true;
+}
+
+CARRIER_API void cg_graph_execute(cgraph_graph* graph) {
+    int width, height;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+    if (width != graph->width || height != graph->height) { graph->dirty = true; }
+
+    // A failed compilation is only retried once something changes
+    if (graph->dirty && !cg_graph_compile(graph)) { return; }
+    if (graph->failed) { return; }
+
+    for (int position = 0; position < graph->order_count; position++) {
+        cgraph_pass_info* pass = &graph->passes[graph->order[position]];
+        const uint64_t writes = cg_graph_writes(pass);
+
+        // Passes without attachments, compute work for instance, only execute
+        if (writes == 0) {
+            if (pass->conf.execute) { pass->conf.execute(pass->conf.user); }
+            continue;
+        }
+
+        if (writes & 1) {
+            cg_begin_pass(&pass->action);
+        } else {
+            cg_begin_framebuffer_pass(&pass->framebuffer, &pass->action);
+        }
+        if (pass->conf.execute) { pass->conf.execute(pass->conf.user); }
+        cg_end_pass();
+    }
+}
+
+CARRIER_API const cg_image* cg_graph_get_image(const cgraph_graph* graph, cgraph_resource resource) {
+    if (resource == 0 || resource > (cgraph_resource)graph->resource_count) { return NULL; }
+
+    const cgraph_resource_info* info = &graph->resources[resource - 1];
+    if (info->kind == CGRAPH_IMPORTED) { return info->image; }
+    if (info->kind == CGRAPH_TRANSIENT && info->physical >= 0) { return &graph->textures[info->physical].image; }
+    return NULL;
+}
+
+CARRIER_API cgraph_stats cg_graph_get_stats(const cgraph_graph* graph) {
+    return graph->stats;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+// Resource masks have bit i set for the resource of handle i + 1
+static uint64_t cg_graph_writes(const cgraph_pass_info* pass) {
+    uint64_t mask = 0;
+    for (int i = 0; i < CG_MAX_COLOR_ATTACHMENTS; i++) {
+        if (pass->conf.colors[i]) { mask |= 1ull << (pass->conf.colors[i] - 1); }
+    }
+    if (pass->conf.depth) { mask |= 1ull << (pass->conf.depth - 1); }
+    return mask;
+}
+
+static uint64_t cg_graph_reads(const cgraph_pass_info* pass) {
+    uint64_t mask = 0;
+    for (int i = 0; i < CGRAPH_MAX_READS; i++) {
+        if (pass->conf.reads[i]) { mask |= 1ull << (pass->conf.reads[i] - 1); }
+    }
+
+    // Loading an attachment depends on whoever wrote it before
+    const cg_pass_action* action = &pass->conf.action;
+    if (action->color_load == CG_LOAD_LOAD) {
+        for (int i = 0; i < CG_MAX_COLOR_ATTACHMENTS; i++) {
+            if (pass->conf.colors[i]) { mask |= 1ull << (pass->conf.colors[i] - 1); }
+        }
+    }
+    if (pass->conf.depth && (action->depth_load == CG_LOAD_LOAD || action->stencil_load == CG_LOAD_LOAD)) {
+        mask |= 1ull << (pass->conf.depth - 1);
+    }
+    return mask;
+}
+
+// Orders the enabled passes so that every read follows the writes it sees.
+// A read sees the writes declared before it, or all writes when there are
+// none, and writes of a resource keep their declaration order.
+static bool cg_graph_order(cgraph_graph* graph) {
+    uint64_t reads[CGRAPH_MAX_PASSES], writes[CGRAPH_MAX_PASSES], depends[CGRAPH_MAX_PASSES];
+    for (int i = 0; i < graph->pass_count; i++) {
+        reads[i] = graph->passes[i].enabled ? cg_graph_reads(&graph->passes[i]) : 0;
+        writes[i] = graph->passes[i].enabled ? cg_graph_writes(&graph->passes[i]) : 0;
+        depends[i] = 0;
+    }
+
+    for (int i = 0; i < graph->pass_count; i++) {
+        if (!graph->passes[i].enabled) { continue; }
+
+        for (int r = 0; r < graph->resource_count; r++) {
+            const uint64_t bit = 1ull << r;
+            uint64_t earlier = 0, later = 0, earlier_readers = 0;
+            for (int j = 0; j < graph->pass_count; j++) {
+                if (j == i) { continue; }
+                if (writes[j] & bit) { if (j < i) { earlier |= 1ull << j; } else { later |= 1ull << j; } }
+                if (j < i && (reads[j] & bit) && !(writes[j] & bit)) { earlier_readers |= 1ull << j; }
+            }
+
+            if (reads[i] & bit) { depends[i] |= earlier ? earlier : later; }
+            if (writes[i] & bit) {
+                depends[i] |= earlier;
+                // Readers that saw an earlier write must run before this one
+                if (earlier) { depends[i] |= earlier_readers; }
+            }
+        }
+        depends[i] &= ~(1ull << i);
+    }
+
+    // Kahn's algorithm, picking the first declared pass that is ready
+    uint64_t placed = 0;
+    graph->order_count = 0;
+    for (;;) {
+        int next = -1;
+        bool pending = false;
+        for (int i = 0; i < graph->pass_count && next < 0; i++) {
+            if (!graph->passes[i].enabled || (placed & (1ull << i))) { continue; }
+            pending = true;
+            if ((depends[i] & ~placed) == 0) { next = i; }
+        }
+        if (next < 0) {
+            if (!pending) { return true; }
+            for (int i = 0; i < graph->pass_count; i++) {
+                if (graph->passes[i].enabled && !(placed & (1ull << i))) {
+                    cr_logf(CR_ERROR, "Failed to compile render graph: cycle through pass '%s'", graph->passes[i].conf.name);
+                    break;
+                }
+            }
+            return false;
+        }
+        placed |= 1ull << next;
+        graph->order[graph->order_count++] = next;
+    }
+}
+
+// Walks the order backwards and keeps the passes whose writes are needed by a
+// later pass, reach the window or an imported image, or that have side effects
+static void cg_graph_cull(cgraph_graph* graph) {
+    uint64_t outputs = 0;
+    for (int r = 0; r < graph->resource_count; r++) {
+        if (graph->resources[r].kind != CGRAPH_TRANSIENT) { outputs |= 1ull << r; }
+    }
+
+    uint64_t needed = 0;
+    int alive[CGRAPH_MAX_PASSES];
+    int alive_count = 0;
+    for (int position = graph->order_count - 1; position >= 0; position--) {
+        const cgraph_pass_info* pass = &graph->passes[graph->order[position]];
+        const uint64_t writes = cg_graph_writes(pass);
+        if (!pass->conf.side_effects && !(writes & (needed | outputs))) { continue; }
+
+        needed = (needed & ~writes) | cg_graph_reads(pass);
+        alive[alive_count++] = graph->order[position];
+    }
+
+    graph->stats.passes = alive_count;
+    graph->stats.culled = graph->order_count - alive_count;
+    graph->order_count = alive_count;
+    for (int i = 0; i < alive_count; i++) {
+        graph->order[i] = alive[alive_count - 1 - i];
+    }
+}
+
+// Gives every live transient resource a texture, sharing one between
+// resources of the same size and format whose lifetimes do not overlap
+static void cg_graph_allocate(cgraph_graph* graph) {
+    for (int r = 0; r < graph->resource_count; r++) {
+        graph->resources[r].first = -1;
+        graph->resources[r].last = -1;
+        graph->resources[r].physical = -1;
+    }
+    for (int position = 0; position < graph->order_count; position++) {
+        const cgraph_pass_info* pass = &graph->passes[graph->order[position]];
+        const uint64_t used = cg_graph_reads(pass) | cg_graph_writes(pass);
+        for (int r = 0; r < graph->resource_count; r++) {
+            if (!(used & (1ull << r))) { continue; }
+            if (graph->resources[r].first < 0) { graph->resources[r].first = position; }
+            graph->resources[r].last = position;
+        }
+    }
+
+    for (int t = 0; t < graph->texture_count; t++) {
+        graph->textures[t].used = false;
+        graph->textures[t].last = -1;
+    }
+
+    graph->stats.resources = 0;
+    graph->stats.unaliased_bytes = 0;
+    for (int position = 0; position < graph->order_count; position++) {
+        for (int r = 0; r < graph->resource_count; r++) {
+            cgraph_resource_info* resource = &graph->resources[r];
+            if (resource->kind != CGRAPH_TRANSIENT || resource->first != position) { continue; }
+
+            int width, height;
+            cg_graph_texture_size(graph, resource, &width, &height);
+
+            int chosen = -1;
+            for (int t = 0; t < graph->texture_count && chosen < 0; t++) {
+                const cg_image* image = &graph->textures[t].image;
+                if (graph->textures[t].last < position && image->width == width && image->height == height && image->format == resource->conf.format) {
+                    chosen = t;
+                }
+            }
+            if (chosen < 0) {
+                const cg_image image = cg_make_image(&(cg_image_conf){
+                    .width = width, .height = height, .format = resource->conf.format, .render_target = true
+                });
+                if (!image.texture) {
+                    cr_logf(CR_ERROR, "Failed to create graph texture '%s'", resource->name);
+                    continue;
+                }
+                chosen = graph->texture_count++;
+                graph->textures[chosen] = (cgraph_texture){ .image = image };
+            }
+
+            graph->textures[chosen].used = true;
+            graph->textures[chosen].last = resource->last;
+            resource->physical = chosen;
+            graph->stats.resources++;
+            graph->stats.unaliased_bytes += cg_image_level_size(&graph->textures[chosen].image, 0);
+        }
+    }
+
+    // Textures left over from an earlier compilation are released
+    int remap[CGRAPH_MAX_RESOURCES];
+    int kept = 0;
+    graph->stats.bytes = 0;
+    for (int t = 0; t < graph->texture_count; t++) {
+        if (!graph->textures[t].used) {
+            cg_destroy_image(graph->textures[t].image);
+            remap[t] = -1;
+            continue;
+        }
+        graph->stats.bytes += cg_image_level_size(&graph->textures[t].image, 0);
+        remap[t] = kept;
+        graph->textures[kept++] = graph->textures[t];
+    }
+    graph->texture_count = kept;
+    graph->stats.textures = kept;
+    for (int r = 0; r < graph->resource_count; r++) {
+        if (graph->resources[r].physical >= 0) { graph->resources[r].physical = remap[graph->resources[r].physical]; }
+    }
+}
+
+// Makes the framebuffers of the live passes and derives their actions.
+// Contents of a transient attachment are never loaded on its first use and
+// never stored on its last, both are discarded instead.
+static bool cg_graph_build_passes(cgraph_graph* graph) {
+    for (int position = 0; position < graph->order_count; position++) {
+        cgraph_pass_info* pass = &graph->passes[graph->order[position]];
+        const uint64_t writes = cg_graph_writes(pass);
+        pass->action = pass->conf.action;
+        if (writes == 0) { continue; }
+
+        if (writes & 1) {
+            if (writes != 1) {
+                cr_logf(CR_ERROR, "Failed to compile render graph: pass '%s' writes the backbuffer and textures", pass->conf.name);
+                return false;
+            }
+            continue;
+        }
+
+        cg_framebuffer_conf conf = { 0 };
+        bool fresh = true, finished = true;
+        int count = 0;
+        for (int i = 0; i < CG_MAX_COLOR_ATTACHMENTS; i++) {
+            if (!pass->conf.colors[i]) { continue; }
+            const cgraph_resource_info* resource = &graph->resources[pass->conf.colors[i] - 1];
+            conf.colors[count++] = cg_graph_get_image(graph, pass->conf.colors[i]);
+            fresh = fresh && resource->kind == CGRAPH_TRANSIENT && resource->first == position;
+            finished = finished && resource->kind == CGRAPH_TRANSIENT && resource->last == position;
+        }
+        if (count > 0) {
+            if (fresh && pass->action.color_load == CG_LOAD_LOAD) { pass->action.color_load = CG_LOAD_DONTCARE; }
+            if (finished) { pass->action.color_store = CG_STORE_DONTCARE; }
+        }
+
+        if (pass->conf.depth) {
+            const cgraph_resource_info* resource = &graph->resources[pass->conf.depth - 1];
+            conf.depth = cg_graph_get_image(graph, pass->conf.depth);
+            if (resource->kind == CGRAPH_TRANSIENT && resource->first == position) {
+                if (pass->action.depth_load == CG_LOAD_LOAD) { pass->action.depth_load = CG_LOAD_DONTCARE; }
+                if (pass->action.stencil_load == CG_LOAD_LOAD) { pass->action.stencil_load = CG_LOAD_DONTCARE; }
+            }
+            if (resource->kind == CGRAPH_TRANSIENT && resource->last == position) {
+                pass->action.depth_store = CG_STORE_DONTCARE;
+                pass->action.stencil_store = CG_STORE_DONTCARE;
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (!conf.colors[i]) { return false; }
+        }
+        if (pass->conf.depth && !conf.depth) { return false; }
+
+        pass->framebuffer = cg_make_framebuffer(&conf);
+        if (!pass->framebuffer.framebuffer) {
+            cr_logf(CR_ERROR, "Failed to compile render graph: no framebuffer for pass '%s'", pass->conf.name);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void cg_graph_release_passes(cgraph_graph* graph) {
+    for (int i = 0; i < graph->pass_count; i++) {
+        if (graph->passes[i].framebuffer.framebuffer) {
+            cg_destroy_framebuffer(graph->passes[i].framebuffer);
+            graph->passes[i].framebuffer = (cg_framebuffer){ 0 };
+        }
+    }
+}
+
+static void cg_graph_texture_size(const cgraph_graph* graph, const cgraph_resource_info* resource, int* width, int* height) {
+    const float scale = resource->conf.scale > 0.0f ? resource->conf.scale : 1.0f;
+    *width = resource->conf.width > 0 ? resource->conf.width : (int)((float)graph->width * scale);
+    *height = resource->conf.height > 0 ? resource->conf.height : (int)((float)graph->height * scale);
+    if (*width < 1) { *width = 1; }
+    if (*height < 1) { *height = 1; }
+}
+
+#endif // CARRIER_GRAPH_IMPLEMENTATION
@@ -0,0 +1,496 @@
+#ifndef CARRIER_JOBS_H
+#define CARRIER_JOBS_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+
+// Maximum number of workers, the main thread counts as worker 0
+#ifndef CJOB_MAX_WORKERS
+#define CJOB_MAX_WORKERS 64
+#endif
+
+// Number of queued jobs per worker, must be a power of two
+#ifndef CJOB_DEQUE_SIZE
+#define CJOB_DEQUE_SIZE 4096
+#endif
+
+// Number of job records per worker, must be a power of two
+#ifndef CJOB_POOL_SIZE
+#define CJOB_POOL_SIZE 4096
+#endif
+
+// Failed rounds of stealing before an idle worker goes to sleep
+#define CJOB_SPIN_ROUNDS 64
+
+// Pool slots tried before a submission falls back to running inline
+#define CJOB_POOL_PROBES 16
+
+// Counter bit held by the finisher that releases the dependent jobs
+#define CJOB_RELEASING ((int64_t)1 << 62)
+
+typedef void (*cjob_func)(void* data);
+typedef void (*cjob_range_func)(void* data, size_t begin, size_t end);
+
+typedef struct cjob_job cjob_job;
+
+// Configuration structure for the jobs module, zero workers means one per core
+typedef struct {
+    int workers;
+} cjob_conf;
+
+// Completion counter, zero-initialized by the user. Every job submitted with
+// the counter adds one and removes it when done, so zero means all finished.
+typedef struct {
+    int64_t value;
+    cjob_job* waiting;
+} cjob_counter;
+
+// Job declaration, a job with an after counter starts once it reaches zero
+typedef struct {
+    cjob_func func;
+    void* data;
+    cjob_counter* after;
+} cjob_decl;
+
+// Job record, single jobs set func and range jobs set range
+struct cjob_job {
+    cjob_func func;
+    cjob_range_func range;
+    void* data;
+    size_t begin, end, grain;
+    cjob_counter* counter;
+    cjob_job* next;
+    int busy;
+};
+
+// Fixed-capacity Chase-Lev deque. The owner pushes and pops at the bottom,
+// thieves take from the top, top and bottom live on separate cache lines.
+typedef struct {
+    int64_t top;
+    char pad0[64];
+    int64_t bottom;
+    char pad1[64];
+    cjob_job* slots[CJOB_DEQUE_SIZE];
+} cjob_deque;
+
+// Worker state, only the owner allocates from its pool
+typedef struct {
+    cjob_deque deque;
+    cjob_job pool[CJOB_POOL_SIZE];
+    size_t pool_next;
+    uint32_t seed;
+    pthread_t thread;
+} cjob_worker;
+
+// Job system structure for the jobs module
+typedef struct {
+    cjob_worker* workers;
+    int worker_count;
+    bool running;
+    uint64_t epoch;
+    int sleeping;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+} cjob_system;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_jobs_setup(const cjob_conf* conf);
+CARRIER_API void cr_jobs_shutdown(void);
+CARRIER_API void cr_jobs_run(const cjob_decl* jobs, size_t count, cjob_counter* counter);
+CARRIER_API void cr_jobs_parallel_for(size_t count, size_t grain, cjob_range_func func, void* data, cjob_counter* counter);
+CARRIER_API void cr_jobs_wait(cjob_counter* counter);
+CARRIER_API int cr_jobs_worker_count(void);
+CARRIER_API int cr_jobs_worker_index(void);
+
+#endif // CARRIER_JOBS_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_JOBS_IMPLEMENTATION)
+#define CARRIER_JOBS_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static cjob_worker* cr_jobs_self(void);
+static cjob_job* cr_jobs_alloc(cjob_worker* worker);
+static void cr_jobs_push(cjob_job* job);
+static void cr_jobs_park(cjob_job* job, cjob_counter* after);
+static void cr_jobs_schedule(cjob_job* list);
+static void cr_jobs_execute(cjob_job* job);
+static void cr_jobs_finish(cjob_counter* counter);
+static bool cr_jobs_help(void);
+static void cr_jobs_notify(void);
+static bool cr_jobs_deque_push(cjob_deque* deque, cjob_job* job);
+static cjob_job* cr_jobs_deque_pop(cjob_deque* deque);
+static cjob_job* cr_jobs_deque_steal(cjob_deque* deque);
+static void* cr_jobs_thread(void* arg);
+
+// Global variable to hold the job system
+static cjob_system cjobs = {0};
+
+// Worker index of the current thread, -1 for threads outside the pool
+static __thread int cjob_thread_index = -1;
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_jobs_setup(const cjob_conf* conf) {
+    if (cjobs.workers) { return; }
+
+    int count = conf->workers;
+    if (count <= 0) { count = (int)sysconf(_SC_NPROCESSORS_ONLN); }
+    if (count < 1) { count = 1; }
+    if (count > CJOB_MAX_WORKERS) { count = CJOB_MAX_WORKERS; }
+
+    cjobs.workers = (cjob_worker*)cr_calloc((size_t)count, sizeof(cjob_worker));
+    if (!cjobs.workers) {
+        cr_log(CR_ERROR, "Failed to initialize [carrier jobs module], running jobs inline");
+        return;
+    }
+
+    pthread_mutex_init(&cjobs.mutex, NULL);
+    pthread_cond_init(&cjobs.wake, NULL);
+    cjobs.epoch = 0;
+    cjobs.sleeping = 0;
+    cjobs.worker_count = count;
+    for (int i = 0; i < count; i++) {
+        cjobs.workers[i].seed = 0x9e3779b9u * (uint32_t)(i + 1);
+    }
+
+    // The calling thread becomes worker 0 and helps whenever it waits
+    cjob_thread_index = 0;
+    __atomic_store_n(&cjobs.running, true, __ATOMIC_RELEASE);
+
+    for (int i = 1; i < count; i++) {
+        if (pthread_create(&cjobs.workers[i].thread, NULL, cr_jobs_thread, (void*)(intptr_t)i) != 0) {
+            cr_logf(CR_WARNING, "Failed to start job worker %d, continuing with %d workers", i, i);
+            __atomic_store_n(&cjobs.worker_count, i, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier jobs module] (%d workers)", cjobs.worker_count);
+}
+
+CARRIER_API void cr_jobs_shutdown(void) {
+    if (!cjobs.workers) { return; }
+
+    pthread_mutex_lock(&cjobs.mutex);
+    __atomic_store_n(&cjobs.running, false, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&cjobs.wake);
+    pthread_mutex_unlock(&cjobs.mutex);
+
+    for (int i = 1; i < cjobs.worker_count; i++) {
+        pthread_join(cjobs.workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&cjobs.wake);
+    pthread_mutex_destroy(&cjobs.mutex);
+    cr_free(cjobs.workers);
+    cjobs.workers = NULL;
+    cjobs.worker_count = 0;
+    cjob_thread_index = -1;
+    cr_log(CR_SUCCESS, "Successfully shutdown [carrier jobs module]");
+}
+
+CARRIER_API void cr_jobs_run(const cjob_decl* jobs, size_t count, cjob_counter* counter) {
+    cjob_worker* self = cr_jobs_self();
+
+    for (size_t i = 0; i < count; i++) {
+        // Threads outside the pool and full pools run the job right away
+        cjob_job* job = self ? cr_jobs_alloc(self) : NULL;
+        if (!job) {
+            if (jobs[i].after) { cr_jobs_wait(jobs[i].after); }
+            jobs[i].func(jobs[i].data);
+            continue;
+        }
+
+        job->func = jobs[i].func;
+        job->range = NULL;
+        job->data = jobs[i].data;
+        job->counter = counter;
+        if (counter) { __atomic_add_fetch(&counter->value, 1, __ATOMIC_ACQ_REL); }
+
+        if (jobs[i].after && __atomic_load_n(&jobs[i].after->value, __ATOMIC_ACQUIRE) != 0) {
+            cr_jobs_park(job, jobs[i].after);
+        } else {
+            cr_jobs_push(job);
+        }
+    }
+}
+
+CARRIER_API void cr_jobs_parallel_for(size_t count, size_t grain, cjob_range_func func, void* data, cjob_counter* counter) {
+    if (count == 0) { return; }
+
+    cjob_worker* self = cr_jobs_self();
+    cjob_job* job = self ? cr_jobs_alloc(self) : NULL;
+    if (!job) {
+        func(data, 0, count);
+        return;
+    }
+
+    // Aim for a few chunks per worker so stealing can balance uneven work
+    if (grain == 0) { grain = count / ((size_t)cjobs.worker_count * 8); }
+    if (grain == 0) { grain = 1; }
+
+    job->func = NULL;
+    job->range = func;
+    job->data = data;
+    job->begin = 0;
+    job->end = count;
+    job->grain = grain;
+    job->counter = counter;
+    if (counter) { __atomic_add_fetch(&counter->value, 1, __ATOMIC_ACQ_REL); }
+    cr_jobs_push(job);
+}
+
+CARRIER_API void cr_jobs_wait(cjob_counter* counter) {
+    // Run queued jobs instead of blocking, the waited jobs may be among them
+    while (__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) != 0) {
+        if (!cr_jobs_help()) { sched_yield(); }
+    }
+}
+
+CARRIER_API int cr_jobs_worker_count(void) {
+    return cjobs.worker_count > 0 ? cjobs.worker_count : 1;
+}
+
+CARRIER_API int cr_jobs_worker_index(void) {
+    return cjob_thread_index;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static cjob_worker* cr_jobs_self(void) {
+    if (cjob_thread_index < 0 || !cjobs.workers) { return NULL; }
+    return &cjobs.workers[cjob_thread_index];
+}
+
+static cjob_job* cr_jobs_alloc(cjob_worker* worker) {
+    // Records are reused round-robin, a slot still running is skipped
+    for (int probe = 0; probe < CJOB_POOL_PROBES; probe++) {
+        cjob_job* job = &worker->pool[worker->pool_next++ & (CJOB_POOL_SIZE - 1)];
+        if (!__atomic_load_n(&job->busy, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&job->busy, 1, __ATOMIC_RELAXED);
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void cr_jobs_push(cjob_job* job) {
+    cjob_worker* self = cr_jobs_self();
+    if (self && cr_jobs_deque_push(&self->deque, job)) {
+        cr_jobs_notify();
+        return;
+    }
+    cr_jobs_execute(job);
+}
+
+static void cr_jobs_park(cjob_job* job, cjob_counter* after) {
+    cjob_job* head = __atomic_load_n(&after->waiting, __ATOMIC_SEQ_CST);
+    do {
+        job->next = head;
+    } while (!__atomic_compare_exchange_n(&after->waiting, &head, job, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+    // The counter may have reached zero before the job was linked, then
+    // nobody else will release the list
+    const int64_t value = __atomic_load_n(&after->value, __ATOMIC_SEQ_CST);
+    if (value == 0 || (value & CJOB_RELEASING)) {
+        cr_jobs_schedule(__atomic_exchange_n(&after->waiting, NULL, __ATOMIC_SEQ_CST));
+    }
+}
+
+static void cr_jobs_schedule(cjob_job* list) {
+    while (list) {
+        cjob_job* next = list->next;
+        cr_jobs_push(list);
+        list = next;
+    }
+}
+
+static void cr_jobs_execute(cjob_job* job) {
+    cjob_worker* self = cr_jobs_self();
+    cjob_counter* counter = job->counter;
+
+    if (job->range) {
+        size_t begin = job->begin;
+        size_t end = job->end;
+
+        while (begin < end) {
+            // Split only while the own deque is empty, so a range is divided
+            // when other workers may be hungry and not ahead of time
+            if (end - begin > job->grain && self &&
+                __atomic_load_n(&self->deque.bottom, __ATOMIC_RELAXED) <= __atomic_load_n(&self->deque.top, __ATOMIC_ACQUIRE)) {
+                cjob_job* child = cr_jobs_alloc(self);
+                if (child) {
+                    const size_t middle = begin + (end - begin) / 2;
+                    *child = *job;
+                    child->busy = 1;
+                    child->begin = middle;
+                    child->end = end;
+                    if (counter) { __atomic_add_fetch(&counter->value, 1, __ATOMIC_ACQ_REL); }
+                    cr_jobs_push(child);
+                    end = middle;
+                    continue;
+                }
+            }
+
+            const size_t chunk = end - begin < job->grain ? end : begin + job->grain;
+            job->range(job->data, begin, chunk);
+            begin = chunk;
+        }
+    } else {
+        job->func(job->data);
+    }
+
+    __atomic_store_n(&job->busy, 0, __ATOMIC_RELEASE);
+    if (counter) { cr_jobs_finish(counter); }
+}
+
+static void cr_jobs_finish(cjob_counter* counter) {
+    // The last finisher marks the counter as releasing so waiters cannot
+    // return, and free the counter, before the dependent jobs are scheduled
+    int64_t value = __atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+    bool last;
+    do {
+        last = value == 1;
+    } while (!__atomic_compare_exchange_n(&counter->value, &value, last ? CJOB_RELEASING : value - 1, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    if (!last) { return; }
+
+    cr_jobs_schedule(__atomic_exchange_n(&counter->waiting, NULL, __ATOMIC_SEQ_CST));
+    __atomic_sub_fetch(&counter->value, CJOB_RELEASING, __ATOMIC_RELEASE);
+}
+
+static bool cr_jobs_help(void) {
+    const int count = __atomic_load_n(&cjobs.worker_count, __ATOMIC_ACQUIRE);
+    if (count == 0) { return false; }
+
+    cjob_worker* self = cr_jobs_self();
+    cjob_job* job = self ? cr_jobs_deque_pop(&self->deque) : NULL;
+
+    if (!job) {
+        // Start at a random victim so thieves spread over the workers
+        static __thread uint32_t outside_seed = 0x2545f491u;
+        uint32_t* seed = self ? &self->seed : &outside_seed;
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 17;
+        *seed ^= *seed << 5;
+
+        const int start = (int)(*seed % (uint32_t)count);
+        for (int i = 0; i < count && !job; i++) {
+            const int victim = (start + i) % count;
+            if (victim != cjob_thread_index) {
+                job = cr_jobs_deque_steal(&cjobs.workers[victim].deque);
+            }
+        }
+    }
+
+    if (!job) { return false; }
+    cr_jobs_execute(job);
+    return true;
+}
+
+static void cr_jobs_notify(void) {
+    // Pairs with the epoch check of a worker about to sleep, either the
+    // worker sees the new epoch or this sees the sleeper and wakes it
+    __atomic_add_fetch(&cjobs.epoch, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&cjobs.sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&cjobs.mutex);
+        pthread_cond_signal(&cjobs.wake);
+        pthread_mutex_unlock(&cjobs.mutex);
+    }
+}
+
+static bool cr_jobs_deque_push(cjob_deque* deque, cjob_job* job) {
+    const int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    const int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= CJOB_DEQUE_SIZE) { return false; }
+
+    __atomic_store_n(&deque->slots[bottom & (CJOB_DEQUE_SIZE - 1)], job, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static cjob_job* cr_jobs_deque_pop(cjob_deque* deque) {
+    const int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    cjob_job* job = __atomic_load_n(&deque->slots[bottom & (CJOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (top == bottom) {
+        // Last job, race the thieves for it
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            job = NULL;
+        }
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return job;
+}
+
+static cjob_job* cr_jobs_deque_steal(cjob_deque* deque) {
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    const int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) { return NULL; }
+
+    cjob_job* job = __atomic_load_n(&deque->slots[top & (CJOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return job;
+}
+
+static void* cr_jobs_thread(void* arg) {
+    cjob_thread_index = (int)(intptr_t)arg;
+    int idle = 0;
+
+    while (__atomic_load_n(&cjobs.running, __ATOMIC_ACQUIRE)) {
+        const uint64_t epoch = __atomic_load_n(&cjobs.epoch, __ATOMIC_SEQ_CST);
+        if (cr_jobs_help()) {
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < CJOB_SPIN_ROUNDS) {
+            sched_yield();
+            continue;
+        }
+
+        // Sleep until a push happens after the scan above found nothing
+        pthread_mutex_lock(&cjobs.mutex);
+        __atomic_add_fetch(&cjobs.sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&cjobs.epoch, __ATOMIC_SEQ_CST) == epoch && __atomic_load_n(&cjobs.running, __ATOMIC_SEQ_CST)) {
+            pthread_cond_wait(&cjobs.wake, &cjobs.mutex);
+        }
+        __atomic_sub_fetch(&cjobs.sleeping, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&cjobs.mutex);
+        idle = 0;
+    }
+    return NULL;
+}
+
+#endif // CARRIER_JOBS_IMPLEMENTATION
@@ -1,42 +1,398 @@
 #ifndef CARRIER_LOG_H
 #define CARRIER_LOG_H
 
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include "../libs/carrier_api.h"
 
+// Levels start at one so a zero-initialized clog_conf selects the default, CR_INFO
 typedef enum {
-    CR_ERROR = 0,
+    CR_ERROR = 1,
     CR_WARNING,
     CR_SUCCESS,
+    CR_INFO,
+    CR_DEBUG,
 } clog_type;
 
 #define COLOR_RESET   "\033[0m"
 #define COLOR_CYAN    "\033[36m"
 #define COLOR_YELLOW  "\033[33m"
 #define COLOR_RED     "\033[31m"
+#define COLOR_GRAY    "\033[90m"
 
-static inline void cr_log(clog_type type, const char* message) {
+// Messages above this level are compiled out entirely
+#ifndef CLOG_COMPILE_LEVEL
+#define CLOG_COMPILE_LEVEL CR_DEBUG
+#endif
+
+// Maximum length of a single message, longer messages are truncated
+#ifndef CLOG_MESSAGE_SIZE
+#define CLOG_MESSAGE_SIZE 256
+#endif
+
+// Number of records in each per-thread ring, must be a power of two
+#ifndef CLOG_RING_SIZE
+#define CLOG_RING_SIZE 128
+#endif
+
+// Maximum number of threads that can log concurrently
+#ifndef CLOG_MAX_THREADS
+#define CLOG_MAX_THREADS 16
+#endif
+
+// Configuration structure for the log module
+typedef struct {
+    clog_type level;
+    const char* path;
+    unsigned rate_limit;
+} clog_conf;
+
+// Rate limiting state, one instance per call site
+typedef struct {
+    uint64_t window_start;
+    uint32_t count;
+    uint32_t suppressed;
+} clog_site;
+
+// Log record, formatted on the calling thread and written by the log thread
+typedef struct {
+    uint64_t time;
+    clog_type type;
+    char text[CLOG_MESSAGE_SIZE];
+} clog_record;
+
+// Single-producer single-consumer ring owned by one logging thread, it is
+// released when the thread exits and can then be claimed by another one
+typedef struct {
+    clog_record records[CLOG_RING_SIZE];
+    size_t tail;
+    char pad[64];
+    size_t head;
+    bool owned;
+} clog_ring;
+
+// Logger structure for the log module
+typedef struct {
+    clog_ring rings[CLOG_MAX_THREADS];
+    size_t dropped;
+    size_t reported;
+    int level;
+    unsigned rate_limit;
+    uint64_t start_time;
+    FILE* output;
+    bool running;
+    bool sleeping;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_key_t ring_key;
+    bool ring_key_created;
+} clog_logger;
+
+// Log a printf-style message. Call sites above CLOG_COMPILE_LEVEL compile to
+// nothing, the others are filtered by the runtime level and rate limited.
+#define cr_logf(type, ...) \
+    do { \
+        if ((type) <= CLOG_COMPILE_LEVEL) { \
+            static clog_site clog_call_site; \
+            cr_log_write(&clog_call_site, (type), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define cr_log(type, message) cr_logf(type, "%s", message)
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_log_setup(const clog_conf* conf);
+CARRIER_API void cr_log_shutdown(void);
+CARRIER_API void cr_log_set_level(clog_type level);
+
+// Writes a message for cr_logf, which filters and rate limits through the call site
+CARRIER_API void cr_log_write(clog_site* site, clog_type type, const char* format, ...);
+
+#endif // CARRIER_LOG_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_LOG_IMPLEMENTATION)
+#define CARRIER_LOG_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static bool cr_log_allow(clog_site* site, uint64_t now, uint32_t* suppressed);
+static clog_ring* cr_log_get_ring(void);
+static void cr_log_release_ring(void* ring);
+static void cr_log_wake(void);
+static bool cr_log_pending(void);
+static void cr_log_print(FILE* output, const clog_record* record);
+static size_t cr_log_flush(void);
+static void* cr_log_thread(void* arg);
+static uint64_t cr_log_now(void);
+
+// Global variable to hold the logger state
+static clog_logger clogger = {
+    .level = CR_DEBUG,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER
+};
+
+// Ring claimed by the current thread, if any
+static __thread clog_ring* clog_thread_ring = NULL;
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_log_setup(const clog_conf* conf) {
+    if (__atomic_load_n(&clogger.running, __ATOMIC_ACQUIRE)) { return; }
+
+    clogger.output = stderr;
+    if (conf->path) {
+        clogger.output = fopen(conf->path, "a");
+        if (!clogger.output) {
+            clogger.output = stderr;
+            cr_log(CR_WARNING, "Failed to open log file, logging to stderr");
+        }
+    }
+
+    clogger.level = conf->level ? conf->level : CR_INFO;
+    clogger.rate_limit = conf->rate_limit;
+    clogger.start_time = cr_log_now();
+    clogger.dropped = 0;
+    clogger.reported = 0;
+
+    // Rings go back to the pool through the key destructor when a thread exits
+    if (!clogger.ring_key_created) {
+        clogger.ring_key_created = pthread_key_create(&clogger.ring_key, cr_log_release_ring) == 0;
+    }
+
+    __atomic_store_n(&clogger.running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&clogger.thread, NULL, cr_log_thread, NULL) != 0) {
+        __atomic_store_n(&clogger.running, false, __ATOMIC_RELEASE);
+        cr_log(CR_ERROR, "Failed to start log thread, logging synchronously");
+        return;
+    }
+    cr_log(CR_SUCCESS, "Successfully initialized [carrier log module]");
+}
+
+CARRIER_API void cr_log_shutdown(void) {
+    if (!__atomic_load_n(&clogger.running, __ATOMIC_ACQUIRE)) { return; }
+
+    __atomic_store_n(&clogger.running, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&clogger.mutex);
+    pthread_cond_signal(&clogger.wake);
+    pthread_mutex_unlock(&clogger.mutex);
+    pthread_join(clogger.thread, NULL);
+    cr_log_flush();
+
+    if (clogger.output != stderr) {
+        fclose(clogger.output);
+    }
+    clogger.output = stderr;
+}
+
+CARRIER_API void cr_log_set_level(clog_type level) {
+    __atomic_store_n(&clogger.level, (int)level, __ATOMIC_RELAXED);
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_log_write(clog_site* site, clog_type type, const char* format, ...) {
+    if ((int)type > __atomic_load_n(&clogger.level, __ATOMIC_RELAXED)) { return; }
+
+    const uint64_t now = cr_log_now();
+    uint32_t suppressed = 0;
+    if (!cr_log_allow(site, now, &suppressed)) { return; }
+
+    clog_record local;
+    clog_record* record = &local;
+    clog_ring* ring = NULL;
+
+    // Format straight into the ring when the log thread is running, otherwise
+    // fall back to writing synchronously as before setup
+    if (__atomic_load_n(&clogger.running, __ATOMIC_ACQUIRE)) {
+        ring = cr_log_get_ring();
+        if (ring) {
+            const size_t tail = ring->tail;
+            if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == CLOG_RING_SIZE) {
+                __atomic_fetch_add(&clogger.dropped, 1, __ATOMIC_RELAXED);
+                return;
+            }
+            record = &ring->records[tail & (CLOG_RING_SIZE - 1)];
+        }
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(record->text, sizeof(record->text), format, args);
+    va_end(args);
+
+    if (length < 0) { length = 0; }
+    if ((size_t)length >= sizeof(record->text)) { length = (int)sizeof(record->text) - 1; }
+
+    char* newline_pos = memchr(record->text, '\n', (size_t)length);
+    if (newline_pos) {
+        *newline_pos = '\0';
+        length = (int)(newline_pos - record->text);
+    }
+
+    if (suppressed > 0) {
+        snprintf(record->text + length, sizeof(record->text) - (size_t)length, " (%u similar suppressed)", suppressed);
+    }
+
+    record->time = now;
+    record->type = type;
+
+    if (ring) {
+        __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_SEQ_CST);
+        cr_log_wake();
+    } else if (__atomic_load_n(&clogger.running, __ATOMIC_ACQUIRE)) {
+        // Every ring is taken, dropping keeps the caller from blocking
+        __atomic_fetch_add(&clogger.dropped, 1, __ATOMIC_SEQ_CST);
+        cr_log_wake();
+    } else {
+        cr_log_print(stderr, record);
+    }
+}
+
+static bool cr_log_allow(clog_site* site, uint64_t now, uint32_t* suppressed) {
+    const unsigned limit = clogger.rate_limit;
+    if (limit == 0) { return true; }
+
+    // Allow up to rate_limit messages per call site per second, races between
+    // threads only make the limit slightly inexact
+    const uint64_t window_start = __atomic_load_n(&site->window_start, __ATOMIC_RELAXED);
+    if (window_start == 0 || now - window_start >= 1000000000ull) {
+        __atomic_store_n(&site->window_start, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+        *suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    }
+
+    if (__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) >= limit) {
+        __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+static clog_ring* cr_log_get_ring(void) {
+    if (clog_thread_ring || !clogger.ring_key_created) { return clog_thread_ring; }
+
+    // A released ring may still hold records of its previous owner, the new
+    // owner simply keeps appending behind them. Threads that find every ring
+    // taken drop the message and try again on the next one.
+    for (size_t i = 0; i < CLOG_MAX_THREADS; i++) {
+        bool owned = false;
+        if (__atomic_compare_exchange_n(&clogger.rings[i].owned, &owned, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            clog_thread_ring = &clogger.rings[i];
+            pthread_setspecific(clogger.ring_key, clog_thread_ring);
+            break;
+        }
+    }
+    return clog_thread_ring;
+}
+
+static void cr_log_release_ring(void* ring) {
+    __atomic_store_n(&((clog_ring*)ring)->owned, false, __ATOMIC_RELEASE);
+}
+
+static void cr_log_wake(void) {
+    // Only a sleeping log thread needs the mutex, the stores and loads of tail
+    // and sleeping are sequentially consistent so the wakeup cannot be lost
+    if (!__atomic_load_n(&clogger.sleeping, __ATOMIC_SEQ_CST)) { return; }
+
+    pthread_mutex_lock(&clogger.mutex);
+    pthread_cond_signal(&clogger.wake);
+    pthread_mutex_unlock(&clogger.mutex);
+}
+
+static bool cr_log_pending(void) {
+    for (size_t i = 0; i < CLOG_MAX_THREADS; i++) {
+        const clog_ring* ring = &clogger.rings[i];
+        if (__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) != ring->head) { return true; }
+    }
+    return __atomic_load_n(&clogger.dropped, __ATOMIC_SEQ_CST) != clogger.reported;
+}
+
+static void cr_log_print(FILE* output, const clog_record* record) {
     const char* color = NULL;
 
-    switch (type) {
+    switch (record->type) {
         case CR_ERROR: color = COLOR_RED; break;
         case CR_WARNING: color = COLOR_YELLOW; break;
+        case CR_DEBUG: color = COLOR_GRAY; break;
         default: color = COLOR_CYAN; break;
     }
 
-    time_t now = time(NULL);
-    char* timestamp = ctime(&now);
-    timestamp[strlen(timestamp) - 1] = '\0';
+    const double seconds = (double)(record->time - clogger.start_time) / 1e9;
 
-    char trimmed_message[256];
-    strncpy(trimmed_message, message, sizeof(trimmed_message) - 1);
-    trimmed_message[sizeof(trimmed_message) - 1] = '\0';
+    if (output == stderr) {
+        fprintf(output, "%s[CARRIER]: '%s' [%.6f]%s\n", color, record->text, seconds, COLOR_RESET);
+    } else {
+        fprintf(output, "[CARRIER]: '%s' [%.6f]\n", record->text, seconds);
+    }
+}
 
-    char* newline_pos = strchr(trimmed_message, '\n');
-    if (newline_pos) { *newline_pos = '\0'; }
+static size_t cr_log_flush(void) {
+    size_t written = 0;
+    for (size_t i = 0; i < CLOG_MAX_THREADS; i++) {
+        clog_ring* ring = &clogger.rings[i];
+        const size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+        for (size_t head = ring->head; head != tail; head++) {
+            cr_log_print(clogger.output, &ring->records[head & (CLOG_RING_SIZE - 1)]);
+            __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+            written++;
+        }
+    }
 
-    fprintf(stderr, "%s[CARRIER]: '%s' [%s]%s\n", color, trimmed_message, timestamp, COLOR_RESET);
+    const size_t dropped = __atomic_load_n(&clogger.dropped, __ATOMIC_RELAXED);
+    if (dropped != clogger.reported) {
+        clog_record record = { .time = cr_log_now(), .type = CR_WARNING };
+        snprintf(record.text, sizeof(record.text), "Log buffer overflow: %zu messages dropped", dropped - clogger.reported);
+        cr_log_print(clogger.output, &record);
+        clogger.reported = dropped;
+        written++;
+    }
+
+    if (written > 0) { fflush(clogger.output); }
+    return written;
 }
 
-#endif // CARRIER_LOG_H
+static void* cr_log_thread(void* arg) {
+    (void)arg;
+
+    // Sleeps until a producer or cr_log_shutdown signals, an idle app has no
+    // log thread wakeups at all
+    while (__atomic_load_n(&clogger.running, __ATOMIC_ACQUIRE)) {
+        if (cr_log_flush() > 0) { continue; }
+
+        pthread_mutex_lock(&clogger.mutex);
+        __atomic_store_n(&clogger.sleeping, true, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&clogger.running, __ATOMIC_SEQ_CST) && !cr_log_pending()) {
+            pthread_cond_wait(&clogger.wake, &clogger.mutex);
+        }
+        __atomic_store_n(&clogger.sleeping, false, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&clogger.mutex);
+    }
+    return NULL;
+}
+
+static uint64_t cr_log_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+#endif // CARRIER_LOG_IMPLEMENTATION
@@ -0,0 +1,766 @@
+#ifndef CARRIER_MESH_H
+#define CARRIER_MESH_H
+
+#include <GL/glew.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_gfx.h"
+
+// Maximum number of float attributes of a pool vertex layout
+#define CMESH_MAX_ATTRIBUTES 4
+
+// Maximum number of live meshes of a pool, handles keep 16 bits for the index
+#define CMESH_MAX_MESHES 0xffffu
+
+// Defaults for a zeroed configuration, in vertices and indices
+#define CMESH_DEFAULT_VERTICES (1u << 16)
+#define CMESH_DEFAULT_INDICES (1u << 18)
+
+// Two-level segregated fit, sizes are split by their top bit and then into
+// 16 linear steps below it
+#define CMESH_SL_BITS 4
+#define CMESH_SL_COUNT (1 << CMESH_SL_BITS)
+#define CMESH_FL_COUNT 32
+
+// Block index that links nowhere
+#define CMESH_NONE UINT32_MAX
+
+// Handle of a pooled mesh, slot index plus one in the low 16 bits and the
+// slot generation in the high 16 bits. Zero is never a valid handle.
+typedef uint32_t cmesh_handle;
+
+// Float attribute of a vertex layout, size is the component count
+typedef struct {
+    int size;
+    size_t offset;
+} cmesh_attribute;
+
+// Configuration structure for a mesh pool. A zeroed layout is the position
+// only layout of cg_make_buffer, a zero stride is derived from the attributes.
+// Capacities grow on demand.
+typedef struct {
+    size_t stride;
+    cmesh_attribute attributes[CMESH_MAX_ATTRIBUTES];
+    uint32_t vertex_capacity;
+    uint32_t index_capacity;
+} cmesh_conf;
+
+// Mesh data, indices are relative to the first vertex of the mesh. Without
+// indices the vertices are drawn in order.
+typedef struct {
+    const void* vertices;
+    uint32_t vertex_count;
+    const uint32_t* indices;
+    uint32_t index_count;
+} cmesh_data;
+
+// Location of a mesh in the pool buffers, valid until the next compaction
+typedef struct {
+    int32_t base_vertex;
+    uint32_t first_index;
+    uint32_t count;
+} cmesh_range;
+
+// Indirect draw command, layout defined by glMultiDrawElementsIndirect
+typedef struct {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+} cmesh_command;
+
+// Range of a pool buffer, physically linked to its neighbours and, while
+// free, to the other free blocks of its size class
+typedef struct {
+    uint32_t offset, size;
+    uint32_t prev_physical, next_physical;
+    uint32_t prev_free, next_free;
+    uint32_t owner;
+    bool free;
+} cmesh_block;
+
+// Sub-allocator of one pool buffer in elements. The first block never moves,
+// the last one ends at the capacity.
+typedef struct {
+    cmesh_block* blocks;
+    uint32_t block_count, block_capacity;
+    uint32_t unused;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[CMESH_FL_COUNT];
+    uint32_t heads[CMESH_FL_COUNT][CMESH_SL_COUNT];
+    uint32_t capacity, used;
+    uint32_t first, last;
+} cmesh_allocator;
+
+// Pooled mesh, next_free links the unused slots
+typedef struct {
+    uint32_t vertex_block, index_block;
+    uint32_t index_count;
+    uint32_t next_free;
+    uint16_t generation;
+    bool live;
+} cmesh_entry;
+
+// Pool occupancy, free ranges and the largest ones show fragmentation
+typedef struct {
+    uint32_t meshes;
+    uint32_t vertex_capacity, vertices_used;
+    uint32_t index_capacity, indices_used;
+    uint32_t free_ranges;
+    uint32_t largest_free_vertices, largest_free_indices;
+    uint32_t grows, compactions;
+} cmesh_stats;
+
+// Mesh pool, every mesh of one vertex layout in one vertex and one index
+// buffer. The bindings are owned by the pool, not by the graphics context.
+typedef struct {
+    cmesh_conf conf;
+    cg_bindings bindings;
+    cmesh_allocator vertices, indices;
+    cmesh_entry* meshes;
+    uint32_t mesh_count, mesh_capacity;
+    uint32_t free_mesh;
+    cg_storage_buffer indirect;
+    uint32_t grows, compactions;
+} cmesh_pool;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_mesh_init(cmesh_pool* pool, const cmesh_conf* conf);
+CARRIER_API void cg_mesh_shutdown(cmesh_pool* pool);
+CARRIER_API cmesh_handle cg_mesh_add(cmesh_pool* pool, const cmesh_data* data);
+CARRIER_API void cg_mesh_remove(cmesh_pool* pool, cmesh_handle handle);
+CARRIER_API cmesh_range cg_mesh_get_range(const cmesh_pool* pool, cmesh_handle handle);
+CARRIER_API cmesh_command cg_mesh_command(const cmesh_pool* pool, cmesh_handle handle, uint32_t instance_count, uint32_t base_instance);
+CARRIER_API void cg_mesh_apply(cmesh_pool* pool);
+CARRIER_API void cg_mesh_draw(const cmesh_pool* pool, cmesh_handle handle, int num_instances);
+CARRIER_API void cg_mesh_draw_indirect(cmesh_pool* pool, const cmesh_command* commands, uint32_t count);
+CARRIER_API void cg_mesh_compact(cmesh_pool* pool);
+CARRIER_API cmesh_stats cg_mesh_get_stats(const cmesh_pool* pool);
+
+#endif // CARRIER_MESH_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_MESH_IMPLEMENTATION)
+#define CARRIER_MESH_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static const cmesh_entry* cg_mesh_resolve(const cmesh_pool* pool, cmesh_handle handle);
+static uint32_t cg_mesh_allocate(cmesh_pool* pool, bool vertices, uint32_t size, uint32_t owner);
+static GLuint cg_mesh_create_buffer(size_t size);
+static void cg_mesh_replace_buffer(cmesh_pool* pool, bool vertices, GLuint buffer, size_t old_size, size_t new_size);
+static void cg_mesh_grow(cmesh_pool* pool, bool vertices, uint32_t capacity);
+static void cg_mesh_compact_buffer(cmesh_pool* pool, bool vertices);
+static void cg_mesh_bind_layout(cmesh_pool* pool);
+static bool cg_mesh_allocator_init(cmesh_allocator* allocator, uint32_t capacity);
+static void cg_mesh_allocator_shutdown(cmesh_allocator* allocator);
+static uint32_t cg_mesh_allocator_alloc(cmesh_allocator* allocator, uint32_t size, uint32_t owner);
+static uint32_t cg_mesh_allocator_take(cmesh_allocator* allocator, uint32_t block, uint32_t size, uint32_t owner);
+static void cg_mesh_allocator_free(cmesh_allocator* allocator, uint32_t block);
+static bool cg_mesh_allocator_grow(cmesh_allocator* allocator, uint32_t capacity);
+static bool cg_mesh_allocator_reserve(cmesh_allocator* allocator, uint32_t count);
+static uint32_t cg_mesh_block_new(cmesh_allocator* allocator);
+static void cg_mesh_block_release(cmesh_allocator* allocator, uint32_t block);
+static void cg_mesh_insert_free(cmesh_allocator* allocator, uint32_t block);
+static void cg_mesh_remove_free(cmesh_allocator* allocator, uint32_t block);
+static void cg_mesh_mapping(uint32_t size, int* fl, int* sl);
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_mesh_init(cmesh_pool* pool, const cmesh_conf* conf) {
+    memset(pool, 0, sizeof(*pool));
+    pool->conf = *conf;
+    pool->free_mesh = CMESH_NONE;
+
+    // The zeroed layout matches cg_make_buffer, three floats of position
+    cmesh_conf* layout = &pool->conf;
+    if (layout->attributes[0].size == 0) {
+        layout->attributes[0] = (cmesh_attribute){ 3, 0 };
+    }
+    if (layout->stride == 0) {
+        for (int i = 0; i < CMESH_MAX_ATTRIBUTES && layout->attributes[i].size > 0; i++) {
+            const size_t end = layout->attributes[i].offset + (size_t)layout->attributes[i].size * sizeof(float);
+            if (end > layout->stride) { layout->stride = end; }
+        }
+    }
+    if (layout->vertex_capacity == 0) { layout->vertex_capacity = CMESH_DEFAULT_VERTICES; }
+    if (layout->index_capacity == 0) { layout->index_capacity = CMESH_DEFAULT_INDICES; }
+
+    if (!cg_mesh_allocator_init(&pool->vertices, layout->vertex_capacity) ||
+        !cg_mesh_allocator_init(&pool->indices, layout->index_capacity)) {
+        cr_log(CR_ERROR, "Failed to initialize mesh pool: out of memory");
+        cg_mesh_shutdown(pool);
+        return false;
+    }
+
+    const size_t vertex_size = (size_t)layout->vertex_capacity * layout->stride;
+    const size_t index_size = (size_t)layout->index_capacity * sizeof(GLuint);
+    glGenVertexArrays(1, &pool->bindings.vao);
+    pool->bindings.vbo = cg_mesh_create_buffer(vertex_size);
+    pool->bindings.ebo = cg_mesh_create_buffer(index_size);
+    pool->bindings.size = vertex_size + index_size;
+    cg_track_memory(CG_MEMORY_GEOMETRY, vertex_size, true);
+    cg_track_memory(CG_MEMORY_GEOMETRY, index_size, true);
+    cg_mesh_bind_layout(pool);
+
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier mesh module] (%u vertices, %u indices)", layout->vertex_capacity, layout->index_capacity);
+    return true;
+}
+
+CARRIER_API void cg_mesh_shutdown(cmesh_pool* pool) {
+    if (pool->bindings.vbo) {
+        cg_track_memory(CG_MEMORY_GEOMETRY, (size_t)pool->vertices.capacity * pool->conf.stride, false);
+        glDeleteBuffers(1, &pool->bindings.vbo);
+    }
+    if (pool->bindings.ebo) {
+        cg_track_memory(CG_MEMORY_GEOMETRY, (size_t)pool->indices.capacity * sizeof(GLuint), false);
+        glDeleteBuffers(1, &pool->bindings.ebo);
+    }
+    if (pool->bindings.vao) { glDeleteVertexArrays(1, &pool->bindings.vao); }
+    if (pool->indirect.buffer) { cg_destroy_storage_buffer(pool->indirect); }
+
+    cg_mesh_allocator_shutdown(&pool->vertices);
+    cg_mesh_allocator_shutdown(&pool->indices);
+    cr_free(pool->meshes);
+    memset(pool, 0, sizeof(*pool));
+}
+
+CARRIER_API cmesh_handle cg_mesh_add(cmesh_pool* pool, const cmesh_data* data) {
+    if (!data->vertices || data->vertex_count == 0) {
+        cr_log(CR_ERROR, "Failed to add mesh: no vertices");
+        return 0;
+    }
+    if (data->indices) {
+        for (uint32_t i = 0; i < data->index_count; i++) {
+            if (data->indices[i] >= data->vertex_count) {
+                cr_logf(CR_ERROR, "Failed to add mesh: index %u out of range of %u vertices", data->indices[i], data->vertex_count);
+                return 0;
+            }
+        }
+    }
+
+    // Unindexed meshes get the identity, every draw of the pool is indexed
+    const uint32_t index_count = data->indices ? data->index_count : data->vertex_count;
+    uint32_t* sequence = NULL;
+    if (!data->indices) {
+        sequence = (uint32_t*)cr_alloc((size_t)index_count * sizeof(uint32_t));
+        if (!sequence) {
+            cr_log(CR_ERROR, "Failed to add mesh: out of memory");
+            return 0;
+        }
+        for (uint32_t i = 0; i < index_count; i++) { sequence[i] = i; }
+    }
+
+    uint32_t slot = pool->free_mesh;
+    if (slot == CMESH_NONE) {
+        if (pool->mesh_count == CMESH_MAX_MESHES) {
+            cr_log(CR_ERROR, "Failed to add mesh: too many meshes");
+            cr_free(sequence);
+            return 0;
+        }
+        if (pool->mesh_count == pool->mesh_capacity) {
+            const uint32_t capacity = pool->mesh_capacity ? pool->mesh_capacity * 2 : 64;
+            cmesh_entry* meshes = (cmesh_entry*)cr_realloc(pool->meshes, capacity * sizeof(cmesh_entry));
+            if (!meshes) {
+                cr_log(CR_ERROR, "Failed to add mesh: out of memory");
+                cr_free(sequence);
+                return 0;
+            }
+            pool->meshes = meshes;
+            pool->mesh_capacity = capacity;
+        }
+        slot = pool->mesh_count++;
+        pool->meshes[slot].generation = 0;
+    } else {
+        pool->free_mesh = pool->meshes[slot].next_free;
+    }
+
+    cmesh_entry* entry = &pool->meshes[slot];
+    entry->vertex_block = cg_mesh_allocate(pool, true, data->vertex_count, slot);
+    entry->index_block = cg_mesh_allocate(pool, false, index_count, slot);
+    if (entry->vertex_block == CMESH_NONE || entry->index_block == CMESH_NONE) {
+        cr_log(CR_ERROR, "Failed to add mesh: pool cannot grow");
+        if (entry->vertex_block != CMESH_NONE) { cg_mesh_allocator_free(&pool->vertices, entry->vertex_block); }
+        if (entry->index_block != CMESH_NONE) { cg_mesh_allocator_free(&pool->indices, entry->index_block); }
+        entry->next_free = pool->free_mesh;
+        pool->free_mesh = slot;
+        cr_free(sequence);
+        return 0;
+    }
+
+    const size_t stride = pool->conf.stride;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool->bindings.vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(pool->vertices.blocks[entry->vertex_block].offset * stride),
+                    (GLsizeiptr)(data->vertex_count * stride), data->vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool->bindings.ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(pool->indices.blocks[entry->index_block].offset * sizeof(GLuint)),
+                    (GLsizeiptr)(index_count * sizeof(GLuint)), data->indices ? data->indices : sequence);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    cr_free(sequence);
+
+    entry->index_count = index_count;
+    entry->generation++;
+    entry->live = true;
+    return ((uint32_t)entry->generation << 16) | (slot + 1u);
+}
+
+CARRIER_API void cg_mesh_remove(cmesh_pool* pool, cmesh_handle handle) {
+    if (!cg_mesh_resolve(pool, handle)) {
+        cr_log(CR_WARNING, "Failed to remove mesh: unknown handle");
+        return;
+    }
+
+    const uint32_t slot = (handle & 0xffffu) - 1u;
+    cmesh_entry* entry = &pool->meshes[slot];
+    cg_mesh_allocator_free(&pool->vertices, entry->vertex_block);
+    cg_mesh_allocator_free(&pool->indices, entry->index_block);
+    entry->live = false;
+    entry->next_free = pool->free_mesh;
+    pool->free_mesh = slot;
+}
+
+CARRIER_API cmesh_range cg_mesh_get_range(const cmesh_pool* pool, cmesh_handle handle) {
+    const cmesh_entry* entry = cg_mesh_resolve(pool, handle);
+    if (!entry) { return (cmesh_range){ 0 }; }
+
+    return (cmesh_range){
+        (int32_t)pool->vertices.blocks[entry->vertex_block].offset,
+        pool->indices.blocks[entry->index_block].offset,
+        entry->index_count
+    };
+}
+
+CARRIER_API cmesh_command cg_mesh_command(const cmesh_pool* pool, cmesh_handle handle, uint32_t instance_count, uint32_t base_instance) {
+    const cmesh_range range = cg_mesh_get_range(pool, handle);
+    return (cmesh_command){ range.count, range.count ? instance_count : 0, range.first_index, range.base_vertex, base_instance };
+}
+
+CARRIER_API void cg_mesh_apply(cmesh_pool* pool) {
+    cg_apply_bindings(&pool->bindings);
+}
+
+CARRIER_API void cg_mesh_draw(const cmesh_pool* pool, cmesh_handle handle, int num_instances) {
+    const cmesh_range range = cg_mesh_get_range(pool, handle);
+    if (range.count == 0) { return; }
+
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.count, GL_UNSIGNED_INT,
+                                      (void*)(range.first_index * sizeof(GLuint)), num_instances > 1 ? num_instances : 1, range.base_vertex);
+}
+
+CARRIER_API void cg_mesh_draw_indirect(cmesh_pool* pool, const cmesh_command* commands, uint32_t count) {
+    if (count == 0) { return; }
+
+    if (!GLEW_VERSION_4_3 && !GLEW_ARB_multi_draw_indirect) {
+        // Without base instances only commands starting at instance zero can be drawn
+        const bool base_instance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+        for (uint32_t i = 0; i < count; i++) {
+            const cmesh_command* command = &commands[i];
+            if (command->count == 0 || command->instance_count == 0) { continue; }
+            if (base_instance) {
+                glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei)command->count, GL_UNSIGNED_INT,
+                                                              (void*)(command->first_index * sizeof(GLuint)), (GLsizei)command->instance_count,
+                                                              command->base_vertex, command->base_instance);
+            } else if (command->base_instance == 0) {
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)command->count, GL_UNSIGNED_INT,
+                                                  (void*)(command->first_index * sizeof(GLuint)), (GLsizei)command->instance_count,
+                                                  command->base_vertex);
+            } else {
+                cr_log(CR_ERROR, "Failed to draw mesh: base instances need OpenGL 4.2 or ARB_base_instance");
+            }
+        }
+        return;
+    }
+
+    const size_t size = count * sizeof(cmesh_command);
+    if (size > pool->indirect.size) {
+        if (pool->indirect.buffer) { cg_destroy_storage_buffer(pool->indirect); }
+        pool->indirect = cg_make_storage_buffer(&(cg_storage_conf){ .size = size * 2 });
+    }
+    cg_update_storage_buffer(&pool->indirect, 0, size, commands);
+
+    cg_multi_draw_indirect(&pool->bindings, &pool->indirect, 0, (int)count);
+}
+
+CARRIER_API void cg_mesh_compact(cmesh_pool* pool) {
+    cg_mesh_compact_buffer(pool, true);
+    cg_mesh_compact_buffer(pool, false);
+    pool->compactions++;
+}
+
+CARRIER_API cmesh_stats cg_mesh_get_stats(const cmesh_pool* pool) {
+    cmesh_stats stats = {
+        .vertex_capacity = pool->vertices.capacity,
+        .vertices_used = pool->vertices.used,
+        .index_capacity = pool->indices.capacity,
+        .indices_used = pool->indices.used,
+        .grows = pool->grows,
+        .compactions = pool->compactions
+    };
+    for (uint32_t i = 0; i < pool->mesh_count; i++) {
+        if (pool->meshes[i].live) { stats.meshes++; }
+    }
+
+    const cmesh_allocator* allocators[2] = { &pool->vertices, &pool->indices };
+    uint32_t* largest[2] = { &stats.largest_free_vertices, &stats.largest_free_indices };
+    for (int i = 0; i < 2; i++) {
+        const cmesh_allocator* allocator = allocators[i];
+        if (!allocator->blocks) { continue; }
+        for (uint32_t block = allocator->first; block != CMESH_NONE; block = allocator->blocks[block].next_physical) {
+            const cmesh_block* current = &allocator->blocks[block];
+            if (!current->free) { continue; }
+            stats.free_ranges++;
+            if (current->size > *largest[i]) { *largest[i] = current->size; }
+        }
+    }
+    return stats;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static const cmesh_entry* cg_mesh_resolve(const cmesh_pool* pool, cmesh_handle handle) {
+    const uint32_t slot = (handle & 0xffffu) - 1u;
+    if (handle == 0 || slot >= pool->mesh_count) { return NULL; }
+
+    const cmesh_entry* entry = &pool->meshes[slot];
+    if (!entry->live || entry->generation != (uint16_t)(handle >> 16)) { return NULL; }
+    return entry;
+}
+
+static uint32_t cg_mesh_allocate(cmesh_pool* pool, bool vertices, uint32_t size, uint32_t owner) {
+    cmesh_allocator* allocator = vertices ? &pool->vertices : &pool->indices;
+    uint32_t block = cg_mesh_allocator_alloc(allocator, size, owner);
+    if (block != CMESH_NONE) { return block; }
+
+    // Doubling keeps the copies rare, the size class rounding needs the margin
+    const uint64_t needed = (uint64_t)allocator->capacity + size + (size >> CMESH_SL_BITS) + 1;
+    uint64_t capacity = (uint64_t)allocator->capacity * 2;
+    if (capacity < needed) { capacity = needed; }
+    if (capacity > UINT32_MAX) { capacity = UINT32_MAX; }
+    if (capacity <= allocator->capacity) { return CMESH_NONE; }
+
+    cg_mesh_grow(pool, vertices, (uint32_t)capacity);
+    return cg_mesh_allocator_alloc(allocator, size, owner);
+}
+
+static GLuint cg_mesh_create_buffer(size_t size) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return buffer;
+}
+
+static void cg_mesh_replace_buffer(cmesh_pool* pool, bool vertices, GLuint buffer, size_t old_size, size_t new_size) {
+    GLuint* target = vertices ? &pool->bindings.vbo : &pool->bindings.ebo;
+    glDeleteBuffers(1, target);
+    *target = buffer;
+
+    cg_track_memory(CG_MEMORY_GEOMETRY, old_size, false);
+    cg_track_memory(CG_MEMORY_GEOMETRY, new_size, true);
+    pool->bindings.size = pool->bindings.size - old_size + new_size;
+    cg_mesh_bind_layout(pool);
+}
+
+static void cg_mesh_grow(cmesh_pool* pool, bool vertices, uint32_t capacity) {
+    cmesh_allocator* allocator = vertices ? &pool->vertices : &pool->indices;
+    const size_t element = vertices ? pool->conf.stride : sizeof(GLuint);
+    const size_t old_size = (size_t)allocator->capacity * element;
+    const size_t new_size = (size_t)capacity * element;
+
+    if (!cg_mesh_allocator_grow(allocator, capacity)) { return; }
+
+    // The old contents keep their offsets, only the tail is new
+    const GLuint buffer = cg_mesh_create_buffer(new_size);
+    glBindBuffer(GL_COPY_READ_BUFFER, vertices ? pool->bindings.vbo : pool->bindings.ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)old_size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    cg_mesh_replace_buffer(pool, vertices, buffer, old_size, new_size);
+    pool->grows++;
+}
+
+static void cg_mesh_compact_buffer(cmesh_pool* pool, bool vertices) {
+    cmesh_allocator* allocator = vertices ? &pool->vertices : &pool->indices;
+    const size_t element = vertices ? pool->conf.stride : sizeof(GLuint);
+    const size_t size = (size_t)allocator->capacity * element;
+
+    // Used blocks in buffer order, so every range moves down or stays
+    uint32_t count = 0;
+    for (uint32_t block = allocator->first; block != CMESH_NONE; block = allocator->blocks[block].next_physical) {
+        if (!allocator->blocks[block].free) { count++; }
+    }
+    cmesh_block* used = (cmesh_block*)cr_alloc((count > 0 ? count : 1) * sizeof(cmesh_block));
+    if (!used) {
+        cr_log(CR_ERROR, "Failed to compact mesh pool: out of memory");
+        return;
+    }
+    count = 0;
+    for (uint32_t block = allocator->first; block != CMESH_NONE; block = allocator->blocks[block].next_physical) {
+        if (!allocator->blocks[block].free) { used[count++] = allocator->blocks[block]; }
+    }
+
+    // Every range and the free tail get a block, reserved before the reset so
+    // that the allocator cannot run out of blocks halfway through
+    if (!cg_mesh_allocator_reserve(allocator, count + 1) || !cg_mesh_allocator_init(allocator, allocator->capacity)) {
+        cr_log(CR_ERROR, "Failed to compact mesh pool: out of memory");
+        cr_free(used);
+        return;
+    }
+
+    // Ranges are carved off the one free block in order, which never fails
+    const GLuint buffer = cg_mesh_create_buffer(size);
+    glBindBuffer(GL_COPY_READ_BUFFER, vertices ? pool->bindings.vbo : pool->bindings.ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t block = cg_mesh_allocator_take(allocator, allocator->last, used[i].size, used[i].owner);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)(used[i].offset * element),
+                            (GLintptr)(allocator->blocks[block].offset * element), (GLsizeiptr)(used[i].size * element));
+
+        cmesh_entry* entry = &pool->meshes[used[i].owner];
+        if (vertices) {
+            entry->vertex_block = block;
+        } else {
+            entry->index_block = block;
+        }
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    cr_free(used);
+
+    cg_mesh_replace_buffer(pool, vertices, buffer, size, size);
+}
+
+static void cg_mesh_bind_layout(cmesh_pool* pool) {
+    // Attribute pointers capture the buffer, so a new buffer is bound again
+    glBindVertexArray(pool->bindings.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pool->bindings.vbo);
+    for (GLuint i = 0; i < CMESH_MAX_ATTRIBUTES && pool->conf.attributes[i].size > 0; i++) {
+        const cmesh_attribute* attribute = &pool->conf.attributes[i];
+        glVertexAttribPointer(i, attribute->size, GL_FLOAT, GL_FALSE, (GLsizei)pool->conf.stride, (void*)attribute->offset);
+        glEnableVertexAttribArray(i);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->bindings.ebo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static bool cg_mesh_allocator_init(cmesh_allocator* allocator, uint32_t capacity) {
+    cmesh_block* blocks = allocator->blocks;
+    const uint32_t block_capacity = allocator->block_capacity;
+
+    memset(allocator, 0, sizeof(*allocator));
+    allocator->blocks = blocks;
+    allocator->block_capacity = block_capacity;
+    allocator->unused = CMESH_NONE;
+    for (int fl = 0; fl < CMESH_FL_COUNT; fl++) {
+        for (int sl = 0; sl < CMESH_SL_COUNT; sl++) { allocator->heads[fl][sl] = CMESH_NONE; }
+    }
+
+    const uint32_t block = cg_mesh_block_new(allocator);
+    if (block == CMESH_NONE) { return false; }
+
+    allocator->blocks[block] = (cmesh_block){ 0, capacity, CMESH_NONE, CMESH_NONE, CMESH_NONE, CMESH_NONE, CMESH_NONE, true };
+    allocator->capacity = capacity;
+    allocator->first = allocator->last = block;
+    cg_mesh_insert_free(allocator, block);
+    return true;
+}
+
+static void cg_mesh_allocator_shutdown(cmesh_allocator* allocator) {
+    cr_free(allocator->blocks);
+    memset(allocator, 0, sizeof(*allocator));
+}
+
+static uint32_t cg_mesh_allocator_alloc(cmesh_allocator* allocator, uint32_t size, uint32_t owner) {
+    if (size == 0) { return CMESH_NONE; }
+
+    // Rounding up to the next size class makes any block of the class fit
+    uint32_t search = size;
+    if (search >= CMESH_SL_COUNT) {
+        const uint32_t round = (1u << (31 - __builtin_clz(search) - CMESH_SL_BITS)) - 1u;
+        if (search > UINT32_MAX - round) { return CMESH_NONE; }
+        search += round;
+    }
+
+    int fl, sl;
+    cg_mesh_mapping(search, &fl, &sl);
+    uint32_t sl_map = allocator->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        const uint32_t fl_map = fl + 1 < CMESH_FL_COUNT ? allocator->fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (!fl_map) { return CMESH_NONE; }
+        fl = __builtin_ctz(fl_map);
+        sl_map = allocator->sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return cg_mesh_allocator_take(allocator, allocator->heads[fl][sl], size, owner);
+}
+
+static uint32_t cg_mesh_allocator_take(cmesh_allocator* allocator, uint32_t block, uint32_t size, uint32_t owner) {
+    cg_mesh_remove_free(allocator, block);
+
+    // The remainder stays free behind the taken range
+    if (allocator->blocks[block].size > size) {
+        const uint32_t rest = cg_mesh_block_new(allocator);
+        if (rest != CMESH_NONE) {
+            cmesh_block* current = &allocator->blocks[block];
+            allocator->blocks[rest] = (cmesh_block){
+                current->offset + size, current->size - size, block, current->next_physical, CMESH_NONE, CMESH_NONE, CMESH_NONE, true
+            };
+            if (current->next_physical != CMESH_NONE) { allocator->blocks[current->next_physical].prev_physical = rest; }
+            current->next_physical = rest;
+            current->size = size;
+            if (allocator->last == block) { allocator->last = rest; }
+            cg_mesh_insert_free(allocator, rest);
+        }
+    }
+
+    cmesh_block* current = &allocator->blocks[block];
+    current->free = false;
+    current->owner = owner;
+    allocator->used += current->size;
+    return block;
+}
+
+static void cg_mesh_allocator_free(cmesh_allocator* allocator, uint32_t block) {
+    cmesh_block* blocks = allocator->blocks;
+    blocks[block].free = true;
+    allocator->used -= blocks[block].size;
+
+    // Neighbours merge into the lower block, so the first block never moves
+    const uint32_t next = blocks[block].next_physical;
+    if (next != CMESH_NONE && blocks[next].free) {
+        cg_mesh_remove_free(allocator, next);
+        blocks[block].size += blocks[next].size;
+        blocks[block].next_physical = blocks[next].next_physical;
+        if (blocks[next].next_physical != CMESH_NONE) { blocks[blocks[next].next_physical].prev_physical = block; }
+        if (allocator->last == next) { allocator->last = block; }
+        cg_mesh_block_release(allocator, next);
+    }
+
+    const uint32_t prev = blocks[block].prev_physical;
+    if (prev != CMESH_NONE && blocks[prev].free) {
+        cg_mesh_remove_free(allocator, prev);
+        blocks[prev].size += blocks[block].size;
+        blocks[prev].next_physical = blocks[block].next_physical;
+        if (blocks[block].next_physical != CMESH_NONE) { blocks[blocks[block].next_physical].prev_physical = prev; }
+        if (allocator->last == block) { allocator->last = prev; }
+        cg_mesh_block_release(allocator, block);
+        block = prev;
+    }
+    cg_mesh_insert_free(allocator, block);
+}
+
+static bool cg_mesh_allocator_grow(cmesh_allocator* allocator, uint32_t capacity) {
+    const uint32_t extra = capacity - allocator->capacity;
+    const uint32_t last = allocator->last;
+
+    if (allocator->blocks[last].free) {
+        cg_mesh_remove_free(allocator, last);
+        allocator->blocks[last].size += extra;
+        cg_mesh_insert_free(allocator, last);
+    } else {
+        const uint32_t block = cg_mesh_block_new(allocator);
+        if (block == CMESH_NONE) { return false; }
+
+        allocator->blocks[block] = (cmesh_block){ allocator->capacity, extra, last, CMESH_NONE, CMESH_NONE, CMESH_NONE, CMESH_NONE, true };
+        allocator->blocks[last].next_physical = block;
+        allocator->last = block;
+        cg_mesh_insert_free(allocator, block);
+    }
+    allocator->capacity = capacity;
+    return true;
+}
+
+static bool cg_mesh_allocator_reserve(cmesh_allocator* allocator, uint32_t count) {
+    if (allocator->block_capacity >= count) { return true; }
+
+    cmesh_block* blocks = (cmesh_block*)cr_realloc(allocator->blocks, count * sizeof(cmesh_block));
+    if (!blocks) { return false; }
+    allocator->blocks = blocks;
+    allocator->block_capacity = count;
+    return true;
+}
+
+static uint32_t cg_mesh_block_new(cmesh_allocator* allocator) {
+    if (allocator->unused != CMESH_NONE) {
+        const uint32_t block = allocator->unused;
+        allocator->unused = allocator->blocks[block].next_free;
+        return block;
+    }
+
+    if (allocator->block_count == allocator->block_capacity) {
+        const uint32_t capacity = allocator->block_capacity ? allocator->block_capacity * 2 : 64;
+        cmesh_block* blocks = (cmesh_block*)cr_realloc(allocator->blocks, capacity * sizeof(cmesh_block));
+        if (!blocks) { return CMESH_NONE; }
+        allocator->blocks = blocks;
+        allocator->block_capacity = capacity;
+    }
+    return allocator->block_count++;
+}
+
+static void cg_mesh_block_release(cmesh_allocator* allocator, uint32_t block) {
+    allocator->blocks[block].next_free = allocator->unused;
+    allocator->unused = block;
+}
+
+static void cg_mesh_insert_free(cmesh_allocator* allocator, uint32_t block) {
+    int fl, sl;
+    cg_mesh_mapping(allocator->blocks[block].size, &fl, &sl);
+
+    const uint32_t head = allocator->heads[fl][sl];
+    allocator->blocks[block].prev_free = CMESH_NONE;
+    allocator->blocks[block].next_free = head;
+    if (head != CMESH_NONE) { allocator->blocks[head].prev_free = block; }
+    allocator->heads[fl][sl] = block;
+    allocator->fl_bitmap |= 1u << fl;
+    allocator->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void cg_mesh_remove_free(cmesh_allocator* allocator, uint32_t block) {
+    int fl, sl;
+    cg_mesh_mapping(allocator->blocks[block].size, &fl, &sl);
+
+    const cmesh_block* current = &allocator->blocks[block];
+    if (current->prev_free != CMESH_NONE) { allocator->blocks[current->prev_free].next_free = current->next_free; }
+    if (current->next_free != CMESH_NONE) { allocator->blocks[current->next_free].prev_free = current->prev_free; }
+    if (allocator->heads[fl][sl] == block) {
+        allocator->heads[fl][sl] = current->next_free;
+        if (current->next_free == CMESH_NONE) {
+            allocator->sl_bitmap[fl] &= ~(1u << sl);
+            if (allocator->sl_bitmap[fl] == 0) { allocator->fl_bitmap &= ~(1u << fl); }
+        }
+    }
+}
+
+static void cg_mesh_mapping(uint32_t size, int* fl, int* sl) {
+    if (size < CMESH_SL_COUNT) {
+        *fl = 0;
+        *sl = (int)size;
+        return;
+    }
+
+    const int top = 31 - __builtin_clz(size);
+    *fl = top - CMESH_SL_BITS + 1;
+    *sl = (int)((size >> (top - CMESH_SL_BITS)) ^ CMESH_SL_COUNT);
+}
+
+#endif // CARRIER_MESH_IMPLEMENTATION
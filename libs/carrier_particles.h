@@ -0,0 +1,275 @@
+#ifndef CARRIER_PARTICLES_H
+#define CARRIER_PARTICLES_H
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_gfx.h"
+
+#define CPARTICLE_MAX_EMITS 64
+#define CPARTICLE_GROUP_SIZE 256
+
+// Compute passes, must match shaders/particles.comp
+#define CPARTICLE_PASS_EMIT 0
+#define CPARTICLE_PASS_PREPARE 1
+#define CPARTICLE_PASS_UPDATE 2
+#define CPARTICLE_PASS_FINALIZE 3
+
+// Uniform locations, fixed by explicit layout qualifiers in the shaders
+#define CPARTICLE_PASS_LOCATION 0
+#define CPARTICLE_DELTA_LOCATION 1
+#define CPARTICLE_GRAVITY_LOCATION 2
+#define CPARTICLE_BOUNDS_LOCATION 3
+#define CPARTICLE_RESTITUTION_LOCATION 4
+#define CPARTICLE_SEED_LOCATION 5
+#define CPARTICLE_EMIT_COUNT_LOCATION 6
+#define CPARTICLE_EMIT_POSITION_LOCATION 7
+#define CPARTICLE_EMIT_ANGLE_LOCATION 8
+#define CPARTICLE_EMIT_SPEED_LOCATION 9
+#define CPARTICLE_EMIT_SHAPE_LOCATION 10
+#define CPARTICLE_EMIT_COLOR_LOCATION 11
+#define CPARTICLE_VIEW_PROJ_LOCATION 0
+
+// Configuration structure for the particle module
+typedef struct {
+    uint32_t capacity;
+    vec2 gravity;
+    float restitution;
+} cparticle_conf;
+
+// Emission parameters, angles are in radians
+typedef struct {
+    vec2 position;
+    float direction;
+    float spread;
+    float speed_min, speed_max;
+    float lifetime;
+    float size;
+    vec4 color;
+} cparticle_emitter;
+
+// Particle layout on the GPU, the CPU never reads or writes particles
+typedef struct {
+    float position[2];
+    float velocity[2];
+    float age;
+    float lifetime;
+    uint32_t color;
+    float size;
+} cparticle_particle;
+
+// Indirect draw and dispatch arguments followed by the live counters
+typedef struct {
+    uint32_t draw_count, draw_instances, draw_first, draw_base;
+    uint32_t dispatch_x, dispatch_y, dispatch_z;
+    uint32_t capacity;
+    uint32_t source_live, target_live;
+} cparticle_state;
+
+// Emission queued for the next update
+typedef struct {
+    cparticle_emitter emitter;
+    uint32_t count;
+} cparticle_emit;
+
+// Particle system, particles are double-buffered in SSBOs and compacted into
+// the other buffer on every update
+typedef struct {
+    cg_storage_buffer buffers[2];
+    cg_storage_buffer state;
+    cg_compute_pipeline passes[2];
+    cg_pipeline pipeline;
+    cg_bindings quad;
+    cg_shader compute;
+    cg_shader render;
+    uint32_t capacity;
+    uint32_t current;
+    uint32_t seed;
+    vec4 bounds;
+    vec2 gravity;
+    float restitution;
+    cparticle_emit emits[CPARTICLE_MAX_EMITS];
+    size_t emit_count;
+} cparticle_system;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_particles_init(cparticle_system* sys, const cparticle_conf* conf);
+CARRIER_API void cg_particles_shutdown(cparticle_system* sys);
+CARRIER_API void cg_particles_set_bounds(cparticle_system* sys, float left, float right, float bottom, float top);
+CARRIER_API void cg_particles_emit(cparticle_system* sys, const cparticle_emitter* emitter, uint32_t count);
+CARRIER_API void cg_particles_update(cparticle_system* sys, float delta_time);
+CARRIER_API void cg_particles_render(const cparticle_system* sys, const float* view_projection);
+
+#endif // CARRIER_PARTICLES_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_PARTICLES_IMPLEMENTATION)
+#define CARRIER_PARTICLES_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static void cg_particles_pass(int pass, GLuint groups);
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_particles_init(cparticle_system* sys, const cparticle_conf* conf) {
+    memset(sys, 0, sizeof(*sys));
+
+    if (!GLEW_VERSION_4_3) {
+        cr_log(CR_ERROR, "Failed to initialize particles: compute shaders not supported");
+        return false;
+    }
+
+    sys->compute = cg_load_compute_shader("shaders/particles.comp");
+    sys->render = cg_load_shader("shaders/particles.vert", "shaders/particles.frag");
+    if (!sys->compute.program || !sys->render.program) {
+        cg_particles_shutdown(sys);
+        return false;
+    }
+
+    sys->capacity = conf->capacity > 0 ? conf->capacity : 65536;
+    glm_vec2_copy((float*)conf->gravity, sys->gravity);
+    sys->restitution = conf->restitution;
+    glm_vec4_copy((vec4){ -1.0f, 1.0f, -1.0f, 1.0f }, sys->bounds);
+
+    for (int i = 0; i < 2; i++) {
+        sys->buffers[i] = cg_make_storage_buffer(&(cg_storage_conf){
+            .size = (size_t)sys->capacity * sizeof(cparticle_particle)
+        });
+    }
+
+    // The only CPU write, every later change to the state happens on the GPU
+    const cparticle_state state = { 4, 0, 0, 0, 0, 1, 1, sys->capacity, 0, 0 };
+    sys->state = cg_make_storage_buffer(&(cg_storage_conf){ .size = sizeof(state), .data = &state });
+
+    // One pipeline per direction, the source and target swap every update
+    for (int i = 0; i < 2; i++) {
+        sys->passes[i] = cg_make_compute_pipeline(&(cg_compute_pipeline_conf){
+            .shader = sys->compute,
+            .storage = { sys->buffers[i], sys->buffers[i ^ 1], sys->state }
+        });
+    }
+
+    sys->pipeline = cg_make_pipeline(&(cg_pipeline_conf){ .shader = sys->render, .primitive_type = GL_TRIANGLE_STRIP });
+
+    // Core profile draws need a vertex array even without attributes
+    sys->quad = cg_make_buffer(&(cg_buffer_conf){ 0 });
+
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier particle module] (%u particles)", sys->capacity);
+    return true;
+}
+
+CARRIER_API void cg_particles_shutdown(cparticle_system* sys) {
+    for (int i = 0; i < 2; i++) {
+        if (sys->buffers[i].buffer) { cg_destroy_storage_buffer(sys->buffers[i]); }
+    }
+    if (sys->state.buffer) { cg_destroy_storage_buffer(sys->state); }
+    if (sys->quad.vao) { cg_destroy_buffer(sys->quad); }
+    if (sys->compute.program) { cg_destroy_shader(sys->compute); }
+    if (sys->render.program) { cg_destroy_shader(sys->render); }
+    memset(sys, 0, sizeof(*sys));
+}
+
+CARRIER_API void cg_particles_set_bounds(cparticle_system* sys, float left, float right, float bottom, float top) {
+    glm_vec4_copy((vec4){ left, right, bottom, top }, sys->bounds);
+}
+
+CARRIER_API void cg_particles_emit(cparticle_system* sys, const cparticle_emitter* emitter, uint32_t count) {
+    if (count == 0) { return; }
+
+    if (sys->emit_count == CPARTICLE_MAX_EMITS) {
+        cr_log(CR_WARNING, "Failed to emit particles: too many emitters this frame");
+        return;
+    }
+
+    sys->emits[sys->emit_count].emitter = *emitter;
+    sys->emits[sys->emit_count].count = count < sys->capacity ? count : sys->capacity;
+    sys->emit_count++;
+}
+
+CARRIER_API void cg_particles_update(cparticle_system* sys, float delta_time) {
+    if (!sys->compute.program) { return; }
+
+    cg_apply_compute_pipeline(&sys->passes[sys->current]);
+
+    // Emission appends to the source buffer, one dispatch per emitter
+    for (size_t i = 0; i < sys->emit_count; i++) {
+        const cparticle_emitter* emitter = &sys->emits[i].emitter;
+        const uint32_t count = sys->emits[i].count;
+
+        cg_set_uniform_uint(CPARTICLE_SEED_LOCATION, sys->seed++);
+        cg_set_uniform_uint(CPARTICLE_EMIT_COUNT_LOCATION, count);
+        cg_set_uniform_vec2(CPARTICLE_EMIT_POSITION_LOCATION, emitter->position);
+        cg_set_uniform_vec2(CPARTICLE_EMIT_ANGLE_LOCATION, (const GLfloat[2]){ emitter->direction, emitter->spread });
+        cg_set_uniform_vec2(CPARTICLE_EMIT_SPEED_LOCATION, (const GLfloat[2]){ emitter->speed_min, emitter->speed_max });
+        cg_set_uniform_vec2(CPARTICLE_EMIT_SHAPE_LOCATION, (const GLfloat[2]){ emitter->lifetime, emitter->size });
+        cg_set_uniform_vec4(CPARTICLE_EMIT_COLOR_LOCATION, emitter->color);
+        cg_particles_pass(CPARTICLE_PASS_EMIT, (count + CPARTICLE_GROUP_SIZE - 1) / CPARTICLE_GROUP_SIZE);
+        cg_barrier(CG_BARRIER_STORAGE);
+    }
+    sys->emit_count = 0;
+
+    // Size the update dispatch from the live count without reading it back
+    cg_particles_pass(CPARTICLE_PASS_PREPARE, 1);
+    cg_barrier(CG_BARRIER_STORAGE | CG_BARRIER_INDIRECT);
+
+    cg_set_uniform_int(CPARTICLE_PASS_LOCATION, CPARTICLE_PASS_UPDATE);
+    cg_set_uniform_float(CPARTICLE_DELTA_LOCATION, delta_time);
+    cg_set_uniform_vec2(CPARTICLE_GRAVITY_LOCATION, sys->gravity);
+    cg_set_uniform_vec4(CPARTICLE_BOUNDS_LOCATION, sys->bounds);
+    cg_set_uniform_float(CPARTICLE_RESTITUTION_LOCATION, sys->restitution);
+    cg_dispatch_indirect(&sys->state, offsetof(cparticle_state, dispatch_x));
+    cg_barrier(CG_BARRIER_STORAGE);
+
+    // Publish the survivor count as the instance count of the draw
+    cg_particles_pass(CPARTICLE_PASS_FINALIZE, 1);
+    cg_barrier(CG_BARRIER_STORAGE | CG_BARRIER_INDIRECT);
+
+    glUseProgram(0);
+    sys->current ^= 1u;
+}
+
+CARRIER_API void cg_particles_render(const cparticle_system* sys, const float* view_projection) {
+    if (!sys->render.program) { return; }
+
+    // Particles are blended in emission order and never occlude each other
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    cg_set_depth_test(false);
+
+    cg_pipeline pipeline = sys->pipeline;
+    cg_bindings quad = sys->quad;
+    cg_apply_pipeline(&pipeline);
+    cg_set_uniform_mat4(CPARTICLE_VIEW_PROJ_LOCATION, view_projection);
+    cg_apply_storage_buffer(0, &sys->buffers[sys->current]);
+
+    cg_apply_bindings(&quad);
+    cg_draw_indirect(&quad, &sys->state, offsetof(cparticle_state, draw_count));
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    if (depth_test) { cg_set_depth_test(true); }
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static void cg_particles_pass(int pass, GLuint groups) {
+    cg_set_uniform_int(CPARTICLE_PASS_LOCATION, pass);
+    cg_dispatch(groups, 1, 1);
+}
+
+#endif // CARRIER_PARTICLES_IMPLEMENTATION
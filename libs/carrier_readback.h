@@ -0,0 +1,617 @@
+#ifndef CARRIER_READBACK_H
+#define CARRIER_READBACK_H
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_gfx.h"
+
+// Maximum number of frames in flight between the GPU and the sink
+#define CREADBACK_MAX_SLOTS 8
+
+// Defaults for a zeroed configuration
+#define CREADBACK_DEFAULT_SLOTS 3
+#define CREADBACK_DEFAULT_FPS 60
+
+// Frame count of cg_readback_record that keeps recording until stopped
+#define CREADBACK_CONTINUOUS -1
+
+// Maximum length of a screenshot path
+#define CREADBACK_PATH_SIZE 256
+
+// Destination of the frames read back
+typedef enum {
+    CREADBACK_CALLBACK = 0,
+    CREADBACK_PNG,
+    CREADBACK_Y4M
+} creadback_sink;
+
+// Frame handed to a sink, RGBA8 pixels with rows bottom to top as OpenGL
+// stores them. The pixels are only valid during the callback.
+typedef struct {
+    const uint8_t* pixels;
+    int width;
+    int height;
+    uint64_t index;
+} creadback_frame;
+
+// Called on the sink thread, must not call GL
+typedef void (*creadback_callback)(const creadback_frame* frame, void* user);
+
+// Configuration structure for the readback module. PNG paths are printf
+// patterns taking the frame index as unsigned long long, Y4M paths are a file,
+// "-" for stdout or "|command" for a pipe.
+typedef struct {
+    creadback_sink sink;
+    const char* path;
+    creadback_callback callback;
+    void* user;
+    int slots;
+    int fps;
+} creadback_conf;
+
+// Counters since setup
+typedef struct {
+    uint64_t issued;
+    uint64_t written;
+    uint64_t dropped;
+} creadback_stats;
+
+// Slot states, a slot goes from free to reading on the GPU, then to the sink
+// thread which frees it again
+typedef enum {
+    CREADBACK_FREE = 0,
+    CREADBACK_READING,
+    CREADBACK_SINKING
+} creadback_state;
+
+// Pixel buffer of one frame in flight, pixels is the persistent mapping or a
+// CPU copy when the driver has no buffer storage
+typedef struct {
+    int state;
+    GLuint pbo;
+    GLsync fence;
+    uint8_t* pixels;
+    size_t size;
+    int width, height;
+    uint64_t index;
+    bool record;
+    char screenshot[CREADBACK_PATH_SIZE];
+} creadback_slot;
+
+// Readback system structure for the readback module
+typedef struct {
+    creadback_conf conf;
+    bool persistent;
+    creadback_slot slots[CREADBACK_MAX_SLOTS];
+    int next_slot;
+    int queue[CREADBACK_MAX_SLOTS];
+    int queue_head, queue_tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t thread;
+    bool running;
+    int record_frames;
+    char screenshot[CREADBACK_PATH_SIZE];
+    uint64_t frame_index;
+    FILE* file;
+    bool pipe;
+    int stream_width, stream_height;
+    uint8_t* planes;
+    size_t planes_size;
+    creadback_stats stats;
+} creadback_system;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_readback_setup(const creadback_conf* conf);
+CARRIER_API void cg_readback_shutdown(void);
+CARRIER_API void cg_readback_record(int frames);
+CARRIER_API void cg_readback_screenshot(const char* path);
+CARRIER_API void cg_readback_frame(void);
+CARRIER_API creadback_stats cg_readback_get_stats(void);
+
+#endif // CARRIER_READBACK_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_READBACK_IMPLEMENTATION)
+#define CARRIER_READBACK_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static bool cg_readback_allocate(creadback_slot* slot, int width, int height);
+static void cg_readback_release(creadback_slot* slot);
+static void cg_readback_collect(bool wait);
+static void* cg_readback_thread(void* arg);
+static void cg_readback_sink(creadback_slot* slot);
+static bool cg_readback_write_png(const char* path, const creadback_slot* slot);
+static void cg_readback_write_y4m(const creadback_slot* slot);
+static uint32_t cg_readback_crc(uint32_t crc, const uint8_t* data, size_t size);
+static void cg_readback_put_u32(uint8_t* out, uint32_t value);
+
+// Global variable to hold the readback system
+static creadback_system creadback = {0};
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_readback_setup(const creadback_conf* conf) {
+    if (creadback.running) { return true; }
+
+    creadback.conf = *conf;
+    if (creadback.conf.slots <= 0) { creadback.conf.slots = CREADBACK_DEFAULT_SLOTS; }
+    if (creadback.conf.slots > CREADBACK_MAX_SLOTS) { creadback.conf.slots = CREADBACK_MAX_SLOTS; }
+    if (creadback.conf.fps <= 0) { creadback.conf.fps = CREADBACK_DEFAULT_FPS; }
+
+    if (creadback.conf.sink == CREADBACK_CALLBACK && !creadback.conf.callback) {
+        cr_log(CR_ERROR, "Failed to initialize [carrier readback module]: no callback");
+        return false;
+    }
+    if (creadback.conf.sink != CREADBACK_CALLBACK && !creadback.conf.path) {
+        cr_log(CR_ERROR, "Failed to initialize [carrier readback module]: no path");
+        return false;
+    }
+
+    if (creadback.conf.sink == CREADBACK_Y4M) {
+        const char* path = creadback.conf.path;
+        if (strcmp(path, "-") == 0) {
+            creadback.file = stdout;
+        } else if (path[0] == '|') {
+            creadback.file = popen(path + 1, "w");
+            creadback.pipe = true;
+        } else {
+            creadback.file = fopen(path, "wb");
+        }
+        if (!creadback.file) {
+            cr_logf(CR_ERROR, "Failed to open video stream %s", path);
+            return false;
+        }
+    }
+
+    // Persistently mapped pixel buffers hand frames to the sink without a copy
+    creadback.persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+    pthread_mutex_init(&creadback.mutex, NULL);
+    pthread_cond_init(&creadback.wake, NULL);
+    creadback.running = true;
+
+    if (pthread_create(&creadback.thread, NULL, cg_readback_thread, NULL) != 0) {
+        cr_log(CR_ERROR, "Failed to initialize [carrier readback module]");
+        creadback.running = false;
+        pthread_cond_destroy(&creadback.wake);
+        pthread_mutex_destroy(&creadback.mutex);
+        if (creadback.file && creadback.file != stdout) {
+            if (creadback.pipe) { pclose(creadback.file); } else { fclose(creadback.file); }
+        }
+        memset(&creadback, 0, sizeof(creadback));
+        return false;
+    }
+
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier readback module] (%d slots)", creadback.conf.slots);
+    return true;
+}
+
+CARRIER_API void cg_readback_shutdown(void) {
+    if (!creadback.running) { return; }
+
+    // Frames already read are still written, waiting on their fences once
+    cg_readback_collect(true);
+
+    pthread_mutex_lock(&creadback.mutex);
+    creadback.running = false;
+    pthread_cond_broadcast(&creadback.wake);
+    pthread_mutex_unlock(&creadback.mutex);
+    pthread_join(creadback.thread, NULL);
+
+    for (int i = 0; i < CREADBACK_MAX_SLOTS; i++) {
+        cg_readback_release(&creadback.slots[i]);
+    }
+
+    if (creadback.file && creadback.file != stdout) {
+        if (creadback.pipe) { pclose(creadback.file); } else { fclose(creadback.file); }
+    } else if (creadback.file) {
+        fflush(creadback.file);
+    }
+    cr_free(creadback.planes);
+
+    pthread_cond_destroy(&creadback.wake);
+    pthread_mutex_destroy(&creadback.mutex);
+    cr_logf(CR_SUCCESS, "Successfully shutdown [carrier readback module] (%llu frames written, %llu dropped)",
+            (unsigned long long)creadback.stats.written, (unsigned long long)creadback.stats.dropped);
+    memset(&creadback, 0, sizeof(creadback));
+}
+
+CARRIER_API void cg_readback_record(int frames) {
+    creadback.record_frames = frames;
+}
+
+CARRIER_API void cg_readback_screenshot(const char* path) {
+    if (!creadback.running) {
+        cr_log(CR_ERROR, "Failed to take screenshot: readback module not initialized");
+        return;
+    }
+    snprintf(creadback.screenshot, sizeof(creadback.screenshot), "%s", path);
+}
+
+CARRIER_API void cg_readback_frame(void) {
+    if (!creadback.running) { return; }
+
+    cg_readback_collect(false);
+
+    const uint64_t index = creadback.frame_index++;
+    const bool record = creadback.record_frames != 0;
+    if (!record && !creadback.screenshot[0]) { return; }
+    if (creadback.record_frames > 0) { creadback.record_frames--; }
+
+    // A slot still in flight means the GPU or the sink is behind, the frame is
+    // dropped rather than stalling the pipeline
+    creadback_slot* slot = &creadback.slots[creadback.next_slot];
+    if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != CREADBACK_FREE) {
+        creadback.stats.dropped++;
+        return;
+    }
+
+    int width, height;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+    if (width <= 0 || height <= 0) { return; }
+    if ((slot->width != width || slot->height != height) && !cg_readback_allocate(slot, width, height)) {
+        creadback.stats.dropped++;
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    slot->index = index;
+    slot->record = record;
+    memcpy(slot->screenshot, creadback.screenshot, sizeof(slot->screenshot));
+    creadback.screenshot[0] = '\0';
+    slot->state = CREADBACK_READING;
+    creadback.next_slot = (creadback.next_slot + 1) % creadback.conf.slots;
+    creadback.stats.issued++;
+}
+
+CARRIER_API creadback_stats cg_readback_get_stats(void) {
+    pthread_mutex_lock(&creadback.mutex);
+    const creadback_stats stats = creadback.stats;
+    pthread_mutex_unlock(&creadback.mutex);
+    return stats;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static bool cg_readback_allocate(creadback_slot* slot, int width, int height) {
+    cg_readback_release(slot);
+
+    slot->size = (size_t)width * (size_t)height * 4;
+    glGenBuffers(1, &slot->pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+
+    if (creadback.persistent) {
+        const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)slot->size, NULL, flags);
+        slot->pixels = (uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot->size, flags);
+    } else {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)slot->size, NULL, GL_STREAM_READ);
+        slot->pixels = (uint8_t*)cr_alloc(slot->size);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    cg_track_memory(CG_MEMORY_STAGING, slot->size, true);
+
+    if (!slot->pixels) {
+        cr_log(CR_ERROR, "Failed to allocate readback buffer");
+        cg_readback_release(slot);
+        return false;
+    }
+    slot->width = width;
+    slot->height = height;
+    return true;
+}
+
+static void cg_readback_release(creadback_slot* slot) {
+    if (slot->fence) { glDeleteSync(slot->fence); }
+    if (!creadback.persistent) { cr_free(slot->pixels); }
+    if (slot->pbo) {
+        cg_track_memory(CG_MEMORY_STAGING, slot->size, false);
+        glDeleteBuffers(1, &slot->pbo);
+    }
+    memset(slot, 0, sizeof(*slot));
+}
+
+// Hands every slot whose read has completed to the sink thread, only blocks
+// on the fences at shutdown
+static void cg_readback_collect(bool wait) {
+    for (int i = 0; i < creadback.conf.slots; i++) {
+        creadback_slot* slot = &creadback.slots[(creadback.next_slot + i) % creadback.conf.slots];
+        if (slot->state != CREADBACK_READING) { continue; }
+
+        const GLenum status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED) { continue; }
+        glDeleteSync(slot->fence);
+        slot->fence = NULL;
+
+        if (!creadback.persistent) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+            const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)slot->size, GL_MAP_READ_BIT);
+            if (mapped) { memcpy(slot->pixels, mapped, slot->size); }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        pthread_mutex_lock(&creadback.mutex);
+        slot->state = CREADBACK_SINKING;
+        creadback.queue[creadback.queue_tail] = (int)(slot - creadback.slots);
+        creadback.queue_tail = (creadback.queue_tail + 1) % CREADBACK_MAX_SLOTS;
+        pthread_cond_signal(&creadback.wake);
+        pthread_mutex_unlock(&creadback.mutex);
+    }
+}
+
+static void* cg_readback_thread(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&creadback.mutex);
+    for (;;) {
+        while (creadback.running && creadback.queue_head == creadback.queue_tail) {
+            pthread_cond_wait(&creadback.wake, &creadback.mutex);
+        }
+        if (creadback.queue_head == creadback.queue_tail) { break; }
+
+        creadback_slot* slot = &creadback.slots[creadback.queue[creadback.queue_head]];
+        creadback.queue_head = (creadback.queue_head + 1) % CREADBACK_MAX_SLOTS;
+        pthread_mutex_unlock(&creadback.mutex);
+
+        cg_readback_sink(slot);
+
+        pthread_mutex_lock(&creadback.mutex);
+        creadback.stats.written++;
+        __atomic_store_n(&slot->state, CREADBACK_FREE, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&creadback.mutex);
+    return NULL;
+}
+
+static void cg_readback_sink(creadback_slot* slot) {
+    if (slot->screenshot[0]) {
+        if (cg_readback_write_png(slot->screenshot, slot)) {
+            cr_logf(CR_INFO, "Saved screenshot %s", slot->screenshot);
+        }
+    }
+    if (!slot->record) { return; }
+
+    switch (creadback.conf.sink) {
+        case CREADBACK_CALLBACK: {
+            const creadback_frame frame = { slot->pixels, slot->width, slot->height, slot->index };
+            creadback.conf.callback(&frame, creadback.conf.user);
+            break;
+        }
+        case CREADBACK_PNG: {
+            char path[CREADBACK_PATH_SIZE];
+            snprintf(path, sizeof(path), creadback.conf.path, (unsigned long long)slot->index);
+            cg_readback_write_png(path, slot);
+            break;
+        }
+        case CREADBACK_Y4M:
+            cg_readback_write_y4m(slot);
+            break;
+    }
+}
+
+// Writes an RGBA8 PNG with stored deflate blocks, no compression keeps the
+// sink thread ahead of a full frame rate capture
+static bool cg_readback_write_png(const char* path, const creadback_slot* slot) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        cr_logf(CR_ERROR, "Failed to open %s", path);
+        return false;
+    }
+
+    const size_t row_size = (size_t)slot->width * 4 + 1;
+    const size_t raw_size = row_size * (size_t)slot->height;
+    const size_t block_count = (raw_size + 65534) / 65535;
+    const size_t idat_size = 2 + raw_size + block_count * 5 + 4;
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    uint8_t header[8 + 25 + 8];
+    memcpy(header, signature, 8);
+
+    // IHDR, 8 bit RGBA, no interlacing
+    uint8_t* ihdr = header + 8;
+    cg_readback_put_u32(ihdr, 13);
+    memcpy(ihdr + 4, "IHDR", 4);
+    cg_readback_put_u32(ihdr + 8, (uint32_t)slot->width);
+    cg_readback_put_u32(ihdr + 12, (uint32_t)slot->height);
+    ihdr[16] = 8;
+    ihdr[17] = 6;
+    ihdr[18] = ihdr[19] = ihdr[20] = 0;
+    cg_readback_put_u32(ihdr + 21, cg_readback_crc(0, ihdr + 4, 17));
+
+    uint8_t* idat = header + 33;
+    cg_readback_put_u32(idat, (uint32_t)idat_size);
+    memcpy(idat + 4, "IDAT", 4);
+    fwrite(header, 1, sizeof(header), file);
+
+    uint8_t zlib_header[2] = { 0x78, 0x01 };
+    uint32_t crc = cg_readback_crc(0, idat + 4, 4);
+    crc = cg_readback_crc(crc, zlib_header, 2);
+    fwrite(zlib_header, 1, 2, file);
+
+    // Scanlines are emitted top to bottom with filter type 0, split across
+    // stored blocks of at most 65535 bytes
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t remaining = raw_size, row = 0, column = 0;
+    while (remaining > 0) {
+        const size_t block = remaining < 65535 ? remaining : 65535;
+        remaining -= block;
+
+        uint8_t block_header[5] = { remaining == 0 ? 1 : 0, (uint8_t)block, (uint8_t)(block >> 8), (uint8_t)~block, (uint8_t)(~block >> 8) };
+        crc = cg_readback_crc(crc, block_header, 5);
+        fwrite(block_header, 1, 5, file);
+
+        size_t left = block;
+        while (left > 0) {
+            const uint8_t filter = 0;
+            const uint8_t* data;
+            size_t size;
+            if (column == 0) {
+                data = &filter;
+                size = 1;
+            } else {
+                data = slot->pixels + (size_t)(slot->height - 1 - row) * (row_size - 1) + (column - 1);
+                size = row_size - column;
+                if (size > left) { size = left; }
+            }
+
+            crc = cg_readback_crc(crc, data, size);
+            for (size_t i = 0; i < size; i++) {
+                adler_a += data[i];
+                if (adler_a >= 65521) { adler_a -= 65521; }
+                adler_b += adler_a;
+                if (adler_b >= 65521) { adler_b -= 65521; }
+            }
+            fwrite(data, 1, size, file);
+
+            left -= size;
+            column += size;
+            if (column == row_size) {
+                column = 0;
+                row++;
+            }
+        }
+    }
+
+    uint8_t trailer[4 + 4 + 12];
+    cg_readback_put_u32(trailer, (adler_b << 16) | adler_a);
+    crc = cg_readback_crc(crc, trailer, 4);
+    cg_readback_put_u32(trailer + 4, crc);
+    cg_readback_put_u32(trailer + 8, 0);
+    memcpy(trailer + 12, "IEND", 4);
+    cg_readback_put_u32(trailer + 16, cg_readback_crc(0, (const uint8_t*)"IEND", 4));
+    fwrite(trailer, 1, sizeof(trailer), file);
+
+    const bool success = ferror(file) == 0;
+    fclose(file);
+    if (!success) { cr_logf(CR_ERROR, "Failed to write %s", path); }
+    return success;
+}
+
+// Appends the frame as full range BT.601 4:2:0, the stream keeps the size of
+// its first frame and frames of any other size are skipped
+static void cg_readback_write_y4m(const creadback_slot* slot) {
+    const int width = slot->width, height = slot->height;
+
+    if (creadback.stream_width == 0) {
+        creadback.stream_width = width;
+        creadback.stream_height = height;
+        fprintf(creadback.file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, creadback.conf.fps);
+    } else if (width != creadback.stream_width || height != creadback.stream_height) {
+        cr_log(CR_WARNING, "Failed to write video frame: framebuffer size changed");
+        return;
+    }
+
+    const int chroma_width = (width + 1) / 2, chroma_height = (height + 1) / 2;
+    const size_t luma_size = (size_t)width * (size_t)height;
+    const size_t chroma_size = (size_t)chroma_width * (size_t)chroma_height;
+    if (creadback.planes_size < luma_size + 2 * chroma_size) {
+        creadback.planes_size = luma_size + 2 * chroma_size;
+        cr_free(creadback.planes);
+        creadback.planes = (uint8_t*)cr_alloc(creadback.planes_size);
+        if (!creadback.planes) {
+            creadback.planes_size = 0;
+            cr_log(CR_ERROR, "Failed to allocate video frame planes");
+            return;
+        }
+    }
+
+    uint8_t* luma = creadback.planes;
+    uint8_t* cb = luma + luma_size;
+    uint8_t* cr = cb + chroma_size;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* source = slot->pixels + (size_t)(height - 1 - y) * (size_t)width * 4;
+        for (int x = 0; x < width; x++) {
+            const int r = source[x * 4], g = source[x * 4 + 1], b = source[x * 4 + 2];
+            luma[(size_t)y * width + x] = (uint8_t)((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+
+    // Chroma is the average of each 2x2 block, clamped at odd edges
+    for (int y = 0; y < chroma_height; y++) {
+        const int y0 = height - 1 - 2 * y;
+        const int y1 = y0 > 0 ? y0 - 1 : y0;
+        for (int x = 0; x < chroma_width; x++) {
+            const int x0 = 2 * x;
+            const int x1 = x0 + 1 < width ? x0 + 1 : x0;
+            int r = 0, g = 0, b = 0;
+            const uint8_t* p[4] = {
+                slot->pixels + ((size_t)y0 * width + x0) * 4, slot->pixels + ((size_t)y0 * width + x1) * 4,
+                slot->pixels + ((size_t)y1 * width + x0) * 4, slot->pixels + ((size_t)y1 * width + x1) * 4
+            };
+            for (int i = 0; i < 4; i++) {
+                r += p[i][0];
+                g += p[i][1];
+                b += p[i][2];
+            }
+            const size_t at = (size_t)y * chroma_width + x;
+            const int u = (-43 * r - 85 * g + 128 * b + 512 + 4 * 128 * 256) >> 10;
+            const int v = (128 * r - 107 * g - 21 * b + 512 + 4 * 128 * 256) >> 10;
+            cb[at] = (uint8_t)(u > 255 ? 255 : u);
+            cr[at] = (uint8_t)(v > 255 ? 255 : v);
+        }
+    }
+
+    fputs("FRAME\n", creadback.file);
+    if (fwrite(creadback.planes, 1, luma_size + 2 * chroma_size, creadback.file) != luma_size + 2 * chroma_size) {
+        cr_log(CR_ERROR, "Failed to write video frame");
+    }
+}
+
+static uint32_t cg_readback_crc(uint32_t crc, const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+
+    // Only the sink thread computes checksums
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) { c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1; }
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void cg_readback_put_u32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+#endif // CARRIER_READBACK_IMPLEMENTATION
@@ -0,0 +1,827 @@
+#ifndef CARRIER_STREAM_H
+#define CARRIER_STREAM_H
+
+#include <GL/glew.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_asset.h"
+#include "../libs/carrier_gfx.h"
+
+// Maximum number of live streamed resources
+#ifndef CSTREAM_MAX_RESOURCES
+#define CSTREAM_MAX_RESOURCES 1024
+#endif
+
+// Maximum number of loader threads
+#define CSTREAM_MAX_THREADS 8
+
+// Maximum number of frames with staging data in flight
+#define CSTREAM_MAX_FENCES 8
+
+// Maximum length of an asset name
+#define CSTREAM_PATH_SIZE 256
+
+// Defaults for a zeroed configuration
+#define CSTREAM_DEFAULT_BUDGET_BYTES (4u << 20)
+#define CSTREAM_DEFAULT_BUDGET_MS 2.0f
+#define CSTREAM_DEFAULT_STAGING_SIZE (8u << 20)
+#define CSTREAM_DEFAULT_THREADS 2
+
+// Resource states, a resource starts loading and ends ready or failed. Ready
+// meshes and images are evicted over the memory budget and load again when used.
+typedef enum {
+    CSTREAM_LOADING = 0,
+    CSTREAM_READY,
+    CSTREAM_FAILED,
+    CSTREAM_EVICTED
+} cstream_state;
+
+// Resource kinds
+typedef enum {
+    CSTREAM_MESH = 0,
+    CSTREAM_SHADER,
+    CSTREAM_IMAGE
+} cstream_kind;
+
+// Handle of a streamed resource, slot index in the low 16 bits and the slot
+// generation in the high 16 bits. Zero is never a valid handle.
+typedef uint32_t cstream_handle;
+
+// Decoded mesh, allocation comes from cr_alloc and is freed once the mesh has
+// been uploaded. The vertex layout is the one of cg_make_buffer.
+typedef struct {
+    const void* vertices;
+    size_t vertex_size;
+    const void* indices;
+    size_t index_size;
+    void* allocation;
+} cstream_mesh;
+
+// Mesh decoder, runs on a loader thread and must not call GL. Evicted meshes
+// are decoded again, so the user data must live as long as the resource.
+typedef bool (*cstream_decode_func)(casset_view source, cstream_mesh* mesh, void* user);
+
+// Configuration structure for the stream module, placeholders are returned
+// for resources that are not ready. Eviction follows the memory budget of the
+// graphics module.
+typedef struct {
+    size_t budget_bytes;
+    float budget_ms;
+    size_t staging_size;
+    int threads;
+    cg_bindings* placeholder_bindings;
+    cg_shader placeholder_shader;
+    const cg_image* placeholder_image;
+} cstream_conf;
+
+// Counters of the last update
+typedef struct {
+    size_t bytes_uploaded;
+    float upload_ms;
+    size_t completed;
+    size_t pending;
+    size_t evicted;
+    size_t evicted_bytes;
+    size_t reloaded;
+} cstream_stats;
+
+// Streamed resource, the loader thread owns it between the request and the
+// decoded queues, the GL thread owns it otherwise. Images are decoded into
+// the image configuration, its levels point into the source or the allocation.
+typedef struct {
+    cstream_kind kind;
+    int state;
+    bool cancelled;
+    bool decoded;
+    bool live;
+    uint16_t generation;
+    char paths[2][CSTREAM_PATH_SIZE];
+    cstream_decode_func decode;
+    void* user;
+    cstream_mesh mesh;
+    cg_image_conf image;
+    void* image_allocation;
+    casset_view sources[2];
+    size_t uploaded;
+    bool created;
+    uint64_t last_used;
+    union {
+        cg_bindings bindings;
+        cg_shader shader;
+        cg_image image;
+    } object;
+} cstream_resource;
+
+// Staging range guarded by a fence, end is the staging head after the frame
+typedef struct {
+    GLsync fence;
+    size_t end;
+} cstream_fence;
+
+// Stream system structure for the stream module
+typedef struct {
+    cstream_conf conf;
+    cstream_resource resources[CSTREAM_MAX_RESOURCES];
+    uint32_t free_slots[CSTREAM_MAX_RESOURCES];
+    size_t free_count;
+    uint32_t requests[CSTREAM_MAX_RESOURCES];
+    size_t request_head, request_tail;
+    uint32_t decoded[CSTREAM_MAX_RESOURCES];
+    size_t decoded_head, decoded_tail;
+    size_t pending;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_t threads[CSTREAM_MAX_THREADS];
+    int thread_count;
+    bool running;
+    cstream_resource* uploading;
+    cg_storage_buffer staging;
+    size_t staging_head, staging_tail, staging_fenced;
+    cstream_fence fences[CSTREAM_MAX_FENCES];
+    size_t fence_head, fence_tail;
+    cstream_stats stats;
+    size_t reloaded;
+    uint64_t frame;
+} cstream_system;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_stream_setup(const cstream_conf* conf);
+CARRIER_API void cr_stream_shutdown(void);
+CARRIER_API cstream_handle cr_stream_load_mesh(const char* path, cstream_decode_func decode, void* user);
+CARRIER_API cstream_handle cr_stream_load_shader(const char* vertex_path, const char* fragment_path);
+CARRIER_API cstream_handle cr_stream_load_image(const char* path);
+CARRIER_API void cr_stream_release(cstream_handle handle);
+CARRIER_API void cr_stream_update(void);
+CARRIER_API cstream_state cr_stream_get_state(cstream_handle handle);
+CARRIER_API cg_bindings* cr_stream_get_bindings(cstream_handle handle);
+CARRIER_API int cr_stream_get_element_count(cstream_handle handle);
+CARRIER_API cg_shader cr_stream_get_shader(cstream_handle handle);
+CARRIER_API const cg_image* cr_stream_get_image(cstream_handle handle);
+CARRIER_API cstream_stats cr_stream_get_stats(void);
+
+#endif // CARRIER_STREAM_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_STREAM_IMPLEMENTATION)
+#define CARRIER_STREAM_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static cstream_resource* cr_stream_resolve(cstream_handle handle);
+static cstream_handle cr_stream_request(cstream_kind kind, const char* first, const char* second, cstream_decode_func decode, void* user);
+static void cr_stream_free(cstream_resource* resource);
+static void cr_stream_destroy(cstream_resource* resource);
+static void cr_stream_use(cstream_resource* resource);
+static void cr_stream_evict(void);
+static void cr_stream_finish(cstream_resource* resource, bool success);
+static bool cr_stream_upload_mesh(cstream_resource* resource, size_t budget, size_t* uploaded);
+static bool cr_stream_upload_image(cstream_resource* resource, size_t budget, size_t* uploaded);
+static size_t cr_stream_image_level_size(const cstream_resource* resource, int level);
+static size_t cr_stream_reserve(size_t size, size_t* offset);
+static size_t cr_stream_reserve_rows(size_t row_size, size_t rows, size_t* offset);
+static int cr_stream_compare_last_used(const void* a, const void* b);
+static void cr_stream_retire(size_t keep);
+static bool cr_stream_decode_raw(casset_view source, cstream_mesh* mesh, void* user);
+static void cr_stream_touch(casset_view view);
+static void* cr_stream_thread(void* arg);
+static uint64_t cr_stream_now(void);
+
+// Global variable to hold the stream system
+static cstream_system cstream = {0};
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_stream_setup(const cstream_conf* conf) {
+    if (cstream.running) { return; }
+
+    cstream.conf = *conf;
+    if (cstream.conf.budget_bytes == 0) { cstream.conf.budget_bytes = CSTREAM_DEFAULT_BUDGET_BYTES; }
+    if (cstream.conf.budget_ms <= 0.0f) { cstream.conf.budget_ms = CSTREAM_DEFAULT_BUDGET_MS; }
+    if (cstream.conf.staging_size == 0) { cstream.conf.staging_size = CSTREAM_DEFAULT_STAGING_SIZE; }
+    if (cstream.conf.threads <= 0) { cstream.conf.threads = CSTREAM_DEFAULT_THREADS; }
+    if (cstream.conf.threads > CSTREAM_MAX_THREADS) { cstream.conf.threads = CSTREAM_MAX_THREADS; }
+
+    cstream.free_count = CSTREAM_MAX_RESOURCES;
+    for (uint32_t i = 0; i < CSTREAM_MAX_RESOURCES; i++) {
+        cstream.free_slots[i] = CSTREAM_MAX_RESOURCES - 1 - i;
+    }
+
+    // Uploads go through a persistently mapped ring when the driver allows,
+    // otherwise straight into the destination with glBufferSubData
+    cstream.staging = cg_make_storage_buffer(&(cg_storage_conf){ .size = cstream.conf.staging_size, .persistent = true });
+
+    pthread_mutex_init(&cstream.mutex, NULL);
+    pthread_cond_init(&cstream.wake, NULL);
+    cstream.running = true;
+
+    for (int i = 0; i < cstream.conf.threads; i++) {
+        if (pthread_create(&cstream.threads[i], NULL, cr_stream_thread, NULL) != 0) {
+            cr_logf(CR_WARNING, "Failed to start loader thread %d", i);
+            break;
+        }
+        cstream.thread_count++;
+    }
+
+    if (cstream.thread_count == 0) {
+        cr_log(CR_ERROR, "Failed to initialize [carrier stream module]");
+        cr_stream_shutdown();
+        return;
+    }
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier stream module] (%d loader threads)", cstream.thread_count);
+}
+
+CARRIER_API void cr_stream_shutdown(void) {
+    pthread_mutex_lock(&cstream.mutex);
+    cstream.running = false;
+    pthread_cond_broadcast(&cstream.wake);
+    pthread_mutex_unlock(&cstream.mutex);
+
+    for (int i = 0; i < cstream.thread_count; i++) {
+        pthread_join(cstream.threads[i], NULL);
+    }
+
+    // GL objects belong to the graphics context, only payloads are freed here
+    for (uint32_t i = 0; i < CSTREAM_MAX_RESOURCES; i++) {
+        cr_free(cstream.resources[i].mesh.allocation);
+        cr_free(cstream.resources[i].image_allocation);
+    }
+
+    cr_stream_retire(0);
+    if (cstream.staging.buffer) { cg_destroy_storage_buffer(cstream.staging); }
+
+    pthread_cond_destroy(&cstream.wake);
+    pthread_mutex_destroy(&cstream.mutex);
+    memset(&cstream, 0, sizeof(cstream));
+}
+
+CARRIER_API cstream_handle cr_stream_load_mesh(const char* path, cstream_decode_func decode, void* user) {
+    return cr_stream_request(CSTREAM_MESH, path, NULL, decode ? decode : cr_stream_decode_raw, user);
+}
+
+CARRIER_API cstream_handle cr_stream_load_shader(const char* vertex_path, const char* fragment_path) {
+    return cr_stream_request(CSTREAM_SHADER, vertex_path, fragment_path, NULL, NULL);
+}
+
+CARRIER_API cstream_handle cr_stream_load_image(const char* path) {
+    return cr_stream_request(CSTREAM_IMAGE, path, NULL, NULL, NULL);
+}
+
+CARRIER_API void cr_stream_release(cstream_handle handle) {
+    cstream_resource* resource = cr_stream_resolve(handle);
+    if (!resource) { return; }
+
+    // A loading resource is dropped by the update that would finish it
+    if (__atomic_load_n(&resource->state, __ATOMIC_ACQUIRE) == CSTREAM_LOADING) {
+        __atomic_store_n(&resource->cancelled, true, __ATOMIC_RELEASE);
+        return;
+    }
+
+    cr_stream_destroy(resource);
+    cr_stream_free(resource);
+}
+
+CARRIER_API void cr_stream_update(void) {
+    const uint64_t start = cr_stream_now();
+    const uint64_t budget_ns = (uint64_t)(cstream.conf.budget_ms * 1e6f);
+    size_t bytes = 0;
+
+    memset(&cstream.stats, 0, sizeof(cstream.stats));
+    if (!cstream.running) { return; }
+    cr_stream_retire(CSTREAM_MAX_FENCES);
+    cr_stream_evict();
+
+    // Reloads are requested from the getters between two updates
+    cstream.stats.reloaded = cstream.reloaded;
+    cstream.reloaded = 0;
+
+    while (bytes < cstream.conf.budget_bytes && cr_stream_now() - start < budget_ns) {
+        if (!cstream.uploading) {
+            pthread_mutex_lock(&cstream.mutex);
+            if (cstream.decoded_head != cstream.decoded_tail) {
+                const uint32_t index = cstream.decoded[cstream.decoded_head++ % CSTREAM_MAX_RESOURCES];
+                cstream.uploading = &cstream.resources[index];
+            }
+            pthread_mutex_unlock(&cstream.mutex);
+            if (!cstream.uploading) { break; }
+        }
+
+        cstream_resource* resource = cstream.uploading;
+        if (__atomic_load_n(&resource->cancelled, __ATOMIC_ACQUIRE) || !resource->decoded) {
+            cr_stream_finish(resource, false);
+            continue;
+        }
+
+        if (resource->kind == CSTREAM_SHADER) {
+            // Compilation cannot be split, it runs whole and may overrun the budget once
+            const GLuint shaders[] = {
+                compile_shader(resource->sources[0].data, resource->sources[0].size, GL_VERTEX_SHADER),
+                compile_shader(resource->sources[1].data, resource->sources[1].size, GL_FRAGMENT_SHADER)
+            };
+
+            if (shaders[0] && shaders[1]) {
+                resource->object.shader = link_program(shaders, 2);
+                resource->created = resource->object.shader.program != 0;
+            } else {
+                if (shaders[0]) { glDeleteShader(shaders[0]); }
+                if (shaders[1]) { glDeleteShader(shaders[1]); }
+            }
+            bytes += resource->sources[0].size + resource->sources[1].size;
+            cr_stream_finish(resource, resource->created);
+            continue;
+        }
+
+        size_t uploaded = 0;
+        const bool done = resource->kind == CSTREAM_IMAGE ?
+            cr_stream_upload_image(resource, cstream.conf.budget_bytes - bytes, &uploaded) :
+            cr_stream_upload_mesh(resource, cstream.conf.budget_bytes - bytes, &uploaded);
+        bytes += uploaded;
+        if (done) {
+            cr_stream_finish(resource, resource->created);
+        } else if (uploaded == 0) {
+            // Staging ring is full until the GPU catches up
+            break;
+        }
+    }
+
+    // Fence what this frame staged, the range is reused once the copies ran
+    if (cstream.staging_head != cstream.staging_fenced) {
+        cr_stream_retire(CSTREAM_MAX_FENCES - 1);
+        cstream.fences[cstream.fence_tail++ % CSTREAM_MAX_FENCES] = (cstream_fence){
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), cstream.staging_head
+        };
+        cstream.staging_fenced = cstream.staging_head;
+    }
+
+    cstream.stats.bytes_uploaded = bytes;
+    cstream.stats.upload_ms = (float)(cr_stream_now() - start) / 1e6f;
+    cstream.stats.pending = __atomic_load_n(&cstream.pending, __ATOMIC_RELAXED);
+    cstream.frame++;
+}
+
+CARRIER_API cstream_state cr_stream_get_state(cstream_handle handle) {
+    const cstream_resource* resource = cr_stream_resolve(handle);
+    if (!resource) { return CSTREAM_FAILED; }
+    return (cstream_state)__atomic_load_n(&resource->state, __ATOMIC_ACQUIRE);
+}
+
+CARRIER_API cg_bindings* cr_stream_get_bindings(cstream_handle handle) {
+    cstream_resource* resource = cr_stream_resolve(handle);
+    if (!resource || resource->kind != CSTREAM_MESH) { return cstream.conf.placeholder_bindings; }
+
+    cr_stream_use(resource);
+    if (resource->state != CSTREAM_READY) { return cstream.conf.placeholder_bindings; }
+    return &resource->object.bindings;
+}
+
+CARRIER_API int cr_stream_get_element_count(cstream_handle handle) {
+    const cstream_resource* resource = cr_stream_resolve(handle);
+    if (!resource || resource->kind != CSTREAM_MESH || resource->state != CSTREAM_READY) { return 0; }
+
+    if (resource->mesh.index_size > 0) { return (int)(resource->mesh.index_size / sizeof(GLuint)); }
+    return (int)(resource->mesh.vertex_size / (3 * sizeof(float)));
+}
+
+CARRIER_API cg_shader cr_stream_get_shader(cstream_handle handle) {
+    const cstream_resource* resource = cr_stream_resolve(handle);
+    if (!resource || resource->kind != CSTREAM_SHADER || resource->state != CSTREAM_READY) {
+        return cstream.conf.placeholder_shader;
+    }
+    return resource->object.shader;
+}
+
+CARRIER_API const cg_image* cr_stream_get_image(cstream_handle handle) {
+    cstream_resource* resource = cr_stream_resolve(handle);
+    if (!resource || resource->kind != CSTREAM_IMAGE) { return cstream.conf.placeholder_image; }
+
+    cr_stream_use(resource);
+    if (resource->state != CSTREAM_READY) { return cstream.conf.placeholder_image; }
+    return &resource->object.image;
+}
+
+CARRIER_API cstream_stats cr_stream_get_stats(void) {
+    return cstream.stats;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static cstream_resource* cr_stream_resolve(cstream_handle handle) {
+    const uint32_t index = (handle & 0xffffu) - 1u;
+    if (handle == 0 || index >= CSTREAM_MAX_RESOURCES) { return NULL; }
+
+    cstream_resource* resource = &cstream.resources[index];
+    if (!resource->live || resource->generation != (uint16_t)(handle >> 16)) { return NULL; }
+    return resource;
+}
+
+static cstream_handle cr_stream_request(cstream_kind kind, const char* first, const char* second, cstream_decode_func decode, void* user) {
+    if (!cstream.running) {
+        cr_log(CR_ERROR, "Failed to stream asset: stream module not initialized");
+        return 0;
+    }
+
+    if (cstream.free_count == 0) {
+        cr_logf(CR_ERROR, "Failed to stream '%s': too many resources", first);
+        return 0;
+    }
+
+    const uint32_t index = cstream.free_slots[--cstream.free_count];
+    cstream_resource* resource = &cstream.resources[index];
+    const uint16_t generation = (uint16_t)(resource->generation + 1);
+
+    memset(resource, 0, sizeof(*resource));
+    resource->kind = kind;
+    resource->state = CSTREAM_LOADING;
+    resource->live = true;
+    resource->generation = generation;
+    resource->decode = decode;
+    resource->user = user;
+    resource->last_used = cstream.frame;
+    snprintf(resource->paths[0], CSTREAM_PATH_SIZE, "%s", first);
+    if (second) { snprintf(resource->paths[1], CSTREAM_PATH_SIZE, "%s", second); }
+
+    __atomic_add_fetch(&cstream.pending, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&cstream.mutex);
+    cstream.requests[cstream.request_tail++ % CSTREAM_MAX_RESOURCES] = index;
+    pthread_cond_signal(&cstream.wake);
+    pthread_mutex_unlock(&cstream.mutex);
+
+    return ((uint32_t)generation << 16) | (index + 1u);
+}
+
+static void cr_stream_free(cstream_resource* resource) {
+    cr_free(resource->mesh.allocation);
+    resource->mesh.allocation = NULL;
+    cr_free(resource->image_allocation);
+    resource->image_allocation = NULL;
+    resource->live = false;
+    cstream.free_slots[cstream.free_count++] = (uint32_t)(resource - cstream.resources);
+}
+
+static void cr_stream_destroy(cstream_resource* resource) {
+    if (!resource->created) { return; }
+
+    if (resource->kind == CSTREAM_MESH) { cg_destroy_buffer(resource->object.bindings); }
+    if (resource->kind == CSTREAM_SHADER) { cg_destroy_shader(resource->object.shader); }
+    if (resource->kind == CSTREAM_IMAGE) { cg_destroy_image(resource->object.image); }
+    resource->created = false;
+}
+
+static void cr_stream_use(cstream_resource* resource) {
+    resource->last_used = cstream.frame;
+    if (resource->state != CSTREAM_EVICTED) { return; }
+
+    // The paths and the decoder are kept, the load runs again from the start
+    resource->state = CSTREAM_LOADING;
+    resource->decoded = false;
+    resource->uploaded = 0;
+    memset(&resource->mesh, 0, sizeof(resource->mesh));
+    memset(&resource->image, 0, sizeof(resource->image));
+    memset(resource->sources, 0, sizeof(resource->sources));
+    cstream.reloaded++;
+
+    __atomic_add_fetch(&cstream.pending, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&cstream.mutex);
+    cstream.requests[cstream.request_tail++ % CSTREAM_MAX_RESOURCES] = (uint32_t)(resource - cstream.resources);
+    pthread_cond_signal(&cstream.wake);
+    pthread_mutex_unlock(&cstream.mutex);
+}
+
+static void cr_stream_evict(void) {
+    const cg_memory_stats memory = cg_get_memory_stats();
+    if (memory.budget == 0 || memory.total <= memory.budget) { return; }
+
+    // Least recently used first, resources used since the last update stay
+    cstream_resource* candidates[CSTREAM_MAX_RESOURCES];
+    size_t count = 0;
+    for (uint32_t i = 0; i < CSTREAM_MAX_RESOURCES; i++) {
+        cstream_resource* resource = &cstream.resources[i];
+        if (!resource->live || resource->kind == CSTREAM_SHADER || resource->state != CSTREAM_READY) { continue; }
+        if (resource->last_used >= cstream.frame) { continue; }
+        candidates[count++] = resource;
+    }
+    qsort(candidates, count, sizeof(candidates[0]), cr_stream_compare_last_used);
+
+    size_t total = memory.total;
+    for (size_t i = 0; i < count && total > memory.budget; i++) {
+        cstream_resource* victim = candidates[i];
+        const size_t size = victim->kind == CSTREAM_MESH ? victim->object.bindings.size : victim->object.image.size;
+        cr_stream_destroy(victim);
+        victim->state = CSTREAM_EVICTED;
+        total -= size < total ? size : total;
+        cstream.stats.evicted++;
+        cstream.stats.evicted_bytes += size;
+    }
+}
+
+static void cr_stream_finish(cstream_resource* resource, bool success) {
+    cstream.uploading = NULL;
+    __atomic_sub_fetch(&cstream.pending, 1, __ATOMIC_RELAXED);
+
+    // Payloads are only needed until the upload, the counts stay for drawing
+    cr_free(resource->mesh.allocation);
+    resource->mesh.allocation = NULL;
+    resource->mesh.vertices = resource->mesh.indices = NULL;
+    cr_free(resource->image_allocation);
+    resource->image_allocation = NULL;
+    memset(resource->image.data, 0, sizeof(resource->image.data));
+
+    if (__atomic_load_n(&resource->cancelled, __ATOMIC_ACQUIRE)) {
+        cr_stream_destroy(resource);
+        cr_stream_free(resource);
+        return;
+    }
+
+    if (!success) {
+        cr_logf(CR_ERROR, "Failed to stream '%s'", resource->paths[0]);
+    }
+    resource->last_used = cstream.frame;
+    __atomic_store_n(&resource->state, success ? CSTREAM_READY : CSTREAM_FAILED, __ATOMIC_RELEASE);
+    cstream.stats.completed++;
+}
+
+static bool cr_stream_upload_mesh(cstream_resource* resource, size_t budget, size_t* uploaded) {
+    const cstream_mesh* mesh = &resource->mesh;
+
+    // Storage is allocated up front, the data follows in budgeted chunks
+    if (!resource->created) {
+        resource->object.bindings = cg_make_buffer(&(cg_buffer_conf){
+            .vertex_buffer = { .size = mesh->vertex_size },
+            .index_buffer = { .size = mesh->index_size }
+        });
+        resource->created = true;
+    }
+
+    const size_t total = mesh->vertex_size + mesh->index_size;
+    while (resource->uploaded < total && *uploaded < budget) {
+        // Vertices first, then indices, a chunk never spans both
+        const bool vertices = resource->uploaded < mesh->vertex_size;
+        const size_t region_offset = vertices ? resource->uploaded : resource->uploaded - mesh->vertex_size;
+        const size_t region_size = vertices ? mesh->vertex_size : mesh->index_size;
+        const char* source = (const char*)(vertices ? mesh->vertices : mesh->indices) + region_offset;
+        const GLuint target = vertices ? resource->object.bindings.vbo : resource->object.bindings.ebo;
+
+        size_t chunk = region_size - region_offset;
+        if (chunk > budget - *uploaded) { chunk = budget - *uploaded; }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+        if (cstream.staging.mapped) {
+            size_t offset;
+            chunk = cr_stream_reserve(chunk, &offset);
+            if (chunk == 0) { break; }
+
+            memcpy((char*)cstream.staging.mapped + offset, source, chunk);
+            glBindBuffer(GL_COPY_READ_BUFFER, cstream.staging.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLintptr)region_offset, (GLsizeiptr)chunk);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        } else {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)region_offset, (GLsizeiptr)chunk, source);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        resource->uploaded += chunk;
+        *uploaded += chunk;
+    }
+    return resource->uploaded == total;
+}
+
+static bool cr_stream_upload_image(cstream_resource* resource, size_t budget, size_t* uploaded) {
+    const cg_image_conf* conf = &resource->image;
+
+    // Storage is allocated up front, the levels follow in budgeted bands of rows
+    if (!resource->created) {
+        cg_image_conf storage = *conf;
+        memset(storage.data, 0, sizeof(storage.data));
+        resource->object.image = cg_make_image(&storage);
+        if (!resource->object.image.texture) { return true; }
+        resource->created = true;
+
+        for (int level = 0; level < resource->object.image.levels; level++) {
+            if (conf->data[level].data && cr_stream_image_level_size(resource, level) == 0) {
+                cr_logf(CR_ERROR, "Failed to stream '%s': level %d is truncated", resource->paths[0], level);
+                cr_stream_destroy(resource);
+                return true;
+            }
+        }
+    }
+
+    const cg_image* image = &resource->object.image;
+    size_t pixel_size;
+    int block;
+    GLenum internal_format, pixel_format, pixel_type;
+    pixel_format_info(image->format, &internal_format, &pixel_format, &pixel_type, &pixel_size, &block);
+
+    size_t total = 0;
+    for (int level = 0; level < image->levels; level++) {
+        total += cr_stream_image_level_size(resource, level);
+    }
+
+    glBindTexture(image->target, image->texture);
+    while (resource->uploaded < total && *uploaded < budget) {
+        // Find the level, layer and row the upload is at, a band never spans two layers
+        int level = 0;
+        size_t position = resource->uploaded;
+        while (position >= cr_stream_image_level_size(resource, level)) {
+            position -= cr_stream_image_level_size(resource, level++);
+        }
+
+        const size_t layer_size = cg_image_level_size(image, level);
+        const int width = (image->width >> level) > 0 ? image->width >> level : 1;
+        const int height = (image->height >> level) > 0 ? image->height >> level : 1;
+        const size_t row_size = (size_t)((width + block - 1) / block) * pixel_size;
+        const int rows = (height + block - 1) / block;
+        const int layer = (int)(position / layer_size);
+        const int row = (int)(position % layer_size / row_size);
+        const char* source = (const char*)conf->data[level].data + position;
+
+        // At least one row goes per update, so rows larger than the budget still progress
+        size_t band = (size_t)(rows - row);
+        const size_t affordable = (budget - *uploaded + row_size - 1) / row_size;
+        if (band > affordable) { band = affordable; }
+
+        if (cstream.staging.mapped && row_size <= cstream.staging.size) {
+            size_t offset;
+            band = cr_stream_reserve_rows(row_size, band, &offset);
+            if (band == 0) { break; }
+
+            memcpy((char*)cstream.staging.mapped + offset, source, band * row_size);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, cstream.staging.buffer);
+            upload_image_rows(image, level, layer, row, (int)band, (const void*)(uintptr_t)offset);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        } else {
+            upload_image_rows(image, level, layer, row, (int)band, source);
+        }
+
+        resource->uploaded += band * row_size;
+        *uploaded += band * row_size;
+    }
+
+    const bool done = resource->uploaded == total;
+    if (done && conf->generate_mipmaps && image->levels > 1 && pixel_type != 0) { glGenerateMipmap(image->target); }
+    glBindTexture(image->target, 0);
+    return done;
+}
+
+// Bytes of a level uploaded from the decoded data, zero for levels without
+// data and for levels shorter than their layers need
+static size_t cr_stream_image_level_size(const cstream_resource* resource, int level) {
+    const cg_image* image = &resource->object.image;
+    if (level >= image->levels || !resource->image.data[level].data) { return 0; }
+
+    const size_t size = cg_image_level_size(image, level) * (size_t)image->layers;
+    return resource->image.data[level].size >= size ? size : 0;
+}
+
+static size_t cr_stream_reserve(size_t size, size_t* offset) {
+    const size_t capacity = cstream.staging.size;
+    const size_t position = cstream.staging_head % capacity;
+    const size_t free_space = capacity - (cstream.staging_head - cstream.staging_tail);
+
+    // Chunks can be cut anywhere, so the ring never skips to wrap around
+    if (size > capacity - position) { size = capacity - position; }
+    if (size > free_space) { size = free_space; }
+
+    *offset = position;
+    cstream.staging_head += size;
+    return size;
+}
+
+static size_t cr_stream_reserve_rows(size_t row_size, size_t rows, size_t* offset) {
+    const size_t capacity = cstream.staging.size;
+    const size_t free_space = capacity - (cstream.staging_head - cstream.staging_tail);
+    size_t position = cstream.staging_head % capacity;
+
+    // Bands of rows are contiguous and start aligned for every pixel type, a
+    // row that does not fit before the end of the ring skips the remainder
+    size_t skip = (16 - position % 16) % 16;
+    if (position + skip + row_size > capacity) {
+        skip = capacity - position;
+        position = 0;
+    } else {
+        position += skip;
+    }
+    if (skip >= free_space) { return 0; }
+
+    size_t space = free_space - skip;
+    if (space > capacity - position) { space = capacity - position; }
+    if (rows > space / row_size) { rows = space / row_size; }
+    if (rows == 0) { return 0; }
+
+    *offset = position;
+    cstream.staging_head += skip + rows * row_size;
+    return rows;
+}
+
+static void cr_stream_retire(size_t keep) {
+    // Signaled fences are always retired, older ones are waited for until at
+    // most keep fences are left in flight
+    while (cstream.fence_head != cstream.fence_tail) {
+        cstream_fence* fence = &cstream.fences[cstream.fence_head % CSTREAM_MAX_FENCES];
+        const bool wait = cstream.fence_tail - cstream.fence_head > keep;
+        const GLenum status = glClientWaitSync(fence->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (wait) { continue; }
+            return;
+        }
+
+        // A failed wait leaves nothing to wait for, the fence is retired too
+        glDeleteSync(fence->fence);
+        cstream.staging_tail = fence->end;
+        cstream.fence_head++;
+    }
+}
+
+static bool cr_stream_decode_raw(casset_view source, cstream_mesh* mesh, void* user) {
+    (void)user;
+
+    // The asset is the vertex data itself and stays mapped, nothing to free
+    mesh->vertices = source.data;
+    mesh->vertex_size = source.size;
+    return source.size > 0;
+}
+
+static void cr_stream_touch(casset_view view) {
+    // Fault the pages in here so the GL thread never waits on the disk
+    volatile const char* data = (volatile const char*)view.data;
+    char sum = 0;
+    for (size_t offset = 0; offset < view.size; offset += 4096) {
+        sum ^= data[offset];
+    }
+    (void)sum;
+}
+
+static void* cr_stream_thread(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&cstream.mutex);
+        while (cstream.running && cstream.request_head == cstream.request_tail) {
+            pthread_cond_wait(&cstream.wake, &cstream.mutex);
+        }
+        if (!cstream.running) {
+            pthread_mutex_unlock(&cstream.mutex);
+            return NULL;
+        }
+        const uint32_t index = cstream.requests[cstream.request_head++ % CSTREAM_MAX_RESOURCES];
+        pthread_mutex_unlock(&cstream.mutex);
+
+        cstream_resource* resource = &cstream.resources[index];
+        if (!__atomic_load_n(&resource->cancelled, __ATOMIC_ACQUIRE)) {
+            if (resource->kind == CSTREAM_MESH) {
+                const casset_view source = cr_asset_get(resource->paths[0]);
+                resource->decoded = source.data && resource->decode(source, &resource->mesh, resource->user);
+            } else if (resource->kind == CSTREAM_IMAGE) {
+                resource->sources[0] = cr_asset_get(resource->paths[0]);
+                resource->decoded = resource->sources[0].data &&
+                    cg_decode_image(resource->sources[0], resource->paths[0], &resource->image, &resource->image_allocation);
+            } else {
+                resource->sources[0] = cr_asset_get(resource->paths[0]);
+                resource->sources[1] = cr_asset_get(resource->paths[1]);
+                resource->decoded = resource->sources[0].data && resource->sources[1].data;
+            }
+
+            if (resource->decoded) {
+                cr_stream_touch(resource->sources[0]);
+                cr_stream_touch(resource->sources[1]);
+                cr_stream_touch((casset_view){ (const char*)resource->mesh.vertices, resource->mesh.vertex_size });
+                cr_stream_touch((casset_view){ (const char*)resource->mesh.indices, resource->mesh.index_size });
+            }
+        }
+
+        pthread_mutex_lock(&cstream.mutex);
+        cstream.decoded[cstream.decoded_tail++ % CSTREAM_MAX_RESOURCES] = index;
+        pthread_mutex_unlock(&cstream.mutex);
+    }
+}
+
+static int cr_stream_compare_last_used(const void* a, const void* b) {
+    const uint64_t first = (*(cstream_resource* const*)a)->last_used;
+    const uint64_t second = (*(cstream_resource* const*)b)->last_used;
+    return (first > second) - (first < second);
+}
+
+static uint64_t cr_stream_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+#endif // CARRIER_STREAM_IMPLEMENTATION
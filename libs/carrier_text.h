@@ -0,0 +1,973 @@
+#ifndef CARRIER_TEXT_H
+#define CARRIER_TEXT_H
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_asset.h"
+#include "../libs/carrier_gfx.h"
+
+#define CTEXT_ATLAS_MAGIC 0x46445343u // "CSDF"
+#define CTEXT_ATLAS_VERSION 1
+#define CTEXT_CACHE_SIZE 256
+#define CTEXT_CURVE_STEPS 8
+#define CTEXT_MAX_COMPOSITE_DEPTH 8
+#define CTEXT_PROJ_LOCATION 0
+#define CTEXT_FALLBACK_CODEPOINT '?'
+
+// Configuration structure for the text module. Either a TrueType font or a
+// prebuilt atlas is loaded from the asset archive, the atlas wins if both are
+// set. Zero fields take the defaults.
+typedef struct {
+    const char* font;
+    const char* atlas;
+    float pixel_size;
+    int padding;
+    int atlas_size;
+    uint32_t first_codepoint;
+    uint32_t last_codepoint;
+} ctext_conf;
+
+// Glyph metrics in atlas pixels relative to the pen position on the baseline,
+// texture coordinates are normalized
+typedef struct {
+    uint32_t codepoint;
+    float x_offset, y_offset;
+    float width, height;
+    float advance;
+    float u0, v0, u1, v1;
+} ctext_glyph;
+
+// Prebuilt atlas header, followed by the glyphs sorted by codepoint and the
+// single channel distance field
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t glyph_count;
+    float pixel_size;
+    float ascent, descent, line_gap;
+} ctext_atlas_header;
+
+// Glyph instance, one quad of the instanced text draw
+typedef struct {
+    float rect[4];
+    float uv[4];
+    float color[4];
+} ctext_instance;
+
+// Cached layout of a string in atlas pixels, positioned at the origin
+typedef struct {
+    uint64_t hash;
+    char* text;
+    ctext_instance* glyphs;
+    size_t count;
+    float width, height;
+} ctext_layout;
+
+// Table offsets of a TrueType font, only used while building an atlas
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t head, hhea, hmtx, cmap, loca, glyf, maxp;
+} ctext_font;
+
+// Outline flattened to line segments in atlas pixels
+typedef struct {
+    float* points;
+    size_t count, capacity;
+} ctext_outline;
+
+// Text structure for the text module
+typedef struct {
+    ctext_glyph* glyphs;
+    size_t glyph_count;
+    float pixel_size;
+    float ascent, descent, line_gap;
+    float distance_range;
+
+    uint8_t* pixels;
+    int atlas_width, atlas_height;
+    GLuint texture;
+
+    cg_shader shader;
+    cg_pipeline pipeline;
+    GLuint vao, vbo;
+    size_t buffer_capacity;
+
+    ctext_instance* instances;
+    size_t instance_count, instance_capacity;
+
+    ctext_layout cache[CTEXT_CACHE_SIZE];
+} ctext_context;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_text_setup(const ctext_conf* conf);
+CARRIER_API void cg_text_shutdown(void);
+CARRIER_API void cg_text_draw(const char* text, float x, float y, float size, const float color[4]);
+CARRIER_API void cg_text_measure(const char* text, float size, float* width, float* height);
+CARRIER_API void cg_text_flush(float width, float height);
+CARRIER_API bool cg_text_save_atlas(const char* path);
+
+#endif // CARRIER_TEXT_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_TEXT_IMPLEMENTATION)
+#define CARRIER_TEXT_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static bool cg_text_load_atlas(const char* name);
+static bool cg_text_build_atlas(const char* name, const ctext_conf* conf);
+static bool cg_text_upload(void);
+static const ctext_layout* cg_text_layout(const char* text);
+static const ctext_glyph* cg_text_find_glyph(uint32_t codepoint);
+static uint32_t cg_text_decode(const char** text);
+static bool cg_text_reserve(size_t count);
+
+static bool cg_text_parse_font(const casset_view* view, ctext_font* font);
+static uint32_t cg_text_glyph_index(const ctext_font* font, uint32_t codepoint);
+static bool cg_text_outline(const ctext_font* font, uint32_t glyph, const float transform[6], int depth, ctext_outline* outline);
+static void cg_text_line(ctext_outline* outline, float x0, float y0, float x1, float y1);
+static void cg_text_distance_field(const ctext_outline* outline, uint8_t* pixels, int stride, int width, int height, float range);
+static uint32_t cg_text_u16(const uint8_t* p);
+static uint32_t cg_text_u32(const uint8_t* p);
+
+// Global variable to hold the text context
+static ctext_context ctext = {0};
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_text_setup(const ctext_conf* conf) {
+    cg_text_shutdown();
+
+    const bool loaded = conf->atlas ? cg_text_load_atlas(conf->atlas) : cg_text_build_atlas(conf->font, conf);
+    if (!loaded || !cg_text_upload()) {
+        cg_text_shutdown();
+        return false;
+    }
+
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier text module] (%zu glyphs)", ctext.glyph_count);
+    return true;
+}
+
+CARRIER_API void cg_text_shutdown(void) {
+    if (ctext.texture) {
+        cg_track_memory(CG_MEMORY_TEXTURE, (size_t)ctext.atlas_width * (size_t)ctext.atlas_height, false);
+        glDeleteTextures(1, &ctext.texture);
+    }
+    if (ctext.vbo) {
+        if (ctext.buffer_capacity > 0) { cg_track_memory(CG_MEMORY_GEOMETRY, ctext.buffer_capacity * sizeof(ctext_instance), false); }
+        glDeleteBuffers(1, &ctext.vbo);
+    }
+    if (ctext.vao) { glDeleteVertexArrays(1, &ctext.vao); }
+    if (ctext.shader.program) { cg_destroy_shader(ctext.shader); }
+
+    for (size_t i = 0; i < CTEXT_CACHE_SIZE; i++) {
+        cr_free(ctext.cache[i].text);
+        cr_free(ctext.cache[i].glyphs);
+    }
+
+    cr_free(ctext.glyphs);
+    cr_free(ctext.pixels);
+    cr_free(ctext.instances);
+    memset(&ctext, 0, sizeof(ctext));
+}
+
+CARRIER_API void cg_text_draw(const char* text, float x, float y, float size, const float color[4]) {
+    const ctext_layout* layout = cg_text_layout(text);
+    if (!layout || layout->count == 0) { return; }
+    if (!cg_text_reserve(ctext.instance_count + layout->count)) { return; }
+
+    const float scale = size / ctext.pixel_size;
+    ctext_instance* out = &ctext.instances[ctext.instance_count];
+
+    for (size_t i = 0; i < layout->count; i++) {
+        const ctext_instance* glyph = &layout->glyphs[i];
+        out[i].rect[0] = x + glyph->rect[0] * scale;
+        out[i].rect[1] = y + glyph->rect[1] * scale;
+        out[i].rect[2] = glyph->rect[2] * scale;
+        out[i].rect[3] = glyph->rect[3] * scale;
+        memcpy(out[i].uv, glyph->uv, sizeof(out[i].uv));
+        memcpy(out[i].color, color, sizeof(out[i].color));
+    }
+    ctext.instance_count += layout->count;
+}
+
+CARRIER_API void cg_text_measure(const char* text, float size, float* width, float* height) {
+    const ctext_layout* layout = cg_text_layout(text);
+    const float scale = ctext.pixel_size > 0.0f ? size / ctext.pixel_size : 0.0f;
+
+    if (width) { *width = layout ? layout->width * scale : 0.0f; }
+    if (height) { *height = layout ? layout->height * scale : 0.0f; }
+}
+
+CARRIER_API void cg_text_flush(float width, float height) {
+    if (ctext.instance_count == 0 || !ctext.texture) { return; }
+
+    // Orphan the buffer so the driver does not wait for the previous frame
+    glBindBuffer(GL_ARRAY_BUFFER, ctext.vbo);
+    if (ctext.instance_count > ctext.buffer_capacity) {
+        if (ctext.buffer_capacity > 0) { cg_track_memory(CG_MEMORY_GEOMETRY, ctext.buffer_capacity * sizeof(ctext_instance), false); }
+        ctext.buffer_capacity = ctext.instance_capacity;
+        cg_track_memory(CG_MEMORY_GEOMETRY, ctext.buffer_capacity * sizeof(ctext_instance), true);
+    }
+    glBufferData(GL_ARRAY_BUFFER, ctext.buffer_capacity * sizeof(ctext_instance), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, ctext.instance_count * sizeof(ctext_instance), ctext.instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mat4 projection;
+    glm_ortho(0.0f, width, height, 0.0f, -1.0f, 1.0f, projection);
+
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+    cg_set_depth_test(false);
+    cg_set_blend(true);
+
+    // The instance layout is not the one of cg_make_buffer, so the vertex
+    // array is the module's own and replays report the draw as missing
+    cg_bindings bindings = { ctext.vao, ctext.vbo, 0, 0 };
+    cg_apply_pipeline(&ctext.pipeline);
+    cg_set_uniform_mat4(CTEXT_PROJ_LOCATION, (GLfloat*)&projection[0]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, ctext.texture);
+    cg_apply_bindings(&bindings);
+    cg_render(&bindings, 0, 4, (int)ctext.instance_count);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    if (depth_test) { cg_set_depth_test(true); }
+    if (!blend) { cg_set_blend(false); }
+    ctext.instance_count = 0;
+}
+
+CARRIER_API bool cg_text_save_atlas(const char* path) {
+    if (!ctext.pixels) {
+        cr_log(CR_ERROR, "Failed to save text atlas: no atlas loaded");
+        return false;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        cr_logf(CR_ERROR, "Failed to open '%s' for writing", path);
+        return false;
+    }
+
+    const ctext_atlas_header header = {
+        CTEXT_ATLAS_MAGIC, CTEXT_ATLAS_VERSION,
+        (uint32_t)ctext.atlas_width, (uint32_t)ctext.atlas_height,
+        (uint32_t)ctext.glyph_count, ctext.pixel_size,
+        ctext.ascent, ctext.descent, ctext.line_gap
+    };
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(ctext.glyphs, sizeof(ctext_glyph), ctext.glyph_count, file);
+    fwrite(ctext.pixels, 1, (size_t)ctext.atlas_width * (size_t)ctext.atlas_height, file);
+
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed) {
+        cr_logf(CR_ERROR, "Failed to write '%s'", path);
+        return false;
+    }
+    return true;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static bool cg_text_load_atlas(const char* name) {
+    const casset_view view = cr_asset_get(name);
+    if (!view.data) { return false; }
+
+    const ctext_atlas_header* header = (const ctext_atlas_header*)view.data;
+    if (view.size < sizeof(ctext_atlas_header) || header->magic != CTEXT_ATLAS_MAGIC ||
+        header->version != CTEXT_ATLAS_VERSION || header->pixel_size <= 0.0f) {
+        cr_log(CR_ERROR, "Failed to load text atlas: invalid header");
+        return false;
+    }
+
+    const size_t glyph_bytes = (size_t)header->glyph_count * sizeof(ctext_glyph);
+    const size_t pixel_bytes = (size_t)header->width * (size_t)header->height;
+    if (view.size < sizeof(ctext_atlas_header) + glyph_bytes + pixel_bytes) {
+        cr_log(CR_ERROR, "Failed to load text atlas: truncated file");
+        return false;
+    }
+
+    ctext.glyphs = (ctext_glyph*)cr_alloc(glyph_bytes > 0 ? glyph_bytes : 1);
+    ctext.pixels = (uint8_t*)cr_alloc(pixel_bytes > 0 ? pixel_bytes : 1);
+    if (!ctext.glyphs || !ctext.pixels) {
+        cr_log(CR_ERROR, "Failed to allocate memory for text atlas");
+        return false;
+    }
+
+    memcpy(ctext.glyphs, header + 1, glyph_bytes);
+    memcpy(ctext.pixels, (const char*)(header + 1) + glyph_bytes, pixel_bytes);
+
+    for (size_t i = 1; i < header->glyph_count; i++) {
+        if (ctext.glyphs[i].codepoint <= ctext.glyphs[i - 1].codepoint) {
+            cr_log(CR_ERROR, "Failed to load text atlas: glyphs not sorted");
+            return false;
+        }
+    }
+
+    ctext.glyph_count = header->glyph_count;
+    ctext.atlas_width = (int)header->width;
+    ctext.atlas_height = (int)header->height;
+    ctext.pixel_size = header->pixel_size;
+    ctext.ascent = header->ascent;
+    ctext.descent = header->descent;
+    ctext.line_gap = header->line_gap;
+    return true;
+}
+
+static bool cg_text_build_atlas(const char* name, const ctext_conf* conf) {
+    if (!name) {
+        cr_log(CR_ERROR, "Failed to initialize text: no font or atlas given");
+        return false;
+    }
+
+    const casset_view view = cr_asset_get(name);
+    if (!view.data) { return false; }
+
+    ctext_font font;
+    if (!cg_text_parse_font(&view, &font)) {
+        cr_logf(CR_ERROR, "Failed to load font '%s': missing or invalid tables", name);
+        return false;
+    }
+
+    const float units_per_em = (float)cg_text_u16(font.data + font.head + 18);
+    const uint32_t metric_count = cg_text_u16(font.data + font.hhea + 34);
+    if (units_per_em <= 0.0f || metric_count == 0 || font.hmtx + (size_t)metric_count * 4 > font.size) {
+        cr_logf(CR_ERROR, "Failed to load font '%s': invalid metrics", name);
+        return false;
+    }
+
+    ctext.pixel_size = conf->pixel_size > 0.0f ? conf->pixel_size : 32.0f;
+    const int padding = conf->padding > 0 ? conf->padding : 4;
+    const float scale = ctext.pixel_size / units_per_em;
+    ctext.ascent = (float)(int16_t)cg_text_u16(font.data + font.hhea + 4) * scale;
+    ctext.descent = (float)(int16_t)cg_text_u16(font.data + font.hhea + 6) * scale;
+    ctext.line_gap = (float)(int16_t)cg_text_u16(font.data + font.hhea + 8) * scale;
+
+    const uint32_t first = conf->first_codepoint ? conf->first_codepoint : 32;
+    const uint32_t last = conf->last_codepoint ? conf->last_codepoint : 126;
+    if (last < first) {
+        cr_log(CR_ERROR, "Failed to build text atlas: invalid codepoint range");
+        return false;
+    }
+
+    ctext.atlas_width = ctext.atlas_height = conf->atlas_size > 0 ? conf->atlas_size : 512;
+    ctext.glyphs = (ctext_glyph*)cr_alloc((size_t)(last - first + 1) * sizeof(ctext_glyph));
+    ctext.pixels = (uint8_t*)cr_calloc((size_t)ctext.atlas_width * (size_t)ctext.atlas_height, 1);
+    if (!ctext.glyphs || !ctext.pixels) {
+        cr_log(CR_ERROR, "Failed to allocate memory for text atlas");
+        return false;
+    }
+
+    // Shelf-pack the glyphs left to right, starting a new row when full
+    ctext_outline outline = {0};
+    int pen_x = 0, pen_y = 0, row_height = 0;
+    bool failed = false;
+
+    for (uint32_t codepoint = first; codepoint <= last; codepoint++) {
+        const uint32_t index = cg_text_glyph_index(&font, codepoint);
+        if (index == 0 && codepoint != CTEXT_FALLBACK_CODEPOINT) { continue; }
+
+        const size_t metric = font.hmtx + (size_t)(index < metric_count ? index : metric_count - 1u) * 4;
+        ctext_glyph* glyph = &ctext.glyphs[ctext.glyph_count++];
+        memset(glyph, 0, sizeof(*glyph));
+        glyph->codepoint = codepoint;
+        glyph->advance = (float)cg_text_u16(font.data + metric) * scale;
+
+        // Flatten in font units first to find the bounds
+        const float identity[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+        outline.count = 0;
+        if (!cg_text_outline(&font, index, identity, 0, &outline)) {
+            failed = true;
+            break;
+        }
+        if (outline.count == 0) { continue; }
+
+        float min_x = outline.points[0], max_x = outline.points[0];
+        float min_y = outline.points[1], max_y = outline.points[1];
+        for (size_t i = 0; i < outline.count * 2; i++) {
+            const float x = outline.points[i * 2], y = outline.points[i * 2 + 1];
+            min_x = fminf(min_x, x); max_x = fmaxf(max_x, x);
+            min_y = fminf(min_y, y); max_y = fmaxf(max_y, y);
+        }
+
+        const int width = (int)ceilf((max_x - min_x) * scale) + padding * 2;
+        const int height = (int)ceilf((max_y - min_y) * scale) + padding * 2;
+
+        if (pen_x + width > ctext.atlas_width) {
+            pen_x = 0;
+            pen_y += row_height;
+            row_height = 0;
+        }
+        if (pen_y + height > ctext.atlas_height || width > ctext.atlas_width) {
+            cr_log(CR_ERROR, "Failed to build text atlas: atlas too small");
+            failed = true;
+            break;
+        }
+
+        // Move the outline into the glyph cell, rows grow downwards
+        for (size_t i = 0; i < outline.count * 2; i++) {
+            float* point = &outline.points[i * 2];
+            point[0] = (point[0] - min_x) * scale + (float)padding;
+            point[1] = (max_y - point[1]) * scale + (float)padding;
+        }
+        cg_text_distance_field(&outline, ctext.pixels + (size_t)pen_y * (size_t)ctext.atlas_width + (size_t)pen_x,
+                               ctext.atlas_width, width, height, (float)padding);
+
+        glyph->x_offset = min_x * scale - (float)padding;
+        glyph->y_offset = -(max_y * scale + (float)padding);
+        glyph->width = (float)width;
+        glyph->height = (float)height;
+        glyph->u0 = (float)pen_x / (float)ctext.atlas_width;
+        glyph->v0 = (float)pen_y / (float)ctext.atlas_height;
+        glyph->u1 = (float)(pen_x + width) / (float)ctext.atlas_width;
+        glyph->v1 = (float)(pen_y + height) / (float)ctext.atlas_height;
+
+        pen_x += width;
+        if (height > row_height) { row_height = height; }
+    }
+
+    cr_free(outline.points);
+    ctext.distance_range = (float)padding;
+    return !failed;
+}
+
+static bool cg_text_upload(void) {
+    ctext.shader = cg_load_shader("shaders/text.vert", "shaders/text.frag");
+    if (!ctext.shader.program) { return false; }
+    ctext.pipeline = cg_make_pipeline(&(cg_pipeline_conf){ .shader = ctext.shader, .primitive_type = GL_TRIANGLE_STRIP });
+
+    glGenTextures(1, &ctext.texture);
+    glBindTexture(GL_TEXTURE_2D, ctext.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ctext.atlas_width, ctext.atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, ctext.pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    cg_track_memory(CG_MEMORY_TEXTURE, (size_t)ctext.atlas_width * (size_t)ctext.atlas_height, true);
+
+    // Quads are expanded from gl_VertexID, the only attributes are per instance
+    glGenVertexArrays(1, &ctext.vao);
+    glGenBuffers(1, &ctext.vbo);
+    glBindVertexArray(ctext.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, ctext.vbo);
+
+    for (GLuint i = 0; i < 3; i++) {
+        glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(ctext_instance), (void*)(i * 4 * sizeof(float)));
+        glVertexAttribDivisor(i, 1);
+        glEnableVertexAttribArray(i);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return true;
+}
+
+static const ctext_layout* cg_text_layout(const char* text) {
+    if (!ctext.glyphs) { return NULL; }
+
+    const size_t length = strlen(text);
+    const uint64_t hash = cr_asset_hash(text, length);
+    ctext_layout* layout = &ctext.cache[hash & (CTEXT_CACHE_SIZE - 1)];
+
+    if (layout->text && layout->hash == hash && strcmp(layout->text, text) == 0) {
+        return layout;
+    }
+
+    // Direct-mapped cache, a colliding string replaces the previous layout
+    char* copy = (char*)cr_alloc(length + 1);
+    ctext_instance* glyphs = (ctext_instance*)cr_alloc((length > 0 ? length : 1) * sizeof(ctext_instance));
+    if (!copy || !glyphs) {
+        cr_free(copy);
+        cr_free(glyphs);
+        cr_log(CR_ERROR, "Failed to allocate memory for text layout");
+        return NULL;
+    }
+    memcpy(copy, text, length + 1);
+
+    cr_free(layout->text);
+    cr_free(layout->glyphs);
+    layout->hash = hash;
+    layout->text = copy;
+    layout->glyphs = glyphs;
+    layout->count = 0;
+
+    const float line_height = ctext.ascent - ctext.descent + ctext.line_gap;
+    float pen_x = 0.0f, baseline = ctext.ascent, width = 0.0f;
+    const char* cursor = text;
+
+    while (*cursor) {
+        const uint32_t codepoint = cg_text_decode(&cursor);
+
+        if (codepoint == '\n') {
+            if (pen_x > width) { width = pen_x; }
+            pen_x = 0.0f;
+            baseline += line_height;
+            continue;
+        }
+
+        const ctext_glyph* glyph = cg_text_find_glyph(codepoint);
+        if (!glyph) { glyph = cg_text_find_glyph(CTEXT_FALLBACK_CODEPOINT); }
+        if (!glyph) { continue; }
+
+        if (glyph->width > 0.0f) {
+            ctext_instance* instance = &layout->glyphs[layout->count++];
+            instance->rect[0] = pen_x + glyph->x_offset;
+            instance->rect[1] = baseline + glyph->y_offset;
+            instance->rect[2] = glyph->width;
+            instance->rect[3] = glyph->height;
+            instance->uv[0] = glyph->u0;
+            instance->uv[1] = glyph->v0;
+            instance->uv[2] = glyph->u1;
+            instance->uv[3] = glyph->v1;
+        }
+        pen_x += glyph->advance;
+    }
+
+    layout->width = pen_x > width ? pen_x : width;
+    layout->height = baseline - ctext.descent;
+    return layout;
+}
+
+static const ctext_glyph* cg_text_find_glyph(uint32_t codepoint) {
+    size_t low = 0, high = ctext.glyph_count;
+
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (ctext.glyphs[mid].codepoint < codepoint) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < ctext.glyph_count && ctext.glyphs[low].codepoint == codepoint ? &ctext.glyphs[low] : NULL;
+}
+
+static uint32_t cg_text_decode(const char** text) {
+    const unsigned char* s = (const unsigned char*)*text;
+    uint32_t codepoint;
+    int extra;
+
+    if (s[0] < 0x80) { codepoint = s[0]; extra = 0; }
+    else if ((s[0] & 0xE0) == 0xC0) { codepoint = s[0] & 0x1Fu; extra = 1; }
+    else if ((s[0] & 0xF0) == 0xE0) { codepoint = s[0] & 0x0Fu; extra = 2; }
+    else if ((s[0] & 0xF8) == 0xF0) { codepoint = s[0] & 0x07u; extra = 3; }
+    else {
+        *text += 1;
+        return 0xFFFD;
+    }
+
+    for (int i = 1; i <= extra; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *text += i;
+            return 0xFFFD;
+        }
+        codepoint = codepoint << 6 | (s[i] & 0x3Fu);
+    }
+
+    *text += extra + 1;
+    return codepoint;
+}
+
+static bool cg_text_reserve(size_t count) {
+    if (count <= ctext.instance_capacity) { return true; }
+
+    size_t capacity = ctext.instance_capacity > 0 ? ctext.instance_capacity : 1024;
+    while (capacity < count) { capacity *= 2; }
+
+    ctext_instance* instances = (ctext_instance*)cr_realloc(ctext.instances, capacity * sizeof(ctext_instance));
+    if (!instances) {
+        cr_log(CR_ERROR, "Failed to allocate memory for text instances");
+        return false;
+    }
+
+    ctext.instances = instances;
+    ctext.instance_capacity = capacity;
+    return true;
+}
+
+static bool cg_text_parse_font(const casset_view* view, ctext_font* font) {
+    memset(font, 0, sizeof(*font));
+    font->data = (const uint8_t*)view->data;
+    font->size = view->size;
+    if (font->size < 12) { return false; }
+
+    const uint32_t table_count = cg_text_u16(font->data + 4);
+    for (uint32_t i = 0; i < table_count && 12 + (size_t)(i + 1) * 16 <= font->size; i++) {
+        const uint8_t* record = font->data + 12 + (size_t)i * 16;
+        const size_t offset = cg_text_u32(record + 8);
+        if (offset >= font->size) { continue; }
+
+        if (memcmp(record, "head", 4) == 0) { font->head = offset; }
+        else if (memcmp(record, "hhea", 4) == 0) { font->hhea = offset; }
+        else if (memcmp(record, "hmtx", 4) == 0) { font->hmtx = offset; }
+        else if (memcmp(record, "cmap", 4) == 0) { font->cmap = offset; }
+        else if (memcmp(record, "loca", 4) == 0) { font->loca = offset; }
+        else if (memcmp(record, "glyf", 4) == 0) { font->glyf = offset; }
+        else if (memcmp(record, "maxp", 4) == 0) { font->maxp = offset; }
+    }
+
+    return font->head && font->hhea && font->hmtx && font->cmap && font->loca && font->glyf && font->maxp &&
+           font->head + 54 <= font->size && font->hhea + 36 <= font->size &&
+           font->maxp + 6 <= font->size && font->cmap + 4 <= font->size;
+}
+
+static uint32_t cg_text_glyph_index(const ctext_font* font, uint32_t codepoint) {
+    const uint8_t* data = font->data;
+    const size_t size = font->size;
+    const size_t cmap = font->cmap;
+    const uint32_t subtable_count = cg_text_u16(data + cmap + 2);
+    size_t format4 = 0, format12 = 0;
+
+    // Prefer the full Unicode subtable and fall back to the BMP one
+    for (uint32_t i = 0; i < subtable_count && cmap + 4 + (size_t)(i + 1) * 8 <= size; i++) {
+        const uint8_t* record = data + cmap + 4 + (size_t)i * 8;
+        const uint32_t platform = cg_text_u16(record), encoding = cg_text_u16(record + 2);
+        const size_t offset = cmap + cg_text_u32(record + 4);
+        if (offset + 16 > size || (platform != 0 && !(platform == 3 && (encoding == 1 || encoding == 10)))) { continue; }
+
+        const uint32_t format = cg_text_u16(data + offset);
+        if (format == 12) { format12 = offset; }
+        else if (format == 4) { format4 = offset; }
+    }
+
+    if (format12) {
+        const uint32_t group_count = cg_text_u32(data + format12 + 12);
+        for (uint32_t i = 0; i < group_count && format12 + 16 + (size_t)(i + 1) * 12 <= size; i++) {
+            const uint8_t* group = data + format12 + 16 + (size_t)i * 12;
+            if (codepoint >= cg_text_u32(group) && codepoint <= cg_text_u32(group + 4)) {
+                return cg_text_u32(group + 8) + (codepoint - cg_text_u32(group));
+            }
+        }
+        return 0;
+    }
+
+    if (format4 && codepoint <= 0xFFFF) {
+        const uint32_t segment_count = cg_text_u16(data + format4 + 6) / 2;
+        const size_t ends = format4 + 14;
+        const size_t starts = ends + segment_count * 2 + 2;
+        const size_t deltas = starts + segment_count * 2;
+        const size_t ranges = deltas + segment_count * 2;
+        if (ranges + segment_count * 2 > size) { return 0; }
+
+        for (uint32_t i = 0; i < segment_count; i++) {
+            if (cg_text_u16(data + ends + i * 2) < codepoint) { continue; }
+
+            const uint32_t start = cg_text_u16(data + starts + i * 2);
+            if (start > codepoint) { return 0; }
+
+            const uint32_t delta = cg_text_u16(data + deltas + i * 2);
+            const uint32_t range = cg_text_u16(data + ranges + i * 2);
+            if (range == 0) { return (codepoint + delta) & 0xFFFFu; }
+
+            const size_t address = ranges + i * 2 + range + (codepoint - start) * 2;
+            if (address + 2 > size) { return 0; }
+            const uint32_t index = cg_text_u16(data + address);
+            return index ? (index + delta) & 0xFFFFu : 0;
+        }
+    }
+    return 0;
+}
+
+static bool cg_text_outline(const ctext_font* font, uint32_t glyph, const float transform[6], int depth, ctext_outline* outline) {
+    const uint8_t* data = font->data;
+    const size_t size = font->size;
+    if (glyph >= cg_text_u16(data + font->maxp + 4)) { return true; }
+
+    // Locate the glyph, an empty range means no outline (e.g. space)
+    const bool long_offsets = cg_text_u16(data + font->head + 50) != 0;
+    const size_t entry = font->loca + (size_t)glyph * (long_offsets ? 4 : 2);
+    if (entry + (long_offsets ? 8 : 4) > size) { return false; }
+
+    const size_t start = font->glyf + (long_offsets ? cg_text_u32(data + entry) : cg_text_u16(data + entry) * 2u);
+    const size_t end = font->glyf + (long_offsets ? cg_text_u32(data + entry + 4) : cg_text_u16(data + entry + 2) * 2u);
+    if (end <= start) { return true; }
+    if (end > size || start + 10 > end) { return false; }
+
+    const uint8_t* p = data + start;
+    const uint8_t* limit = data + end;
+    const int16_t contour_count = (int16_t)cg_text_u16(p);
+
+    if (contour_count < 0) {
+        // Composite glyph, every component is an affine transformed glyph
+        if (depth >= CTEXT_MAX_COMPOSITE_DEPTH) { return false; }
+        p += 10;
+
+        uint32_t flags;
+        do {
+            if (p + 4 > limit) { return false; }
+            flags = cg_text_u16(p);
+            const uint32_t component = cg_text_u16(p + 2);
+            p += 4;
+
+            float dx, dy;
+            if (flags & 0x0001) {
+                if (p + 4 > limit) { return false; }
+                dx = (float)(int16_t)cg_text_u16(p);
+                dy = (float)(int16_t)cg_text_u16(p + 2);
+                p += 4;
+            } else {
+                if (p + 2 > limit) { return false; }
+                dx = (float)(int8_t)p[0];
+                dy = (float)(int8_t)p[1];
+                p += 2;
+            }
+
+            float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+            if (flags & 0x0008) {
+                if (p + 2 > limit) { return false; }
+                a = d = (float)(int16_t)cg_text_u16(p) / 16384.0f;
+                p += 2;
+            } else if (flags & 0x0040) {
+                if (p + 4 > limit) { return false; }
+                a = (float)(int16_t)cg_text_u16(p) / 16384.0f;
+                d = (float)(int16_t)cg_text_u16(p + 2) / 16384.0f;
+                p += 4;
+            } else if (flags & 0x0080) {
+                if (p + 8 > limit) { return false; }
+                a = (float)(int16_t)cg_text_u16(p) / 16384.0f;
+                b = (float)(int16_t)cg_text_u16(p + 2) / 16384.0f;
+                c = (float)(int16_t)cg_text_u16(p + 4) / 16384.0f;
+                d = (float)(int16_t)cg_text_u16(p + 6) / 16384.0f;
+                p += 8;
+            }
+
+            // Point matching offsets are rare and not supported
+            if (!(flags & 0x0002)) { dx = dy = 0.0f; }
+
+            const float combined[6] = {
+                transform[0] * a + transform[2] * b, transform[1] * a + transform[3] * b,
+                transform[0] * c + transform[2] * d, transform[1] * c + transform[3] * d,
+                transform[0] * dx + transform[2] * dy + transform[4], transform[1] * dx + transform[3] * dy + transform[5]
+            };
+            if (!cg_text_outline(font, component, combined, depth + 1, outline)) { return false; }
+        } while (flags & 0x0020);
+        return true;
+    }
+
+    // Simple glyph: contour ends, instructions, then flags and packed deltas
+    const uint8_t* ends = p + 10;
+    if (ends + contour_count * 2 + 2 > limit) { return false; }
+    const uint32_t point_count = contour_count > 0 ? cg_text_u16(ends + (contour_count - 1) * 2) + 1u : 0u;
+    p = ends + contour_count * 2;
+    p += 2 + cg_text_u16(p);
+
+    uint8_t* flags = (uint8_t*)cr_alloc(point_count > 0 ? point_count : 1);
+    float* points = (float*)cr_alloc((point_count > 0 ? point_count : 1) * 2 * sizeof(float));
+    if (!flags || !points) {
+        cr_free(flags);
+        cr_free(points);
+        return false;
+    }
+
+    bool valid = true;
+    for (uint32_t i = 0; i < point_count && valid;) {
+        if (p >= limit) { valid = false; break; }
+        const uint8_t flag = *p++;
+        uint32_t repeat = 0;
+        if (flag & 0x08) {
+            if (p >= limit) { valid = false; break; }
+            repeat = *p++;
+        }
+        for (uint32_t r = 0; r <= repeat && i < point_count; r++) { flags[i++] = flag; }
+    }
+
+    for (int axis = 0; axis < 2 && valid; axis++) {
+        const uint8_t short_bit = axis == 0 ? 0x02 : 0x04;
+        const uint8_t same_bit = axis == 0 ? 0x10 : 0x20;
+        int32_t value = 0;
+
+        for (uint32_t i = 0; i < point_count; i++) {
+            if (flags[i] & short_bit) {
+                if (p + 1 > limit) { valid = false; break; }
+                value += (flags[i] & same_bit) ? *p : -(int32_t)*p;
+                p += 1;
+            } else if (!(flags[i] & same_bit)) {
+                if (p + 2 > limit) { valid = false; break; }
+                value += (int16_t)cg_text_u16(p);
+                p += 2;
+            }
+            points[i * 2 + axis] = (float)value;
+        }
+    }
+
+    for (uint32_t i = 0; i < point_count && valid; i++) {
+        const float x = points[i * 2], y = points[i * 2 + 1];
+        points[i * 2] = transform[0] * x + transform[2] * y + transform[4];
+        points[i * 2 + 1] = transform[1] * x + transform[3] * y + transform[5];
+    }
+
+    // Walk every contour, two consecutive off-curve points imply an on-curve
+    // point half way between them
+    uint32_t first = 0;
+    for (int contour = 0; contour < contour_count && valid; contour++) {
+        const uint32_t last = cg_text_u16(ends + contour * 2);
+        if (last < first || last >= point_count) { valid = false; break; }
+        const uint32_t count = last - first + 1;
+
+        uint32_t origin = first;
+        while (origin <= last && !(flags[origin] & 0x01)) { origin++; }
+
+        float start_x, start_y;
+        if (origin > last) {
+            start_x = (points[first * 2] + points[(first + (count > 1)) * 2]) * 0.5f;
+            start_y = (points[first * 2 + 1] + points[(first + (count > 1)) * 2 + 1]) * 0.5f;
+            origin = first;
+        } else {
+            start_x = points[origin * 2];
+            start_y = points[origin * 2 + 1];
+        }
+
+        float x = start_x, y = start_y;
+        float control_x = 0.0f, control_y = 0.0f;
+        bool has_control = false;
+
+        for (uint32_t step = 1; step <= count; step++) {
+            const uint32_t i = first + (origin - first + step) % count;
+            const float px = points[i * 2], py = points[i * 2 + 1];
+
+            if (!(flags[i] & 0x01)) {
+                if (has_control) {
+                    const float mid_x = (control_x + px) * 0.5f, mid_y = (control_y + py) * 0.5f;
+                    for (int s = 1; s <= CTEXT_CURVE_STEPS; s++) {
+                        const float t = (float)s / CTEXT_CURVE_STEPS, u = 1.0f - t;
+                        const float nx = u * u * x + 2.0f * u * t * control_x + t * t * mid_x;
+                        const float ny = u * u * y + 2.0f * u * t * control_y + t * t * mid_y;
+                        cg_text_line(outline, x, y, nx, ny);
+                        x = nx;
+                        y = ny;
+                    }
+                }
+                control_x = px;
+                control_y = py;
+                has_control = true;
+                continue;
+            }
+
+            if (has_control) {
+                for (int s = 1; s <= CTEXT_CURVE_STEPS; s++) {
+                    const float t = (float)s / CTEXT_CURVE_STEPS, u = 1.0f - t;
+                    const float nx = u * u * x + 2.0f * u * t * control_x + t * t * px;
+                    const float ny = u * u * y + 2.0f * u * t * control_y + t * t * py;
+                    cg_text_line(outline, x, y, nx, ny);
+                    x = nx;
+                    y = ny;
+                }
+                has_control = false;
+            } else {
+                cg_text_line(outline, x, y, px, py);
+                x = px;
+                y = py;
+            }
+        }
+
+        // Close the contour back to its starting point
+        if (has_control) {
+            for (int s = 1; s <= CTEXT_CURVE_STEPS; s++) {
+                const float t = (float)s / CTEXT_CURVE_STEPS, u = 1.0f - t;
+                const float nx = u * u * x + 2.0f * u * t * control_x + t * t * start_x;
+                const float ny = u * u * y + 2.0f * u * t * control_y + t * t * start_y;
+                cg_text_line(outline, x, y, nx, ny);
+                x = nx;
+                y = ny;
+            }
+        } else if (x != start_x || y != start_y) {
+            cg_text_line(outline, x, y, start_x, start_y);
+        }
+        first = last + 1;
+    }
+
+    cr_free(flags);
+    cr_free(points);
+    if (!valid) { cr_log(CR_ERROR, "Failed to load font: corrupt glyph"); }
+    return valid;
+}
+
+static void cg_text_line(ctext_outline* outline, float x0, float y0, float x1, float y1) {
+    if (outline->count == outline->capacity) {
+        const size_t capacity = outline->capacity > 0 ? outline->capacity * 2 : 256;
+        float* points = (float*)cr_realloc(outline->points, capacity * 4 * sizeof(float));
+        if (!points) { return; }
+        outline->points = points;
+        outline->capacity = capacity;
+    }
+
+    float* segment = &outline->points[outline->count++ * 4];
+    segment[0] = x0;
+    segment[1] = y0;
+    segment[2] = x1;
+    segment[3] = y1;
+}
+
+static void cg_text_distance_field(const ctext_outline* outline, uint8_t* pixels, int stride, int width, int height, float range) {
+    for (int row = 0; row < height; row++) {
+        for (int column = 0; column < width; column++) {
+            const float px = (float)column + 0.5f, py = (float)row + 0.5f;
+            float nearest = range * range;
+            int winding = 0;
+
+            for (size_t i = 0; i < outline->count; i++) {
+                const float* s = &outline->points[i * 4];
+                const float ex = s[2] - s[0], ey = s[3] - s[1];
+                const float wx = px - s[0], wy = py - s[1];
+
+                // Squared distance to the segment
+                const float length = ex * ex + ey * ey;
+                float t = length > 0.0f ? (wx * ex + wy * ey) / length : 0.0f;
+                t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+                const float dx = wx - ex * t, dy = wy - ey * t;
+                const float distance = dx * dx + dy * dy;
+                if (distance < nearest) { nearest = distance; }
+
+                // Non-zero winding number decides the sign
+                const float cross = ex * wy - wx * ey;
+                if (s[1] <= py) {
+                    if (s[3] > py && cross > 0.0f) { winding++; }
+                } else if (s[3] <= py && cross < 0.0f) {
+                    winding--;
+                }
+            }
+
+            // Map [-range, range] to [0, 1] with the outline at 0.5
+            const float signed_distance = winding != 0 ? sqrtf(nearest) : -sqrtf(nearest);
+            const float value = 0.5f + signed_distance / (2.0f * range);
+            pixels[(size_t)row * (size_t)stride + (size_t)column] = (uint8_t)(fminf(fmaxf(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+static uint32_t cg_text_u16(const uint8_t* p) {
+    return (uint32_t)p[0] << 8 | p[1];
+}
+
+static uint32_t cg_text_u32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+#endif // CARRIER_TEXT_IMPLEMENTATION
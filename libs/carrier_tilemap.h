@@ -0,0 +1,303 @@
+#ifndef CARRIER_TILEMAP_H
+#define CARRIER_TILEMAP_H
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_gfx.h"
+
+// Chunk edge length in tiles, must match shaders/tilemap.vert
+#define CTILEMAP_CHUNK_SIZE 32
+#define CTILEMAP_CHUNK_TILES (CTILEMAP_CHUNK_SIZE * CTILEMAP_CHUNK_SIZE)
+
+// Tile id that is never drawn
+#define CTILEMAP_EMPTY 0
+
+// Uniform locations, fixed by explicit layout qualifiers in the shaders
+#define CTILEMAP_VIEW_PROJ_LOCATION 0
+#define CTILEMAP_ORIGIN_LOCATION 1
+#define CTILEMAP_TILE_SIZE_LOCATION 2
+#define CTILEMAP_CHUNKS_X_LOCATION 3
+
+// Configuration structure for the tilemap module, palette[i] is the color of
+// tile id i and ids past the end of the palette use its last entry
+typedef struct {
+    uint32_t width, height;
+    float tile_size;
+    vec2 origin;
+    const vec4* palette;
+    size_t palette_size;
+} ctilemap_conf;
+
+// Chunk bookkeeping, count is the number of packed tiles in its GPU slot
+typedef struct {
+    uint32_t count;
+    bool dirty;
+} ctilemap_chunk;
+
+// Indirect draw command, layout defined by glMultiDrawArraysIndirect
+typedef struct {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first;
+    uint32_t base_instance;
+} ctilemap_command;
+
+// Counters of the last render
+typedef struct {
+    uint32_t visible_chunks;
+    uint32_t rebuilt_chunks;
+    uint32_t drawn_tiles;
+} ctilemap_stats;
+
+// Tilemap split into square chunks. Every chunk owns a fixed slot of the
+// instance buffer that is only rewritten when one of its tiles changes.
+typedef struct {
+    uint32_t width, height;
+    uint32_t chunks_x, chunks_y;
+    float tile_size;
+    vec2 origin;
+    uint16_t* tiles;
+    ctilemap_chunk* chunks;
+    ctilemap_command* commands;
+    cg_storage_buffer instances;
+    cg_storage_buffer palette;
+    cg_storage_buffer indirect;
+    cg_pipeline pipeline;
+    cg_bindings quad;
+    cg_shader shader;
+    ctilemap_stats stats;
+} ctilemap_map;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_tilemap_init(ctilemap_map* map, const ctilemap_conf* conf);
+CARRIER_API void cg_tilemap_shutdown(ctilemap_map* map);
+CARRIER_API void cg_tilemap_set(ctilemap_map* map, uint32_t x, uint32_t y, uint16_t tile);
+CARRIER_API uint16_t cg_tilemap_get(const ctilemap_map* map, uint32_t x, uint32_t y);
+CARRIER_API void cg_tilemap_load(ctilemap_map* map, const uint16_t* tiles);
+CARRIER_API void cg_tilemap_set_palette(ctilemap_map* map, const vec4* palette, size_t palette_size);
+CARRIER_API void cg_tilemap_render(ctilemap_map* map, const float* view_projection, float left, float right, float bottom, float top);
+
+#endif // CARRIER_TILEMAP_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_TILEMAP_IMPLEMENTATION)
+#define CARRIER_TILEMAP_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static void rebuild_chunk(ctilemap_map* map, uint32_t chunk);
+static bool chunk_span(float low, float high, float origin, float chunk_extent, uint32_t chunks, uint32_t* first, uint32_t* last);
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API bool cg_tilemap_init(ctilemap_map* map, const ctilemap_conf* conf) {
+    memset(map, 0, sizeof(*map));
+
+    if (conf->width == 0 || conf->height == 0) {
+        cr_log(CR_ERROR, "Failed to initialize tilemap: empty map");
+        return false;
+    }
+
+    if (!GLEW_VERSION_4_3 || (!GLEW_VERSION_4_6 && !GLEW_ARB_shader_draw_parameters)) {
+        cr_log(CR_ERROR, "Failed to initialize tilemap: multi-draw with draw parameters not supported");
+        return false;
+    }
+
+    map->shader = cg_load_shader("shaders/tilemap.vert", "shaders/tilemap.frag");
+    if (!map->shader.program) { return false; }
+
+    map->width = conf->width;
+    map->height = conf->height;
+    map->chunks_x = (conf->width + CTILEMAP_CHUNK_SIZE - 1) / CTILEMAP_CHUNK_SIZE;
+    map->chunks_y = (conf->height + CTILEMAP_CHUNK_SIZE - 1) / CTILEMAP_CHUNK_SIZE;
+    map->tile_size = conf->tile_size > 0.0f ? conf->tile_size : 1.0f;
+    glm_vec2_copy((float*)conf->origin, map->origin);
+
+    const size_t chunk_count = (size_t)map->chunks_x * map->chunks_y;
+    map->tiles = (uint16_t*)cr_calloc((size_t)map->width * map->height, sizeof(uint16_t));
+    map->chunks = (ctilemap_chunk*)cr_calloc(chunk_count, sizeof(ctilemap_chunk));
+    map->commands = (ctilemap_command*)cr_alloc(chunk_count * sizeof(ctilemap_command));
+    if (!map->tiles || !map->chunks || !map->commands) {
+        cr_log(CR_ERROR, "Failed to initialize tilemap: out of memory");
+        cg_tilemap_shutdown(map);
+        return false;
+    }
+
+    map->instances = cg_make_storage_buffer(&(cg_storage_conf){ .size = chunk_count * CTILEMAP_CHUNK_TILES * sizeof(uint32_t) });
+    map->indirect = cg_make_storage_buffer(&(cg_storage_conf){ .size = chunk_count * sizeof(ctilemap_command) });
+
+    if (conf->palette && conf->palette_size > 0) {
+        cg_tilemap_set_palette(map, conf->palette, conf->palette_size);
+    } else {
+        const vec4 fallback[] = { { 0.0f, 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } };
+        cg_tilemap_set_palette(map, fallback, 2);
+    }
+
+    map->pipeline = cg_make_pipeline(&(cg_pipeline_conf){ .shader = map->shader, .primitive_type = GL_TRIANGLE_STRIP });
+
+    // Core profile draws need a vertex array even without attributes
+    map->quad = cg_make_buffer(&(cg_buffer_conf){ 0 });
+
+    cr_logf(CR_SUCCESS, "Successfully initialized [carrier tilemap module] (%ux%u tiles, %zu chunks)", map->width, map->height, chunk_count);
+    return true;
+}
+
+CARRIER_API void cg_tilemap_shutdown(ctilemap_map* map) {
+    if (map->instances.buffer) { cg_destroy_storage_buffer(map->instances); }
+    if (map->indirect.buffer) { cg_destroy_storage_buffer(map->indirect); }
+    if (map->palette.buffer) { cg_destroy_storage_buffer(map->palette); }
+    if (map->quad.vao) { cg_destroy_buffer(map->quad); }
+    if (map->shader.program) { cg_destroy_shader(map->shader); }
+    cr_free(map->tiles);
+    cr_free(map->chunks);
+    cr_free(map->commands);
+    memset(map, 0, sizeof(*map));
+}
+
+CARRIER_API void cg_tilemap_set(ctilemap_map* map, uint32_t x, uint32_t y, uint16_t tile) {
+    if (x >= map->width || y >= map->height) { return; }
+
+    uint16_t* slot = &map->tiles[(size_t)y * map->width + x];
+    if (*slot == tile) { return; }
+
+    *slot = tile;
+    map->chunks[(y / CTILEMAP_CHUNK_SIZE) * map->chunks_x + x / CTILEMAP_CHUNK_SIZE].dirty = true;
+}
+
+CARRIER_API uint16_t cg_tilemap_get(const ctilemap_map* map, uint32_t x, uint32_t y) {
+    if (x >= map->width || y >= map->height) { return CTILEMAP_EMPTY; }
+    return map->tiles[(size_t)y * map->width + x];
+}
+
+CARRIER_API void cg_tilemap_load(ctilemap_map* map, const uint16_t* tiles) {
+    memcpy(map->tiles, tiles, (size_t)map->width * map->height * sizeof(uint16_t));
+
+    // Chunks are rebuilt lazily the first time they become visible
+    const size_t chunk_count = (size_t)map->chunks_x * map->chunks_y;
+    for (size_t i = 0; i < chunk_count; i++) {
+        map->chunks[i].dirty = true;
+    }
+}
+
+CARRIER_API void cg_tilemap_set_palette(ctilemap_map* map, const vec4* palette, size_t palette_size) {
+    // The shader clamps ids to the last entry, an empty palette has none
+    if (!palette || palette_size == 0) {
+        cr_log(CR_ERROR, "Failed to set tilemap palette: palette is empty");
+        return;
+    }
+
+    if (map->palette.buffer) { cg_destroy_storage_buffer(map->palette); }
+    map->palette = cg_make_storage_buffer(&(cg_storage_conf){ .size = palette_size * sizeof(vec4), .data = palette });
+}
+
+CARRIER_API void cg_tilemap_render(ctilemap_map* map, const float* view_projection, float left, float right, float bottom, float top) {
+    memset(&map->stats, 0, sizeof(map->stats));
+    if (!map->shader.program) { return; }
+
+    // Only the chunks overlapping the view are touched, so the CPU cost
+    // depends on the view size and not on the map size
+    const float chunk_extent = map->tile_size * CTILEMAP_CHUNK_SIZE;
+    uint32_t first_x, last_x, first_y, last_y;
+    if (!chunk_span(left, right, map->origin[0], chunk_extent, map->chunks_x, &first_x, &last_x) ||
+        !chunk_span(bottom, top, map->origin[1], chunk_extent, map->chunks_y, &first_y, &last_y)) {
+        return;
+    }
+
+    uint32_t command_count = 0;
+    for (uint32_t cy = first_y; cy <= last_y; cy++) {
+        for (uint32_t cx = first_x; cx <= last_x; cx++) {
+            const uint32_t index = cy * map->chunks_x + cx;
+            ctilemap_chunk* chunk = &map->chunks[index];
+
+            if (chunk->dirty) {
+                rebuild_chunk(map, index);
+                map->stats.rebuilt_chunks++;
+            }
+            map->stats.visible_chunks++;
+            if (chunk->count == 0) { continue; }
+
+            map->commands[command_count++] = (ctilemap_command){ 4, chunk->count, 0, index * CTILEMAP_CHUNK_TILES };
+            map->stats.drawn_tiles += chunk->count;
+        }
+    }
+    if (command_count == 0) { return; }
+
+    cg_update_storage_buffer(&map->indirect, 0, command_count * sizeof(ctilemap_command), map->commands);
+
+    // The map is a background layer and never occludes later draws
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    cg_set_depth_test(false);
+
+    cg_apply_pipeline(&map->pipeline);
+    cg_set_uniform_mat4(CTILEMAP_VIEW_PROJ_LOCATION, view_projection);
+    cg_set_uniform_vec2(CTILEMAP_ORIGIN_LOCATION, map->origin);
+    cg_set_uniform_float(CTILEMAP_TILE_SIZE_LOCATION, map->tile_size);
+    cg_set_uniform_uint(CTILEMAP_CHUNKS_X_LOCATION, map->chunks_x);
+    cg_apply_storage_buffer(0, &map->instances);
+    cg_apply_storage_buffer(1, &map->palette);
+
+    cg_apply_bindings(&map->quad);
+    cg_multi_draw_indirect(&map->quad, &map->indirect, 0, (int)command_count);
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    if (depth_test) { cg_set_depth_test(true); }
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static void rebuild_chunk(ctilemap_map* map, uint32_t chunk) {
+    uint32_t packed[CTILEMAP_CHUNK_TILES];
+    uint32_t count = 0;
+
+    const uint32_t base_x = (chunk % map->chunks_x) * CTILEMAP_CHUNK_SIZE;
+    const uint32_t base_y = (chunk / map->chunks_x) * CTILEMAP_CHUNK_SIZE;
+    const uint32_t end_x = base_x + CTILEMAP_CHUNK_SIZE < map->width ? base_x + CTILEMAP_CHUNK_SIZE : map->width;
+    const uint32_t end_y = base_y + CTILEMAP_CHUNK_SIZE < map->height ? base_y + CTILEMAP_CHUNK_SIZE : map->height;
+
+    // Empty tiles are dropped, the slot only holds what is drawn
+    for (uint32_t y = base_y; y < end_y; y++) {
+        const uint16_t* row = &map->tiles[(size_t)y * map->width];
+        for (uint32_t x = base_x; x < end_x; x++) {
+            if (row[x] == CTILEMAP_EMPTY) { continue; }
+            packed[count++] = (x - base_x) | ((y - base_y) << 5) | ((uint32_t)row[x] << 16);
+        }
+    }
+
+    if (count > 0) {
+        cg_update_storage_buffer(&map->instances, (size_t)chunk * CTILEMAP_CHUNK_TILES * sizeof(uint32_t), count * sizeof(uint32_t), packed);
+    }
+    map->chunks[chunk].count = count;
+    map->chunks[chunk].dirty = false;
+}
+
+static bool chunk_span(float low, float high, float origin, float chunk_extent, uint32_t chunks, uint32_t* first, uint32_t* last) {
+    const float start = floorf((low - origin) / chunk_extent);
+    const float end = floorf((high - origin) / chunk_extent);
+    if (end < 0.0f || start >= (float)chunks) { return false; }
+
+    *first = start > 0.0f ? (uint32_t)start : 0;
+    *last = end < (float)(chunks - 1) ? (uint32_t)end : chunks - 1;
+    return true;
+}
+
+#endif // CARRIER_TILEMAP_IMPLEMENTATION
@@ -0,0 +1,420 @@
+#ifndef CARRIER_TRANSFORM_H
+#define CARRIER_TRANSFORM_H
+
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libs/carrier_api.h"
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+
+#define CTRANSFORM_INVALID (-1)
+
+// Handle to a transform node, stable for the lifetime of the system
+typedef int32_t ctransform_handle;
+
+// Local translation, rotation and scale of a transform node
+typedef struct {
+    vec3 position;
+    versor rotation;
+    vec3 scale;
+} ctransform_local;
+
+// Transform system storing all nodes in a flat array sorted by depth, so that
+// every parent is stored before its children and one forward sweep is enough
+// to propagate world matrices.
+typedef struct {
+    // Per slot (depth-sorted) data
+    ctransform_local* local;
+    mat4* world;
+    int32_t* parent;
+    int32_t* handle_of;
+    uint32_t* changed;
+    uint8_t* dirty;
+
+    // Per handle data
+    int32_t* slot_of;
+    int32_t* parent_handle;
+
+    size_t count, capacity;
+    size_t dirty_count, first_dirty;
+    uint32_t frame;
+    bool topology_dirty;
+
+    // Optional destination for world matrices, indexed by handle. It must hold
+    // at least as many matrices as there are nodes.
+    mat4* upload;
+    size_t upload_first, upload_last;
+} ctransform_system;
+
+// PUBLIC API
+// These functions are intended to be used by the users of the library.
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_transform_init(ctransform_system* sys, size_t capacity);
+CARRIER_API void cr_transform_shutdown(ctransform_system* sys);
+CARRIER_API ctransform_handle cr_transform_create(ctransform_system* sys, ctransform_handle parent);
+CARRIER_API void cr_transform_set_parent(ctransform_system* sys, ctransform_handle node, ctransform_handle parent);
+CARRIER_API void cr_transform_set_position(ctransform_system* sys, ctransform_handle node, const vec3 position);
+CARRIER_API void cr_transform_set_rotation(ctransform_system* sys, ctransform_handle node, const versor rotation);
+CARRIER_API void cr_transform_set_scale(ctransform_system* sys, ctransform_handle node, const vec3 scale);
+CARRIER_API const ctransform_local* cr_transform_get_local(const ctransform_system* sys, ctransform_handle node);
+CARRIER_API const float* cr_transform_get_world(const ctransform_system* sys, ctransform_handle node);
+CARRIER_API void cr_transform_set_upload(ctransform_system* sys, mat4* upload);
+CARRIER_API bool cr_transform_take_upload_range(ctransform_system* sys, size_t* first, size_t* count);
+CARRIER_API size_t cr_transform_update(ctransform_system* sys);
+
+#endif // CARRIER_TRANSFORM_H
+
+#if defined(CARRIER_IMPLEMENTATION) && !defined(CARRIER_TRANSFORM_IMPLEMENTATION)
+#define CARRIER_TRANSFORM_IMPLEMENTATION
+
+// INTERNAL
+// These functions are intended for internal use within the library.
+// === === === === === ===
+// === === === === === ===
+
+static bool cr_transform_grow(ctransform_system* sys);
+static bool cr_transform_valid(const ctransform_system* sys, ctransform_handle node);
+static void cr_transform_mark_dirty(ctransform_system* sys, ctransform_handle node);
+static void cr_transform_sort(ctransform_system* sys);
+static void cr_transform_compose(const ctransform_local* local, mat4 dest);
+
+// PUBLIC API IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+CARRIER_API void cr_transform_init(ctransform_system* sys, size_t capacity) {
+    memset(sys, 0, sizeof(*sys));
+    sys->capacity = capacity > 0 ? capacity : 64;
+    sys->upload_first = SIZE_MAX;
+
+    sys->local = (ctransform_local*)cr_alloc(sys->capacity * sizeof(ctransform_local));
+    sys->world = (mat4*)cr_alloc(sys->capacity * sizeof(mat4));
+    sys->parent = (int32_t*)cr_alloc(sys->capacity * sizeof(int32_t));
+    sys->handle_of = (int32_t*)cr_alloc(sys->capacity * sizeof(int32_t));
+    sys->changed = (uint32_t*)cr_alloc(sys->capacity * sizeof(uint32_t));
+    sys->dirty = (uint8_t*)cr_alloc(sys->capacity * sizeof(uint8_t));
+    sys->slot_of = (int32_t*)cr_alloc(sys->capacity * sizeof(int32_t));
+    sys->parent_handle = (int32_t*)cr_alloc(sys->capacity * sizeof(int32_t));
+
+    if (!sys->local || !sys->world || !sys->parent || !sys->handle_of ||
+        !sys->changed || !sys->dirty || !sys->slot_of || !sys->parent_handle) {
+        cr_log(CR_ERROR, "Failed to allocate memory for transform system");
+        cr_transform_shutdown(sys);
+        return;
+    }
+    cr_log(CR_SUCCESS, "Successfully initialized [carrier transform module]");
+}
+
+CARRIER_API void cr_transform_shutdown(ctransform_system* sys) {
+    cr_free(sys->local);
+    cr_free(sys->world);
+    cr_free(sys->parent);
+    cr_free(sys->handle_of);
+    cr_free(sys->changed);
+    cr_free(sys->dirty);
+    cr_free(sys->slot_of);
+    cr_free(sys->parent_handle);
+    memset(sys, 0, sizeof(*sys));
+}
+
+CARRIER_API ctransform_handle cr_transform_create(ctransform_system* sys, ctransform_handle parent) {
+    if (parent != CTRANSFORM_INVALID && !cr_transform_valid(sys, parent)) {
+        cr_log(CR_ERROR, "Failed to create transform: invalid parent");
+        return CTRANSFORM_INVALID;
+    }
+
+    if (sys->count == sys->capacity && !cr_transform_grow(sys)) {
+        return CTRANSFORM_INVALID;
+    }
+
+    // New nodes are appended, which keeps the array sorted because the parent
+    // already exists and is therefore stored at a lower slot.
+    const size_t slot = sys->count++;
+    const ctransform_handle node = (ctransform_handle)slot;
+
+    glm_vec3_zero(sys->local[slot].position);
+    glm_quat_identity(sys->local[slot].rotation);
+    glm_vec3_one(sys->local[slot].scale);
+    glm_mat4_identity(sys->world[slot]);
+    sys->parent[slot] = parent == CTRANSFORM_INVALID ? -1 : sys->slot_of[parent];
+    sys->handle_of[slot] = node;
+    sys->changed[slot] = 0;
+    sys->dirty[slot] = 0;
+    sys->slot_of[node] = (int32_t)slot;
+    sys->parent_handle[node] = parent;
+
+    cr_transform_mark_dirty(sys, node);
+    return node;
+}
+
+CARRIER_API void cr_transform_set_parent(ctransform_system* sys, ctransform_handle node, ctransform_handle parent) {
+    if (!cr_transform_valid(sys, node)) {
+        cr_log(CR_ERROR, "Failed to set transform parent: invalid node");
+        return;
+    }
+    if (parent != CTRANSFORM_INVALID && !cr_transform_valid(sys, parent)) {
+        cr_log(CR_ERROR, "Failed to set transform parent: invalid parent");
+        return;
+    }
+    if (sys->parent_handle[node] == parent) { return; }
+
+    // Refuse to create cycles
+    for (ctransform_handle it = parent; it != CTRANSFORM_INVALID; it = sys->parent_handle[it]) {
+        if (it == node) {
+            cr_log(CR_ERROR, "Failed to set transform parent: cycle detected");
+            return;
+        }
+    }
+
+    sys->parent_handle[node] = parent;
+    sys->topology_dirty = true;
+    cr_transform_mark_dirty(sys, node);
+}
+
+CARRIER_API void cr_transform_set_position(ctransform_system* sys, ctransform_handle node, const vec3 position) {
+    if (!cr_transform_valid(sys, node)) {
+        cr_log(CR_ERROR, "Failed to set transform position: invalid node");
+        return;
+    }
+    ctransform_local* local = &sys->local[sys->slot_of[node]];
+    if (memcmp(local->position, position, sizeof(vec3)) == 0) { return; }
+    memcpy(local->position, position, sizeof(vec3));
+    cr_transform_mark_dirty(sys, node);
+}
+
+CARRIER_API void cr_transform_set_rotation(ctransform_system* sys, ctransform_handle node, const versor rotation) {
+    if (!cr_transform_valid(sys, node)) {
+        cr_log(CR_ERROR, "Failed to set transform rotation: invalid node");
+        return;
+    }
+    ctransform_local* local = &sys->local[sys->slot_of[node]];
+    if (memcmp(local->rotation, rotation, sizeof(versor)) == 0) { return; }
+    memcpy(local->rotation, rotation, sizeof(versor));
+    cr_transform_mark_dirty(sys, node);
+}
+
+CARRIER_API void cr_transform_set_scale(ctransform_system* sys, ctransform_handle node, const vec3 scale) {
+    if (!cr_transform_valid(sys, node)) {
+        cr_log(CR_ERROR, "Failed to set transform scale: invalid node");
+        return;
+    }
+    ctransform_local* local = &sys->local[sys->slot_of[node]];
+    if (memcmp(local->scale, scale, sizeof(vec3)) == 0) { return; }
+    memcpy(local->scale, scale, sizeof(vec3));
+    cr_transform_mark_dirty(sys, node);
+}
+
+CARRIER_API const ctransform_local* cr_transform_get_local(const ctransform_system* sys, ctransform_handle node) {
+    if (!cr_transform_valid(sys, node)) {
+        cr_log(CR_ERROR, "Failed to get transform: invalid node");
+        return NULL;
+    }
+    return &sys->local[sys->slot_of[node]];
+}
+
+CARRIER_API const float* cr_transform_get_world(const ctransform_system* sys, ctransform_handle node) {
+    if (!cr_transform_valid(sys, node)) {
+        cr_log(CR_ERROR, "Failed to get transform: invalid node");
+        return NULL;
+    }
+    return (const float*)sys->world[sys->slot_of[node]];
+}
+
+CARRIER_API void cr_transform_set_upload(ctransform_system* sys, mat4* upload) {
+    sys->upload = upload;
+    sys->upload_first = SIZE_MAX;
+    sys->upload_last = 0;
+
+    // Fill the new destination once, afterwards only changed matrices are written
+    if (upload) {
+        for (size_t slot = 0; slot < sys->count; slot++) {
+            glm_mat4_copy(sys->world[slot], upload[sys->handle_of[slot]]);
+        }
+        if (sys->count > 0) {
+            sys->upload_first = 0;
+            sys->upload_last = sys->count - 1;
+        }
+    }
+}
+
+CARRIER_API bool cr_transform_take_upload_range(ctransform_system* sys, size_t* first, size_t* count) {
+    if (sys->upload_first > sys->upload_last) { return false; }
+
+    *first = sys->upload_first;
+    *count = sys->upload_last - sys->upload_first + 1;
+    sys->upload_first = SIZE_MAX;
+    sys->upload_last = 0;
+    return true;
+}
+
+CARRIER_API size_t cr_transform_update(ctransform_system* sys) {
+    if (sys->dirty_count == 0 && !sys->topology_dirty) { return 0; }
+
+    if (sys->topology_dirty) {
+        cr_transform_sort(sys);
+    }
+
+    // A node is recomputed when its local transform changed or its parent's
+    // world matrix was recomputed during this sweep.
+    const uint32_t frame = ++sys->frame;
+    size_t updated = 0;
+
+    for (size_t slot = sys->first_dirty; slot < sys->count; slot++) {
+        const int32_t parent = sys->parent[slot];
+        const bool parent_changed = parent >= 0 && sys->changed[parent] == frame;
+
+        if (!sys->dirty[slot] && !parent_changed) { continue; }
+
+        if (parent >= 0) {
+            mat4 local;
+            cr_transform_compose(&sys->local[slot], local);
+            glm_mul(sys->world[parent], local, sys->world[slot]);
+        } else {
+            cr_transform_compose(&sys->local[slot], sys->world[slot]);
+        }
+
+        sys->dirty[slot] = 0;
+        sys->changed[slot] = frame;
+        updated++;
+
+        if (sys->upload) {
+            const size_t node = (size_t)sys->handle_of[slot];
+            glm_mat4_copy(sys->world[slot], sys->upload[node]);
+            if (node < sys->upload_first) { sys->upload_first = node; }
+            if (node > sys->upload_last) { sys->upload_last = node; }
+        }
+    }
+
+    sys->dirty_count = 0;
+    sys->first_dirty = sys->count;
+    return updated;
+}
+
+// INTERNAL IMPLEMENTATION
+// === === === === === ===
+// === === === === === ===
+
+static bool cr_transform_grow(ctransform_system* sys) {
+    const size_t capacity = sys->capacity * 2;
+
+    ctransform_local* local = (ctransform_local*)cr_realloc(sys->local, capacity * sizeof(ctransform_local));
+    if (local) { sys->local = local; }
+    mat4* world = (mat4*)cr_realloc(sys->world, capacity * sizeof(mat4));
+    if (world) { sys->world = world; }
+    int32_t* parent = (int32_t*)cr_realloc(sys->parent, capacity * sizeof(int32_t));
+    if (parent) { sys->parent = parent; }
+    int32_t* handle_of = (int32_t*)cr_realloc(sys->handle_of, capacity * sizeof(int32_t));
+    if (handle_of) { sys->handle_of = handle_of; }
+    uint32_t* changed = (uint32_t*)cr_realloc(sys->changed, capacity * sizeof(uint32_t));
+    if (changed) { sys->changed = changed; }
+    uint8_t* dirty = (uint8_t*)cr_realloc(sys->dirty, capacity * sizeof(uint8_t));
+    if (dirty) { sys->dirty = dirty; }
+    int32_t* slot_of = (int32_t*)cr_realloc(sys->slot_of, capacity * sizeof(int32_t));
+    if (slot_of) { sys->slot_of = slot_of; }
+    int32_t* parent_handle = (int32_t*)cr_realloc(sys->parent_handle, capacity * sizeof(int32_t));
+    if (parent_handle) { sys->parent_handle = parent_handle; }
+
+    if (!local || !world || !parent || !handle_of || !changed || !dirty || !slot_of || !parent_handle) {
+        cr_log(CR_ERROR, "Failed to allocate memory for transform nodes");
+        return false;
+    }
+
+    sys->capacity = capacity;
+    return true;
+}
+
+static bool cr_transform_valid(const ctransform_system* sys, ctransform_handle node) {
+    return node >= 0 && (size_t)node < sys->count;
+}
+
+static void cr_transform_mark_dirty(ctransform_system* sys, ctransform_handle node) {
+    const size_t slot = (size_t)sys->slot_of[node];
+    if (sys->dirty[slot]) { return; }
+
+    sys->dirty[slot] = 1;
+    sys->dirty_count++;
+    if (sys->dirty_count == 1 || slot < sys->first_dirty) {
+        sys->first_dirty = slot;
+    }
+}
+
+static void cr_transform_sort(ctransform_system* sys) {
+    const size_t count = sys->count;
+
+    // Scratch layout: depth and new slot per handle, then the old slot data
+    uint32_t* depth = (uint32_t*)cr_alloc(count * sizeof(uint32_t));
+    size_t* offsets = (size_t*)cr_calloc(count + 1, sizeof(size_t));
+    int32_t* order = (int32_t*)cr_alloc(count * sizeof(int32_t));
+    ctransform_local* local = (ctransform_local*)cr_alloc(count * sizeof(ctransform_local));
+    mat4* world = (mat4*)cr_alloc(count * sizeof(mat4));
+    uint8_t* dirty = (uint8_t*)cr_alloc(count * sizeof(uint8_t));
+
+    if (!depth || !offsets || !order || !local || !world || !dirty) {
+        cr_log(CR_ERROR, "Failed to allocate memory for transform sort");
+        cr_free(depth); cr_free(offsets); cr_free(order); cr_free(local); cr_free(world); cr_free(dirty);
+        return;
+    }
+
+    for (size_t node = 0; node < count; node++) {
+        uint32_t d = 0;
+        for (ctransform_handle it = sys->parent_handle[node]; it != CTRANSFORM_INVALID; it = sys->parent_handle[it]) {
+            d++;
+        }
+        depth[node] = d;
+        offsets[d + 1]++;
+    }
+    for (size_t d = 1; d <= count; d++) {
+        offsets[d] += offsets[d - 1];
+    }
+
+    // Stable counting sort by depth, visiting handles in their old slot order
+    for (size_t slot = 0; slot < count; slot++) {
+        const int32_t node = sys->handle_of[slot];
+        order[offsets[depth[node]]++] = node;
+    }
+
+    memcpy(local, sys->local, count * sizeof(ctransform_local));
+    memcpy(world, sys->world, count * sizeof(mat4));
+    memcpy(dirty, sys->dirty, count * sizeof(uint8_t));
+
+    for (size_t slot = 0; slot < count; slot++) {
+        const int32_t node = order[slot];
+        const int32_t old = sys->slot_of[node];
+        sys->local[slot] = local[old];
+        glm_mat4_copy(world[old], sys->world[slot]);
+        sys->dirty[slot] = dirty[old];
+        sys->changed[slot] = 0;
+        sys->handle_of[slot] = node;
+    }
+    for (size_t slot = 0; slot < count; slot++) {
+        sys->slot_of[sys->handle_of[slot]] = (int32_t)slot;
+    }
+    for (size_t slot = 0; slot < count; slot++) {
+        const ctransform_handle parent = sys->parent_handle[sys->handle_of[slot]];
+        sys->parent[slot] = parent == CTRANSFORM_INVALID ? -1 : sys->slot_of[parent];
+    }
+
+    cr_free(depth); cr_free(offsets); cr_free(order); cr_free(local); cr_free(world); cr_free(dirty);
+
+    sys->first_dirty = 0;
+    sys->topology_dirty = false;
+}
+
+static void cr_transform_compose(const ctransform_local* local, mat4 dest) {
+    // dest = T * R * S
+    glm_quat_mat4((float*)local->rotation, dest);
+    glm_vec4_scale(dest[0], local->scale[0], dest[0]);
+    glm_vec4_scale(dest[1], local->scale[1], dest[1]);
+    glm_vec4_scale(dest[2], local->scale[2], dest[2]);
+    dest[3][0] = local->position[0];
+    dest[3][1] = local->position[1];
+    dest[3][2] = local->position[2];
+    dest[3][3] = 1.0f;
+}
+
+#endif // CARRIER_TRANSFORM_IMPLEMENTATION
@@ -1,8 +1,81 @@
 #ifndef CARRIER_TYPES_H
 #define CARRIER_TYPES_H
 
+// Graphics backend the cg_* handles below are declared for, set by the backend
+// option of the build. OpenGL is the only backend implemented so far.
+#ifndef CG_BACKEND_GL
+#define CG_BACKEND_GL 1
+#endif
+
+#if CG_BACKEND_GL
+#include <GL/glew.h>
+#else
+#error "No graphics backend selected, build with CG_BACKEND_GL=1"
+#endif
+
 #include <GLFW/glfw3.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "../libs/carrier_log.h"
+#include "../libs/carrier_alloc.h"
+#include "../libs/carrier_jobs.h"
+
+// Capacity of the application event queue, must be a power of two
+#ifndef CAPP_EVENT_QUEUE_SIZE
+#define CAPP_EVENT_QUEUE_SIZE 1024
+#endif
+
+// Number of 64-bit words needed to hold one bit per key code
+#define CAPP_KEY_WORDS ((GLFW_KEY_LAST + 64) / 64)
+
+// Identification of input recordings, bump the version when the layout changes
+#define CAPP_REPLAY_MAGIC 0x43455243u // "CREC"
+#define CAPP_REPLAY_VERSION 2
+
+// Identification of graphics captures, bump the version when the layout changes
+#define CG_CAPTURE_MAGIC 0x50434743u // "CGCP"
+#define CG_CAPTURE_VERSION 3
+
+// Maximum number of integer fields of a captured command
+#define CG_CAPTURE_MAX_FIELDS 16
+
+// Number of storage buffer binding points a compute pipeline can declare
+#ifndef CG_MAX_STORAGE_BINDINGS
+#define CG_MAX_STORAGE_BINDINGS 8
+#endif
+
+// Maximum number of mipmap levels of an image, enough for 32768 pixels
+#define CG_MAX_MIPMAPS 16
+
+// Default size of the pixel upload ring, and the frames it can have in flight
+#define CG_DEFAULT_UPLOAD_SIZE (8u << 20)
+#define CG_MAX_UPLOAD_FENCES 8
+
+// Maximum number of color attachments of a framebuffer
+#define CG_MAX_COLOR_ATTACHMENTS 4
+
+// Maximum number of features of a shader variant set, one bit of the key each
+#define CG_MAX_SHADER_FEATURES 32
+
+// BACKEND HANDLES
+// === === === === === ===
+// === === === === === ===
+
+#if CG_BACKEND_GL
+// Name of a backend object: program, buffer, vertex array, texture, sampler or framebuffer
+typedef GLuint cg_handle;
+
+// Backend enumerant, a primitive type or a texture target
+typedef GLenum cg_enum;
+
+// Fence the CPU can wait on
+typedef GLsync cg_fence;
+
+// Uniform location
+typedef GLint cg_uniform;
+#endif
 
 // ENUMERATIONS
 // === === === === === ===
@@ -17,7 +90,8 @@ typedef enum {
     CAPP_EVENT_MOUSE_UP,
     CAPP_EVENT_MOUSE_MOVE,
     CAPP_EVENT_MOUSE_SCROLL,
-    CAPP_EVENT_RESIZE
+    CAPP_EVENT_RESIZE,
+    CAPP_EVENT_CUSTOM
 } capp_event_type;
 
 // Key codes for the application
@@ -161,6 +235,147 @@ typedef enum {
     CAPP_MOUSE_8 = GLFW_MOUSE_BUTTON_8
 } capp_mousecode;
 
+// Input recording modes for the application
+typedef enum {
+    CAPP_REPLAY_OFF = 0,
+    CAPP_REPLAY_RECORD,
+    CAPP_REPLAY_PLAY
+} capp_replay_mode;
+
+// Entry kinds of an input recording, entries are stored in the order they happened
+typedef enum {
+    CAPP_REPLAY_EVENT = 0,
+    CAPP_REPLAY_TICK,
+    CAPP_REPLAY_END,
+    CAPP_REPLAY_HASH
+} capp_replay_entry;
+
+// Parts of an input snapshot stored in a tick entry, the others are unchanged or zero
+typedef enum {
+    CAPP_REPLAY_KEYS = 1 << 0,
+    CAPP_REPLAY_KEYS_PRESSED = 1 << 1,
+    CAPP_REPLAY_KEYS_RELEASED = 1 << 2,
+    CAPP_REPLAY_BUTTONS = 1 << 3,
+    CAPP_REPLAY_MOUSE = 1 << 4,
+    CAPP_REPLAY_SCROLL = 1 << 5,
+    CAPP_REPLAY_SIZE = 1 << 6
+} capp_replay_flags;
+
+// Memory barrier flags for the graphics module, combined with bitwise or.
+// Each flag names the way the data written by a dispatch is read next.
+typedef enum {
+    CG_BARRIER_STORAGE = 1 << 0,
+    CG_BARRIER_INDIRECT = 1 << 1,
+    CG_BARRIER_VERTEX = 1 << 2,
+    CG_BARRIER_INDEX = 1 << 3,
+    CG_BARRIER_UNIFORM = 1 << 4,
+    CG_BARRIER_BUFFER_UPDATE = 1 << 5,
+    CG_BARRIER_MAPPED = 1 << 6,
+    CG_BARRIER_ALL = 0x7f
+} cg_barrier_flags;
+
+// Commands of a graphics capture. Each one is stored as its opcode, field
+// count, data size, the 64-bit fields and the data. Recorded GL names are
+// translated by the replay.
+typedef enum {
+    CG_CAPTURE_SETUP = 0,
+    CG_CAPTURE_SHADER_SOURCE,
+    CG_CAPTURE_SHADER_BINARY,
+    CG_CAPTURE_PROGRAM,
+    CG_CAPTURE_DESTROY_PROGRAM,
+    CG_CAPTURE_BUFFER,
+    CG_CAPTURE_DESTROY_BUFFER,
+    CG_CAPTURE_STORAGE,
+    CG_CAPTURE_DESTROY_STORAGE,
+    CG_CAPTURE_UPDATE_BUFFER,
+    CG_CAPTURE_FRAME_START,
+    CG_CAPTURE_BEGIN_PASS,
+    CG_CAPTURE_END_PASS,
+    CG_CAPTURE_COMMIT,
+    CG_CAPTURE_APPLY_PIPELINE,
+    CG_CAPTURE_APPLY_BINDINGS,
+    CG_CAPTURE_APPLY_COMPUTE,
+    CG_CAPTURE_DISPATCH,
+    CG_CAPTURE_DISPATCH_INDIRECT,
+    CG_CAPTURE_BARRIER,
+    CG_CAPTURE_RENDER,
+    CG_CAPTURE_UNIFORM_MAT4,
+    CG_CAPTURE_UNIFORM_VEC4,
+    CG_CAPTURE_WIREFRAME,
+    CG_CAPTURE_APPLY_STORAGE,
+    CG_CAPTURE_DRAW_INDIRECT,
+    CG_CAPTURE_MULTI_DRAW_INDIRECT,
+    CG_CAPTURE_UNIFORM_FLOAT,
+    CG_CAPTURE_UNIFORM_INT,
+    CG_CAPTURE_UNIFORM_UINT,
+    CG_CAPTURE_UNIFORM_VEC2,
+    CG_CAPTURE_DEPTH_TEST,
+    CG_CAPTURE_BLEND
+} cg_capture_op;
+
+// Pixel formats of the graphics module. The BC formats are block compressed
+// and uploaded as they are, without decoding on the CPU.
+typedef enum {
+    CG_PIXELFORMAT_NONE = 0,
+    CG_PIXELFORMAT_R8,
+    CG_PIXELFORMAT_RG8,
+    CG_PIXELFORMAT_RGBA8,
+    CG_PIXELFORMAT_SRGB8A8,
+    CG_PIXELFORMAT_RGBA16F,
+    CG_PIXELFORMAT_RGBA32F,
+    CG_PIXELFORMAT_BC1,
+    CG_PIXELFORMAT_BC1_SRGB,
+    CG_PIXELFORMAT_BC3,
+    CG_PIXELFORMAT_BC3_SRGB,
+    CG_PIXELFORMAT_BC4,
+    CG_PIXELFORMAT_BC5,
+    CG_PIXELFORMAT_BC7,
+    CG_PIXELFORMAT_BC7_SRGB,
+    CG_PIXELFORMAT_DEPTH32F,
+    CG_PIXELFORMAT_DEPTH24_STENCIL8,
+    CG_PIXELFORMAT_COUNT
+} cg_pixel_format;
+
+// Texture filters of the graphics module, CG_FILTER_NONE disables mipmapping
+typedef enum {
+    CG_FILTER_LINEAR = 0,
+    CG_FILTER_NEAREST,
+    CG_FILTER_NONE
+} cg_filter;
+
+// Texture coordinate wrapping of the graphics module
+typedef enum {
+    CG_WRAP_REPEAT = 0,
+    CG_WRAP_CLAMP,
+    CG_WRAP_MIRROR
+} cg_wrap;
+
+// What a pass does with the previous contents of an attachment. The default
+// clears color, and depth and stencil when their clear value is in range.
+typedef enum {
+    CG_LOAD_DEFAULT = 0,
+    CG_LOAD_CLEAR,
+    CG_LOAD_LOAD,
+    CG_LOAD_DONTCARE
+} cg_load_action;
+
+// What a pass does with an attachment when it ends, don't care invalidates it
+typedef enum {
+    CG_STORE_STORE = 0,
+    CG_STORE_DONTCARE
+} cg_store_action;
+
+// Categories of the graphics memory accounting. Staging covers upload and
+// readback buffers, render targets are images drawn to by passes.
+typedef enum {
+    CG_MEMORY_GEOMETRY = 0,
+    CG_MEMORY_STORAGE,
+    CG_MEMORY_TEXTURE,
+    CG_MEMORY_RENDER_TARGET,
+    CG_MEMORY_STAGING,
+    CG_MEMORY_COUNT
+} cg_memory_category;
+
 // STRUCTURES
 // === === === === === ===
 // === === === === === ===
@@ -170,16 +385,17 @@ typedef struct {
     float r, g, b, a;
 } cg_color;
 
-// Input structure for the application
+// Input snapshot for the application, latched once per frame. The pressed
+// and released sets hold every transition since the previous latch, so a tap
+// shorter than a frame is still reported.
 typedef struct {
-    capp_keycode key_code;
-    capp_mousecode mouse_code;
-    int scancode;
-    int action;
-    int mods;
-    int mouse_button;
-    double mouse_x, mouse_y;
-    double scroll_x, scroll_y;
+    uint64_t keys[CAPP_KEY_WORDS];
+    uint64_t keys_pressed[CAPP_KEY_WORDS];
+    uint64_t keys_released[CAPP_KEY_WORDS];
+    uint32_t buttons, buttons_pressed, buttons_released;
+    float mouse_x, mouse_y;
+    float delta_x, delta_y;
+    float scroll_x, scroll_y;
 } capp_input;
 
 // Window structure for the application
@@ -189,15 +405,102 @@ typedef struct {
     const char* window_title;
     bool fullscreen;
     int gl_major, gl_minor;
+    bool iconified;
+    bool redraw;
+    double redraw_deadline;
 } capp_window;
 
+// Key event data for the application
+typedef struct {
+    capp_keycode key_code;
+    int scancode;
+    int mods;
+} capp_key_event;
+
+// Mouse button and mouse move event data for the application
+typedef struct {
+    capp_mousecode mouse_code;
+    int mods;
+    float x, y;
+} capp_mouse_event;
+
+// Scroll event data for the application, offsets of coalesced events are summed
+typedef struct {
+    float x, y;
+} capp_scroll_event;
+
+// Resize event data for the application
+typedef struct {
+    int width, height;
+} capp_resize_event;
+
+// Custom event data for the application, posted by the user from any thread
+typedef struct {
+    int id;
+    void* data;
+} capp_custom_event;
+
 // Event structure for the application
 typedef struct {
     capp_event_type type;
-    capp_window window;
-    capp_input input;
+    union {
+        capp_key_event key;
+        capp_mouse_event mouse;
+        capp_scroll_event scroll;
+        capp_resize_event resize;
+        capp_custom_event custom;
+    } data;
 } capp_event;
 
+// Event queue cell, the sequence number tells producers and the consumer
+// whether the cell is free or holds a published event
+typedef struct {
+    size_t sequence;
+    capp_event event;
+} capp_event_cell;
+
+// Bounded multi-producer single-consumer event queue for the application.
+// Head and tail live on separate cache lines to avoid false sharing.
+typedef struct {
+    capp_event_cell cells[CAPP_EVENT_QUEUE_SIZE];
+    char pad0[64];
+    size_t tail;
+    char pad1[64];
+    size_t head;
+    size_t dropped;
+    size_t reported;
+    capp_event pending;
+    bool has_pending;
+} capp_event_queue;
+
+// Input recording configuration for the application, at most one path is set.
+// A timestep makes the recorded clock advance by exactly that much per tick,
+// it is stored in the recording and replays always run with it.
+typedef struct {
+    const char* record_path;
+    const char* replay_path;
+    float timestep;
+} capp_replay_conf;
+
+// Input recording state for the application. The clock, window size and input
+// snapshot come from the file while playing, so every tick sees what it saw
+// when it was recorded.
+typedef struct {
+    capp_replay_mode mode;
+    FILE* file;
+    float timestep;
+    double time;
+    double started;
+    uint64_t tick;
+    uint64_t hash;
+    uint64_t divergences;
+    uint64_t first_divergence;
+    int width, height;
+    capp_input previous;
+    int pending_entry;
+    bool failed;
+} capp_replay;
+
 // Configuration structure for the application
 typedef struct {
     void (*init_cb)(void);
@@ -208,12 +511,30 @@ typedef struct {
     const char* window_title;
     bool resizable, fullscreen;
     int gl_major, gl_minor;
+    bool manual_event_drain;
+    bool late_input_latch;
+    bool on_demand;
+    capp_replay_conf replay;
+    clog_conf log;
+    cmem_conf memory;
+    cjob_conf jobs;
 } capp_conf;
 
-// Configuration structure for the graphics module
+// Configuration structure for the graphics module. With a capture path, resource
+// creation is written to the file from setup on and the commands of the given
+// number of frames follow, starting after the first commit. The upload size is
+// the size of the pixel upload ring, zero for the default. The memory budget is
+// the byte limit evicting modules keep the graphics memory under, zero for none.
+// Offscreen contexts have no window, cg_commit ends the frame without presenting.
 typedef struct {
     bool depth_test;
     bool blend;
+    bool offscreen;
+    cmem_allocator allocator;
+    const char* capture_path;
+    int capture_frames;
+    size_t upload_size;
+    size_t memory_budget;
 } cg_conf;
 
 // Pass action structure for the graphics module
@@ -221,22 +542,57 @@ typedef struct {
     cg_color clear_color;
     float clear_depth;
     int clear_stencil;
+    cg_load_action color_load, depth_load, stencil_load;
+    cg_store_action color_store, depth_store, stencil_store;
 } cg_pass_action;
 
 // Shader structure for the graphics module
 typedef struct {
-    GLuint program;
+    cg_handle program;
 } cg_shader;
 
-// Bindings structure for the graphics module
+// Feature set of a shader variant, bit i enables the i-th feature of the set
+typedef uint32_t cg_variant_key;
+
+// Cached program of a variant set, failed variants are cached with program 0
+typedef struct {
+    cg_variant_key key;
+    cg_shader shader;
+    bool used;
+} cg_shader_variant;
+
+// Shader variant set, one program per feature combination in a hash table
+// keyed by the feature bits. Paths and feature names must outlive the set.
 typedef struct {
-    GLuint vao, vbo, ebo;
+    const char* vertex_path;
+    const char* fragment_path;
+    const char* features[CG_MAX_SHADER_FEATURES];
+    int feature_count;
+    cg_shader_variant* variants;
+    size_t variant_count, variant_capacity;
+} cg_shader_variants;
+
+// Shader variant set configuration. Features are define names injected after
+// the #version line, up to the first missing one. The listed variants are
+// compiled when the set is made, any other one on its first use.
+typedef struct {
+    const char* vertex_path;
+    const char* fragment_path;
+    const char* features[CG_MAX_SHADER_FEATURES];
+    const cg_variant_key* variants;
+    size_t variant_count;
+} cg_shader_variants_conf;
+
+// Bindings structure for the graphics module, size counts both buffers in bytes
+typedef struct {
+    cg_handle vao, vbo, ebo;
+    size_t size;
 } cg_bindings;
 
 // Pipeline structure for the graphics module
 typedef struct {
     cg_shader shader;
-    GLenum primitive_type;
+    cg_enum primitive_type;
 } cg_pipeline;
 
 // Vertex buffer configuration structure for the graphics module
@@ -260,21 +616,155 @@ typedef struct {
 // Pipeline configuration structure for the graphics module
 typedef struct {
     cg_shader shader;
-    GLenum primitive_type;
+    cg_enum primitive_type;
 } cg_pipeline_conf;
 
+// Storage buffer structure for the graphics module, mapped is only set for
+// persistently mapped buffers and stays valid until the buffer is destroyed
+typedef struct {
+    cg_handle buffer;
+    size_t size;
+    void* mapped;
+} cg_storage_buffer;
+
+// Storage buffer configuration structure for the graphics module
+typedef struct {
+    size_t size;
+    const void* data;
+    bool persistent;
+} cg_storage_conf;
+
+// Compute pipeline structure for the graphics module, storage[i] is bound to
+// binding point i of the shader
+typedef struct {
+    cg_shader shader;
+    cg_storage_buffer storage[CG_MAX_STORAGE_BINDINGS];
+} cg_compute_pipeline;
+
+// Compute pipeline configuration structure for the graphics module, unused
+// binding points are left zeroed
+typedef struct {
+    cg_shader shader;
+    cg_storage_buffer storage[CG_MAX_STORAGE_BINDINGS];
+} cg_compute_pipeline_conf;
+
+// Image structure for the graphics module, a 2D texture or, with more than
+// one layer, a 2D array texture with immutable storage. Size is the storage of
+// all levels and layers in bytes.
+typedef struct {
+    cg_handle texture;
+    cg_enum target;
+    int width, height;
+    int layers;
+    int levels;
+    cg_pixel_format format;
+    size_t size;
+    bool render_target;
+} cg_image;
+
+// Pixel data of one mipmap level, the layers follow each other
+typedef struct {
+    const void* data;
+    size_t size;
+} cg_image_data;
+
+// Image configuration structure for the graphics module. Zero layers or
+// levels count as one, with generate_mipmaps zero levels make a full chain
+// built from the first level. Render targets are accounted apart from textures.
+typedef struct {
+    int width, height;
+    int layers;
+    int levels;
+    cg_pixel_format format;
+    bool generate_mipmaps;
+    bool render_target;
+    cg_image_data data[CG_MAX_MIPMAPS];
+} cg_image_conf;
+
+// Sampler structure for the graphics module
+typedef struct {
+    cg_handle sampler;
+} cg_sampler;
+
+// Sampler configuration structure for the graphics module, an anisotropy
+// above one enables anisotropic filtering where supported
+typedef struct {
+    cg_filter min_filter;
+    cg_filter mag_filter;
+    cg_filter mipmap_filter;
+    cg_wrap wrap_u, wrap_v;
+    float max_anisotropy;
+} cg_sampler_conf;
+
+// Framebuffer structure for the graphics module
+typedef struct {
+    cg_handle framebuffer;
+    int width, height;
+    int color_count;
+    bool depth, stencil;
+} cg_framebuffer;
+
+// Framebuffer configuration structure for the graphics module, color images
+// are attached in order up to the first missing one. Images must outlive the
+// framebuffer.
+typedef struct {
+    const cg_image* colors[CG_MAX_COLOR_ATTACHMENTS];
+    const cg_image* depth;
+} cg_framebuffer_conf;
+
+// Fenced range of the pixel upload ring, end is the ring head after the frame
+typedef struct {
+    cg_fence fence;
+    size_t end;
+} cg_upload_fence;
+
+// Memory statistics of the graphics module in bytes, as tracked by the module
+// itself. Peak is the highest total since setup.
+typedef struct {
+    size_t bytes[CG_MEMORY_COUNT];
+    size_t objects[CG_MEMORY_COUNT];
+    size_t total, peak;
+    size_t budget;
+} cg_memory_stats;
+
 // Context structure for the graphics module
 typedef struct {
+    cmem_allocator allocator;
     cg_shader* shaders;
-    size_t shader_count;
+    size_t shader_count, shader_capacity;
     cg_pipeline* pipelines;
-    size_t pipeline_count;
+    size_t pipeline_count, pipeline_capacity;
     cg_bindings* bindings;
-    size_t binding_count;
+    size_t binding_count, binding_capacity;
+    cg_compute_pipeline* compute_pipelines;
+    size_t compute_pipeline_count, compute_pipeline_capacity;
+    cg_storage_buffer* storage_buffers;
+    size_t storage_buffer_count, storage_buffer_capacity;
+    cg_image* images;
+    size_t image_count, image_capacity;
+    cg_sampler* samplers;
+    size_t sampler_count, sampler_capacity;
+    cg_framebuffer* framebuffers;
+    size_t framebuffer_count, framebuffer_capacity;
+    cg_framebuffer pass_framebuffer;
+    cg_pass_action pass_action;
+    int window_viewport[4];
+    bool viewport_saved;
+    cg_enum primitive_type;
+    cg_handle upload_buffer;
+    void* upload_mapped;
+    size_t upload_size;
+    size_t upload_head, upload_tail, upload_fenced;
+    cg_upload_fence upload_fences[CG_MAX_UPLOAD_FENCES];
+    size_t upload_fence_head, upload_fence_tail;
+    cg_memory_stats memory;
+    bool depth_test, blend;
+    bool offscreen;
+    FILE* capture;
+    const char* capture_path;
+    int capture_pending;
+    int capture_frames;
+    int captured_frames;
 } cg_context;
 
-
-// Uniform type for the graphics module
-typedef GLint cg_uniform;
-
 #endif // CARRIER_TYPES_H
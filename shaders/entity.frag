@@ -0,0 +1,19 @@
+#version 460 core
+
+// Shared by the paddles and the ball, features are defined per variant:
+// ROUND cuts the unit quad down to its inscribed circle
+
+layout(location = 0) in vec2 v_local;
+
+layout(location = 0) out vec4 frag_color;
+
+layout(location = 3) uniform vec4 u_color;
+
+void main() {
+#ifdef ROUND
+    if (dot(v_local, v_local) > 0.25) {
+        discard;
+    }
+#endif
+    frag_color = u_color;
+}
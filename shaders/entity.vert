@@ -0,0 +1,14 @@
+#version 460 core
+
+layout(location = 0) in vec3 a_pos;
+
+layout(location = 0) out vec2 v_local;
+
+layout(location = 0) uniform mat4 u_model;
+layout(location = 1) uniform mat4 u_view;
+layout(location = 2) uniform mat4 u_proj;
+
+void main() {
+    v_local = a_pos.xy;
+    gl_Position = u_proj * u_view * u_model * vec4(a_pos, 1.0);
+}
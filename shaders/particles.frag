@@ -0,0 +1,11 @@
+#version 450 core
+
+layout(location = 0) in vec4 v_color;
+layout(location = 1) in vec2 v_corner;
+
+layout(location = 0) out vec4 frag_color;
+
+void main() {
+    float falloff = 1.0 - smoothstep(0.5, 1.0, length(v_corner));
+    frag_color = vec4(v_color.rgb, v_color.a * falloff);
+}
@@ -0,0 +1,27 @@
+#version 450 core
+
+struct particle {
+    vec2 position;
+    vec2 velocity;
+    float age;
+    float lifetime;
+    uint color;
+    float size;
+};
+
+layout(std430, binding = 0) readonly buffer Particles { particle particles[]; };
+
+layout(location = 0) uniform mat4 u_view_proj;
+
+layout(location = 0) out vec4 v_color;
+layout(location = 1) out vec2 v_corner;
+
+void main() {
+    particle p = particles[gl_InstanceID];
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    v_color = unpackUnorm4x8(p.color);
+    v_color.a *= 1.0 - clamp(p.age / p.lifetime, 0.0, 1.0);
+    v_corner = corner;
+    gl_Position = u_view_proj * vec4(p.position + corner * p.size * 0.5, 0.0, 1.0);
+}
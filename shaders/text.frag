@@ -0,0 +1,15 @@
+#version 460 core
+
+layout(location = 0) in vec2 v_uv;
+layout(location = 1) in vec4 v_color;
+
+layout(location = 0) out vec4 frag_color;
+
+layout(binding = 0) uniform sampler2D u_atlas;
+
+void main() {
+    float distance = texture(u_atlas, v_uv).r;
+    float width = fwidth(distance);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    frag_color = vec4(v_color.rgb, v_color.a * alpha);
+}
@@ -0,0 +1,17 @@
+#version 460 core
+
+layout(location = 0) in vec4 a_rect;
+layout(location = 1) in vec4 a_uv;
+layout(location = 2) in vec4 a_color;
+
+layout(location = 0) uniform mat4 u_proj;
+
+layout(location = 0) out vec2 v_uv;
+layout(location = 1) out vec4 v_color;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    v_uv = mix(a_uv.xy, a_uv.zw, corner);
+    v_color = a_color;
+    gl_Position = u_proj * vec4(a_rect.xy + corner * a_rect.zw, 0.0, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 450 core
+
+layout(std430, binding = 1) readonly buffer Palette { vec4 palette[]; };
+
+layout(location = 0) flat in uint v_tile;
+layout(location = 1) in vec2 v_local;
+
+layout(location = 0) out vec4 frag_color;
+
+void main() {
+    vec4 color = palette[min(v_tile, uint(palette.length()) - 1u)];
+
+    // Darken the tile border so neighbouring tiles of one id stay readable
+    vec2 edge = min(v_local, 1.0 - v_local);
+    color.rgb *= mix(0.8, 1.0, smoothstep(0.0, 0.08, min(edge.x, edge.y)));
+    frag_color = color;
+}
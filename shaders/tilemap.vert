@@ -0,0 +1,32 @@
+#version 450 core
+#extension GL_ARB_shader_draw_parameters : require
+
+// Each tile is one packed uint: local x in bits 0-4, local y in bits 5-9 and
+// the tile id in bits 16-31. Chunk c owns the slot starting at c * 1024 and
+// is drawn with that slot as its base instance.
+const uint CHUNK_SIZE = 32u;
+const uint CHUNK_TILES = CHUNK_SIZE * CHUNK_SIZE;
+
+layout(std430, binding = 0) readonly buffer Tiles { uint tiles[]; };
+
+layout(location = 0) uniform mat4 u_view_proj;
+layout(location = 1) uniform vec2 u_origin;
+layout(location = 2) uniform float u_tile_size;
+layout(location = 3) uniform uint u_chunks_x;
+
+layout(location = 0) flat out uint v_tile;
+layout(location = 1) out vec2 v_local;
+
+void main() {
+    uint slot = uint(gl_BaseInstanceARB);
+    uint tile = tiles[slot + uint(gl_InstanceID)];
+    uint chunk = slot / CHUNK_TILES;
+
+    uvec2 position = uvec2(chunk % u_chunks_x, chunk / u_chunks_x) * CHUNK_SIZE;
+    position += uvec2(tile & 31u, (tile >> 5u) & 31u);
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    v_tile = tile >> 16u;
+    v_local = corner;
+    gl_Position = u_view_proj * vec4(u_origin + (vec2(position) + corner) * u_tile_size, 0.0, 1.0);
+}
@@ -5,8 +5,8 @@
 #include "../libs/carrier_app.h"
 #include <cglm/vec3.h>
 
-void init_ball(ball* ball) {
-    ball->shd = cg_load_shader("../shaders/ball.vert", "../shaders/ball.frag");
+void init_ball(ball* ball, ctransform_system* transforms, cg_shader shader) {
+    ball->shd = shader;
 
     const GLfloat vertices[] = {
         // Position (quad)
@@ -39,13 +39,17 @@ void init_ball(ball* ball) {
         .primitive_type = GL_TRIANGLES
     });
 
-    ball->model_loc = cg_get_location(ball->shd, "u_model");
-    ball->view_loc = cg_get_location(ball->shd, "u_view");
-    ball->proj_loc = cg_get_location(ball->shd, "u_proj");
-    ball->color_loc = cg_get_location(ball->shd, "u_color");
+    ball->model_loc = MODEL_LOCATION;
+    ball->view_loc = VIEW_LOCATION;
+    ball->proj_loc = PROJ_LOCATION;
+    ball->color_loc = COLOR_LOCATION;
 
     glm_vec3_zero(ball->position);
     glm_vec3_copy((vec3){ BALL_SPEED, BALL_SPEED, 0.0f }, ball->velocity);
+
+    ball->transforms = transforms;
+    ball->node = cr_transform_create(transforms, CTRANSFORM_INVALID);
+    cr_transform_set_scale(transforms, ball->node, (vec3){ BALL_SIZE, BALL_SIZE, 0.0f });
 }
 
 void update_ball(ball* ball, player* player, enemy* enemy, float delta_time, float aspect) {
@@ -78,17 +82,13 @@ void update_ball(ball* ball, player* player, enemy* enemy, float delta_time, flo
     if (ball->position[0] + BALL_HALF_SIZE > aspect || ball->position[0] - BALL_HALF_SIZE < -aspect) {
         ball_reset(ball, aspect);
     }
+
+    cr_transform_set_position(ball->transforms, ball->node, (vec3){ ball->position[0], ball->position[1], 0.0f });
 }
 
 void render_ball(ball* ball, float aspect) {
     const float color_time = cr_get_time();
 
-    // Model matrix (translation, scaling)
-    mat4 translation, scaling, model;
-    glm_translate_make(translation, (vec3){ ball->position[0], ball->position[1], 0.0f });
-    glm_scale_make(scaling, (vec3){ BALL_SIZE, BALL_SIZE, 0.0f });
-    glm_mat4_mul(translation, scaling, model);
-
     // View matrix (identity)
     mat4 view;
     glm_mat4_identity(view);
@@ -114,7 +114,7 @@ void render_ball(ball* ball, float aspect) {
     // Render ball
     cg_apply_pipeline(&ball->pipe);
     cg_apply_bindings(&ball->bind);
-    cg_set_uniform_mat4(ball->model_loc, (GLfloat*)&model[0]);
+    cg_set_uniform_mat4(ball->model_loc, cr_transform_get_world(ball->transforms, ball->node));
     cg_set_uniform_mat4(ball->view_loc, (GLfloat*)&view[0]);
     cg_set_uniform_mat4(ball->proj_loc, (GLfloat*)&projection[0]);
     cg_set_uniform_vec4(ball->color_loc, (GLfloat*)&color[0]);
@@ -2,6 +2,7 @@
 #define BALL_H
 
 #include "../libs/carrier_gfx.h"
+#include "../libs/carrier_transform.h"
 #include <cglm/cglm.h>
 
 typedef struct player player;
@@ -15,11 +16,13 @@ typedef struct ball {
     cg_uniform proj_loc;
     cg_uniform color_loc;
     cg_shader shd;
+    ctransform_system* transforms;
+    ctransform_handle node;
     vec3 position;
     vec3 velocity;
 } ball;
 
-void init_ball(ball* ball);
+void init_ball(ball* ball, ctransform_system* transforms, cg_shader shader);
 void update_ball(ball* ball, player* player, enemy* enemy, float delta_time, float aspect);
 void render_ball(ball* ball, float aspect);
 
@@ -28,4 +28,10 @@
 #define BALL_SIZE   0.05f
 #define BALL_HALF_SIZE (BALL_SIZE / 2.0f)
 
+// Uniform locations, fixed by explicit layout qualifiers in the shaders
+#define MODEL_LOCATION 0
+#define VIEW_LOCATION  1
+#define PROJ_LOCATION  2
+#define COLOR_LOCATION 3
+
 #endif //CONSTANTS_H
@@ -3,8 +3,8 @@
 #include "../libs/carrier_app.h"
 #include "constants.h"
 
-void init_enemy(enemy* enemy) {
-    enemy->shd = cg_load_shader("../shaders/enemy.vert", "../shaders/enemy.frag");
+void init_enemy(enemy* enemy, ctransform_system* transforms, cg_shader shader) {
+    enemy->shd = shader;
 
     const GLfloat vertices[] = {
         // Position (quad)
@@ -37,15 +37,19 @@ void init_enemy(enemy* enemy) {
         .primitive_type = GL_TRIANGLES
     });
 
-    enemy->model_loc = cg_get_location(enemy->shd, "u_model");
-    enemy->view_loc = cg_get_location(enemy->shd, "u_view");
-    enemy->proj_loc = cg_get_location(enemy->shd, "u_proj");
-    enemy->color_loc = cg_get_location(enemy->shd, "u_color");
+    enemy->model_loc = MODEL_LOCATION;
+    enemy->view_loc = VIEW_LOCATION;
+    enemy->proj_loc = PROJ_LOCATION;
+    enemy->color_loc = COLOR_LOCATION;
 
     glm_vec3_zero(enemy->position);
+
+    enemy->transforms = transforms;
+    enemy->node = cr_transform_create(transforms, CTRANSFORM_INVALID);
+    cr_transform_set_scale(transforms, enemy->node, (vec3){ ENEMY_WIDTH, ENEMY_HEIGHT, 0.0f });
 }
 
-void update_enemy(enemy* enemy, ball* ball, float delta_time) {
+void update_enemy(enemy* enemy, ball* ball, float delta_time, float aspect) {
     if (ball->position[0] > 0.0f) {
         if (enemy->position[1] < ball->position[1]) {
             enemy->position[1] += ENEMY_SPEED * delta_time;
@@ -53,17 +57,13 @@ void update_enemy(enemy* enemy, ball* ball, float delta_time) {
             enemy->position[1] -= ENEMY_SPEED * delta_time;
         }
     }
+
+    cr_transform_set_position(enemy->transforms, enemy->node, (vec3){ 0.95f * aspect, enemy->position[1], 0.0f });
 }
 
 void render_enemy(enemy* enemy, float aspect) {
     const float color_time = cr_get_time();
 
-    // Model matrix (translation, scaling)
-    mat4 translation, scaling, model;
-    glm_translate_make(translation, (vec3){ 0.95 * aspect, enemy->position[1], 0.0f });
-    glm_scale_make(scaling, (vec3){ ENEMY_WIDTH, ENEMY_HEIGHT, 0.0f });
-    glm_mat4_mul(translation, scaling, model);
-
     // View matrix(identity)
     mat4 view;
     glm_mat4_identity(view);
@@ -89,7 +89,7 @@ void render_enemy(enemy* enemy, float aspect) {
     // Render enemy
     cg_apply_pipeline(&enemy->pipe);
     cg_apply_bindings(&enemy->bind);
-    cg_set_uniform_mat4(enemy->model_loc, (GLfloat*)&model[0]);
+    cg_set_uniform_mat4(enemy->model_loc, cr_transform_get_world(enemy->transforms, enemy->node));
     cg_set_uniform_mat4(enemy->view_loc, (GLfloat*)&view[0]);
     cg_set_uniform_mat4(enemy->proj_loc, (GLfloat*)&projection[0]);
     cg_set_uniform_vec4(enemy->color_loc, (GLfloat*)&color[0]);
@@ -2,6 +2,7 @@
 #define ENEMY_H
 
 #include "../libs/carrier_gfx.h"
+#include "../libs/carrier_transform.h"
 #include <cglm/cglm.h>
 
 typedef struct ball ball;
@@ -14,11 +15,13 @@ typedef struct enemy {
     cg_uniform proj_loc;
     cg_uniform color_loc;
     cg_shader shd;
+    ctransform_system* transforms;
+    ctransform_handle node;
     vec3 position;
 } enemy;
 
-void init_enemy(enemy* enemy);
-void update_enemy(enemy* enemy, ball* ball, float delta_time);
+void init_enemy(enemy* enemy, ctransform_system* transforms, cg_shader shader);
+void update_enemy(enemy* enemy, ball* ball, float delta_time, float aspect);
 void render_enemy(enemy* enemy, float aspect);
 
 #endif // ENEMY_H
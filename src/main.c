@@ -1,35 +1,130 @@
+#define CARRIER_IMPLEMENTATION
 #include "player.h"
 #include "enemy.h"
 #include "ball.h"
 #include "../libs/carrier_app.h"
+#include "../libs/carrier_particles.h"
+#include "../libs/carrier_readback.h"
+#include "../libs/carrier_text.h"
+#include "../libs/carrier_tilemap.h"
+
+#ifdef CARRIER_SPIRV
+#include "entity.vert.spv.h"
+#include "entity.frag.spv.h"
+#include "entity_round.frag.spv.h"
+#endif
+
+// Feature bits of the entity shader variants, in the order of the features
+#define ENTITY_ROUND (1u << 0)
 
 static struct {
     cg_pass_action pass_action;
+    ctransform_system transforms;
+    cparticle_system particles;
+    ctilemap_map court;
+#ifdef CARRIER_SPIRV
+    cg_shader entity_shaders[2];
+#else
+    cg_shader_variants entity_shaders;
+#endif
     player player;
     enemy enemy;
     ball ball;
     float aspect;
     float width, height;
+    bool hud;
+    char hud_text[64];
+    float hud_time;
+    int hud_frames;
+    const char* capture_path;
+    const char* video_path;
+    long frame_limit;
+    long frame_count;
 } state;
 
 void init(void) {
     cg_setup(&(cg_conf) {
         .blend = true,
-        .depth_test = true
+        .depth_test = true,
+        .capture_path = state.capture_path,
+        .capture_frames = 60
+    });
+
+    // Frames are read back for F12 screenshots and for --video recordings
+    cg_readback_setup(&(creadback_conf) {
+        .sink = state.video_path ? CREADBACK_Y4M : CREADBACK_PNG,
+        .path = state.video_path ? state.video_path : "frame-%05llu.png"
     });
+    if (state.video_path) { cg_readback_record(CREADBACK_CONTINUOUS); }
 
+    // Stencil is unused and depth is not needed once the frame is drawn
     state.pass_action = (cg_pass_action) {
         .clear_color = { 0.1f, 0.1f, 0.15f, 1.0f },
         .clear_depth = 1.0f,
-        .clear_stencil = 0
+        .stencil_load = CG_LOAD_DONTCARE,
+        .depth_store = CG_STORE_DONTCARE,
+        .stencil_store = CG_STORE_DONTCARE
     };
 
     state.width = cr_get_width();
     state.height = cr_get_height(); 
 
-    init_player(&state.player);
-    init_enemy(&state.enemy);
-    init_ball(&state.ball);
+    cr_transform_init(&state.transforms, 16);
+
+    cg_particles_init(&state.particles, &(cparticle_conf) {
+        .capacity = 16384,
+        .gravity = { 0.0f, -0.5f },
+        .restitution = 0.5f
+    });
+
+    // Court background, a faint checkerboard with a dashed center line
+    const vec4 court_palette[] = {
+        { 0.0f, 0.0f, 0.0f, 0.0f },
+        { 1.0f, 1.0f, 1.0f, 0.25f },
+        { 1.0f, 1.0f, 1.0f, 0.02f },
+        { 1.0f, 1.0f, 1.0f, 0.05f }
+    };
+    if (cg_tilemap_init(&state.court, &(ctilemap_conf) {
+        .width = 64,
+        .height = 32,
+        .tile_size = 1.0f / 16.0f,
+        .origin = { -2.0f, -1.0f },
+        .palette = court_palette,
+        .palette_size = sizeof(court_palette) / sizeof(court_palette[0])
+    })) {
+        for (uint32_t y = 0; y < 32; y++) {
+            for (uint32_t x = 0; x < 64; x++) {
+                const bool center = (x == 31 || x == 32) && y % 4 < 2;
+                cg_tilemap_set(&state.court, x, y, center ? 1 : (uint16_t)(2 + (x + y) % 2));
+            }
+        }
+    }
+
+    // Frame rate overlay, the atlas is built from the packed font at startup
+    state.hud = cg_text_setup(&(ctext_conf) { .font = "fonts/DejaVuSansMono.ttf" });
+
+    // The paddles and the ball share one shader, the ball draws the round variant
+#ifdef CARRIER_SPIRV
+    state.entity_shaders[0] = cg_load_shader_spirv(entity_vert_spv, sizeof(entity_vert_spv), entity_frag_spv, sizeof(entity_frag_spv));
+    state.entity_shaders[1] = cg_load_shader_spirv(entity_vert_spv, sizeof(entity_vert_spv), entity_round_frag_spv, sizeof(entity_round_frag_spv));
+    const cg_shader paddle_shader = state.entity_shaders[0];
+    const cg_shader ball_shader = state.entity_shaders[1];
+#else
+    const cg_variant_key entity_variants[] = { 0, ENTITY_ROUND };
+    state.entity_shaders = cg_make_shader_variants(&(cg_shader_variants_conf) {
+        .vertex_path = "shaders/entity.vert",
+        .fragment_path = "shaders/entity.frag",
+        .features = { "ROUND" },
+        .variants = entity_variants,
+        .variant_count = sizeof(entity_variants) / sizeof(entity_variants[0])
+    });
+    const cg_shader paddle_shader = cg_get_shader_variant(&state.entity_shaders, 0);
+    const cg_shader ball_shader = cg_get_shader_variant(&state.entity_shaders, ENTITY_ROUND);
+#endif
+
+    init_player(&state.player, &state.transforms, paddle_shader);
+    init_enemy(&state.enemy, &state.transforms, paddle_shader);
+    init_ball(&state.ball, &state.transforms, ball_shader);
 }
 
 void frame(void) {
@@ -39,6 +134,10 @@ void frame(void) {
     const float delta_time = current_time - last_time;
     last_time = current_time;
 
+    if (state.frame_limit > 0 && ++state.frame_count >= state.frame_limit) {
+        cr_set_window_should_close(true);
+    }
+
     // Get window aspect ratio
     state.aspect = state.width / state.height;
 
@@ -56,21 +155,90 @@ void frame(void) {
     cg_begin_pass(&state.pass_action);
 
     // Update here
-    update_player(&state.player, delta_time, cwindow);
-    update_enemy(&state.enemy, &state.ball, delta_time);
+    update_player(&state.player, delta_time, state.aspect, cr_get_input());
+    update_enemy(&state.enemy, &state.ball, delta_time, state.aspect);
+    const float ball_direction = state.ball.velocity[0];
     update_ball(&state.ball, &state.player, &state.enemy, delta_time, state.aspect);
 
+    // Fold the simulation state into the tick hash, replays compare it every tick
+    cr_replay_hash(state.player.position, sizeof(state.player.position));
+    cr_replay_hash(state.enemy.position, sizeof(state.enemy.position));
+    cr_replay_hash(state.ball.position, sizeof(state.ball.position));
+    cr_replay_hash(state.ball.velocity, sizeof(state.ball.velocity));
+
+    // Recompute world matrices of moved entities only
+    cr_transform_update(&state.transforms);
+
+    // Ball trail, plus a burst of sparks whenever a paddle hits the ball
+    cparticle_emitter emitter = {
+        .position = { state.ball.position[0], state.ball.position[1] },
+        .direction = 0.0f,
+        .spread = 2.0f * GLM_PIf,
+        .speed_min = 0.0f,
+        .speed_max = 0.1f,
+        .lifetime = 0.4f,
+        .size = 0.02f,
+        .color = { 1.0f, 0.8f, 0.4f, 0.8f }
+    };
+    cg_particles_emit(&state.particles, &emitter, 8);
+
+    if ((ball_direction > 0.0f) != (state.ball.velocity[0] > 0.0f)) {
+        emitter.direction = state.ball.velocity[0] > 0.0f ? 0.0f : GLM_PIf;
+        emitter.spread = GLM_PIf * 0.75f;
+        emitter.speed_min = 0.5f;
+        emitter.speed_max = 1.5f;
+        emitter.lifetime = 0.8f;
+        emitter.size = 0.015f;
+        glm_vec4_copy((vec4){ 1.0f, 1.0f, 1.0f, 1.0f }, emitter.color);
+        cg_particles_emit(&state.particles, &emitter, 256);
+    }
+
+    cg_particles_set_bounds(&state.particles, -state.aspect, state.aspect, -1.0f, 1.0f);
+    cg_particles_update(&state.particles, delta_time);
+
     // Render here
+    mat4 projection;
+    glm_ortho(-state.aspect, state.aspect, -1.0f, 1.0f, -1.0f, 1.0f, projection);
+    cg_tilemap_render(&state.court, (float*)projection, -state.aspect, state.aspect, -1.0f, 1.0f);
+
     render_player(&state.player, state.aspect);
     render_enemy(&state.enemy, state.aspect);
     render_ball(&state.ball, state.aspect);
 
+    cg_particles_render(&state.particles, (float*)projection);
+
+    // The overlay text changes twice a second so its layout stays cached
+    if (state.hud) {
+        state.hud_time += delta_time;
+        state.hud_frames++;
+        if (state.hud_time >= 0.5f) {
+            snprintf(state.hud_text, sizeof(state.hud_text), "%.0f FPS %.2f ms",
+                     state.hud_frames / state.hud_time, 1000.0f * state.hud_time / state.hud_frames);
+            state.hud_time = 0.0f;
+            state.hud_frames = 0;
+        }
+        cg_text_draw(state.hud_text, 8.0f, 8.0f, 16.0f, (const float[4]) { 1.0f, 1.0f, 1.0f, 0.8f });
+        cg_text_flush(cr_get_width(), cr_get_height());
+    }
+
     // End pass and commit frame
     cg_end_pass();
+    cg_readback_frame();
     cg_commit();
 }
 
 void cleanup(void) {
+    cg_text_shutdown();
+    cg_particles_shutdown(&state.particles);
+    cg_tilemap_shutdown(&state.court);
+    cr_transform_shutdown(&state.transforms);
+#ifdef CARRIER_SPIRV
+    cg_destroy_shader(state.entity_shaders[0]);
+    cg_destroy_shader(state.entity_shaders[1]);
+#else
+    cg_destroy_shader_variants(&state.entity_shaders);
+#endif
+    cg_readback_shutdown();
     cg_shutdown();
 }
 
@@ -78,7 +246,7 @@ void event(const capp_event* e) {
     static bool wireframe = false;
 
     if (e->type == CAPP_EVENT_KEY_DOWN) {
-        switch (e->input.key_code) {
+        switch (e->data.key.key_code) {
             case CAPP_KEY_ESCAPE:
                 cr_set_window_should_close(true);
                 break;
@@ -88,6 +256,10 @@ void event(const capp_event* e) {
                 cg_set_wireframe(wireframe);
                 break;
 
+            case CAPP_KEY_F12:
+                cg_readback_screenshot("screenshot.png");
+                break;
+
             default:
                 break;
         }
@@ -95,7 +267,27 @@ void event(const capp_event* e) {
 }
 
 capp_conf carrier_main(int argc, char* argv[]) {
-    (void)argc, (void)argv;
+    // --record <file> saves the session, --replay <file> plays it back,
+    // --timestep <seconds> records on a fixed step that the replay reuses,
+    // --capture <file> writes the graphics commands of 60 frames for carrier-replay,
+    // --frames <count> quits after the given number of frames,
+    // --video <file> records the session as Y4M, "|command" pipes it instead
+    capp_replay_conf replay = {0};
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0) {
+            replay.record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            replay.replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--timestep") == 0) {
+            replay.timestep = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            state.capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            state.frame_limit = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--video") == 0) {
+            state.video_path = argv[++i];
+        }
+    }
 
     return (capp_conf) {
         .init_cb = init,
@@ -109,6 +301,12 @@ capp_conf carrier_main(int argc, char* argv[]) {
         .fullscreen = false,
         .gl_major = 4,
         .gl_minor = 6,
+        .late_input_latch = true,
+        .replay = replay,
+        .log = {
+            .level = CR_SUCCESS,
+            .rate_limit = 10
+        },
     };
 }
 
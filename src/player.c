@@ -3,8 +3,8 @@
 #include "constants.h"
 #include "../libs/carrier_app.h"
 
-void init_player(player* player) {
-    player->shd = cg_load_shader("../shaders/player.vert", "../shaders/player.frag");
+void init_player(player* player, ctransform_system* transforms, cg_shader shader) {
+    player->shd = shader;
 
     const GLfloat vertices[] = {
         // Position (quad)
@@ -37,20 +37,24 @@ void init_player(player* player) {
         .primitive_type = GL_TRIANGLES
     });
 
-    player->model_loc = cg_get_location(player->shd, "u_model");
-    player->view_loc = cg_get_location(player->shd, "u_view");
-    player->proj_loc = cg_get_location(player->shd, "u_proj");
-    player->color_loc = cg_get_location(player->shd, "u_color");
+    player->model_loc = MODEL_LOCATION;
+    player->view_loc = VIEW_LOCATION;
+    player->proj_loc = PROJ_LOCATION;
+    player->color_loc = COLOR_LOCATION;
 
     glm_vec3_zero(player->position);
+
+    player->transforms = transforms;
+    player->node = cr_transform_create(transforms, CTRANSFORM_INVALID);
+    cr_transform_set_scale(transforms, player->node, (vec3){ PLAYER_WIDTH, PLAYER_HEIGHT, 0.0f });
 }
 
-void update_player(player* player, float delta_time, const capp_window* window) {
+void update_player(player* player, float delta_time, float aspect, const capp_input* input) {
     int direction = 0;
 
-    if (cr_get_key(window, CAPP_KEY_W) == GLFW_PRESS) {
+    if (cr_key_held(input, CAPP_KEY_W)) {
         direction = 1;
-    } else if (cr_get_key(window, CAPP_KEY_S) == GLFW_PRESS) {
+    } else if (cr_key_held(input, CAPP_KEY_S)) {
         direction = -1;
     }
 
@@ -65,17 +69,13 @@ void update_player(player* player, float delta_time, const capp_window* window)
     } else if (player->position[1] < BOTTOM_BOUNDARY + PLAYER_HALF_HEIGHT) {
         player->position[1] = BOTTOM_BOUNDARY + PLAYER_HALF_HEIGHT;
     }
+
+    cr_transform_set_position(player->transforms, player->node, (vec3){ -0.95f * aspect, player->position[1], 0.0f });
 }
 
 void render_player(player* player, float aspect) {
     const float color_time = cr_get_time();
 
-    // Model matrix (translation, scaling)
-    mat4 translation, scaling, model;
-    glm_translate_make(translation, (vec3){ -0.95f * aspect, player->position[1], 0.0f });
-    glm_scale_make(scaling, (vec3){ PLAYER_WIDTH, PLAYER_HEIGHT, 0.0f });
-    glm_mat4_mul(translation, scaling, model);
-
     // View matrix (identity)
     mat4 view;
     glm_mat4_identity(view);
@@ -101,7 +101,7 @@ void render_player(player* player, float aspect) {
     // Render player
     cg_apply_pipeline(&player->pipe);
     cg_apply_bindings(&player->bind);
-    cg_set_uniform_mat4(player->model_loc, (GLfloat*)&model[0]);
+    cg_set_uniform_mat4(player->model_loc, cr_transform_get_world(player->transforms, player->node));
     cg_set_uniform_mat4(player->view_loc, (GLfloat*)&view[0]);
     cg_set_uniform_mat4(player->proj_loc, (GLfloat*)&projection[0]);
     cg_set_uniform_vec4(player->color_loc, (GLfloat*)&color[0]);
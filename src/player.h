@@ -2,6 +2,7 @@
 #define PLAYER_H
 
 #include "../libs/carrier_gfx.h"
+#include "../libs/carrier_transform.h"
 #include <cglm/cglm.h>
 
 typedef struct player {
@@ -12,11 +13,13 @@ typedef struct player {
     cg_uniform proj_loc;
     cg_uniform color_loc;
     cg_shader shd;
+    ctransform_system* transforms;
+    ctransform_handle node;
     vec3 position;
 } player;
 
-void init_player(player* player);
-void update_player(player* player, float delta_time, const capp_window* window);
+void init_player(player* player, ctransform_system* transforms, cg_shader shader);
+void update_player(player* player, float delta_time, float aspect, const capp_input* input);
 void render_player(player* player, float aspect);
 
 #endif // PLAYER_H
@@ -0,0 +1,882 @@
+#define CARRIER_IMPLEMENTATION
+#include "../src/player.h"
+#include "../src/enemy.h"
+#include "../src/ball.h"
+#include "../src/constants.h"
+#include "../libs/carrier_app.h"
+#include "../libs/carrier_particles.h"
+#include "../libs/carrier_tilemap.h"
+#include "../libs/carrier_text.h"
+#include "../libs/carrier_stream.h"
+#include "../libs/carrier_graph.h"
+#include "../libs/carrier_mesh.h"
+#include <math.h>
+#include <sched.h>
+
+// Runs the benchmark scenarios headless and writes the results as JSON.
+// Usage: carrier-bench [--output <file>] [--baseline <file>] [--threshold <percent>]
+//                      [--samples <count>] [--filter <name>]
+// Every scenario runs a fixed number of operations per sample, so results of
+// two runs on the same machine are comparable. Medians slower than the
+// baseline by more than the threshold fail the run, and so do scenarios of
+// the baseline that did not run, e.g. graphics scenarios without a display.
+
+#define BENCH_MAX_SAMPLES 64
+#define BENCH_DEFAULT_SAMPLES 10
+#define BENCH_DEFAULT_THRESHOLD 10.0
+#define BENCH_QUAD_COUNT 10000
+#define BENCH_EVENT_BATCH 512
+#define BENCH_LOG_BATCH (CLOG_RING_SIZE / 2)
+#define BENCH_NAME_SIZE 64
+#define BENCH_PARTICLE_COUNT 1000000
+#define BENCH_TILEMAP_SIZE 4096
+#define BENCH_TILEMAP_VIEW_WIDTH 64.0f
+#define BENCH_TILEMAP_VIEW_HEIGHT 36.0f
+#define BENCH_TEXT_LABELS 2000
+#define BENCH_TEXT_STRINGS 64
+#define BENCH_STREAM_ASSET "fonts/DejaVuSansMono.ttf"
+#define BENCH_EVICT_MESHES 32
+#define BENCH_EVICT_RESIDENT 16
+#define BENCH_EVICT_WINDOW 8
+#define BENCH_MESH_COUNT 1024
+#define BENCH_MESH_CHURN 32
+#define BENCH_MESH_COMPACT 50
+#define BENCH_MESH_CELLS 16
+#define BENCH_GRAPH_QUADS 64
+#define BENCH_GRAPH_TOGGLE 16
+#define BENCH_JOB_ELEMENTS (1u << 20)
+#define BENCH_JOB_BATCH 1024
+
+// Scenario description, run returns the time spent on the measured part
+typedef struct {
+    const char* name;
+    const char* operation;
+    size_t operations;
+    bool needs_gl;
+    uint64_t (*run)(size_t operations);
+} bench_scenario;
+
+// Result of a scenario, times are in nanoseconds per operation
+typedef struct {
+    const char* name;
+    const char* operation;
+    double median;
+    double stddev;
+    size_t iterations;
+    size_t samples;
+} bench_result;
+
+// Baseline entry read back from a previous run
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    double median;
+} bench_baseline;
+
+// Global variable to hold the state shared by the graphics scenarios
+static struct {
+    GLFWwindow* window;
+    cg_shader shader;
+    cg_bindings quad;
+    cparticle_system particles;
+    bool particles_ready;
+    ctilemap_map tilemap;
+    bool tilemap_ready;
+    bool text_ready;
+    cmesh_pool meshes;
+    cmesh_handle mesh_handles[BENCH_MESH_COUNT];
+    cmesh_command mesh_commands[BENCH_MESH_COUNT];
+    bool meshes_ready;
+    cgraph_graph graph;
+    cgraph_pass graph_debug;
+    bool graph_ready;
+    bool available;
+} bench_gl;
+
+static const GLfloat quad_vertices[] = {
+    -0.5f, -0.5f, 0.0f,
+     0.5f, -0.5f, 0.0f,
+     0.5f,  0.5f, 0.0f,
+    -0.5f,  0.5f, 0.0f
+};
+
+static const GLint quad_indices[] = { 0, 1, 2, 2, 3, 0 };
+
+static uint64_t bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static cg_bindings bench_make_quad(void) {
+    return cg_make_buffer(&(cg_buffer_conf) {
+        .vertex_buffer = { .size = sizeof(quad_vertices), .data = quad_vertices },
+        .index_buffer = { .size = sizeof(quad_indices), .data = quad_indices }
+    });
+}
+
+static bool bench_gl_setup(void) {
+    if (!glfwInit()) {
+        cr_log(CR_WARNING, "No display available, skipping graphics scenarios");
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    bench_gl.window = glfwCreateWindow(256, 256, "carrier-bench", NULL, NULL);
+    if (!bench_gl.window) {
+        cr_log(CR_WARNING, "Failed to create hidden window, skipping graphics scenarios");
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(bench_gl.window);
+    glfwSwapInterval(0);
+    cg_setup(&(cg_conf) { .blend = false, .depth_test = false });
+
+    bench_gl.shader = cg_load_shader("shaders/entity.vert", "shaders/entity.frag");
+    if (!bench_gl.shader.program) {
+        cg_shutdown();
+        glfwDestroyWindow(bench_gl.window);
+        glfwTerminate();
+        return false;
+    }
+    bench_gl.quad = bench_make_quad();
+    return true;
+}
+
+static void bench_gl_shutdown(void) {
+    if (bench_gl.particles_ready) { cg_particles_shutdown(&bench_gl.particles); }
+    if (bench_gl.tilemap_ready) { cg_tilemap_shutdown(&bench_gl.tilemap); }
+    if (bench_gl.text_ready) { cg_text_shutdown(); }
+    if (bench_gl.meshes_ready) { cg_mesh_shutdown(&bench_gl.meshes); }
+    if (bench_gl.graph_ready) { cg_graph_shutdown(&bench_gl.graph); }
+    cg_shutdown();
+    glfwDestroyWindow(bench_gl.window);
+    glfwTerminate();
+}
+
+// SCENARIOS
+// === === === === === ===
+// === === === === === ===
+
+static uint64_t bench_draw_quads(size_t frames) {
+    mat4 identity, model;
+    glm_mat4_identity(identity);
+    const vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    cg_pipeline pipeline = { .shader = bench_gl.shader, .primitive_type = GL_TRIANGLES };
+
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        cg_apply_pipeline(&pipeline);
+        cg_apply_bindings(&bench_gl.quad);
+        cg_set_uniform_mat4(VIEW_LOCATION, (GLfloat*)&identity[0]);
+        cg_set_uniform_mat4(PROJ_LOCATION, (GLfloat*)&identity[0]);
+        cg_set_uniform_vec4(COLOR_LOCATION, color);
+
+        for (int i = 0; i < BENCH_QUAD_COUNT; i++) {
+            glm_translate_make(model, (vec3){ (float)(i % 100) * 0.02f - 1.0f, (float)(i / 100) * 0.02f - 1.0f, 0.0f });
+            glm_scale_uniform(model, 0.01f);
+            cg_set_uniform_mat4(MODEL_LOCATION, (GLfloat*)&model[0]);
+            cg_render(&bench_gl.quad, 0, 6, 1);
+        }
+        cg_end_pass();
+        glFinish();
+    }
+    return bench_now() - start;
+}
+
+static uint64_t bench_shader_load(size_t loads, bool cold) {
+    uint64_t elapsed = 0;
+
+    for (size_t i = 0; i < loads; i++) {
+        // A cold load maps and indexes the archive again. Driver-side shader
+        // caches cannot be flushed from here and may still be warm.
+        if (cold) { cr_asset_unmount(); }
+
+        const uint64_t start = bench_now();
+        cg_shader shader = cg_load_shader("shaders/entity.vert", "shaders/entity.frag");
+        elapsed += bench_now() - start;
+
+        if (shader.program) { cg_destroy_shader(shader); }
+    }
+    return elapsed;
+}
+
+static uint64_t bench_shader_load_cold(size_t loads) {
+    return bench_shader_load(loads, true);
+}
+
+static uint64_t bench_shader_load_warm(size_t loads) {
+    return bench_shader_load(loads, false);
+}
+
+static uint64_t bench_buffer_churn(size_t buffers) {
+    const uint64_t start = bench_now();
+    for (size_t i = 0; i < buffers; i++) {
+        cg_destroy_buffer(bench_make_quad());
+    }
+    glFinish();
+    return bench_now() - start;
+}
+
+static uint64_t bench_particles(size_t frames) {
+    mat4 identity;
+    glm_mat4_identity(identity);
+
+    // Fill the system once with particles that outlive the benchmark, every
+    // frame then simulates, compacts and draws all of them
+    if (!bench_gl.particles_ready) {
+        bench_gl.particles_ready = cg_particles_init(&bench_gl.particles, &(cparticle_conf) {
+            .capacity = BENCH_PARTICLE_COUNT,
+            .gravity = { 0.0f, -0.1f },
+            .restitution = 0.9f
+        });
+        if (!bench_gl.particles_ready) { return 0; }
+
+        cg_particles_emit(&bench_gl.particles, &(cparticle_emitter) {
+            .spread = 2.0f * GLM_PIf,
+            .speed_min = 0.1f,
+            .speed_max = 1.0f,
+            .lifetime = 1e6f,
+            .size = 0.002f,
+            .color = { 1.0f, 1.0f, 1.0f, 0.5f }
+        }, BENCH_PARTICLE_COUNT);
+    }
+
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        cg_particles_update(&bench_gl.particles, 1.0f / 60.0f);
+        cg_particles_render(&bench_gl.particles, (float*)identity);
+        glFinish();
+    }
+    return bench_now() - start;
+}
+
+static uint64_t bench_tilemap(size_t frames) {
+    static const vec4 palette[] = {
+        { 0.0f, 0.0f, 0.0f, 0.0f },
+        { 0.2f, 0.5f, 0.2f, 1.0f },
+        { 0.4f, 0.3f, 0.2f, 1.0f },
+        { 0.2f, 0.3f, 0.6f, 1.0f }
+    };
+
+    // Fill every tile once, the scenario then scrolls a 64x36 tile view
+    // diagonally so chunks keep entering the view and get built lazily
+    if (!bench_gl.tilemap_ready) {
+        bench_gl.tilemap_ready = cg_tilemap_init(&bench_gl.tilemap, &(ctilemap_conf) {
+            .width = BENCH_TILEMAP_SIZE,
+            .height = BENCH_TILEMAP_SIZE,
+            .tile_size = 1.0f,
+            .palette = palette,
+            .palette_size = sizeof(palette) / sizeof(palette[0])
+        });
+        if (!bench_gl.tilemap_ready) { return 0; }
+
+        uint16_t* tiles = (uint16_t*)malloc((size_t)BENCH_TILEMAP_SIZE * BENCH_TILEMAP_SIZE * sizeof(uint16_t));
+        if (!tiles) { return 0; }
+        for (size_t i = 0; i < (size_t)BENCH_TILEMAP_SIZE * BENCH_TILEMAP_SIZE; i++) {
+            tiles[i] = (uint16_t)(1 + (i * 2654435761u >> 16) % 3);
+        }
+        cg_tilemap_load(&bench_gl.tilemap, tiles);
+        free(tiles);
+    }
+
+    const float range = (float)BENCH_TILEMAP_SIZE - BENCH_TILEMAP_VIEW_WIDTH;
+    static size_t position = 0;
+    mat4 projection;
+
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++, position++) {
+        const float left = fmodf((float)position * 8.0f, range);
+        const float bottom = fmodf((float)position * 5.0f, range);
+        glm_ortho(left, left + BENCH_TILEMAP_VIEW_WIDTH, bottom, bottom + BENCH_TILEMAP_VIEW_HEIGHT, -1.0f, 1.0f, projection);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        cg_tilemap_render(&bench_gl.tilemap, (float*)projection, left, left + BENCH_TILEMAP_VIEW_WIDTH, bottom, bottom + BENCH_TILEMAP_VIEW_HEIGHT);
+        glFinish();
+    }
+    return bench_now() - start;
+}
+
+static uint64_t bench_text(size_t frames) {
+    static char labels[BENCH_TEXT_STRINGS][32];
+    const float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // HUD-style frame, a few distinct labels drawn many times so layouts are
+    // cached and the cost is batching and the single instanced draw
+    if (!bench_gl.text_ready) {
+        bench_gl.text_ready = cg_text_setup(&(ctext_conf) { .font = "fonts/DejaVuSansMono.ttf" });
+        if (!bench_gl.text_ready) { return 0; }
+
+        for (int i = 0; i < BENCH_TEXT_STRINGS; i++) {
+            snprintf(labels[i], sizeof(labels[i]), "Label %d: %d units", i, i * 37);
+        }
+    }
+
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (int i = 0; i < BENCH_TEXT_LABELS; i++) {
+            cg_text_draw(labels[i % BENCH_TEXT_STRINGS], (float)(i % 8) * 32.0f, (float)(i / 8) * 1.0f, 12.0f, color);
+        }
+        cg_text_flush(256.0f, 256.0f);
+        glFinish();
+    }
+    return bench_now() - start;
+}
+
+static uint64_t bench_stream(size_t meshes) {
+    cstream_handle handles[CSTREAM_MAX_RESOURCES];
+    if (meshes > CSTREAM_MAX_RESOURCES) { meshes = CSTREAM_MAX_RESOURCES; }
+
+    // The font is the largest packed asset, its bytes are streamed as raw
+    // vertex data under the default per-update budget until every copy is ready
+    cr_stream_setup(&(cstream_conf) {0});
+
+    const uint64_t start = bench_now();
+    for (size_t i = 0; i < meshes; i++) {
+        handles[i] = cr_stream_load_mesh(BENCH_STREAM_ASSET, NULL, NULL);
+    }
+
+    size_t pending = meshes;
+    while (pending > 0) {
+        cr_stream_update();
+        pending = 0;
+        for (size_t i = 0; i < meshes; i++) {
+            pending += cr_stream_get_state(handles[i]) == CSTREAM_LOADING;
+        }
+    }
+    glFinish();
+    const uint64_t elapsed = bench_now() - start;
+
+    for (size_t i = 0; i < meshes; i++) {
+        cr_stream_release(handles[i]);
+    }
+    cr_stream_shutdown();
+    return elapsed;
+}
+
+static uint64_t bench_stream_evict(size_t frames) {
+    cstream_handle handles[BENCH_EVICT_MESHES];
+    const size_t mesh_size = cr_asset_get(BENCH_STREAM_ASSET).size;
+    const cg_memory_stats memory = cg_get_memory_stats();
+
+    // Twice as many copies of the font as the memory budget holds, a window
+    // of them sliding over all copies is used every frame, so the least
+    // recently used ones keep being evicted and reloaded as it comes around
+    cr_stream_setup(&(cstream_conf) {0});
+    cg_set_memory_budget(memory.total + BENCH_EVICT_RESIDENT * mesh_size);
+    for (size_t i = 0; i < BENCH_EVICT_MESHES; i++) {
+        handles[i] = cr_stream_load_mesh(BENCH_STREAM_ASSET, NULL, NULL);
+    }
+
+    static size_t position = 0;
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++, position++) {
+        for (size_t i = 0; i < BENCH_EVICT_WINDOW; i++) {
+            cr_stream_get_bindings(handles[(position + i) % BENCH_EVICT_MESHES]);
+        }
+        cr_stream_update();
+    }
+    glFinish();
+    const uint64_t elapsed = bench_now() - start;
+
+    for (size_t i = 0; i < BENCH_EVICT_MESHES; i++) {
+        cr_stream_release(handles[i]);
+    }
+    cr_stream_shutdown();
+    cg_set_memory_budget(memory.budget);
+    return elapsed;
+}
+
+// Adds a strip of quads to the pool, the size varies with the seed
+static cmesh_handle bench_mesh_add(size_t seed) {
+    static GLfloat vertices[(BENCH_MESH_CELLS + 1) * 2 * 3];
+    static uint32_t indices[BENCH_MESH_CELLS * 6];
+    const uint32_t cells = 1 + (uint32_t)((seed * 2654435761u >> 16) % BENCH_MESH_CELLS);
+    const float x = (float)(seed % 32) * 0.0625f - 1.0f;
+    const float y = (float)(seed / 32 % 32) * 0.0625f - 1.0f;
+
+    for (uint32_t i = 0; i <= cells; i++) {
+        for (uint32_t side = 0; side < 2; side++) {
+            GLfloat* vertex = &vertices[(i * 2 + side) * 3];
+            vertex[0] = x + (float)i * 0.06f / (float)cells;
+            vertex[1] = y + (float)side * 0.06f;
+            vertex[2] = 0.0f;
+        }
+    }
+    for (uint32_t i = 0; i < cells; i++) {
+        const uint32_t quad[6] = { i * 2, i * 2 + 2, i * 2 + 3, i * 2 + 3, i * 2 + 1, i * 2 };
+        memcpy(&indices[i * 6], quad, sizeof(quad));
+    }
+    return cg_mesh_add(&bench_gl.meshes, &(cmesh_data) {
+        .vertices = vertices, .vertex_count = (cells + 1) * 2, .indices = indices, .index_count = cells * 6
+    });
+}
+
+static uint64_t bench_mesh_pool(size_t frames) {
+    mat4 identity;
+    glm_mat4_identity(identity);
+    const vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    cg_pipeline pipeline = { .shader = bench_gl.shader, .primitive_type = GL_TRIANGLES };
+
+    // Strips of different lengths in one pool. Every frame replaces a few of
+    // them so the pool fragments, compacts it now and then, and draws every
+    // mesh with one indirect call.
+    if (!bench_gl.meshes_ready) {
+        bench_gl.meshes_ready = cg_mesh_init(&bench_gl.meshes, &(cmesh_conf) { .vertex_capacity = 4096, .index_capacity = 8192 });
+        if (!bench_gl.meshes_ready) { return 0; }
+        for (size_t i = 0; i < BENCH_MESH_COUNT; i++) {
+            bench_gl.mesh_handles[i] = bench_mesh_add(i);
+        }
+    }
+
+    static size_t position = 0;
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++, position++) {
+        for (size_t i = 0; i < BENCH_MESH_CHURN; i++) {
+            const size_t slot = (position * BENCH_MESH_CHURN + i) * 7 % BENCH_MESH_COUNT;
+            cg_mesh_remove(&bench_gl.meshes, bench_gl.mesh_handles[slot]);
+            bench_gl.mesh_handles[slot] = bench_mesh_add(slot + position);
+        }
+        if (position % BENCH_MESH_COMPACT == BENCH_MESH_COMPACT - 1) { cg_mesh_compact(&bench_gl.meshes); }
+
+        for (size_t i = 0; i < BENCH_MESH_COUNT; i++) {
+            bench_gl.mesh_commands[i] = cg_mesh_command(&bench_gl.meshes, bench_gl.mesh_handles[i], 1, 0);
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        cg_apply_pipeline(&pipeline);
+        cg_mesh_apply(&bench_gl.meshes);
+        cg_set_uniform_mat4(MODEL_LOCATION, (GLfloat*)&identity[0]);
+        cg_set_uniform_mat4(VIEW_LOCATION, (GLfloat*)&identity[0]);
+        cg_set_uniform_mat4(PROJ_LOCATION, (GLfloat*)&identity[0]);
+        cg_set_uniform_vec4(COLOR_LOCATION, color);
+        cg_mesh_draw_indirect(&bench_gl.meshes, bench_gl.mesh_commands, BENCH_MESH_COUNT);
+        glFinish();
+    }
+    return bench_now() - start;
+}
+
+// Draws a grid of quads with the ball shader, the work of every graph pass
+static void bench_graph_draw(void* user) {
+    (void)user;
+    mat4 identity, model;
+    glm_mat4_identity(identity);
+    const vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    cg_pipeline pipeline = { .shader = bench_gl.shader, .primitive_type = GL_TRIANGLES };
+
+    cg_apply_pipeline(&pipeline);
+    cg_apply_bindings(&bench_gl.quad);
+    cg_set_uniform_mat4(VIEW_LOCATION, (GLfloat*)&identity[0]);
+    cg_set_uniform_mat4(PROJ_LOCATION, (GLfloat*)&identity[0]);
+    cg_set_uniform_vec4(COLOR_LOCATION, color);
+    for (int i = 0; i < BENCH_GRAPH_QUADS; i++) {
+        glm_translate_make(model, (vec3){ (float)(i % 8) * 0.25f - 0.875f, (float)(i / 8) * 0.25f - 0.875f, 0.0f });
+        glm_scale_uniform(model, 0.2f);
+        cg_set_uniform_mat4(MODEL_LOCATION, (GLfloat*)&model[0]);
+        cg_render(&bench_gl.quad, 0, 6, 1);
+    }
+}
+
+static uint64_t bench_graph(size_t frames) {
+    // Deferred-style frame: a scene pass into color and depth, lighting and a
+    // half resolution bloom reading it, a composite onto the window, and a
+    // debug view nothing reads, which is culled. Toggling the debug pass every
+    // few frames recompiles the graph, so the compiler is measured too.
+    if (!bench_gl.graph_ready) {
+        cgraph_graph* graph = &bench_gl.graph;
+        cg_graph_init(graph);
+
+        const cgraph_resource scene = cg_graph_create_texture(graph, "scene", &(cgraph_texture_conf){ .format = CG_PIXELFORMAT_RGBA8 });
+        const cgraph_resource depth = cg_graph_create_texture(graph, "depth", &(cgraph_texture_conf){ .format = CG_PIXELFORMAT_DEPTH24_STENCIL8 });
+        const cgraph_resource lit = cg_graph_create_texture(graph, "lit", &(cgraph_texture_conf){ .format = CG_PIXELFORMAT_RGBA16F });
+        const cgraph_resource bloom = cg_graph_create_texture(graph, "bloom", &(cgraph_texture_conf){ .scale = 0.5f, .format = CG_PIXELFORMAT_RGBA16F });
+        const cgraph_resource debug = cg_graph_create_texture(graph, "debug", &(cgraph_texture_conf){ .format = CG_PIXELFORMAT_RGBA8 });
+        const cg_pass_action clear = { .clear_depth = 1.0f };
+
+        cg_graph_add_pass(graph, &(cgraph_pass_conf){
+            .name = "scene", .colors = { scene }, .depth = depth, .action = clear, .execute = bench_graph_draw
+        });
+        cg_graph_add_pass(graph, &(cgraph_pass_conf){
+            .name = "lighting", .reads = { scene, depth }, .colors = { lit }, .action = clear, .execute = bench_graph_draw
+        });
+        cg_graph_add_pass(graph, &(cgraph_pass_conf){
+            .name = "bloom", .reads = { lit }, .colors = { bloom }, .action = clear, .execute = bench_graph_draw
+        });
+        bench_gl.graph_debug = cg_graph_add_pass(graph, &(cgraph_pass_conf){
+            .name = "debug", .reads = { depth }, .colors = { debug }, .action = clear, .execute = bench_graph_draw
+        });
+        cg_graph_add_pass(graph, &(cgraph_pass_conf){
+            .name = "composite", .reads = { lit, bloom }, .colors = { CGRAPH_BACKBUFFER }, .action = clear, .execute = bench_graph_draw
+        });
+        bench_gl.graph_ready = cg_graph_compile(graph);
+        if (!bench_gl.graph_ready) {
+            cg_graph_shutdown(graph);
+            return 0;
+        }
+    }
+
+    static size_t position = 0;
+    const uint64_t start = bench_now();
+    for (size_t frame = 0; frame < frames; frame++, position++) {
+        if (position % BENCH_GRAPH_TOGGLE == 0) {
+            cg_graph_set_pass_enabled(&bench_gl.graph, bench_gl.graph_debug, (position / BENCH_GRAPH_TOGGLE) % 2 == 0);
+        }
+        cg_graph_execute(&bench_gl.graph);
+        glFinish();
+    }
+    return bench_now() - start;
+}
+
+static float bench_job_values[BENCH_JOB_ELEMENTS];
+
+static void bench_job_integrate(void* data, size_t begin, size_t end) {
+    const float delta_time = *(const float*)data;
+    for (size_t i = begin; i < end; i++) {
+        bench_job_values[i] += (1.0f - bench_job_values[i]) * delta_time;
+    }
+}
+
+static uint64_t bench_jobs_parallel_for(size_t passes) {
+    float delta_time = 1.0f / 60.0f;
+
+    const uint64_t start = bench_now();
+    for (size_t pass = 0; pass < passes; pass++) {
+        cjob_counter counter = {0};
+        cr_jobs_parallel_for(BENCH_JOB_ELEMENTS, 0, bench_job_integrate, &delta_time, &counter);
+        cr_jobs_wait(&counter);
+    }
+    return bench_now() - start;
+}
+
+static void bench_job_empty(void* data) {
+    (void)data;
+}
+
+static uint64_t bench_jobs_spawn(size_t jobs) {
+    const cjob_decl decl = { bench_job_empty, NULL, NULL };
+    cjob_counter counter = {0};
+
+    // Waiting every batch keeps the pools from filling up and running inline
+    const uint64_t start = bench_now();
+    for (size_t i = 0; i < jobs; i++) {
+        cr_jobs_run(&decl, 1, &counter);
+        if ((i + 1) % BENCH_JOB_BATCH == 0) { cr_jobs_wait(&counter); }
+    }
+    cr_jobs_wait(&counter);
+    return bench_now() - start;
+}
+
+static size_t bench_dispatched = 0;
+
+static void bench_count_event(const capp_event* event) {
+    bench_dispatched += (size_t)event->data.key.key_code & 1u;
+}
+
+static uint64_t bench_event_dispatch(size_t events) {
+    capp_event event = { .type = CAPP_EVENT_KEY_DOWN };
+    size_t pushed = 0;
+
+    const uint64_t start = bench_now();
+    while (pushed < events) {
+        const size_t batch = events - pushed < BENCH_EVENT_BATCH ? events - pushed : BENCH_EVENT_BATCH;
+        for (size_t i = 0; i < batch; i++) {
+            event.data.key.key_code = (capp_keycode)(CAPP_KEY_A + (int)((pushed + i) % 26));
+            cr_event_queue_push(&cevents, &event);
+        }
+        cr_drain_events(bench_count_event);
+        pushed += batch;
+    }
+    return bench_now() - start;
+}
+
+static uint64_t bench_log_throughput(size_t messages) {
+    uint64_t elapsed = 0;
+
+    // Write to /dev/null so only the logging path itself is measured
+    cr_log_shutdown();
+    cr_log_setup(&(clog_conf) { .level = CR_DEBUG, .path = "/dev/null" });
+
+    for (size_t written = 0; written < messages; written += BENCH_LOG_BATCH) {
+        const uint64_t start = bench_now();
+        for (size_t i = 0; i < BENCH_LOG_BATCH; i++) {
+            cr_logf(CR_DEBUG, "Benchmark message %zu of %zu", written + i, messages);
+        }
+        elapsed += bench_now() - start;
+
+        // Wait for the log thread outside the measurement so no record is dropped
+        while (clog_thread_ring && __atomic_load_n(&clog_thread_ring->head, __ATOMIC_ACQUIRE) != clog_thread_ring->tail) {
+            sched_yield();
+        }
+    }
+
+    cr_log_shutdown();
+    cr_log_setup(&(clog_conf) { .level = CR_WARNING });
+    return elapsed;
+}
+
+static uint64_t bench_simulation_tick(size_t ticks) {
+    ctransform_system transforms;
+    player player = {0};
+    enemy enemy = {0};
+    ball ball = {0};
+    capp_input input = {0};
+    const float delta_time = 1.0f / 60.0f;
+    const float aspect = 4.0f / 3.0f;
+
+    // Build the entities without their graphics resources
+    cr_transform_init(&transforms, 16);
+    player.transforms = enemy.transforms = ball.transforms = &transforms;
+    player.node = cr_transform_create(&transforms, CTRANSFORM_INVALID);
+    enemy.node = cr_transform_create(&transforms, CTRANSFORM_INVALID);
+    ball.node = cr_transform_create(&transforms, CTRANSFORM_INVALID);
+    glm_vec3_copy((vec3){ BALL_SPEED, BALL_SPEED, 0.0f }, ball.velocity);
+
+    const uint64_t start = bench_now();
+    for (size_t tick = 0; tick < ticks; tick++) {
+        // Alternate between holding W and S every two seconds
+        const capp_keycode held = (tick / 120) % 2 == 0 ? CAPP_KEY_W : CAPP_KEY_S;
+        memset(input.keys, 0, sizeof(input.keys));
+        input.keys[held >> 6] |= (uint64_t)1 << (held & 63);
+
+        update_player(&player, delta_time, aspect, &input);
+        update_enemy(&enemy, &ball, delta_time, aspect);
+        update_ball(&ball, &player, &enemy, delta_time, aspect);
+        cr_transform_update(&transforms);
+    }
+    const uint64_t elapsed = bench_now() - start;
+
+    cr_transform_shutdown(&transforms);
+    return elapsed;
+}
+
+static const bench_scenario scenarios[] = {
+    { "draw_quads", "frame", 20, true, bench_draw_quads },
+    { "shader_load_cold", "load", 10, true, bench_shader_load_cold },
+    { "shader_load_warm", "load", 10, true, bench_shader_load_warm },
+    { "buffer_churn", "buffer", 1000, true, bench_buffer_churn },
+    { "particles_1m", "frame", 20, true, bench_particles },
+    { "tilemap_4096", "frame", 100, true, bench_tilemap },
+    { "text_labels", "frame", 20, true, bench_text },
+    { "stream_upload", "mesh", 64, true, bench_stream },
+    { "stream_evict", "frame", 100, true, bench_stream_evict },
+    { "mesh_pool", "frame", 100, true, bench_mesh_pool },
+    { "graph_frame", "frame", 100, true, bench_graph },
+    { "event_dispatch", "event", 100000, false, bench_event_dispatch },
+    { "log_throughput", "message", 8192, false, bench_log_throughput },
+    { "simulation_tick", "tick", 100000, false, bench_simulation_tick },
+    { "jobs_parallel_for", "pass", 100, false, bench_jobs_parallel_for },
+    { "jobs_spawn", "job", 100000, false, bench_jobs_spawn },
+};
+
+// REPORTING
+// === === === === === ===
+// === === === === === ===
+
+static int compare_doubles(const void* a, const void* b) {
+    const double lhs = *(const double*)a;
+    const double rhs = *(const double*)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static bench_result bench_run(const bench_scenario* scenario, size_t samples) {
+    double times[BENCH_MAX_SAMPLES];
+
+    // The first sample warms caches and lazy initialization and is discarded
+    scenario->run(scenario->operations);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < samples; i++) {
+        times[i] = (double)scenario->run(scenario->operations) / (double)scenario->operations;
+        sum += times[i];
+    }
+
+    const double mean = sum / (double)samples;
+    double variance = 0.0;
+    for (size_t i = 0; i < samples; i++) {
+        variance += (times[i] - mean) * (times[i] - mean);
+    }
+    variance /= samples > 1 ? (double)(samples - 1) : 1.0;
+
+    qsort(times, samples, sizeof(double), compare_doubles);
+    const double median = samples % 2 ? times[samples / 2] : (times[samples / 2 - 1] + times[samples / 2]) / 2.0;
+
+    return (bench_result) {
+        .name = scenario->name,
+        .operation = scenario->operation,
+        .median = median,
+        .stddev = sqrt(variance),
+        .iterations = scenario->operations * samples,
+        .samples = samples
+    };
+}
+
+static bool bench_write_json(const char* path, const bench_result* results, size_t count) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        cr_logf(CR_ERROR, "Failed to open '%s' for writing", path);
+        return false;
+    }
+
+    // One scenario per line, bench_read_baseline relies on it
+    fprintf(file, "{\n  \"version\": 1,\n  \"unit\": \"ns\",\n  \"scenarios\": [\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "    {\"name\": \"%s\", \"operation\": \"%s\", \"median\": %.3f, \"stddev\": %.3f, \"iterations\": %zu, \"samples\": %zu}%s\n",
+                results[i].name, results[i].operation, results[i].median, results[i].stddev,
+                results[i].iterations, results[i].samples, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    return !failed;
+}
+
+static size_t bench_read_baseline(const char* path, bench_baseline* baseline, size_t capacity) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        cr_logf(CR_ERROR, "Failed to open baseline '%s'", path);
+        return 0;
+    }
+
+    char line[512];
+    size_t count = 0;
+    while (count < capacity && fgets(line, sizeof(line), file)) {
+        const char* name = strstr(line, "\"name\": \"");
+        const char* median = strstr(line, "\"median\": ");
+        if (!name || !median) { continue; }
+
+        name += strlen("\"name\": \"");
+        const char* end = strchr(name, '"');
+        if (!end || (size_t)(end - name) >= BENCH_NAME_SIZE) { continue; }
+
+        memcpy(baseline[count].name, name, (size_t)(end - name));
+        baseline[count].name[end - name] = '\0';
+        baseline[count].median = strtod(median + strlen("\"median\": "), NULL);
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+static size_t bench_compare(const bench_result* results, size_t count, const bench_baseline* baseline, size_t baseline_count, double threshold, const char* filter) {
+    size_t failures = 0;
+
+    for (size_t j = 0; j < baseline_count; j++) {
+        if (filter && !strstr(baseline[j].name, filter)) { continue; }
+
+        const bench_result* result = NULL;
+        for (size_t i = 0; i < count && !result; i++) {
+            if (strcmp(results[i].name, baseline[j].name) == 0) { result = &results[i]; }
+        }
+
+        // A scenario that did not run would otherwise pass the comparison
+        if (!result) {
+            printf("  %-20s %9s MISSING\n", baseline[j].name, "");
+            failures++;
+            continue;
+        }
+        if (baseline[j].median <= 0.0) { continue; }
+
+        const double change = (result->median / baseline[j].median - 1.0) * 100.0;
+        const bool regressed = change > threshold;
+        printf("  %-20s %+8.2f%% %s\n", result->name, change, regressed ? "REGRESSION" : "");
+        if (regressed) { failures++; }
+    }
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    const char* output = "bench.json";
+    const char* baseline_path = NULL;
+    const char* filter = NULL;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    size_t samples = BENCH_DEFAULT_SAMPLES;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--output") == 0 && has_value) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && has_value) {
+            threshold = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--samples") == 0 && has_value) {
+            samples = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--output <file>] [--baseline <file>] [--threshold <percent>] [--samples <count>] [--filter <name>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (samples == 0 || samples > BENCH_MAX_SAMPLES) {
+        fprintf(stderr, "%s: samples must be between 1 and %d\n", argv[0], BENCH_MAX_SAMPLES);
+        return EXIT_FAILURE;
+    }
+
+    cr_log_setup(&(clog_conf) { .level = CR_WARNING });
+    cr_jobs_setup(&(cjob_conf) {0});
+    cr_event_queue_init(&cevents);
+    bench_gl.available = bench_gl_setup();
+
+    const size_t scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
+    bench_result results[sizeof(scenarios) / sizeof(scenarios[0])];
+    size_t result_count = 0;
+    size_t skipped = 0;
+
+    for (size_t i = 0; i < scenario_count; i++) {
+        const bench_scenario* scenario = &scenarios[i];
+        if (filter && !strstr(scenario->name, filter)) { continue; }
+        if (scenario->needs_gl && !bench_gl.available) {
+            printf("%-20s %12s    SKIPPED (no OpenGL context)\n", scenario->name, "");
+            skipped++;
+            continue;
+        }
+
+        results[result_count] = bench_run(scenario, samples);
+        printf("%-20s %12.1f ns/%-8s (stddev %.1f, %zu iterations)\n",
+               results[result_count].name, results[result_count].median, scenario->operation,
+               results[result_count].stddev, results[result_count].iterations);
+        fflush(stdout);
+        result_count++;
+    }
+
+    if (bench_gl.available) { bench_gl_shutdown(); }
+    cr_jobs_shutdown();
+
+    if (skipped > 0) {
+        cr_logf(CR_WARNING, "%zu scenarios were skipped, they are missing from %s", skipped, output);
+    }
+
+    int status = bench_write_json(output, results, result_count) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (baseline_path) {
+        bench_baseline baseline[sizeof(scenarios) / sizeof(scenarios[0])];
+        const size_t baseline_count = bench_read_baseline(baseline_path, baseline, scenario_count);
+
+        if (baseline_count > 0) {
+            printf("Compared to %s (threshold %.1f%%):\n", baseline_path, threshold);
+            const size_t failures = bench_compare(results, result_count, baseline, baseline_count, threshold, filter);
+            if (failures > 0) {
+                cr_logf(CR_ERROR, "%zu scenarios regressed by more than %.1f%% or did not run", failures, threshold);
+                status = EXIT_FAILURE;
+            }
+        } else {
+            // The baseline was asked for, comparing against nothing must not pass
+            cr_logf(CR_ERROR, "Failed to read any scenario from baseline '%s'", baseline_path);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    cr_log_shutdown();
+    return status;
+}
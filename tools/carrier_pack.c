@@ -0,0 +1,124 @@
+#define CARRIER_IMPLEMENTATION
+#include "../libs/carrier_asset.h"
+
+// Packs assets into a single archive readable by cr_asset_mount.
+// Usage: carrier-pack <output> <root> <name>...
+// Each name is stored as given and read from <root>/<name>.
+
+typedef struct {
+    const char* name;
+    uint64_t hash;
+    char* data;
+    size_t size;
+} pack_item;
+
+static char* load_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) { return NULL; }
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* buffer = length >= 0 ? (char*)malloc((size_t)length + 1) : NULL;
+    if (!buffer || fread(buffer, 1, (size_t)length, file) != (size_t)length) {
+        free(buffer);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *size = (size_t)length;
+    return buffer;
+}
+
+static int compare_items(const void* a, const void* b) {
+    const pack_item* lhs = (const pack_item*)a;
+    const pack_item* rhs = (const pack_item*)b;
+    if (lhs->hash != rhs->hash) { return lhs->hash < rhs->hash ? -1 : 1; }
+    return strcmp(lhs->name, rhs->name);
+}
+
+static uint64_t align_up(uint64_t value) {
+    return (value + CASSET_ALIGNMENT - 1) & ~(uint64_t)(CASSET_ALIGNMENT - 1);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <output> <root> <name>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* output = argv[1];
+    const char* root = argv[2];
+    const size_t count = (size_t)(argc - 3);
+
+    pack_item* items = (pack_item*)calloc(count > 0 ? count : 1, sizeof(pack_item));
+    if (!items) { return EXIT_FAILURE; }
+
+    for (size_t i = 0; i < count; i++) {
+        char path[CASSET_PATH_SIZE];
+        items[i].name = argv[i + 3];
+        items[i].hash = cr_asset_hash(items[i].name, strlen(items[i].name));
+        snprintf(path, sizeof(path), "%s/%s", root, items[i].name);
+
+        items[i].data = load_file(path, &items[i].size);
+        if (!items[i].data) {
+            fprintf(stderr, "%s: failed to read '%s'\n", argv[0], path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    qsort(items, count, sizeof(pack_item), compare_items);
+
+    // Lay out the index, the name blob and the aligned payloads
+    casset_entry* entries = (casset_entry*)calloc(count > 0 ? count : 1, sizeof(casset_entry));
+    if (!entries) { return EXIT_FAILURE; }
+
+    uint64_t offset = sizeof(casset_header) + count * sizeof(casset_entry);
+    for (size_t i = 0; i < count; i++) {
+        entries[i].hash = items[i].hash;
+        entries[i].name_offset = (uint32_t)offset;
+        entries[i].name_length = (uint32_t)strlen(items[i].name);
+        offset += entries[i].name_length;
+    }
+    for (size_t i = 0; i < count; i++) {
+        offset = align_up(offset);
+        entries[i].offset = offset;
+        entries[i].size = items[i].size;
+        offset += items[i].size + 1;
+    }
+
+    FILE* file = fopen(output, "wb");
+    if (!file) {
+        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], output);
+        return EXIT_FAILURE;
+    }
+
+    const casset_header header = { CASSET_MAGIC, CASSET_VERSION, (uint32_t)count, 0 };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries, sizeof(casset_entry), count, file);
+    for (size_t i = 0; i < count; i++) {
+        fwrite(items[i].name, 1, entries[i].name_length, file);
+    }
+
+    const char padding[CASSET_ALIGNMENT] = {0};
+    for (size_t i = 0; i < count; i++) {
+        const long position = ftell(file);
+        fwrite(padding, 1, (size_t)(entries[i].offset - (uint64_t)position), file);
+        fwrite(items[i].data, 1, items[i].size, file);
+        fwrite(padding, 1, 1, file);
+        free(items[i].data);
+    }
+
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    free(entries);
+    free(items);
+
+    if (failed) {
+        fprintf(stderr, "%s: failed to write '%s'\n", argv[0], output);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
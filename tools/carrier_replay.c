@@ -0,0 +1,562 @@
+#define CARRIER_IMPLEMENTATION
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "../libs/carrier_app.h"
+#include "../libs/carrier_gfx.h"
+
+// Replays a graphics capture written by cg_capture_frames headless and prints
+// the CPU submit time and GPU time of every captured frame.
+// Usage: carrier-replay <capture> [--loops <count>]
+// Everything recorded before the first frame runs once, the frames then run
+// in a loop. Each loop starts from the buffer contents of the capture, and
+// resources created inside the frames are only created on an extra warm-up
+// loop that is not measured.
+// The context is made through EGL without a surface, so no display is needed,
+// and the passes draw into an offscreen framebuffer of the captured size.
+
+#define REPLAY_DEFAULT_LOOPS 10
+#define REPLAY_MAX_LOOPS 1000
+
+// Command read back from the capture, data points into the file contents
+typedef struct {
+    cg_capture_op op;
+    uint32_t field_count;
+    uint64_t fields[CG_CAPTURE_MAX_FIELDS];
+    const unsigned char* data;
+    size_t size;
+} replay_command;
+
+// Kind of a recorded GL object
+typedef enum {
+    REPLAY_SHADER,
+    REPLAY_PROGRAM,
+    REPLAY_BUFFER,
+    REPLAY_BINDINGS,
+    REPLAY_STORAGE
+} replay_kind;
+
+// Recorded GL name and the object created for it while replaying
+typedef struct {
+    replay_kind kind;
+    uint64_t recorded;
+    GLuint name;
+    cg_bindings bindings;
+    cg_storage_buffer storage;
+} replay_object;
+
+// Global variable to hold the state of the replay
+static struct {
+    unsigned char* contents;
+    replay_command* commands;
+    size_t command_count, command_capacity;
+    replay_object* objects;
+    size_t object_count, object_capacity;
+    size_t first_frame;
+    size_t missing;
+    EGLDisplay display;
+    EGLContext context;
+    cg_image color, depth;
+    cg_framebuffer target;
+} replay;
+
+static uint64_t replay_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static int replay_compare(const void* a, const void* b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double replay_median(double* values, size_t count) {
+    qsort(values, count, sizeof(double), replay_compare);
+    return count % 2 ? values[count / 2] : 0.5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+// CAPTURE FILE
+// === === === === === ===
+// === === === === === ===
+
+static bool replay_read(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        cr_logf(CR_ERROR, "Failed to open capture '%s'", path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    replay.contents = length > 0 ? (unsigned char*)cr_alloc((size_t)length) : NULL;
+    const bool read = replay.contents && fread(replay.contents, 1, (size_t)length, file) == (size_t)length;
+    fclose(file);
+
+    uint32_t header[2] = { 0, 0 };
+    if (read && length >= (long)sizeof(header)) { memcpy(header, replay.contents, sizeof(header)); }
+    if (header[0] != CG_CAPTURE_MAGIC || header[1] != CG_CAPTURE_VERSION) {
+        cr_logf(CR_ERROR, "Failed to read capture '%s': not a version %d capture", path, CG_CAPTURE_VERSION);
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    replay.first_frame = SIZE_MAX;
+    while (offset < (size_t)length) {
+        replay_command command = { 0 };
+        uint32_t op;
+        uint64_t size;
+        if ((size_t)length - offset < 16) { break; }
+        memcpy(&op, replay.contents + offset, 4);
+        memcpy(&command.field_count, replay.contents + offset + 4, 4);
+        memcpy(&size, replay.contents + offset + 8, 8);
+        offset += 16;
+
+        // The size comes straight from the file, compare against what is left
+        // so a corrupt one cannot wrap the sum past the bounds check
+        if (command.field_count > CG_CAPTURE_MAX_FIELDS) { break; }
+        const size_t fields_size = command.field_count * sizeof(uint64_t);
+        if ((size_t)length - offset < fields_size || size > (size_t)length - offset - fields_size) { break; }
+        memcpy(command.fields, replay.contents + offset, fields_size);
+        offset += fields_size;
+
+        command.op = (cg_capture_op)op;
+        command.data = replay.contents + offset;
+        command.size = (size_t)size;
+        offset += (size_t)size;
+
+        if (command.op == CG_CAPTURE_FRAME_START && replay.first_frame == SIZE_MAX) {
+            replay.first_frame = replay.command_count;
+        }
+        replay_command* commands = (replay_command*)grow_array(replay.commands, &replay.command_capacity, replay.command_count, sizeof(replay_command));
+        if (!commands) {
+            cr_logf(CR_ERROR, "Failed to read capture '%s': out of memory", path);
+            return false;
+        }
+        replay.commands = commands;
+        replay.commands[replay.command_count++] = command;
+    }
+
+    if (offset < (size_t)length) {
+        cr_logf(CR_WARNING, "Capture '%s' is truncated, replaying the complete commands", path);
+    }
+    if (replay.first_frame == SIZE_MAX) {
+        cr_logf(CR_ERROR, "Failed to read capture '%s': no captured frames", path);
+        return false;
+    }
+    return true;
+}
+
+// OBJECTS
+// === === === === === ===
+// === === === === === ===
+
+static replay_object* replay_find(replay_kind kind, uint64_t recorded) {
+    // Newest first, GL reuses the names of deleted objects
+    for (size_t i = replay.object_count; i > 0; i--) {
+        replay_object* object = &replay.objects[i - 1];
+        if (object->kind == kind && object->recorded == recorded) { return object; }
+    }
+    if (recorded != 0) { replay.missing++; }
+    return NULL;
+}
+
+static replay_object* replay_add(replay_kind kind, uint64_t recorded) {
+    replay.objects = (replay_object*)grow_array(replay.objects, &replay.object_capacity, replay.object_count, sizeof(replay_object));
+    replay_object* object = &replay.objects[replay.object_count++];
+    *object = (replay_object){ .kind = kind, .recorded = recorded };
+    return object;
+}
+
+static void replay_check_shader(GLuint shader) {
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetShaderInfoLog(shader, 512, NULL, info_log);
+        cr_log(CR_ERROR, info_log);
+    }
+}
+
+// CONTEXT
+// === === === === === ===
+// === === === === === ===
+
+static bool replay_create_context(void) {
+    // The surfaceless platform needs neither a display server nor a window,
+    // drivers without it fall back to the default display
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    replay.display = get_platform_display ? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+    if (replay.display == EGL_NO_DISPLAY) { replay.display = eglGetDisplay(EGL_DEFAULT_DISPLAY); }
+
+    if (replay.display == EGL_NO_DISPLAY || !eglInitialize(replay.display, NULL, NULL)) {
+        cr_log(CR_ERROR, "Failed to initialize EGL");
+        return false;
+    }
+
+    const char* extensions = eglQueryString(replay.display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context") || !strstr(extensions, "EGL_KHR_no_config_context")) {
+        cr_log(CR_ERROR, "Failed to create EGL context: surfaceless contexts not supported");
+        return false;
+    }
+
+    const EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 6,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    if (!eglBindAPI(EGL_OPENGL_API) ||
+        (replay.context = eglCreateContext(replay.display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes)) == EGL_NO_CONTEXT) {
+        cr_logf(CR_ERROR, "Failed to create EGL context: OpenGL 4.6 core not supported (0x%x)", (unsigned)eglGetError());
+        return false;
+    }
+
+    if (!eglMakeCurrent(replay.display, EGL_NO_SURFACE, EGL_NO_SURFACE, replay.context)) {
+        cr_log(CR_ERROR, "Failed to make EGL context current");
+        return false;
+    }
+    return true;
+}
+
+static void replay_destroy_context(void) {
+    if (replay.display == EGL_NO_DISPLAY) { return; }
+
+    eglMakeCurrent(replay.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (replay.context != EGL_NO_CONTEXT) { eglDestroyContext(replay.display, replay.context); }
+    eglTerminate(replay.display);
+}
+
+static bool replay_create_target(int width, int height) {
+    replay.color = cg_make_image(&(cg_image_conf) {
+        .width = width, .height = height, .format = CG_PIXELFORMAT_RGBA8, .render_target = true
+    });
+    replay.depth = cg_make_image(&(cg_image_conf) {
+        .width = width, .height = height, .format = CG_PIXELFORMAT_DEPTH24_STENCIL8, .render_target = true
+    });
+    if (!replay.color.texture || !replay.depth.texture) { return false; }
+
+    replay.target = cg_make_framebuffer(&(cg_framebuffer_conf) { .colors = { &replay.color }, .depth = &replay.depth });
+    return replay.target.framebuffer != 0;
+}
+
+// COMMANDS
+// === === === === === ===
+// === === === === === ===
+
+static void replay_execute(const replay_command* command, bool create) {
+    const uint64_t* fields = command->fields;
+    replay_object* object;
+
+    switch (command->op) {
+        case CG_CAPTURE_SHADER_SOURCE:
+            if (create) {
+                const char* source = (const char*)command->data;
+                const GLint length = (GLint)command->size;
+                object = replay_add(REPLAY_SHADER, fields[0]);
+                object->name = glCreateShader((GLenum)fields[1]);
+                glShaderSource(object->name, 1, &source, &length);
+                glCompileShader(object->name);
+                replay_check_shader(object->name);
+            }
+            break;
+        case CG_CAPTURE_SHADER_BINARY:
+            if (create) {
+                object = replay_add(REPLAY_SHADER, fields[0]);
+                object->name = glCreateShader((GLenum)fields[1]);
+                glShaderBinary(1, &object->name, GL_SHADER_BINARY_FORMAT_SPIR_V, command->data, (GLsizei)command->size);
+                glSpecializeShader(object->name, "main", 0, NULL, NULL);
+                replay_check_shader(object->name);
+            }
+            break;
+        case CG_CAPTURE_PROGRAM:
+            if (create) {
+                const GLuint program = glCreateProgram();
+                for (uint32_t i = 1; i < command->field_count; i++) {
+                    object = replay_find(REPLAY_SHADER, fields[i]);
+                    if (object) { glAttachShader(program, object->name); }
+                }
+                glLinkProgram(program);
+                for (uint32_t i = 1; i < command->field_count; i++) {
+                    object = replay_find(REPLAY_SHADER, fields[i]);
+                    if (object) { glDeleteShader(object->name); object->recorded = 0; }
+                }
+                replay_add(REPLAY_PROGRAM, fields[0])->name = program;
+            }
+            break;
+        case CG_CAPTURE_BUFFER:
+            if (create) {
+                const size_t vertex_size = (size_t)fields[3];
+                const cg_bindings bindings = cg_make_buffer(&(cg_buffer_conf) {
+                    .vertex_buffer = { .size = vertex_size, .data = fields[5] ? command->data : NULL },
+                    .index_buffer = { .size = (size_t)fields[4], .data = fields[6] ? command->data + (fields[5] ? vertex_size : 0) : NULL }
+                });
+                replay_add(REPLAY_BINDINGS, fields[0])->bindings = bindings;
+                replay_add(REPLAY_BUFFER, fields[1])->name = bindings.vbo;
+                if (fields[2]) { replay_add(REPLAY_BUFFER, fields[2])->name = bindings.ebo; }
+            }
+            break;
+        case CG_CAPTURE_STORAGE:
+            if (create) {
+                const cg_storage_buffer storage = cg_make_storage_buffer(&(cg_storage_conf) {
+                    .size = (size_t)fields[1], .persistent = fields[2] != 0, .data = fields[3] ? command->data : NULL
+                });
+                replay_add(REPLAY_STORAGE, fields[0])->storage = storage;
+                replay_add(REPLAY_BUFFER, fields[0])->name = storage.buffer;
+            }
+            break;
+        case CG_CAPTURE_DESTROY_PROGRAM:
+            // Destroying inside the frames would break the next loop
+            if (create && (object = replay_find(REPLAY_PROGRAM, fields[0]))) {
+                glDeleteProgram(object->name);
+                object->recorded = 0;
+            }
+            break;
+        case CG_CAPTURE_DESTROY_BUFFER:
+            if (create && (object = replay_find(REPLAY_BINDINGS, fields[0]))) {
+                cg_destroy_buffer(object->bindings);
+                object->recorded = 0;
+            }
+            break;
+        case CG_CAPTURE_DESTROY_STORAGE:
+            if (create && (object = replay_find(REPLAY_STORAGE, fields[0]))) {
+                cg_destroy_storage_buffer(object->storage);
+                object->recorded = 0;
+            }
+            break;
+        case CG_CAPTURE_UPDATE_BUFFER:
+            if ((object = replay_find(REPLAY_BUFFER, fields[0]))) {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, object->name);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)fields[1], (GLsizeiptr)command->size, command->data);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+            break;
+        case CG_CAPTURE_BEGIN_PASS: {
+            cg_pass_action action;
+            memcpy(&action, command->data, sizeof(action));
+            cg_begin_framebuffer_pass(&replay.target, &action);
+            break;
+        }
+        case CG_CAPTURE_END_PASS:
+            cg_end_pass();
+            break;
+        case CG_CAPTURE_APPLY_PIPELINE:
+            if ((object = replay_find(REPLAY_PROGRAM, fields[0]))) {
+                cg_pipeline pipeline = { .shader = { object->name }, .primitive_type = (GLenum)fields[1] };
+                cg_apply_pipeline(&pipeline);
+            }
+            break;
+        case CG_CAPTURE_APPLY_BINDINGS:
+            if ((object = replay_find(REPLAY_BINDINGS, fields[0]))) { cg_apply_bindings(&object->bindings); }
+            break;
+        case CG_CAPTURE_APPLY_STORAGE:
+            if ((object = replay_find(REPLAY_STORAGE, fields[1]))) { cg_apply_storage_buffer((GLuint)fields[0], &object->storage); }
+            break;
+        case CG_CAPTURE_APPLY_COMPUTE:
+            if ((object = replay_find(REPLAY_PROGRAM, fields[0]))) {
+                cg_compute_pipeline pipeline = { .shader = { object->name } };
+                for (uint32_t i = 1; i < command->field_count && i <= CG_MAX_STORAGE_BINDINGS; i++) {
+                    replay_object* storage = fields[i] ? replay_find(REPLAY_STORAGE, fields[i]) : NULL;
+                    if (storage) { pipeline.storage[i - 1] = storage->storage; }
+                }
+                cg_apply_compute_pipeline(&pipeline);
+            }
+            break;
+        case CG_CAPTURE_DISPATCH:
+            cg_dispatch((GLuint)fields[0], (GLuint)fields[1], (GLuint)fields[2]);
+            break;
+        case CG_CAPTURE_DISPATCH_INDIRECT:
+            if ((object = replay_find(REPLAY_STORAGE, fields[0]))) { cg_dispatch_indirect(&object->storage, (size_t)fields[1]); }
+            break;
+        case CG_CAPTURE_BARRIER:
+            cg_barrier((int)fields[0]);
+            break;
+        case CG_CAPTURE_RENDER:
+            if ((object = replay_find(REPLAY_BINDINGS, fields[0]))) {
+                cg_render(&object->bindings, (int)fields[1], (int)fields[2], (int)fields[3]);
+            }
+            break;
+        case CG_CAPTURE_DRAW_INDIRECT: {
+            replay_object* arguments = replay_find(REPLAY_STORAGE, fields[1]);
+            if ((object = replay_find(REPLAY_BINDINGS, fields[0])) && arguments) {
+                cg_draw_indirect(&object->bindings, &arguments->storage, (size_t)fields[2]);
+            }
+            break;
+        }
+        case CG_CAPTURE_MULTI_DRAW_INDIRECT: {
+            replay_object* arguments = replay_find(REPLAY_STORAGE, fields[1]);
+            if ((object = replay_find(REPLAY_BINDINGS, fields[0])) && arguments) {
+                cg_multi_draw_indirect(&object->bindings, &arguments->storage, (size_t)fields[2], (int)fields[3]);
+            }
+            break;
+        }
+        case CG_CAPTURE_UNIFORM_MAT4: {
+            GLfloat value[16];
+            memcpy(value, command->data, sizeof(value));
+            cg_set_uniform_mat4((cg_uniform)fields[0], value);
+            break;
+        }
+        case CG_CAPTURE_UNIFORM_VEC4: {
+            GLfloat value[4];
+            memcpy(value, command->data, sizeof(value));
+            cg_set_uniform_vec4((cg_uniform)fields[0], value);
+            break;
+        }
+        case CG_CAPTURE_UNIFORM_VEC2: {
+            GLfloat value[2];
+            memcpy(value, command->data, sizeof(value));
+            cg_set_uniform_vec2((cg_uniform)fields[0], value);
+            break;
+        }
+        case CG_CAPTURE_UNIFORM_FLOAT: {
+            GLfloat value;
+            memcpy(&value, command->data, sizeof(value));
+            cg_set_uniform_float((cg_uniform)fields[0], value);
+            break;
+        }
+        case CG_CAPTURE_UNIFORM_INT:
+            cg_set_uniform_int((cg_uniform)fields[0], (GLint)fields[1]);
+            break;
+        case CG_CAPTURE_UNIFORM_UINT:
+            cg_set_uniform_uint((cg_uniform)fields[0], (GLuint)fields[1]);
+            break;
+        case CG_CAPTURE_WIREFRAME:
+            cg_set_wireframe(fields[0] != 0);
+            break;
+        case CG_CAPTURE_DEPTH_TEST:
+            cg_set_depth_test(fields[0] != 0);
+            break;
+        case CG_CAPTURE_BLEND:
+            cg_set_blend(fields[0] != 0);
+            break;
+        default:
+            break;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = NULL;
+    size_t loops = REPLAY_DEFAULT_LOOPS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = strtoul(argv[++i], NULL, 10);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+
+    if (!path) {
+        fprintf(stderr, "usage: %s <capture> [--loops <count>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (loops == 0 || loops > REPLAY_MAX_LOOPS) {
+        fprintf(stderr, "%s: loops must be between 1 and %d\n", argv[0], REPLAY_MAX_LOOPS);
+        return EXIT_FAILURE;
+    }
+
+    cr_log_setup(&(clog_conf) { .level = CR_WARNING });
+    if (!replay_read(path)) { return EXIT_FAILURE; }
+
+    const replay_command* setup = &replay.commands[0];
+    const replay_command* start = &replay.commands[replay.first_frame];
+    const bool depth_test = setup->op == CG_CAPTURE_SETUP && setup->fields[0];
+    const bool blend = setup->op == CG_CAPTURE_SETUP && setup->fields[1];
+
+    replay.display = EGL_NO_DISPLAY;
+    replay.context = EGL_NO_CONTEXT;
+    if (!replay_create_context()) {
+        replay_destroy_context();
+        return EXIT_FAILURE;
+    }
+
+    cg_setup(&(cg_conf) { .depth_test = depth_test, .blend = blend, .offscreen = true });
+    if (!replay_create_target((int)start->fields[0], (int)start->fields[1])) {
+        cr_log(CR_ERROR, "Failed to create the offscreen framebuffer");
+        cg_shutdown();
+        replay_destroy_context();
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < replay.first_frame; i++) {
+        replay_execute(&replay.commands[i], true);
+    }
+
+    size_t frame_count = 0;
+    for (size_t i = replay.first_frame; i < replay.command_count; i++) {
+        if (replay.commands[i].op == CG_CAPTURE_COMMIT) { frame_count++; }
+    }
+
+    double* cpu = (double*)cr_calloc(frame_count * loops + 1, sizeof(double));
+    double* gpu = (double*)cr_calloc(frame_count * loops + 1, sizeof(double));
+    GLuint query;
+    glGenQueries(1, &query);
+
+    for (size_t loop = 0; loop <= loops; loop++) {
+        // Start every loop from the buffer contents the capture opened with
+        if (loop > 0) {
+            for (size_t i = 0; i < replay.first_frame; i++) {
+                if (replay.commands[i].op == CG_CAPTURE_UPDATE_BUFFER) { replay_execute(&replay.commands[i], false); }
+            }
+        }
+
+        size_t frame = 0;
+        size_t i = replay.first_frame + 1;
+        while (frame < frame_count) {
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            const uint64_t begin = replay_now();
+            for (; replay.commands[i].op != CG_CAPTURE_COMMIT; i++) {
+                replay_execute(&replay.commands[i], loop == 0);
+            }
+            const uint64_t end = replay_now();
+            glEndQuery(GL_TIME_ELAPSED);
+            cg_commit();
+
+            // Waiting on the query serializes the frames, the GPU time of one frame is not hidden by the next
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if (loop > 0) {
+                cpu[frame * loops + loop - 1] = (double)(end - begin) / 1e6;
+                gpu[frame * loops + loop - 1] = (double)elapsed / 1e6;
+            }
+            frame++;
+            i++;
+        }
+    }
+
+    double cpu_total = 0.0, gpu_total = 0.0;
+    for (size_t frame = 0; frame < frame_count; frame++) {
+        const double cpu_median = replay_median(&cpu[frame * loops], loops);
+        const double gpu_median = replay_median(&gpu[frame * loops], loops);
+        printf("frame %-4zu cpu %8.3f ms   gpu %8.3f ms\n", frame, cpu_median, gpu_median);
+        cpu_total += cpu_median;
+        gpu_total += gpu_median;
+    }
+    if (frame_count > 0) {
+        printf("%zu frames, %zu loops, mean cpu %.3f ms, mean gpu %.3f ms\n", frame_count, loops,
+               cpu_total / (double)frame_count, gpu_total / (double)frame_count);
+    }
+    if (replay.missing > 0) {
+        cr_logf(CR_WARNING, "%zu commands referenced objects missing from the capture", replay.missing);
+    }
+
+    glDeleteQueries(1, &query);
+    for (size_t i = 0; i < replay.object_count; i++) {
+        if (replay.objects[i].kind == REPLAY_PROGRAM && replay.objects[i].recorded) { glDeleteProgram(replay.objects[i].name); }
+    }
+    cr_free(cpu);
+    cr_free(gpu);
+    cr_free(replay.objects);
+    cr_free(replay.commands);
+    cr_free(replay.contents);
+
+    cg_shutdown();
+    replay_destroy_context();
+    cr_log_shutdown();
+    return EXIT_SUCCESS;
+}